@@ -0,0 +1,88 @@
+#define CL_HPP_ENABLE_EXCEPTIONS
+#define CL_HPP_TARGET_OPENCL_VERSION 300
+
+#include <CL/opencl.hpp>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Compares the host time spent per launch by cl::KernelFunctor and
+// cl::KernelLaunchCache for a kernel whose scalar argument changes on every
+// launch. On devices without cl_khr_command_buffer_mutable_dispatch both
+// take the same path.
+
+const int numElements = 1024;
+const int numLaunches = 10000;
+
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+template <typename Functor>
+double timeLaunches(Functor& functor, cl::CommandQueue& queue, cl::Buffer& buffer)
+{
+    cl::EnqueueArgs args(queue, cl::NDRange(numElements));
+
+    // Warm up, so that the cache has recorded its command buffer
+    functor.enqueue(args, buffer, 0);
+    queue.finish();
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numLaunches; ++i) {
+        functor.enqueue(args, buffer, i);
+    }
+    auto end = std::chrono::steady_clock::now();
+    queue.finish();
+
+    return std::chrono::duration<double, std::micro>(end - start).count() / numLaunches;
+}
+#endif
+
+int main(void)
+{
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+    std::string kernelSource{R"CLC(
+        kernel void addValue(global int *data, int val)
+        {
+          data[get_global_id(0)] += val;
+        }
+    )CLC"};
+
+    cl::Program program(kernelSource);
+    try {
+        program.build();
+    }
+    catch (...) {
+        cl_int buildErr = CL_SUCCESS;
+        auto buildInfo = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(&buildErr);
+        for (auto &pair : buildInfo) {
+            std::cerr << pair.second << std::endl << std::endl;
+        }
+
+        return 1;
+    }
+
+    cl::Device device = cl::Device::getDefault();
+    std::string extensions = device.getInfo<CL_DEVICE_EXTENSIONS>();
+    if (extensions.find("cl_khr_command_buffer_mutable_dispatch") == std::string::npos) {
+        std::cout << "Device does not support cl_khr_command_buffer_mutable_dispatch, "
+                     "the launch cache falls back to regular launches.\n";
+    }
+
+    cl::CommandQueue queue = cl::CommandQueue::getDefault();
+    std::vector<int> data(numElements, 0);
+    cl::Buffer buffer(queue, data.begin(), data.end(), false);
+
+    cl::KernelFunctor<cl::Buffer, int> functor(program, "addValue");
+    cl::KernelLaunchCache<cl::Buffer, int> cache(program, "addValue");
+
+    double functorTime = timeLaunches(functor, queue, buffer);
+    double cacheTime = timeLaunches(cache, queue, buffer);
+
+    std::cout << "Host time per launch over " << numLaunches << " launches:\n";
+    std::cout << "\tKernelFunctor:     " << functorTime << " us\n";
+    std::cout << "\tKernelLaunchCache: " << cacheTime << " us\n";
+
+    return 0;
+#else
+    std::cout << "The OpenCL headers do not declare cl_khr_command_buffer_mutable_dispatch.\n";
+    return 0;
+#endif
+}
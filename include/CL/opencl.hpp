@@ -206,6 +206,38 @@
  *
  *   Enable the cl_khr_il_program extension.
  *
+ * - CL_HPP_ENABLE_PROGRAM_BINARY_CACHE
+ *
+ *   Enable cl::ProgramBinaryCache, a persistent on-disk cache of program
+ *   binaries that lets applications skip recompiling OpenCL C sources
+ *   across process runs.
+ *
+ * - CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE
+ *
+ *   Make the functions and cl::EnqueueArgs constructors that take no
+ *   queue use the queue of the calling thread, see
+ *   cl::CommandQueue::getThreadDefault(), instead of the process-wide
+ *   default queue. Commands enqueued this way from different threads are
+ *   not ordered with respect to each other. A cl::EnqueueArgs keeps a
+ *   reference to the queue of the thread that constructed it.
+ *
+ * - CL_HPP_ENABLE_HOST_REFERENCE_COUNT
+ *
+ *   Copies of a wrapper object share the OpenCL reference of the object
+ *   they were copied from, counted on the host, instead of calling
+ *   clRetain and clRelease for every copy. Devices, semaphores and command
+ *   buffers keep using the OpenCL reference count. The reference count
+ *   reported by the OpenCL implementation no longer matches the number of
+ *   wrappers.
+ *
+ * - CL_HPP_ENABLE_FILE_BUFFER
+ *
+ *   Enable cl::Buffer::createFromFile(), which memory-maps a file and
+ *   creates a buffer over the mapping on devices that share memory with
+ *   the host. Requires OpenCL 1.1 or newer. On Windows this includes
+ *   <windows.h>, so define NOMINMAX before including this header to keep
+ *   the min and max macros from breaking std::min and std::max.
+ *
  *
  * \section example Example
  *
@@ -568,6 +600,13 @@
 #include <mutex>
 #include <cstring>
 #include <functional>
+#include <atomic>
+#include <future>
+#include <map>
+#include <thread>
+#include <initializer_list>
+#include <algorithm>
+#include <memory>
 
 
 // Define a size_type to represent a correctly resolved size_t
@@ -586,6 +625,25 @@ namespace cl {
 #include <exception>
 #endif // #if defined(CL_HPP_ENABLE_EXCEPTIONS)
 
+#if defined(CL_HPP_ENABLE_PROGRAM_BINARY_CACHE)
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sys/stat.h>
+#endif // #if defined(CL_HPP_ENABLE_PROGRAM_BINARY_CACHE)
+
+#if defined(CL_HPP_ENABLE_FILE_BUFFER)
+#if defined(_WIN32)
+#include <windows.h>
+#else // #if defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #if defined(_WIN32)
+#endif // #if defined(CL_HPP_ENABLE_FILE_BUFFER)
+
 #if !defined(CL_HPP_NO_STD_VECTOR)
 #include <vector>
 namespace cl {
@@ -604,7 +662,6 @@ namespace cl {
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
 #if !defined(CL_HPP_NO_STD_UNIQUE_PTR)
-#include <memory>
 namespace cl {
     // Replace unique_ptr and allocate_pointer for internal use
     // to allow user to replace them
@@ -714,6 +771,28 @@ namespace cl {
             clGetExtensionFunctionAddressForPlatform(platform, #name);  \
     }
 
+#define CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, name)            \
+    pfn_##name = (PFN_##name)                                           \
+        CL_HPP_GET_EXT_FCN_ADDRESS_(platform, #name)
+
+// Entry point to call for an object without a platform table
+#define CL_HPP_FALLBACK_EXT_FCN_(name)                                  \
+    (cl::pfn_##name != nullptr ? cl::pfn_##name :                       \
+        cl::detail::ExtensionDispatch::fallback()->pfn_##name)
+
+// Entry point to call for an object whose platform table may be unknown
+#define CL_HPP_EXT_FCN_(dispatch, name)                                 \
+    ((dispatch) != nullptr ? (dispatch)->pfn_##name :                   \
+        CL_HPP_FALLBACK_EXT_FCN_(name))
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+#define CL_HPP_GET_EXT_FCN_ADDRESS_(platform, name)                     \
+    clGetExtensionFunctionAddressForPlatform(platform, name)
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 120
+#define CL_HPP_GET_EXT_FCN_ADDRESS_(platform, name)                     \
+    ((void) platform, clGetExtensionFunctionAddress(name))
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 120
+
 #ifdef cl_khr_external_memory
     enum class ExternalMemoryType : cl_external_memory_handle_type_khr;
 #endif
@@ -727,6 +806,7 @@ namespace cl {
     class DeviceCommandQueue;
     class Memory;
     class Buffer;
+    class StagingRing;
     class Pipe;
 #ifdef cl_khr_semaphore
     class Semaphore;
@@ -858,6 +938,9 @@ static inline cl_int errHandler (cl_int err, const char * errStr = nullptr)
 #define __SET_USER_EVENT_STATUS_ERR         CL_HPP_ERR_STR_(clSetUserEventStatus)
 #define __SET_EVENT_CALLBACK_ERR            CL_HPP_ERR_STR_(clSetEventCallback)
 #define __WAIT_FOR_EVENTS_ERR               CL_HPP_ERR_STR_(clWaitForEvents)
+#define __EVENT_LIST_FULL_ERR               CL_HPP_ERR_STR_(cl::EventList::push_back)
+#define __TASK_GRAPH_ADD_ERR                CL_HPP_ERR_STR_(cl::TaskGraph::addCommand)
+#define __TASK_GRAPH_SUBMIT_ERR             CL_HPP_ERR_STR_(cl::TaskGraph::submit)
 
 #define __CREATE_KERNEL_ERR                 CL_HPP_ERR_STR_(clCreateKernel)
 #define __SET_KERNEL_ARGS_ERR               CL_HPP_ERR_STR_(clSetKernelArg)
@@ -1089,6 +1172,227 @@ CL_HPP_DEFINE_STATIC_MEMBER_ PFN_clGetMutableCommandInfoKHR pfn_clGetMutableComm
 
 namespace detail {
 
+/*! \brief Extension entry points of one platform.
+ *
+ *  The addresses returned by clGetExtensionFunctionAddressForPlatform are
+ *  only valid for objects of that platform, so every platform gets a table
+ *  of its own. A table is resolved once, when its platform is discovered by
+ *  Platform::get or first reached from an object, and is kept until the
+ *  process exits. Objects created through an extension hold on to the table
+ *  of their platform and call through it.
+ *
+ *  Handles adopted without a platform call the cl::pfn_ pointer when the
+ *  application has set it, and otherwise the entry point of the first table
+ *  resolved. The library never writes the cl::pfn_ pointers itself, so they
+ *  can be read without a lock.
+ *
+ *  When Platform::get finds a single platform, every object belongs to it
+ *  and its table is returned without querying the object. Otherwise the
+ *  platform is looked up through clGet*Info. The result is not cached per
+ *  handle, since a released handle may be reused by another platform.
+ */
+class ExtensionDispatch
+{
+public:
+#ifdef cl_khr_external_memory
+    PFN_clEnqueueAcquireExternalMemObjectsKHR pfn_clEnqueueAcquireExternalMemObjectsKHR;
+    PFN_clEnqueueReleaseExternalMemObjectsKHR pfn_clEnqueueReleaseExternalMemObjectsKHR;
+#endif // cl_khr_external_memory
+
+#ifdef cl_khr_semaphore
+    PFN_clCreateSemaphoreWithPropertiesKHR pfn_clCreateSemaphoreWithPropertiesKHR;
+    PFN_clReleaseSemaphoreKHR              pfn_clReleaseSemaphoreKHR;
+    PFN_clRetainSemaphoreKHR               pfn_clRetainSemaphoreKHR;
+    PFN_clEnqueueWaitSemaphoresKHR         pfn_clEnqueueWaitSemaphoresKHR;
+    PFN_clEnqueueSignalSemaphoresKHR       pfn_clEnqueueSignalSemaphoresKHR;
+    PFN_clGetSemaphoreInfoKHR              pfn_clGetSemaphoreInfoKHR;
+#endif // cl_khr_semaphore
+
+#ifdef cl_khr_external_semaphore
+    PFN_clGetSemaphoreHandleForTypeKHR     pfn_clGetSemaphoreHandleForTypeKHR;
+#endif // cl_khr_external_semaphore
+
+#if defined(cl_khr_command_buffer)
+    PFN_clCreateCommandBufferKHR        pfn_clCreateCommandBufferKHR;
+    PFN_clFinalizeCommandBufferKHR      pfn_clFinalizeCommandBufferKHR;
+    PFN_clRetainCommandBufferKHR        pfn_clRetainCommandBufferKHR;
+    PFN_clReleaseCommandBufferKHR       pfn_clReleaseCommandBufferKHR;
+    PFN_clGetCommandBufferInfoKHR       pfn_clGetCommandBufferInfoKHR;
+    PFN_clEnqueueCommandBufferKHR       pfn_clEnqueueCommandBufferKHR;
+    PFN_clCommandBarrierWithWaitListKHR pfn_clCommandBarrierWithWaitListKHR;
+    PFN_clCommandCopyBufferKHR          pfn_clCommandCopyBufferKHR;
+    PFN_clCommandCopyBufferRectKHR      pfn_clCommandCopyBufferRectKHR;
+    PFN_clCommandCopyBufferToImageKHR   pfn_clCommandCopyBufferToImageKHR;
+    PFN_clCommandCopyImageKHR           pfn_clCommandCopyImageKHR;
+    PFN_clCommandCopyImageToBufferKHR   pfn_clCommandCopyImageToBufferKHR;
+    PFN_clCommandFillBufferKHR          pfn_clCommandFillBufferKHR;
+    PFN_clCommandFillImageKHR           pfn_clCommandFillImageKHR;
+    PFN_clCommandNDRangeKernelKHR       pfn_clCommandNDRangeKernelKHR;
+#endif /* cl_khr_command_buffer */
+
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+    PFN_clUpdateMutableCommandsKHR      pfn_clUpdateMutableCommandsKHR;
+    PFN_clGetMutableCommandInfoKHR      pfn_clGetMutableCommandInfoKHR;
+#endif /* cl_khr_command_buffer_mutable_dispatch */
+
+    //! \brief Returns the table of platform, resolving it on first use.
+    static const ExtensionDispatch* get(cl_platform_id platform)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_ptr<ExtensionDispatch>& table = tables_[platform];
+        if (!table) {
+            table.reset(new ExtensionDispatch(platform));
+            if (first_.load(std::memory_order_relaxed) == nullptr) {
+                first_.store(table.get(), std::memory_order_release);
+            }
+        }
+        return table.get();
+    }
+
+    /*! \brief Resolves the tables of all platforms of the process.
+     *
+     *  Called by Platform::get with the complete list of platforms. With a
+     *  single platform its table is used for every object from then on.
+     */
+    static void discover(const vector<cl_platform_id>& platforms)
+    {
+        const ExtensionDispatch* table = nullptr;
+        for (cl_platform_id platform : platforms) {
+            table = get(platform);
+        }
+        sole_.store(platforms.size() == 1 ? table : nullptr, std::memory_order_release);
+    }
+
+    //! \brief Returns the first table resolved, or an empty one.
+    static const ExtensionDispatch* fallback()
+    {
+        static const ExtensionDispatch empty{};
+        const ExtensionDispatch* table = first_.load(std::memory_order_acquire);
+        return table != nullptr ? table : &empty;
+    }
+
+    //! \brief Returns the table of the platform of device, or nullptr.
+    static const ExtensionDispatch* getForDevice(cl_device_id device)
+    {
+        if (const ExtensionDispatch* sole = sole_.load(std::memory_order_acquire)) {
+            return sole;
+        }
+        cl_platform_id platform = nullptr;
+        if (::clGetDeviceInfo(device, CL_DEVICE_PLATFORM, sizeof(platform), &platform, nullptr) != CL_SUCCESS) {
+            return nullptr;
+        }
+        return get(platform);
+    }
+
+    //! \brief Returns the table of the platform of queue, or nullptr.
+    static const ExtensionDispatch* getForQueue(cl_command_queue queue)
+    {
+        if (const ExtensionDispatch* sole = sole_.load(std::memory_order_acquire)) {
+            return sole;
+        }
+        cl_device_id device = nullptr;
+        if (::clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(device), &device, nullptr) != CL_SUCCESS) {
+            return nullptr;
+        }
+        return getForDevice(device);
+    }
+
+    //! \brief Returns the table of the platform of context, or nullptr.
+    static const ExtensionDispatch* getForContext(cl_context context)
+    {
+        if (const ExtensionDispatch* sole = sole_.load(std::memory_order_acquire)) {
+            return sole;
+        }
+        size_type size = 0;
+        if (::clGetContextInfo(context, CL_CONTEXT_DEVICES, 0, nullptr, &size) != CL_SUCCESS
+            || size == 0) {
+            return nullptr;
+        }
+        vector<cl_device_id> devices(size / sizeof(cl_device_id));
+        if (::clGetContextInfo(context, CL_CONTEXT_DEVICES, size, devices.data(), nullptr) != CL_SUCCESS) {
+            return nullptr;
+        }
+        return getForDevice(devices[0]);
+    }
+
+#ifdef CL_HPP_UNIT_TEST_ENABLE
+    /*! \brief Forget all resolved tables.
+     *
+     * This supports cleanup in the unit test framework, where the same
+     * platform handle is reused with different entry points.
+     */
+    static void unitTestClear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_.store(nullptr);
+        sole_.store(nullptr);
+        tables_.clear();
+    }
+#endif // #ifdef CL_HPP_UNIT_TEST_ENABLE
+
+private:
+    static std::mutex mutex_;
+    static std::map<cl_platform_id, std::unique_ptr<ExtensionDispatch>> tables_;
+    static std::atomic<const ExtensionDispatch*> first_;
+    static std::atomic<const ExtensionDispatch*> sole_;
+
+    ExtensionDispatch() = default;
+
+    explicit ExtensionDispatch(cl_platform_id platform)
+    {
+        (void) platform;
+#ifdef cl_khr_external_memory
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clEnqueueAcquireExternalMemObjectsKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clEnqueueReleaseExternalMemObjectsKHR);
+#endif // cl_khr_external_memory
+
+#ifdef cl_khr_semaphore
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCreateSemaphoreWithPropertiesKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clReleaseSemaphoreKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clRetainSemaphoreKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clEnqueueWaitSemaphoresKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clEnqueueSignalSemaphoresKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clGetSemaphoreInfoKHR);
+#endif // cl_khr_semaphore
+
+#ifdef cl_khr_external_semaphore
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clGetSemaphoreHandleForTypeKHR);
+#endif // cl_khr_external_semaphore
+
+#if defined(cl_khr_command_buffer)
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCreateCommandBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clFinalizeCommandBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clRetainCommandBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clReleaseCommandBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clGetCommandBufferInfoKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clEnqueueCommandBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandBarrierWithWaitListKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandCopyBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandCopyBufferRectKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandCopyBufferToImageKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandCopyImageKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandCopyImageToBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandFillBufferKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandFillImageKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clCommandNDRangeKernelKHR);
+#endif /* cl_khr_command_buffer */
+
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clUpdateMutableCommandsKHR);
+        CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_(platform, clGetMutableCommandInfoKHR);
+#endif /* cl_khr_command_buffer_mutable_dispatch */
+    }
+};
+
+CL_HPP_DEFINE_STATIC_MEMBER_ std::mutex ExtensionDispatch::mutex_;
+CL_HPP_DEFINE_STATIC_MEMBER_ std::map<cl_platform_id, std::unique_ptr<ExtensionDispatch>> ExtensionDispatch::tables_;
+CL_HPP_DEFINE_STATIC_MEMBER_ std::atomic<const ExtensionDispatch*> ExtensionDispatch::first_{nullptr};
+CL_HPP_DEFINE_STATIC_MEMBER_ std::atomic<const ExtensionDispatch*> ExtensionDispatch::sole_{nullptr};
+
+} // namespace detail
+
+namespace detail {
+
 // Generic getInfoHelper. The final parameter is used to guide overload
 // resolution: the actual parameter passed is an int, which makes this
 // a worse conversion sequence than a specialization that declares the
@@ -1871,6 +2175,118 @@ getInfo(Func f, const Arg0& arg0, const Arg1& arg1, cl_uint name, T* param)
     return getInfoHelper(f0, name, param, 0);
 }
 
+/* Info parameters whose value may change during the lifetime of the object.
+ * These are never served from the info cache.
+ */
+template <typename enum_type, cl_int Name>
+struct is_mutable_info : std::false_type {};
+
+#define CL_HPP_DECLARE_MUTABLE_INFO_(token, param_name) \
+template<>                                              \
+struct is_mutable_info<detail:: token, param_name> : std::true_type {};
+
+CL_HPP_DECLARE_MUTABLE_INFO_(cl_device_info, CL_DEVICE_AVAILABLE)
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+CL_HPP_DECLARE_MUTABLE_INFO_(cl_device_info, CL_DEVICE_REFERENCE_COUNT)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+#if defined(cl_ext_device_fission)
+CL_HPP_DECLARE_MUTABLE_INFO_(cl_device_info, CL_DEVICE_REFERENCE_COUNT_EXT)
+#endif // cl_ext_device_fission
+#ifdef CL_DEVICE_GLOBAL_FREE_MEMORY_AMD
+CL_HPP_DECLARE_MUTABLE_INFO_(cl_device_info, CL_DEVICE_GLOBAL_FREE_MEMORY_AMD)
+#endif
+
+/*! \brief Process-wide cache of immutable info parameters, keyed by handle
+ *         and parameter name.
+ *
+ *  Cached values are never moved, so references to them stay valid until
+ *  the entries of their handle are cleared.
+ */
+template <typename Handle>
+class InfoCache
+{
+private:
+    typedef std::map<std::pair<Handle, cl_uint>, std::shared_ptr<void>> Entries;
+
+    static std::mutex mutex_;
+    static Entries entries_;
+    // Set by the first insertion, lets contains() and clear() skip the lock
+    // until then
+    static std::atomic<bool> used_;
+
+public:
+    template <typename T, typename Query>
+    static cl_int get(Handle handle, cl_uint name, Query query, const T** param)
+    {
+        const std::pair<Handle, cl_uint> key(handle, name);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            typename Entries::const_iterator it = entries_.find(key);
+            if (it != entries_.end()) {
+                *param = static_cast<const T*>(it->second.get());
+                return CL_SUCCESS;
+            }
+        }
+
+        // Query without holding the lock. Threads that miss concurrently
+        // all query the driver, and the first one to publish its value wins.
+        std::shared_ptr<T> value = std::make_shared<T>();
+        cl_int err = query(value.get());
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        used_ = true;
+        typename Entries::iterator it =
+            entries_.insert(std::make_pair(key, std::shared_ptr<void>(value))).first;
+        *param = static_cast<const T*>(it->second.get());
+        return CL_SUCCESS;
+    }
+
+    //! \brief Returns whether any parameter of the handle is cached.
+    static bool contains(Handle handle)
+    {
+        if (!used_) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        typename Entries::const_iterator it =
+            entries_.lower_bound(std::make_pair(handle, (std::numeric_limits<cl_uint>::min)()));
+        return it != entries_.end() && it->first.first == handle;
+    }
+
+    static void clear(Handle handle)
+    {
+        if (!used_) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        entries_.erase(
+            entries_.lower_bound(std::make_pair(handle, (std::numeric_limits<cl_uint>::min)())),
+            entries_.upper_bound(std::make_pair(handle, (std::numeric_limits<cl_uint>::max)())));
+    }
+};
+
+template <typename Handle>
+std::mutex InfoCache<Handle>::mutex_;
+template <typename Handle>
+typename InfoCache<Handle>::Entries InfoCache<Handle>::entries_;
+template <typename Handle>
+std::atomic<bool> InfoCache<Handle>::used_(false);
+
+template <typename enum_type, cl_int Name, typename Func, typename Handle>
+inline cl_int getCachedInfo(
+    Func f, Handle handle,
+    const typename param_traits<enum_type, Name>::param_type** param)
+{
+    typedef typename param_traits<enum_type, Name>::param_type param_type;
+    return InfoCache<Handle>::get(
+        handle, Name,
+        [&](param_type* value) { return getInfo(f, handle, Name, value); },
+        param);
+}
+
 
 template<typename T>
 struct ReferenceHandler
@@ -1978,13 +2394,18 @@ struct ReferenceHandler<cl_program>
     { return ::clReleaseProgram(program); }
 };
 
+inline void releaseKernelArgShadow(cl_kernel kernel);
+
 template <>
 struct ReferenceHandler<cl_kernel>
 {
     static cl_int retain(cl_kernel kernel)
     { return ::clRetainKernel(kernel); }
     static cl_int release(cl_kernel kernel)
-    { return ::clReleaseKernel(kernel); }
+    {
+        releaseKernelArgShadow(kernel);
+        return ::clReleaseKernel(kernel);
+    }
 };
 
 template <>
@@ -2000,19 +2421,21 @@ struct ReferenceHandler<cl_event>
 template <>
 struct ReferenceHandler<cl_semaphore_khr>
 {
-    static cl_int retain(cl_semaphore_khr semaphore)
+    static cl_int retain(cl_semaphore_khr semaphore, const ExtensionDispatch* dispatch = nullptr)
     { 
-        if (pfn_clRetainSemaphoreKHR != nullptr) {
-            return pfn_clRetainSemaphoreKHR(semaphore);
+        PFN_clRetainSemaphoreKHR pfn = CL_HPP_EXT_FCN_(dispatch, clRetainSemaphoreKHR);
+        if (pfn != nullptr) {
+            return pfn(semaphore);
         }
 
         return CL_INVALID_OPERATION;
     }
 
-    static cl_int release(cl_semaphore_khr semaphore)
+    static cl_int release(cl_semaphore_khr semaphore, const ExtensionDispatch* dispatch = nullptr)
     {
-        if (pfn_clReleaseSemaphoreKHR != nullptr) {
-            return pfn_clReleaseSemaphoreKHR(semaphore);
+        PFN_clReleaseSemaphoreKHR pfn = CL_HPP_EXT_FCN_(dispatch, clReleaseSemaphoreKHR);
+        if (pfn != nullptr) {
+            return pfn(semaphore);
         }
 
         return CL_INVALID_OPERATION;
@@ -2023,20 +2446,22 @@ struct ReferenceHandler<cl_semaphore_khr>
 template <>
 struct ReferenceHandler<cl_command_buffer_khr>
 {
-    static cl_int retain(cl_command_buffer_khr cmdBufferKhr)
+    static cl_int retain(cl_command_buffer_khr cmdBufferKhr, const ExtensionDispatch* dispatch = nullptr)
     {
-        if (pfn_clRetainCommandBufferKHR == nullptr) {
+        PFN_clRetainCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch, clRetainCommandBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION, __RETAIN_COMMAND_BUFFER_KHR_ERR);
         }
-        return pfn_clRetainCommandBufferKHR(cmdBufferKhr);
+        return pfn(cmdBufferKhr);
     }
 
-    static cl_int release(cl_command_buffer_khr cmdBufferKhr)
+    static cl_int release(cl_command_buffer_khr cmdBufferKhr, const ExtensionDispatch* dispatch = nullptr)
     {
-        if (pfn_clReleaseCommandBufferKHR == nullptr) {
+        PFN_clReleaseCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch, clReleaseCommandBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION, __RELEASE_COMMAND_BUFFER_KHR_ERR);
         }
-        return pfn_clReleaseCommandBufferKHR(cmdBufferKhr);
+        return pfn(cmdBufferKhr);
     }
 };
 
@@ -2074,14 +2499,67 @@ static cl_uint getVersion(const vector<char> &versionInfo)
     return (highVersion << 16) | lowVersion;
 }
 
-static cl_uint getPlatformVersion(cl_platform_id platform)
+/*! \brief Process-wide cache of platform versions, keyed by platform.
+ *
+ *  A platform's version cannot change while it is loaded, so it is only
+ *  queried and parsed the first time it is needed.
+ */
+class PlatformVersionCache
 {
-    size_type size = 0;
-    clGetPlatformInfo(platform, CL_PLATFORM_VERSION, 0, nullptr, &size);
+private:
+    static std::mutex mutex_;
+    static std::map<cl_platform_id, cl_uint> versions_;
+
+public:
+    static cl_uint get(cl_platform_id platform)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::map<cl_platform_id, cl_uint>::const_iterator it = versions_.find(platform);
+            if (it != versions_.end()) {
+                return it->second;
+            }
+        }
+
+        size_type size = 0;
+        cl_int err = clGetPlatformInfo(platform, CL_PLATFORM_VERSION, 0, nullptr, &size);
+
+        if (err != CL_SUCCESS) {
+            return 0;
+        }
+
+        vector<char> versionInfo(size);
+        err = clGetPlatformInfo(platform, CL_PLATFORM_VERSION, size, versionInfo.data(), &size);
+        if (err != CL_SUCCESS) {
+            return 0;
+        }
+        cl_uint version = getVersion(versionInfo);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        versions_.insert(std::make_pair(platform, version));
+        return version;
+    }
+
+#ifdef CL_HPP_UNIT_TEST_ENABLE
+    /*! \brief Forget all cached versions.
+     *
+     * This supports cleanup in the unit test framework, where the same
+     * platform handle is reused with different versions.
+     */
+    static void unitTestClear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        versions_.clear();
+    }
+#endif // #ifdef CL_HPP_UNIT_TEST_ENABLE
+};
+
+CL_HPP_DEFINE_STATIC_MEMBER_ std::mutex PlatformVersionCache::mutex_;
+CL_HPP_DEFINE_STATIC_MEMBER_ std::map<cl_platform_id, cl_uint> PlatformVersionCache::versions_;
 
-    vector<char> versionInfo(size);
-    clGetPlatformInfo(platform, CL_PLATFORM_VERSION, size, versionInfo.data(), &size);
-    return getVersion(versionInfo);
+static cl_uint getPlatformVersion(cl_platform_id platform)
+{
+    return PlatformVersionCache::get(platform);
 }
 
 static cl_uint getDevicePlatformVersion(cl_device_id device)
@@ -2105,6 +2583,154 @@ static cl_uint getContextPlatformVersion(cl_context context)
 }
 #endif // CL_HPP_TARGET_OPENCL_VERSION >= 120 && CL_HPP_MINIMUM_OPENCL_VERSION < 120
 
+#if defined(CL_HPP_ENABLE_HOST_REFERENCE_COUNT)
+/*! \brief Process-wide record of wrapper copies sharing an OpenCL reference.
+ *
+ *  Copying a wrapper records a copy of its handle here instead of retaining
+ *  the object, and releasing a wrapper consumes a recorded copy before it
+ *  falls back to releasing the object. The OpenCL references held are then
+ *  the wrappers minus the recorded copies of a handle, whichever wrapper
+ *  goes first. Keeping the count outside of the wrapper leaves wrappers the
+ *  size of their handle, which vectors of wrappers passed as handle arrays
+ *  rely on.
+ *
+ *  The table is a fixed array of slots probed linearly from the handle, each
+ *  holding a handle and an atomic word with its copy count in the low and
+ *  a generation in the high 32 bits. Recording and consuming copies are
+ *  compare and swap loops on that word, so no lock is taken. A slot whose
+ *  count drops to zero can be claimed for another handle, which bumps the
+ *  generation, so an update racing with the claim fails and rescans. The
+ *  same handle may end up in more than one slot, which is harmless since
+ *  any recorded copy can be consumed. When every slot in the probe window
+ *  is taken the copy is not recorded and the caller retains the object.
+ */
+class HostReferenceTable
+{
+public:
+    static const size_type numSlots = 4096;
+    static const size_type probeLength = 16;
+
+private:
+    static const cl_ulong countMask_ = 0xFFFFFFFFull;
+    // Count of a slot that is being claimed for a handle
+    static const cl_ulong busy_ = countMask_;
+
+    struct Slot
+    {
+        std::atomic<cl_ulong> word_;
+        std::atomic<const void*> handle_;
+
+        Slot() : word_(0), handle_(nullptr) { }
+    };
+
+    // Never destroyed, so that wrappers released during static
+    // destruction can still look themselves up
+    static Slot* slots()
+    {
+        static Slot* slots = new Slot[numSlots];
+        return slots;
+    }
+
+    static size_type first(const void* handle)
+    {
+        // Handles are at least 16 byte aligned in practice
+        return (reinterpret_cast<size_type>(handle) >> 4) % numSlots;
+    }
+
+    static bool live(cl_ulong word)
+    {
+        cl_ulong count = word & countMask_;
+        return count != 0 && count != busy_;
+    }
+
+public:
+    /*! \brief Records a copy sharing the OpenCL reference of handle.
+     *
+     *  Returns false when the probe window of handle is full, the caller
+     *  then has to retain the object instead.
+     */
+    static bool addCopy(const void* handle)
+    {
+        Slot* slots = HostReferenceTable::slots();
+        size_type start = first(handle);
+
+        for (size_type i = 0; i < probeLength; ++i) {
+            Slot& slot = slots[(start + i) % numSlots];
+            cl_ulong word = slot.word_.load(std::memory_order_acquire);
+            while (live(word) && (word & countMask_) + 1 != busy_ &&
+                   slot.handle_.load(std::memory_order_relaxed) == handle) {
+                if (slot.word_.compare_exchange_weak(
+                        word, word + 1, std::memory_order_acq_rel)) {
+                    return true;
+                }
+            }
+        }
+
+        for (size_type i = 0; i < probeLength; ++i) {
+            Slot& slot = slots[(start + i) % numSlots];
+            cl_ulong word = slot.word_.load(std::memory_order_acquire);
+            while ((word & countMask_) == 0) {
+                if (slot.word_.compare_exchange_weak(
+                        word, (word & ~countMask_) | busy_,
+                        std::memory_order_acquire)) {
+                    slot.handle_.store(handle, std::memory_order_relaxed);
+                    slot.word_.store(
+                        (((word >> 32) + 1) << 32) | 1, std::memory_order_release);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /*! \brief Consumes a recorded copy of handle.
+     *
+     *  Returns false when there is none, the caller then holds an OpenCL
+     *  reference it has to release.
+     */
+    static bool removeCopy(const void* handle)
+    {
+        Slot* slots = HostReferenceTable::slots();
+        size_type start = first(handle);
+
+        for (size_type i = 0; i < probeLength; ++i) {
+            Slot& slot = slots[(start + i) % numSlots];
+            cl_ulong word = slot.word_.load(std::memory_order_acquire);
+            while (live(word) &&
+                   slot.handle_.load(std::memory_order_relaxed) == handle) {
+                if (slot.word_.compare_exchange_weak(
+                        word, word - 1, std::memory_order_acq_rel)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+//! \brief Whether copies of T are recorded in HostReferenceTable.
+template <typename T>
+struct IsHostReferenceCounted
+{
+    static const bool value = true;
+};
+
+// Objects without a reference count have nothing to share
+template <>
+struct IsHostReferenceCounted<cl_platform_id>
+{
+    static const bool value = false;
+};
+
+#if defined(cl_khr_command_buffer)
+template <>
+struct IsHostReferenceCounted<cl_mutable_command_khr>
+{
+    static const bool value = false;
+};
+#endif // cl_khr_command_buffer
+#endif // CL_HPP_ENABLE_HOST_REFERENCE_COUNT
+
 template <typename T>
 class Wrapper
 {
@@ -2132,7 +2758,7 @@ public:
     Wrapper(const Wrapper<cl_type>& rhs)
     {
         object_ = rhs.object_;
-        detail::errHandler(retain(), __RETAIN_ERR);
+        detail::errHandler(retainCopy(), __RETAIN_ERR);
     }
 
     Wrapper(Wrapper<cl_type>&& rhs) noexcept
@@ -2146,7 +2772,7 @@ public:
         if (this != &rhs) {
             detail::errHandler(release(), __RELEASE_ERR);
             object_ = rhs.object_;
-            detail::errHandler(retain(), __RETAIN_ERR);
+            detail::errHandler(retainCopy(), __RETAIN_ERR);
         }
         return *this;
     }
@@ -2188,9 +2814,29 @@ protected:
         }
     }
 
+    //! \brief Takes the reference of a copy of another wrapper.
+    cl_int retainCopy() const
+    {
+#if defined(CL_HPP_ENABLE_HOST_REFERENCE_COUNT)
+        if (object_ != nullptr && IsHostReferenceCounted<cl_type>::value &&
+            !HostReferenceTable::addCopy(object_)) {
+            return retain();
+        }
+        return CL_SUCCESS;
+#else // CL_HPP_ENABLE_HOST_REFERENCE_COUNT
+        return retain();
+#endif // CL_HPP_ENABLE_HOST_REFERENCE_COUNT
+    }
+
     cl_int release() const
     {
         if (object_ != nullptr) {
+#if defined(CL_HPP_ENABLE_HOST_REFERENCE_COUNT)
+            if (IsHostReferenceCounted<cl_type>::value &&
+                HostReferenceTable::removeCopy(object_)) {
+                return CL_SUCCESS;
+            }
+#endif // CL_HPP_ENABLE_HOST_REFERENCE_COUNT
             return ReferenceHandler<cl_type>::release(object_);
         }
         else {
@@ -2252,7 +2898,7 @@ public:
     Wrapper(const Wrapper<cl_type>& rhs)
     {
         object_ = rhs.object_;
-        referenceCountable_ = isReferenceCountable(object_); 
+        referenceCountable_ = rhs.referenceCountable_;
         detail::errHandler(retain(), __RETAIN_ERR);
     }
 
@@ -2329,16 +2975,161 @@ protected:
     }
 };
 
+#if defined(cl_khr_semaphore) || defined(cl_khr_command_buffer)
+/*! \brief Wrapper for objects created through extension entry points.
+ *
+ *  Keeps the ExtensionDispatch table of the platform the object belongs to,
+ *  so that reference counting and the other calls made on the object reach
+ *  that platform's entry points.
+ */
 template <typename T>
-inline bool operator==(const Wrapper<T> &lhs, const Wrapper<T> &rhs)
+class ExtensionWrapper
 {
-    return lhs() == rhs();
-}
+public:
+    typedef T cl_type;
 
-template <typename T>
-inline bool operator!=(const Wrapper<T> &lhs, const Wrapper<T> &rhs)
-{
-    return !operator==(lhs, rhs);
+protected:
+    cl_type object_;
+    const ExtensionDispatch* dispatch_;
+
+public:
+    ExtensionWrapper() : object_(nullptr), dispatch_(nullptr) { }
+
+    ExtensionWrapper(
+        const cl_type &obj,
+        bool retainObject,
+        const ExtensionDispatch* dispatch = nullptr) :
+        object_(obj),
+        dispatch_(dispatch)
+    {
+        if (retainObject) {
+            detail::errHandler(retain(), __RETAIN_ERR);
+        }
+    }
+
+    ~ExtensionWrapper()
+    {
+        if (object_ != nullptr) { release(); }
+    }
+
+    ExtensionWrapper(const ExtensionWrapper<cl_type>& rhs)
+    {
+        object_ = rhs.object_;
+        dispatch_ = rhs.dispatch_;
+        detail::errHandler(retain(), __RETAIN_ERR);
+    }
+
+    ExtensionWrapper(ExtensionWrapper<cl_type>&& rhs) noexcept
+    {
+        object_ = rhs.object_;
+        dispatch_ = rhs.dispatch_;
+        rhs.object_ = nullptr;
+    }
+
+    ExtensionWrapper<cl_type>& operator = (const ExtensionWrapper<cl_type>& rhs)
+    {
+        if (this != &rhs) {
+            detail::errHandler(release(), __RELEASE_ERR);
+            object_ = rhs.object_;
+            dispatch_ = rhs.dispatch_;
+            detail::errHandler(retain(), __RETAIN_ERR);
+        }
+        return *this;
+    }
+
+    ExtensionWrapper<cl_type>& operator = (ExtensionWrapper<cl_type>&& rhs)
+    {
+        if (this != &rhs) {
+            detail::errHandler(release(), __RELEASE_ERR);
+            object_ = rhs.object_;
+            dispatch_ = rhs.dispatch_;
+            rhs.object_ = nullptr;
+        }
+        return *this;
+    }
+
+    //! \brief Adopts a handle whose platform is not known.
+    ExtensionWrapper<cl_type>& operator = (const cl_type &rhs)
+    {
+        detail::errHandler(release(), __RELEASE_ERR);
+        object_ = rhs;
+        dispatch_ = nullptr;
+        return *this;
+    }
+
+    const cl_type& operator ()() const { return object_; }
+
+    cl_type& operator ()() { return object_; }
+
+    cl_type get() const { return object_; }
+
+    /*! \brief Returns the entry points of the platform of the object.
+     *
+     *  Returns nullptr for handles adopted without a platform, which use
+     *  the cl::pfn_ pointers or the first table resolved instead.
+     */
+    const ExtensionDispatch* getDispatch() const { return dispatch_; }
+
+protected:
+    template<typename Func, typename U>
+    friend inline cl_int getInfoHelper(Func, cl_uint, U*, int, typename U::cl_type);
+
+    cl_int retain() const
+    {
+        if (object_ != nullptr) {
+            return ReferenceHandler<cl_type>::retain(object_, dispatch_);
+        }
+        else {
+            return CL_SUCCESS;
+        }
+    }
+
+    cl_int release() const
+    {
+        if (object_ != nullptr) {
+            return ReferenceHandler<cl_type>::release(object_, dispatch_);
+        }
+        else {
+            return CL_SUCCESS;
+        }
+    }
+};
+#endif // cl_khr_semaphore || cl_khr_command_buffer
+
+#ifdef cl_khr_semaphore
+template <>
+class Wrapper<cl_semaphore_khr> : public ExtensionWrapper<cl_semaphore_khr>
+{
+public:
+    using ExtensionWrapper<cl_semaphore_khr>::ExtensionWrapper;
+    using ExtensionWrapper<cl_semaphore_khr>::operator=;
+
+    Wrapper() { }
+};
+#endif // cl_khr_semaphore
+
+#if defined(cl_khr_command_buffer)
+template <>
+class Wrapper<cl_command_buffer_khr> : public ExtensionWrapper<cl_command_buffer_khr>
+{
+public:
+    using ExtensionWrapper<cl_command_buffer_khr>::ExtensionWrapper;
+    using ExtensionWrapper<cl_command_buffer_khr>::operator=;
+
+    Wrapper() { }
+};
+#endif // cl_khr_command_buffer
+
+template <typename T>
+inline bool operator==(const Wrapper<T> &lhs, const Wrapper<T> &rhs)
+{
+    return lhs() == rhs();
+}
+
+template <typename T>
+inline bool operator!=(const Wrapper<T> &lhs, const Wrapper<T> &rhs)
+{
+    return !operator==(lhs, rhs);
 }
 
 } // namespace detail
@@ -2438,6 +3229,18 @@ public:
      */
     static Device getDefault(
         cl_int *errResult = nullptr)
+    {
+        return getDefaultRef(errResult);
+    }
+
+    /*! \brief Returns the default device without adding a reference to it.
+     *
+     *  The returned object stays valid until the process exits.
+     *
+     *  \see getDefault()
+     */
+    static const Device& getDefaultRef(
+        cl_int *errResult = nullptr)
     {
         std::call_once(default_initialized_, makeDefault);
         detail::errHandler(default_error_);
@@ -2495,6 +3298,62 @@ public:
         return param;
     }
 
+    /*! \brief Wrapper for clGetDeviceInfo() that caches the result.
+     *
+     *  The first call for a parameter queries the driver and publishes the
+     *  value in a process-wide cache keyed by the device ID, later calls from
+     *  any thread return a reference to that value. Only parameters that are
+     *  immutable for the lifetime of the device may be cached.
+     *
+     *  The returned reference stays valid until clearInfoCache() is called
+     *  for the device. For a sub-device, it also becomes invalid once the
+     *  sub-device is released and createSubDevices() returns its ID again.
+     */
+    template <cl_device_info name>
+    const typename detail::param_traits<detail::cl_device_info, name>::param_type&
+    getCachedInfo(cl_int* err = nullptr) const
+    {
+        static_assert(!detail::is_mutable_info<detail::cl_device_info, name>::value,
+            "Mutable device info parameters cannot be cached");
+        typedef typename detail::param_traits<
+            detail::cl_device_info, name>::param_type param_type;
+
+        const param_type* param = nullptr;
+        cl_int result = detail::errHandler(
+            detail::getCachedInfo<detail::cl_device_info, name>(
+                &::clGetDeviceInfo, object_, &param),
+            __GET_DEVICE_INFO_ERR);
+        if (err != nullptr) {
+            *err = result;
+        }
+        if (param == nullptr) {
+            static const param_type empty = param_type();
+            return empty;
+        }
+        return *param;
+    }
+
+    /*! \brief Snapshots all immutable device info parameters known to the
+     *         bindings into the info cache in one call.
+     *
+     *  Parameters that the device does not support are skipped. Subsequent
+     *  getCachedInfo() calls are served without querying the driver.
+     */
+    cl_int cacheInfo() const;
+
+    /*! \brief Removes the cached info parameters of this device.
+     *
+     *  The ID of a released sub-device may be reused for a new one. The
+     *  entries of such an ID are dropped when createSubDevices() returns
+     *  it. Call this function before releasing a sub-device created through
+     *  the C API whose info was cached. No references previously returned
+     *  by getCachedInfo() for this device may be used afterwards.
+     */
+    void clearInfoCache() const
+    {
+        detail::InfoCache<cl_device_id>::clear(object_);
+    }
+
 #if CL_HPP_TARGET_OPENCL_VERSION >= 210
     /**
      * Return the current value of the host clock as seen by the device.
@@ -2555,6 +3414,23 @@ public:
 };
 
 using BuildLogType = vector<std::pair<cl::Device, typename detail::param_traits<detail::cl_program_build_info, CL_PROGRAM_BUILD_LOG>::param_type>>;
+
+/*! \brief Outcome of an asynchronous program build.
+ *
+ *  Converts to the error code build() would have returned. The build logs
+ *  are only filled in when the build failed.
+ */
+struct BuildResult
+{
+    cl_int error;
+    BuildLogType buildLogs;
+
+    operator cl_int() const
+    {
+        return error;
+    }
+};
+
 #if defined(CL_HPP_ENABLE_EXCEPTIONS)
 /**
 * Exception class for build errors to carry build info
@@ -2574,13 +3450,15 @@ public:
     }
 };
 namespace detail {
+    // The build logs are only fetched when the build failed
+    template <typename BuildLogFunctor>
     static inline cl_int buildErrHandler(
         cl_int err,
         const char * errStr,
-        const BuildLogType &buildLogs)
+        BuildLogFunctor getBuildLogs)
     {
         if (err != CL_SUCCESS) {
-            throw BuildError(err, errStr, buildLogs);
+            throw BuildError(err, errStr, getBuildLogs());
         }
         return err;
     }
@@ -2588,12 +3466,13 @@ namespace detail {
 
 #else
 namespace detail {
+    template <typename BuildLogFunctor>
     static inline cl_int buildErrHandler(
         cl_int err,
         const char * errStr,
-        const BuildLogType &buildLogs)
+        BuildLogFunctor getBuildLogs)
     {
-        (void)buildLogs; // suppress unused variable warning
+        (void)getBuildLogs; // suppress unused variable warning
         (void)errStr;
         return err;
     }
@@ -2754,6 +3633,40 @@ public:
         return param;
     }
 
+    /*! \brief Wrapper for clGetPlatformInfo() that caches the result.
+     *
+     *  \see Device::getCachedInfo()
+     */
+    template <cl_platform_info name>
+    const typename detail::param_traits<detail::cl_platform_info, name>::param_type&
+    getCachedInfo(cl_int* err = nullptr) const
+    {
+        static_assert(!detail::is_mutable_info<detail::cl_platform_info, name>::value,
+            "Mutable platform info parameters cannot be cached");
+        typedef typename detail::param_traits<
+            detail::cl_platform_info, name>::param_type param_type;
+
+        const param_type* param = nullptr;
+        cl_int result = detail::errHandler(
+            detail::getCachedInfo<detail::cl_platform_info, name>(
+                &::clGetPlatformInfo, object_, &param),
+            __GET_PLATFORM_INFO_ERR);
+        if (err != nullptr) {
+            *err = result;
+        }
+        if (param == nullptr) {
+            static const param_type empty = param_type();
+            return empty;
+        }
+        return *param;
+    }
+
+    //! \brief Removes the cached info parameters of this platform.
+    void clearInfoCache() const
+    {
+        detail::InfoCache<cl_platform_id>::clear(object_);
+    }
+
     /*! \brief Gets a list of devices for this platform.
      * 
      *  Wraps clGetDeviceIDs().
@@ -2920,6 +3833,7 @@ public:
             for (size_type i = 0; i < ids.size(); i++) {
                 (*platforms)[i] = Platform(ids[i]);
             }
+            detail::ExtensionDispatch::discover(ids);
         }
         return CL_SUCCESS;
     }
@@ -2968,6 +3882,62 @@ public:
 #endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
 }; // class Platform
 
+namespace detail {
+template <typename enum_type, cl_int Name>
+inline typename std::enable_if<
+    std::is_same<enum_type, detail::cl_device_info>::value &&
+    !is_mutable_info<enum_type, Name>::value>::type
+cacheDeviceInfo(cl_device_id device, cl_int* result)
+{
+    const typename param_traits<enum_type, Name>::param_type* param;
+    cl_int err = getCachedInfo<enum_type, Name>(&::clGetDeviceInfo, device, &param);
+    // Parameters the device does not support are reported as CL_INVALID_VALUE
+    if (err != CL_SUCCESS && err != CL_INVALID_VALUE && *result == CL_SUCCESS) {
+        *result = err;
+    }
+}
+
+template <typename enum_type, cl_int Name>
+inline typename std::enable_if<
+    !std::is_same<enum_type, detail::cl_device_info>::value ||
+    is_mutable_info<enum_type, Name>::value>::type
+cacheDeviceInfo(cl_device_id, cl_int*)
+{
+}
+} // namespace detail
+
+inline cl_int Device::cacheInfo() const
+{
+    cl_int result = CL_SUCCESS;
+
+#define CL_HPP_CACHE_DEVICE_INFO_(token, param_name, T) \
+    detail::cacheDeviceInfo<detail:: token, param_name>(object_, &result);
+
+    CL_HPP_PARAM_NAME_INFO_1_0_(CL_HPP_CACHE_DEVICE_INFO_)
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+    CL_HPP_PARAM_NAME_INFO_1_1_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    CL_HPP_PARAM_NAME_INFO_1_2_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    CL_HPP_PARAM_NAME_INFO_2_0_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    CL_HPP_PARAM_NAME_INFO_2_1_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 210
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+    CL_HPP_PARAM_NAME_INFO_2_2_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 220
+#if CL_HPP_TARGET_OPENCL_VERSION >= 300
+    CL_HPP_PARAM_NAME_INFO_3_0_(CL_HPP_CACHE_DEVICE_INFO_)
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 300
+
+#undef CL_HPP_CACHE_DEVICE_INFO_
+
+    return detail::errHandler(result, __GET_DEVICE_INFO_ERR);
+}
+
 #if CL_HPP_TARGET_OPENCL_VERSION >= 120
    //! \brief Wrapper for clCreateSubDevices().
 inline cl_int Device::createSubDevices(const cl_device_partition_property* properties,
@@ -2987,6 +3957,12 @@ inline cl_int Device::createSubDevices(const cl_device_partition_property* prope
         return detail::errHandler(err, __CREATE_SUB_DEVICES_ERR);
     }
 
+    // The IDs may have belonged to released sub-devices whose info was
+    // cached
+    for (cl_device_id id : ids) {
+        detail::InfoCache<cl_device_id>::clear(id);
+    }
+
     // Cannot trivially assign because we need to capture intermediates
     // with safe construction
     if (devices)
@@ -3042,6 +4018,12 @@ inline cl_int Device::createSubDevices(const cl_device_partition_property_ext* p
     {
         return detail::errHandler(err, __CREATE_SUB_DEVICES_ERR);
     }
+    // The IDs may have belonged to released sub-devices whose info was
+    // cached
+    for (cl_device_id id : ids) {
+        detail::InfoCache<cl_device_id>::clear(id);
+    }
+
     // Cannot trivially assign because we need to capture intermediates
     // with safe construction
     if (devices)
@@ -3318,6 +4300,17 @@ public:
      *  \note All calls to this function return the same cl_context as the first.
      */
     static Context getDefault(cl_int * err = nullptr) 
+    {
+        return getDefaultRef(err);
+    }
+
+    /*! \brief Returns the default context without adding a reference to it.
+     *
+     *  The returned object stays valid until the process exits.
+     *
+     *  \see getDefault()
+     */
+    static const Context& getDefaultRef(cl_int * err = nullptr)
     {
         std::call_once(default_initialized_, makeDefault);
         detail::errHandler(default_error_);
@@ -3471,7 +4464,7 @@ inline void Device::makeDefault()
     {
         cl_int error = 0;
 
-        Context context = Context::getDefault(&error);
+        const Context& context = Context::getDefaultRef(&error);
         detail::errHandler(error, __CREATE_CONTEXT_ERR);
 
         if (error != CL_SUCCESS) {
@@ -3493,6 +4486,14 @@ CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag Context::default_initialized_;
 CL_HPP_DEFINE_STATIC_MEMBER_ Context Context::default_;
 CL_HPP_DEFINE_STATIC_MEMBER_ cl_int Context::default_error_ = CL_SUCCESS;
 
+namespace detail {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+inline bool isCapturePlaceholder(const cl_event* events, size_type count);
+#else
+inline bool isCapturePlaceholder(const cl_event*, size_type) { return false; }
+#endif
+} // namespace detail
+
 /*! \brief Class interface for cl_event.
  *
  *  \note Copies of these objects are shallow, meaning that the copy will refer
@@ -3577,10 +4578,16 @@ public:
 
     /*! \brief Blocks the calling thread until this event completes.
      * 
-     *  Wraps clWaitForEvents().
+     *  Wraps clWaitForEvents(). Fails with CL_INVALID_OPERATION for an event
+     *  returned by a command recorded by a CommandBufferCapture that is still
+     *  active on the calling thread, as that event cannot complete before
+     *  the capture ends.
      */
     cl_int wait() const
     {
+        if (detail::isCapturePlaceholder(&object_, 1)) {
+            return detail::errHandler(CL_INVALID_OPERATION, __WAIT_FOR_EVENTS_ERR);
+        }
         return detail::errHandler(
             ::clWaitForEvents(1, &object_),
             __WAIT_FOR_EVENTS_ERR);
@@ -3673,63 +4680,181 @@ public:
 inline static cl_int
 WaitForEvents(const vector<Event>& events)
 {
+    static_assert(sizeof(cl::Event) == sizeof(cl_event),
+    "Size of cl::Event must be equal to size of cl_event");
+
+    if (detail::isCapturePlaceholder(reinterpret_cast<const cl_event*>(events.data()), events.size())) {
+        return detail::errHandler(CL_INVALID_OPERATION, __WAIT_FOR_EVENTS_ERR);
+    }
     return detail::errHandler(
         ::clWaitForEvents(
             (cl_uint) events.size(), (events.size() > 0) ? (cl_event*)&events.front() : nullptr),
         __WAIT_FOR_EVENTS_ERR);
 }
 
-/*! \brief Class interface for cl_mem.
+/*! \brief Non-owning view of a list of events to wait for.
  *
- *  \note Copies of these objects are shallow, meaning that the copy will refer
- *        to the same underlying cl_mem as the original.  For details, see
- *        clRetainMemObject() and clReleaseMemObject().
+ *  Every enqueue function that takes a vector<Event> pointer also has an
+ *  overload taking an EventWaitList. Unlike a vector<Event>, building a wait
+ *  list does not allocate or retain the events. They must stay alive until
+ *  the call using the list returns.
  *
- *  \see cl_mem
+ *  Converts implicitly from a vector<Event> pointer and from an EventList:
+ *  \code
+ *  queue.enqueueMarkerWithWaitList(cl::EventList<2>{ first, second });
+ *  queue.enqueueMarkerWithWaitList(cl::EventWaitList(events, count));
+ *  \endcode
  */
-class Memory : public detail::Wrapper<cl_mem>
+class EventWaitList
 {
+private:
+    const Event* events_;
+    size_type size_;
+
 public:
-    //! \brief Default constructor - initializes to nullptr.
-    Memory() : detail::Wrapper<cl_type>() { }
+    EventWaitList() : events_(nullptr), size_(0) { }
 
-    /*! \brief Constructor from cl_mem - takes ownership.
-     *
-     *  Optionally transfer ownership of a refcount on the cl_mem
-     *  into the new Memory object.
-     *
-     * \param retainObject will cause the constructor to retain its cl object.
-     *                     Defaults to false to maintain compatibility with
-     *                     earlier versions.
-     *
-     *  See Memory for further details.
-     */
-    explicit Memory(const cl_mem& memory, bool retainObject) :
-        detail::Wrapper<cl_type>(memory, retainObject) { }
+    EventWaitList(const vector<Event>* events) :
+        events_((events != nullptr && events->size() > 0) ? &events->front() : nullptr),
+        size_((events != nullptr) ? events->size() : 0) { }
 
-    /*! \brief Assignment operator from cl_mem - takes ownership.
-     *
-     *  This effectively transfers ownership of a refcount on the rhs and calls
-     *  clReleaseMemObject() on the value previously held by this instance.
-     */
-    Memory& operator = (const cl_mem& rhs)
-    {
-        detail::Wrapper<cl_type>::operator=(rhs);
-        return *this;
-    }
+    EventWaitList(const Event* events, size_type size) :
+        events_(size > 0 ? events : nullptr),
+        size_(size) { }
 
-    //! \brief Wrapper for clGetMemObjectInfo().
-    template <typename T>
-    cl_int getInfo(cl_mem_info name, T* param) const
+    explicit EventWaitList(const Event& event) :
+        events_(&event),
+        size_(1) { }
+
+    size_type size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    const Event* data() const { return events_; }
+
+    //! \brief Returns the events as an array of cl_event, or nullptr if empty.
+    const cl_event* get() const
     {
-        return detail::errHandler(
-            detail::getInfo(&::clGetMemObjectInfo, object_, name, param),
-            __GET_MEM_OBJECT_INFO_ERR);
+        static_assert(sizeof(cl::Event) == sizeof(cl_event),
+        "Size of cl::Event must be equal to size of cl_event");
+
+        return reinterpret_cast<const cl_event*>(events_);
     }
+};
 
-    //! \brief Wrapper for clGetMemObjectInfo() that returns by value.
-    template <cl_mem_info name> typename
-    detail::param_traits<detail::cl_mem_info, name>::param_type
+/*! \brief Fixed-capacity list of events stored inline.
+ *
+ *  Holds up to N events without allocating, and converts implicitly to an
+ *  EventWaitList so it can be passed to any enqueue function.
+ */
+template <size_type N>
+class EventList
+{
+private:
+    Event events_[N];
+    size_type size_;
+
+public:
+    EventList() : size_(0) { }
+
+    EventList(std::initializer_list<Event> events) : size_(0)
+    {
+        for (const Event& event : events) {
+            push_back(event);
+        }
+    }
+
+    /*! \brief Appends an event.
+     *
+     *  \return CL_SUCCESS, or CL_OUT_OF_RESOURCES if the list is full.
+     */
+    cl_int push_back(Event event)
+    {
+        if (size_ == N) {
+            return detail::errHandler(CL_OUT_OF_RESOURCES, __EVENT_LIST_FULL_ERR);
+        }
+        events_[size_++] = std::move(event);
+        return CL_SUCCESS;
+    }
+
+    void clear()
+    {
+        while (size_ > 0) {
+            events_[--size_] = Event();
+        }
+    }
+
+    size_type size() const { return size_; }
+
+    static constexpr size_type capacity() { return N; }
+
+    bool empty() const { return size_ == 0; }
+
+    Event& operator[](size_type index) { return events_[index]; }
+
+    const Event& operator[](size_type index) const { return events_[index]; }
+
+    const Event* begin() const { return events_; }
+
+    const Event* end() const { return events_ + size_; }
+
+    operator EventWaitList() const
+    {
+        return EventWaitList(events_, size_);
+    }
+};
+
+/*! \brief Class interface for cl_mem.
+ *
+ *  \note Copies of these objects are shallow, meaning that the copy will refer
+ *        to the same underlying cl_mem as the original.  For details, see
+ *        clRetainMemObject() and clReleaseMemObject().
+ *
+ *  \see cl_mem
+ */
+class Memory : public detail::Wrapper<cl_mem>
+{
+public:
+    //! \brief Default constructor - initializes to nullptr.
+    Memory() : detail::Wrapper<cl_type>() { }
+
+    /*! \brief Constructor from cl_mem - takes ownership.
+     *
+     *  Optionally transfer ownership of a refcount on the cl_mem
+     *  into the new Memory object.
+     *
+     * \param retainObject will cause the constructor to retain its cl object.
+     *                     Defaults to false to maintain compatibility with
+     *                     earlier versions.
+     *
+     *  See Memory for further details.
+     */
+    explicit Memory(const cl_mem& memory, bool retainObject) :
+        detail::Wrapper<cl_type>(memory, retainObject) { }
+
+    /*! \brief Assignment operator from cl_mem - takes ownership.
+     *
+     *  This effectively transfers ownership of a refcount on the rhs and calls
+     *  clReleaseMemObject() on the value previously held by this instance.
+     */
+    Memory& operator = (const cl_mem& rhs)
+    {
+        detail::Wrapper<cl_type>::operator=(rhs);
+        return *this;
+    }
+
+    //! \brief Wrapper for clGetMemObjectInfo().
+    template <typename T>
+    cl_int getInfo(cl_mem_info name, T* param) const
+    {
+        return detail::errHandler(
+            detail::getInfo(&::clGetMemObjectInfo, object_, name, param),
+            __GET_MEM_OBJECT_INFO_ERR);
+    }
+
+    //! \brief Wrapper for clGetMemObjectInfo() that returns by value.
+    template <cl_mem_info name> typename
+    detail::param_traits<detail::cl_mem_info, name>::param_type
     getInfo(cl_int* err = nullptr) const
     {
         typename detail::param_traits<
@@ -3780,6 +4905,8 @@ template< typename IteratorType >
 cl_int copy( const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer );
 template< typename IteratorType >
 cl_int copy( const CommandQueue &queue, const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator );
+template< typename IteratorType >
+cl_int copy( StagingRing &ring, IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer );
 
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
@@ -3863,6 +4990,15 @@ public:
 };
 
 // Pre-declare SVM map function
+template<typename T>
+inline cl_int enqueueMapSVM(
+    T* ptr,
+    cl_bool blocking,
+    cl_map_flags flags,
+    size_type size,
+    EventWaitList events,
+    Event* event = nullptr);
+
 template<typename T>
 inline cl_int enqueueMapSVM(
     T* ptr,
@@ -4047,6 +5183,23 @@ public:
     friend class SVMAllocator;
 };
 
+namespace detail
+{
+    /*! \brief Tells the allocator of a container when the container is
+     *  mapped or unmapped through CommandQueue.
+     *
+     *  Allocators that reuse coarse-grained memory specialize this to learn
+     *  whether the memory they get back is still mapped.
+     */
+    template<class Alloc>
+    struct SVMMapState
+    {
+        static void set(const Alloc&, void*, bool)
+        {
+        }
+    };
+} // namespace detail
+
 #if !defined(CL_HPP_NO_STD_UNIQUE_PTR)
 namespace detail
 {
@@ -4225,7 +5378,7 @@ public:
         cl_mem_flags flags,
         size_type size,
         void* host_ptr = nullptr,
-        cl_int* err = nullptr) : Buffer(Context::getDefault(err), flags, size, host_ptr, err) { }
+        cl_int* err = nullptr) : Buffer(Context::getDefaultRef(err), flags, size, host_ptr, err) { }
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 300
     /*! \brief Constructs a Buffer in the default context and with specified properties.
@@ -4245,7 +5398,7 @@ public:
         cl_mem_flags flags,
         size_type size,
         void* host_ptr = nullptr,
-        cl_int* err = nullptr) : Buffer(Context::getDefault(err), properties, flags, size, host_ptr, err) { }
+        cl_int* err = nullptr) : Buffer(Context::getDefaultRef(err), properties, flags, size, host_ptr, err) { }
 #endif
 
     /*!
@@ -4277,7 +5430,7 @@ public:
         
         size_type size = sizeof(DataType)*(endIterator - startIterator);
 
-        Context context = Context::getDefault(err);
+        const Context& context = Context::getDefaultRef(err);
 
         if( useHostPtr ) {
             object_ = ::clCreateBuffer(context(), flags, size, const_cast<DataType*>(&*startIterator), &error);
@@ -4316,6 +5469,35 @@ public:
     Buffer(const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator,
         bool readOnly, bool useHostPtr = false, cl_int* err = nullptr);
 
+    /*!
+    * \brief Construct a Buffer from a host container via iterators, uploading
+    * the data in chunks through the staging buffers of ring.
+    * The Buffer is created in the context of the ring's queue.
+    */
+    template< typename IteratorType >
+    Buffer(StagingRing &ring, IteratorType startIterator, IteratorType endIterator,
+        bool readOnly, cl_int* err = nullptr);
+
+#if defined(CL_HPP_ENABLE_FILE_BUFFER) && CL_HPP_TARGET_OPENCL_VERSION >= 110
+    /*!
+    * \brief Creates a Buffer with the contents of the file at path, in the
+    * context of queue.
+    *
+    * The file is memory-mapped. If the device of queue shares memory with
+    * the host, the Buffer is created with CL_MEM_USE_HOST_PTR over the
+    * mapping, so the data is never copied; the mapping is released by a
+    * destructor callback once the Buffer is. Other devices get a Buffer
+    * filled through a StagingRing on queue, after which the file is unmapped.
+    *
+    * The mapping is copy-on-write, so the file itself is never modified.
+    */
+    static Buffer createFromFile(
+        const CommandQueue &queue,
+        const string &path,
+        cl_mem_flags flags = CL_MEM_READ_ONLY,
+        cl_int* err = nullptr);
+#endif // #if defined(CL_HPP_ENABLE_FILE_BUFFER) && CL_HPP_TARGET_OPENCL_VERSION >= 110
+
     //! \brief Default constructor - initializes to nullptr.
     Buffer() : Memory() { }
 
@@ -4370,6 +5552,300 @@ public:
 #endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
 };
 
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+/*! \class BufferPool
+ * \brief Sub-allocates buffers from large parent buffers.
+ *
+ * Each allocation is a sub-buffer created with Buffer::createSubBuffer, so it
+ * can be used anywhere a Buffer is accepted and copied freely. Requests are
+ * rounded up to power-of-two size classes of at least the largest
+ * CL_DEVICE_MEM_BASE_ADDR_ALIGN of the devices in the context. A range goes
+ * back to the free list of its size class once the OpenCL implementation has
+ * destroyed the sub-buffer, that is after the last wrapper was released and
+ * the commands using it have completed. Ranges are not coalesced.
+ *
+ * Parent buffers are created on demand and kept until the pool and all of
+ * its allocations are gone. Requests larger than the block size get a parent
+ * buffer of their own, which is released with the allocation. All member
+ * functions are thread safe.
+ */
+class BufferPool
+{
+public:
+    //! \brief Memory use of a BufferPool, in bytes unless noted otherwise.
+    struct Statistics
+    {
+        //! Number of parent buffers
+        size_type blocks;
+        //! Size of all parent buffers
+        size_type reserved;
+        //! Size requested by the live allocations
+        size_type requested;
+        //! Size of the size classes of the live allocations
+        size_type allocated;
+        //! Size of the ranges waiting in free lists
+        size_type free;
+        //! Number of live allocations
+        size_type allocations;
+    };
+
+private:
+    struct Block
+    {
+        Buffer buffer_;
+        size_type size_;
+        // Ranges past this offset have never been allocated
+        size_type used_;
+        // Holds a single allocation larger than the block size
+        bool dedicated_;
+    };
+
+    struct Range
+    {
+        size_type block_;
+        size_type origin_;
+    };
+
+    struct State
+    {
+        std::mutex mutex_;
+        Context context_;
+        cl_mem_flags flags_;
+        size_type blockSize_;
+        size_type alignment_;
+        vector<Block> blocks_;
+        // Keyed by size class
+        std::map<size_type, vector<Range>> free_;
+        Statistics statistics_;
+    };
+
+    // Owned by the destructor callback of an allocation
+    struct Allocation
+    {
+        std::shared_ptr<State> state_;
+        Range range_;
+        size_type sizeClass_;
+        size_type requested_;
+    };
+
+    std::shared_ptr<State> state_;
+
+    // Returns 0 when size cannot be rounded up to a power of two
+    size_type sizeClass(size_type size) const
+    {
+        if (size > (std::numeric_limits<size_type>::max)() / 2 + 1) {
+            return 0;
+        }
+        size_type sizeClass = state_->alignment_;
+        while (sizeClass < size) {
+            sizeClass <<= 1;
+        }
+        return sizeClass;
+    }
+
+    // Called with the lock held
+    cl_int reserve(size_type sizeClass, Range* range)
+    {
+        State& state = *state_;
+        std::map<size_type, vector<Range>>::iterator list = state.free_.find(sizeClass);
+        if (list != state.free_.end() && !list->second.empty()) {
+            *range = list->second.back();
+            list->second.pop_back();
+            state.statistics_.free -= sizeClass;
+            return CL_SUCCESS;
+        }
+
+        for (size_type i = 0; i < state.blocks_.size(); ++i) {
+            Block& block = state.blocks_[i];
+            if (block.size_ - block.used_ >= sizeClass) {
+                range->block_ = i;
+                range->origin_ = block.used_;
+                block.used_ += sizeClass;
+                return CL_SUCCESS;
+            }
+        }
+
+        // Requests larger than a block get a parent buffer of their own
+        bool dedicated = sizeClass > state.blockSize_;
+        size_type size = dedicated ? sizeClass : state.blockSize_;
+        cl_int error;
+        Buffer buffer(state.context_, state.flags_, size, nullptr, &error);
+        if (error != CL_SUCCESS) {
+            return error;
+        }
+        Block block = { std::move(buffer), size, sizeClass, dedicated };
+
+        // Reuse the slot of a released dedicated parent, ranges refer to
+        // blocks by index
+        size_type index = 0;
+        while (index < state.blocks_.size() && state.blocks_[index].buffer_() != nullptr) {
+            ++index;
+        }
+        if (index < state.blocks_.size()) {
+            state.blocks_[index] = std::move(block);
+        }
+        else {
+            state.blocks_.push_back(std::move(block));
+        }
+        state.statistics_.blocks += 1;
+        state.statistics_.reserved += size;
+        range->block_ = index;
+        range->origin_ = 0;
+        return CL_SUCCESS;
+    }
+
+    static void CL_CALLBACK onRelease(cl_mem, void* user_data)
+    {
+        std::unique_ptr<Allocation> allocation(static_cast<Allocation*>(user_data));
+        State& state = *allocation->state_;
+        // Released after the lock
+        Buffer parent;
+        std::lock_guard<std::mutex> lock(state.mutex_);
+        Block& block = state.blocks_[allocation->range_.block_];
+        if (block.dedicated_) {
+            parent = std::move(block.buffer_);
+            state.statistics_.blocks -= 1;
+            state.statistics_.reserved -= block.size_;
+            block.size_ = 0;
+            block.used_ = 0;
+            block.dedicated_ = false;
+        }
+        else {
+            state.free_[allocation->sizeClass_].push_back(allocation->range_);
+            state.statistics_.free += allocation->sizeClass_;
+        }
+        state.statistics_.allocated -= allocation->sizeClass_;
+        state.statistics_.requested -= allocation->requested_;
+        state.statistics_.allocations -= 1;
+    }
+
+public:
+    /*! \brief Creates a pool of buffers in context.
+     *
+     *  \param flags Used to create the parent buffers. The access flags
+     *  among them are also passed to createSubBuffer.
+     *  \param blockSize Size of the parent buffers.
+     */
+    BufferPool(
+        const Context& context,
+        cl_mem_flags flags = CL_MEM_READ_WRITE,
+        size_type blockSize = 16 * 1024 * 1024,
+        cl_int* err = nullptr) :
+        state_(std::make_shared<State>())
+    {
+        state_->context_ = context;
+        state_->flags_ = flags;
+        state_->blockSize_ = blockSize;
+        state_->alignment_ = 1;
+        Statistics statistics = { 0, 0, 0, 0, 0, 0 };
+        state_->statistics_ = statistics;
+
+        cl_int error;
+        vector<Device> devices = context.getInfo<CL_CONTEXT_DEVICES>(&error);
+        for (size_type i = 0; i < devices.size() && error == CL_SUCCESS; ++i) {
+            // Reported in bits
+            cl_uint align = devices[i].getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>(&error) / 8;
+            if (error == CL_SUCCESS && align > state_->alignment_) {
+                state_->alignment_ = align;
+            }
+        }
+
+        if (err != nullptr) {
+            *err = error;
+        }
+    }
+
+    //! \brief Allocates a buffer of at least size bytes.
+    Buffer allocate(size_type size, cl_int* err = nullptr)
+    {
+        size_type sizeClass = this->sizeClass(size);
+        if (sizeClass == 0) {
+            detail::errHandler(CL_INVALID_BUFFER_SIZE, __CREATE_BUFFER_ERR);
+            if (err != nullptr) {
+                *err = CL_INVALID_BUFFER_SIZE;
+            }
+            return Buffer();
+        }
+        std::unique_ptr<Allocation> allocation(new Allocation());
+        allocation->state_ = state_;
+        allocation->sizeClass_ = sizeClass;
+        allocation->requested_ = size;
+
+        cl_int error;
+        Buffer parent;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex_);
+            error = reserve(sizeClass, &allocation->range_);
+            if (error == CL_SUCCESS) {
+                parent = state_->blocks_[allocation->range_.block_].buffer_;
+                state_->statistics_.allocated += sizeClass;
+                state_->statistics_.requested += size;
+                state_->statistics_.allocations += 1;
+            }
+        }
+
+        if (error != CL_SUCCESS) {
+            if (err != nullptr) {
+                *err = error;
+            }
+            return Buffer();
+        }
+
+        cl_buffer_region region = { allocation->range_.origin_, size };
+        Buffer result(::clCreateSubBuffer(
+            parent(),
+            state_->flags_ & (CL_MEM_READ_WRITE | CL_MEM_WRITE_ONLY | CL_MEM_READ_ONLY),
+            CL_BUFFER_CREATE_TYPE_REGION,
+            &region,
+            &error));
+        const char* errStr = __CREATE_SUBBUFFER_ERR;
+        if (error == CL_SUCCESS) {
+            error = ::clSetMemObjectDestructorCallback(result(), onRelease, allocation.get());
+            errStr = __SET_MEM_OBJECT_DESTRUCTOR_CALLBACK_ERR;
+        }
+        if (error == CL_SUCCESS) {
+            allocation.release();
+        }
+        else {
+            // Nothing can be using the range yet
+            result = Buffer();
+            onRelease(nullptr, allocation.release());
+        }
+        detail::errHandler(error, errStr);
+
+        if (err != nullptr) {
+            *err = error;
+        }
+        return result;
+    }
+
+    //! \brief Allocates a buffer of count elements of type T.
+    template <typename T>
+    Buffer allocate(size_type count, cl_int* err = nullptr)
+    {
+        return allocate(count * sizeof(T), err);
+    }
+
+    //! \brief Returns the alignment of allocations in bytes.
+    size_type getAlignment() const
+    {
+        return state_->alignment_;
+    }
+
+    /*! \brief Returns the current memory use of the pool.
+     *
+     *  allocated - requested is lost to rounding up to size classes, free is
+     *  lost to ranges of size classes that are not being requested, and
+     *  reserved - allocated - free has not been handed out yet.
+     */
+    Statistics getStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        return state_->statistics_;
+    }
+};
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
+
 #if defined (CL_HPP_USE_DX_INTEROP)
 /*! \brief Class interface for creating OpenCL buffers from ID3D10Buffer's.
  *
@@ -5458,7 +6934,7 @@ public:
     {
         cl_int error;
 
-        Context context = Context::getDefault(err);
+        const Context& context = Context::getDefaultRef(err);
 
         cl_mem_flags flags = CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS;
         object_ = ::clCreatePipe(context(), flags, packet_size, max_packets, nullptr, &error);
@@ -5756,37 +7232,319 @@ struct KernelArgumentHandler<LocalSpaceArg, void>
     static const void* ptr(const LocalSpaceArg&) { return nullptr; }
 };
 
-} 
-//! \endcond
+//! \brief Whether Kernel::setArg passes a T as an SVM pointer.
+template <typename T>
+struct KernelSVMArg
+{
+    static const bool value = false;
+};
 
-/*! Local
- * \brief Helper function for generating LocalSpaceArg objects.
- */
-inline LocalSpaceArg
-Local(size_type size)
+template <typename T>
+struct KernelSVMArg<T*>
 {
-    LocalSpaceArg ret = { size };
-    return ret;
-}
+    static const bool value = true;
+    static const void* get(const T* ptr) { return ptr; }
+};
 
-/*! \brief Class interface for cl_kernel.
- *
- *  \note Copies of these objects are shallow, meaning that the copy will refer
- *        to the same underlying cl_kernel as the original.  For details, see
- *        clRetainKernel() and clReleaseKernel().
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+template <typename T, class D>
+struct KernelSVMArg<cl::pointer<T, D>>
+{
+    static const bool value = true;
+    static const void* get(const cl::pointer<T, D>& ptr) { return ptr.get(); }
+};
+
+template <typename T, class Alloc>
+struct KernelSVMArg<cl::vector<T, Alloc>>
+{
+    static const bool value = true;
+    static const void* get(const cl::vector<T, Alloc>& vec) { return vec.data(); }
+};
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+/*! \brief Last value successfully set for each argument of a kernel.
  *
- *  \see cl_kernel
+ *  Values are compared bytewise. The objects behind remembered memory
+ *  object, sampler and queue handles are retained, so that their handles
+ *  cannot be reused by new objects meanwhile.
  */
-class Kernel : public detail::Wrapper<cl_kernel>
+class KernelArgShadow
 {
-public:
-    inline Kernel(const Program& program, const char* name, cl_int* err = nullptr);
+private:
+    struct Arg
+    {
+        bool valid_;
+        bool svm_;
+        size_type size_;
+        bool hasValue_;
+        vector<unsigned char> value_;
+        Wrapper<cl_mem> memory_;
+        Wrapper<cl_sampler> sampler_;
+        Wrapper<cl_command_queue> queue_;
+
+        Arg() : valid_(false), svm_(false), size_(0), hasValue_(false) { }
+    };
 
-    //! \brief Default constructor - initializes to nullptr.
-    Kernel() { }
+    vector<Arg> args_;
+    size_type hits_;
 
-    /*! \brief Constructor from cl_kernel - takes ownership.
-     * 
+public:
+    KernelArgShadow() : hits_(0) { }
+
+    //! \brief Returns true if the argument already holds exactly this value.
+    bool matches(cl_uint index, bool svm, size_type size, const void* value)
+    {
+        if (index >= args_.size() || !args_[index].valid_) {
+            return false;
+        }
+
+        const Arg& arg = args_[index];
+        if (arg.svm_ != svm || arg.size_ != size || arg.hasValue_ != (value != nullptr)) {
+            return false;
+        }
+        if (value != nullptr && std::memcmp(arg.value_.data(), value, size) != 0) {
+            return false;
+        }
+        ++hits_;
+        return true;
+    }
+
+    /*! \brief Records the outcome of setting an argument.
+     *
+     *  A failed call leaves the argument in an unknown state, so it is
+     *  forgotten rather than recorded.
+     */
+    void update(cl_uint index, bool svm, size_type size, const void* value, bool succeeded)
+    {
+        if (index >= args_.size()) {
+            if (!succeeded) {
+                return;
+            }
+            args_.resize(index + 1);
+        }
+
+        Arg& arg = args_[index];
+        arg.valid_ = succeeded;
+        arg.memory_ = Wrapper<cl_mem>();
+        arg.sampler_ = Wrapper<cl_sampler>();
+        arg.queue_ = Wrapper<cl_command_queue>();
+        if (!succeeded) {
+            return;
+        }
+        arg.svm_ = svm;
+        arg.size_ = size;
+        arg.hasValue_ = (value != nullptr);
+        if (value != nullptr) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(value);
+            arg.value_.assign(bytes, bytes + size);
+        }
+    }
+
+    //! \brief Keeps the object behind a remembered handle alive.
+    void hold(cl_uint index, const Wrapper<cl_mem>* memory)
+    {
+        args_[index].memory_ = *memory;
+    }
+
+    void hold(cl_uint index, const Wrapper<cl_sampler>* sampler)
+    {
+        args_[index].sampler_ = *sampler;
+    }
+
+    void hold(cl_uint index, const Wrapper<cl_command_queue>* queue)
+    {
+        args_[index].queue_ = *queue;
+    }
+
+    // Other arguments are plain values
+    void hold(cl_uint, const void*)
+    {
+    }
+
+    void clear()
+    {
+        args_.clear();
+    }
+
+    size_type hits() const { return hits_; }
+
+    void resetCounters()
+    {
+        hits_ = 0;
+    }
+};
+
+/*! \brief Argument shadows of the kernels with shadowing enabled.
+ *
+ *  Keyed by cl_kernel, so every Kernel wrapping the same handle shares one
+ *  shadow, whenever it was copied. Kernels are spread over sharded locks,
+ *  and a lookup takes no lock unless a shadowed kernel hashes to the same
+ *  slot.
+ */
+class KernelArgShadowTable
+{
+private:
+    typedef std::map<cl_kernel, std::shared_ptr<KernelArgShadow>> Shadows;
+
+    static const size_type numSlots_ = 1024;
+    static const size_type numShards_ = 64;
+
+    struct Shard
+    {
+        std::mutex mutex_;
+        Shadows shadows_;
+    };
+
+    Shard shards_[numShards_];
+    // Number of shadowed kernels hashing to each slot
+    std::atomic<cl_uint> slots_[numSlots_];
+
+    KernelArgShadowTable()
+    {
+        for (std::atomic<cl_uint>& slot : slots_) {
+            slot = 0;
+        }
+    }
+
+    // Handles are at least 16 byte aligned in practice
+    static size_type slot(cl_kernel kernel)
+    {
+        return (reinterpret_cast<size_type>(kernel) >> 4) % numSlots_;
+    }
+
+    Shard& shard(cl_kernel kernel)
+    {
+        return shards_[slot(kernel) % numShards_];
+    }
+
+public:
+    // Never destroyed, so that kernels released during static
+    // destruction can still look themselves up
+    static KernelArgShadowTable& instance()
+    {
+        static KernelArgShadowTable* table = new KernelArgShadowTable();
+        return *table;
+    }
+
+    std::shared_ptr<KernelArgShadow> find(cl_kernel kernel)
+    {
+        if (slots_[slot(kernel)] == 0) {
+            return nullptr;
+        }
+        Shard& shard = this->shard(kernel);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        Shadows::const_iterator it = shard.shadows_.find(kernel);
+        return it != shard.shadows_.end() ? it->second : nullptr;
+    }
+
+    //! \brief Starts shadowing a kernel, keeping an existing shadow.
+    void insert(cl_kernel kernel, const KernelArgShadow& shadow = KernelArgShadow())
+    {
+        Shard& shard = this->shard(kernel);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        if (shard.shadows_.find(kernel) == shard.shadows_.end()) {
+            shard.shadows_[kernel] = std::make_shared<KernelArgShadow>(shadow);
+            ++slots_[slot(kernel)];
+        }
+    }
+
+    void erase(cl_kernel kernel)
+    {
+        // Released outside the lock, since it may release held objects
+        std::shared_ptr<KernelArgShadow> shadow;
+        Shard& shard = this->shard(kernel);
+        std::lock_guard<std::mutex> lock(shard.mutex_);
+        Shadows::iterator it = shard.shadows_.find(kernel);
+        if (it != shard.shadows_.end()) {
+            shadow = std::move(it->second);
+            shard.shadows_.erase(it);
+            --slots_[slot(kernel)];
+        }
+    }
+};
+
+// The handle of a released kernel may be reused, so its shadow is dropped
+// with the last reference
+inline void releaseKernelArgShadow(cl_kernel kernel)
+{
+    KernelArgShadowTable& table = KernelArgShadowTable::instance();
+    if (!table.find(kernel)) {
+        return;
+    }
+    cl_uint count = 0;
+    if (::clGetKernelInfo(kernel, CL_KERNEL_REFERENCE_COUNT, sizeof(count), &count, nullptr) == CL_SUCCESS &&
+        count == 1) {
+        table.erase(kernel);
+    }
+}
+
+} 
+//! \endcond
+
+/*! Local
+ * \brief Helper function for generating LocalSpaceArg objects.
+ */
+inline LocalSpaceArg
+Local(size_type size)
+{
+    LocalSpaceArg ret = { size };
+    return ret;
+}
+
+/*! \brief Class interface for cl_kernel.
+ *
+ *  \note Copies of these objects are shallow, meaning that the copy will refer
+ *        to the same underlying cl_kernel as the original.  For details, see
+ *        clRetainKernel() and clReleaseKernel().
+ *
+ *  \see cl_kernel
+ */
+class Kernel : public detail::Wrapper<cl_kernel>
+{
+private:
+    // value is the argument object, or nullptr if it is not to be shadowed
+    template <typename T>
+    cl_int setArgHelper(cl_uint index, size_type size, const void* argPtr, const T* value)
+    {
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        if (shadow && value != nullptr && shadow->matches(index, false, size, argPtr)) {
+            return CL_SUCCESS;
+        }
+        cl_int error = ::clSetKernelArg(object_, index, size, argPtr);
+        if (shadow) {
+            // Values that cannot be shadowed are forgotten
+            bool remembered = value != nullptr && error == CL_SUCCESS;
+            shadow->update(index, false, size, argPtr, remembered);
+            if (remembered) {
+                shadow->hold(index, value);
+            }
+        }
+        return detail::errHandler(error, __SET_KERNEL_ARGS_ERR);
+    }
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    cl_int setArgSVMPointerHelper(cl_uint index, const void* argPtr)
+    {
+        cl_int error = ::clSetKernelArgSVMPointer(object_, index, argPtr);
+        // An SVM pointer may be freed and reallocated at the same address
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        if (shadow) {
+            shadow->update(index, true, sizeof(argPtr), &argPtr, false);
+        }
+        return detail::errHandler(error, __SET_KERNEL_ARGS_ERR);
+    }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+public:
+    inline Kernel(const Program& program, const char* name, cl_int* err = nullptr);
+
+    //! \brief Default constructor - initializes to nullptr.
+    Kernel() { }
+
+    /*! \brief Constructor from cl_kernel - takes ownership.
+     * 
      * \param retainObject will cause the constructor to retain its cl object.
      *                     Defaults to false to maintain compatibility with
      *                     earlier versions.
@@ -5807,6 +7565,70 @@ public:
         return *this;
     }
 
+    /*! \brief Enables or disables skipping of redundant setArg calls.
+     *
+     *  While enabled, the last value successfully set for each argument of
+     *  the cl_kernel is remembered, and setArg does not call the driver again
+     *  when the new value is bytewise identical. The setting belongs to the
+     *  cl_kernel, so it is shared by every Kernel object wrapping it.
+     *
+     *  Memory objects, samplers and device queues are compared by handle,
+     *  and the remembered ones are retained until the argument changes or
+     *  shadowing is disabled, so that no new object can reuse a remembered
+     *  handle. SVM pointers and arguments set through setArg(index, size,
+     *  ptr) are always passed on, since an SVM allocation may be freed and
+     *  a new one made at the same address.
+     *
+     *  \note Arguments set on the cl_kernel by calling the C API directly
+     *        are not seen. Call invalidateArgShadow() after doing so.
+     */
+    void enableArgShadowing(bool enabled = true)
+    {
+        if (object_ == nullptr) {
+            return;
+        }
+        if (enabled) {
+            detail::KernelArgShadowTable::instance().insert(object_);
+        }
+        else {
+            detail::KernelArgShadowTable::instance().erase(object_);
+        }
+    }
+
+    bool isArgShadowingEnabled() const
+    {
+        return static_cast<bool>(detail::KernelArgShadowTable::instance().find(object_));
+    }
+
+    //! \brief Forgets all remembered argument values.
+    void invalidateArgShadow()
+    {
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        if (shadow) {
+            shadow->clear();
+        }
+    }
+
+    /*! \brief Number of setArg calls skipped because the remembered value
+     *         was identical.
+     */
+    size_type getArgShadowHits() const
+    {
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        return shadow ? shadow->hits() : 0;
+    }
+
+    void resetArgShadowCounters()
+    {
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        if (shadow) {
+            shadow->resetCounters();
+        }
+    }
+
 
 
 
@@ -5917,9 +7739,7 @@ public:
     template<typename T, class D>
     cl_int setArg(cl_uint index, const cl::pointer<T, D> &argPtr)
     {
-        return detail::errHandler(
-            ::clSetKernelArgSVMPointer(object_, index, argPtr.get()),
-            __SET_KERNEL_ARGS_ERR);
+        return setArgSVMPointerHelper(index, argPtr.get());
     }
 
     /*! \brief setArg overload taking a vector type.
@@ -5927,9 +7747,7 @@ public:
     template<typename T, class Alloc>
     cl_int setArg(cl_uint index, const cl::vector<T, Alloc> &argPtr)
     {
-        return detail::errHandler(
-            ::clSetKernelArgSVMPointer(object_, index, argPtr.data()),
-            __SET_KERNEL_ARGS_ERR);
+        return setArgSVMPointerHelper(index, argPtr.data());
     }
 
     /*! \brief setArg overload taking a pointer type
@@ -5938,9 +7756,7 @@ public:
     typename std::enable_if<std::is_pointer<T>::value, cl_int>::type
         setArg(cl_uint index, const T argPtr)
     {
-        return detail::errHandler(
-            ::clSetKernelArgSVMPointer(object_, index, argPtr),
-            __SET_KERNEL_ARGS_ERR);
+        return setArgSVMPointerHelper(index, argPtr);
     }
 #endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
@@ -5950,20 +7766,16 @@ public:
     typename std::enable_if<!std::is_pointer<T>::value, cl_int>::type
         setArg(cl_uint index, const T &value)
     {
-        return detail::errHandler(
-            ::clSetKernelArg(
-                object_,
-                index,
-                detail::KernelArgumentHandler<T>::size(value),
-                detail::KernelArgumentHandler<T>::ptr(value)),
-            __SET_KERNEL_ARGS_ERR);
+        return setArgHelper(
+            index,
+            detail::KernelArgumentHandler<T>::size(value),
+            detail::KernelArgumentHandler<T>::ptr(value),
+            &value);
     }
 
     cl_int setArg(cl_uint index, size_type size, const void* argPtr)
     {
-        return detail::errHandler(
-            ::clSetKernelArg(object_, index, size, argPtr),
-            __SET_KERNEL_ARGS_ERR);
+        return setArgHelper<void>(index, size, argPtr, nullptr);
     }
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
@@ -6087,17 +7899,193 @@ public:
      * @return A new kernel object with internal state entirely separate from that
      *         of the original but with any arguments set on the original intact.
      */
-    Kernel clone()
+    Kernel clone(cl_int* err = nullptr)
     {
         cl_int error;
-        Kernel retValue(clCloneKernel(this->get(), &error));
+        Kernel retValue = cloneHelper(&error);
 
         detail::errHandler(error, __CLONE_KERNEL_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
+        return retValue;
+    }
+
+private:
+    friend class KernelPool;
+
+    // clone() without the error handler, so that callers can recover
+    Kernel cloneHelper(cl_int* error) const
+    {
+        Kernel retValue(clCloneKernel(this->get(), error));
+
+        // The clone starts with the same arguments but tracks them separately
+        std::shared_ptr<detail::KernelArgShadow> shadow =
+            detail::KernelArgShadowTable::instance().find(object_);
+        if (shadow && *error == CL_SUCCESS) {
+            detail::KernelArgShadow cloneShadow(*shadow);
+            cloneShadow.resetCounters();
+            detail::KernelArgShadowTable::instance().insert(retValue(), cloneShadow);
+        }
         return retValue;
     }
 #endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
 };
 
+namespace detail {
+/*! \brief Joins every joinable thread of a container when it goes out of
+ *         scope, so that unwinding never destroys a running std::thread.
+ */
+template <typename Threads>
+class ThreadJoiner
+{
+private:
+    Threads& threads_;
+
+public:
+    explicit ThreadJoiner(Threads& threads) : threads_(threads) { }
+
+    ThreadJoiner(const ThreadJoiner&) = delete;
+    ThreadJoiner& operator=(const ThreadJoiner&) = delete;
+
+    ~ThreadJoiner()
+    {
+        for (std::thread& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+};
+
+/*! \brief Shared state of an asynchronous program build.
+ *
+ *  The state is owned jointly by the thread that starts the build and by
+ *  the build notification; whichever releases it last deletes it.
+ */
+class AsyncBuildState
+{
+private:
+    vector<cl_device_id> devices_;
+    std::promise<BuildResult> promise_;
+    std::once_flag completed_;
+    std::atomic<int> references_;
+
+    // Reduces the per-device build status to a single error code
+    cl_int getBuildStatus(cl_program program, const vector<cl_device_id>& devices) const
+    {
+        for (cl_device_id device : devices) {
+            cl_build_status status;
+            cl_int error = ::clGetProgramBuildInfo(
+                program, device, CL_PROGRAM_BUILD_STATUS,
+                sizeof(status), &status, nullptr);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+            if (status != CL_BUILD_SUCCESS) {
+                return CL_BUILD_PROGRAM_FAILURE;
+            }
+        }
+        return CL_SUCCESS;
+    }
+
+    BuildLogType getBuildLogs(cl_program program, const vector<cl_device_id>& devices) const
+    {
+        BuildLogType buildLogs;
+        for (cl_device_id device : devices) {
+            string log;
+            detail::getInfo(&::clGetProgramBuildInfo, program, device, CL_PROGRAM_BUILD_LOG, &log);
+            buildLogs.push_back(std::make_pair(Device(device, true), log));
+        }
+        return buildLogs;
+    }
+
+    void doComplete(cl_program program, cl_int err)
+    {
+        vector<cl_device_id> devices = devices_;
+        if (devices.empty()) {
+            cl_int error = detail::getInfo(&::clGetProgramInfo, program, CL_PROGRAM_DEVICES, &devices);
+            if (err == CL_SUCCESS) {
+                err = error;
+            }
+        }
+        if (err == CL_SUCCESS) {
+            err = getBuildStatus(program, devices);
+        }
+
+        BuildResult result;
+        result.error = err;
+        if (err != CL_SUCCESS) {
+            result.buildLogs = getBuildLogs(program, devices);
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+            promise_.set_exception(std::make_exception_ptr(
+                BuildError(err, __BUILD_PROGRAM_ERR, result.buildLogs)));
+            return;
+#endif // #if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        }
+        promise_.set_value(std::move(result));
+    }
+
+public:
+    explicit AsyncBuildState(const vector<cl_device_id>& devices) :
+        devices_(devices), references_(2) { }
+
+    std::future<BuildResult> getFuture()
+    {
+        return promise_.get_future();
+    }
+
+    //! \brief Publishes the result of the build; later calls have no effect.
+    void complete(cl_program program, cl_int err)
+    {
+        std::call_once(completed_, [&]() { doComplete(program, err); });
+    }
+
+    void release()
+    {
+        if (--references_ == 0) {
+            delete this;
+        }
+    }
+
+    static void CL_CALLBACK notify(cl_program program, void* data)
+    {
+        AsyncBuildState* state = static_cast<AsyncBuildState*>(data);
+        state->complete(program, CL_SUCCESS);
+        state->release();
+    }
+};
+
+inline std::future<BuildResult> buildProgramAsync(
+    cl_program program,
+    const vector<cl_device_id>& devices,
+    const char* options)
+{
+    AsyncBuildState* state = new AsyncBuildState(devices);
+    std::future<BuildResult> result = state->getFuture();
+
+    cl_int error = ::clBuildProgram(
+        program,
+        (cl_uint)devices.size(),
+        devices.empty() ? nullptr : devices.data(),
+        options,
+        &AsyncBuildState::notify,
+        state);
+
+    if (error != CL_SUCCESS) {
+        state->complete(program, error);
+        // A build that could not be started never calls the notification,
+        // but a failed build may still call it from another thread, so the
+        // notification keeps its reference in that case.
+        if (error != CL_BUILD_PROGRAM_FAILURE) {
+            state->release();
+        }
+    }
+    state->release();
+    return result;
+}
+} // namespace detail
+
 /*! \class Program
  * \brief Program interface that implements cl_program.
  */
@@ -6122,7 +8110,7 @@ public:
         const char * strings = source.c_str();
         const size_type length  = source.size();
 
-        Context context = Context::getDefault(err);
+        const Context& context = Context::getDefaultRef(err);
 
         object_ = ::clCreateProgramWithSource(
             context(), (cl_uint)1, &strings, &length, &error);
@@ -6143,7 +8131,8 @@ public:
                 nullptr,
                 nullptr);
 
-            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
         }
 
         if (err != nullptr) {
@@ -6180,7 +8169,8 @@ public:
                 nullptr,
                 nullptr);
             
-            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
         }
 
         if (err != nullptr) {
@@ -6197,7 +8187,7 @@ public:
         cl_int* err = nullptr)
     {
         cl_int error;
-        Context context = Context::getDefault(err);
+        const Context& context = Context::getDefaultRef(err);
 
         const size_type n = (size_type)sources.size();
 
@@ -6272,7 +8262,7 @@ public:
     {
         cl_int error;
 
-        Context context = Context::getDefault(err);
+        const Context& context = Context::getDefaultRef(err);
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 210
 
@@ -6306,7 +8296,8 @@ public:
                 nullptr,
                 nullptr);
 
-            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
         }
 
         if (err != nullptr) {
@@ -6359,7 +8350,8 @@ public:
                 nullptr,
                 nullptr);
 
-            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+            detail::buildErrHandler(error, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
         }
 
         if (err != nullptr) {
@@ -6521,18 +8513,89 @@ public:
             notifyFptr,
             data);
 
-        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
     }
 
-    cl_int build(
-        const Device& device,
+    /*! \brief Builds the program for several devices in parallel.
+     *
+     *  Issues one clBuildProgram() call per device from a pool of worker
+     *  threads, so that implementations which compile for one device at a
+     *  time can use several host cores. The results and build logs of all
+     *  devices are joined as for build(const vector<Device>&, ...).
+     *
+     *  \param numThreads Number of worker threads. Zero selects
+     *                    std::thread::hardware_concurrency(). No more
+     *                    threads than devices are ever started. If a
+     *                    thread cannot be started, the calling thread builds
+     *                    for the remaining devices itself.
+     */
+    cl_int buildParallel(
+        const vector<Device>& devices,
         const char* options = nullptr,
-        void (CL_CALLBACK * notifyFptr)(cl_program, void *) = nullptr,
-        void* data = nullptr) const
+        size_type numThreads = 0) const
     {
-        cl_device_id deviceID = device();
+        const size_type numDevices = devices.size();
+        vector<cl_int> buildErrors(numDevices, CL_SUCCESS);
+        std::atomic<size_type> next(0);
+
+        auto worker = [&]() {
+            for (size_type i = next++; i < numDevices; i = next++) {
+                cl_device_id deviceID = devices[i]();
+                buildErrors[i] = ::clBuildProgram(
+                    object_, 1, &deviceID, options, nullptr, nullptr);
+            }
+        };
 
-        cl_int buildError = ::clBuildProgram(
+        if (numThreads == 0) {
+            numThreads = std::thread::hardware_concurrency();
+        }
+        if (numThreads > numDevices) {
+            numThreads = numDevices;
+        }
+
+        // The calling thread takes part in the build
+        vector<std::thread> threads;
+        {
+            detail::ThreadJoiner<vector<std::thread>> joiner(threads);
+            try {
+                threads.reserve(numThreads);
+                for (size_type i = 1; i < numThreads; ++i) {
+                    threads.emplace_back(worker);
+                }
+            }
+            catch (...) {
+                // The calling thread builds for the devices left over
+            }
+            worker();
+        }
+
+        cl_int buildError = CL_SUCCESS;
+        for (cl_int error : buildErrors) {
+            if (error != CL_SUCCESS) {
+                buildError = error;
+                break;
+            }
+        }
+        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR,
+                [&]() {
+                    BuildLogType buildLog;
+                    for (const Device& device : devices) {
+                        buildLog.push_back(std::make_pair(device, getBuildInfo<CL_PROGRAM_BUILD_LOG>(device)));
+                    }
+                    return buildLog;
+                });
+    }
+
+    cl_int build(
+        const Device& device,
+        const char* options = nullptr,
+        void (CL_CALLBACK * notifyFptr)(cl_program, void *) = nullptr,
+        void* data = nullptr) const
+    {
+        cl_device_id deviceID = device();
+
+        cl_int buildError = ::clBuildProgram(
             object_,
             1,
             &deviceID,
@@ -6540,9 +8603,12 @@ public:
             notifyFptr,
             data);
 
-        BuildLogType buildLog(0);
-        buildLog.push_back(std::make_pair(device, getBuildInfo<CL_PROGRAM_BUILD_LOG>(device)));
-        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR, buildLog);
+        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR,
+                [&]() {
+                    BuildLogType buildLog(0);
+                    buildLog.push_back(std::make_pair(device, getBuildInfo<CL_PROGRAM_BUILD_LOG>(device)));
+                    return buildLog;
+                });
     }
 
     cl_int build(
@@ -6558,7 +8624,42 @@ public:
             notifyFptr,
             data);
 
-        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+        return detail::buildErrHandler(buildError, __BUILD_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
+    }
+
+    /*! \brief Starts building the program for the given devices without
+     *         waiting for the build to complete.
+     *
+     *  Wraps clBuildProgram() with a build notification. The returned future
+     *  becomes ready when the build completes and holds the value build()
+     *  would have returned, together with the build logs if the build
+     *  failed. When exceptions are enabled, a failed build stores a
+     *  BuildError carrying the build logs in the future instead.
+     *  The program must not be released before the future is ready.
+     */
+    std::future<BuildResult> buildAsync(
+        const vector<Device>& devices,
+        const char* options = nullptr) const
+    {
+        size_type numDevices = devices.size();
+        vector<cl_device_id> deviceIDs(numDevices);
+
+        for( size_type deviceIndex = 0; deviceIndex < numDevices; ++deviceIndex ) {
+            deviceIDs[deviceIndex] = (devices[deviceIndex])();
+        }
+
+        return detail::buildProgramAsync(object_, deviceIDs, options);
+    }
+
+    /*! \brief Starts building the program for all devices associated with
+     *         it without waiting for the build to complete.
+     *
+     *  \see buildAsync(const vector<Device>&, const char*)
+     */
+    std::future<BuildResult> buildAsync(const char* options = nullptr) const
+    {
+        return detail::buildProgramAsync(object_, vector<cl_device_id>(), options);
     }
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 120
@@ -6577,7 +8678,8 @@ public:
             nullptr,
             notifyFptr,
             data);
-        return detail::buildErrHandler(error, __COMPILE_PROGRAM_ERR, getBuildInfo<CL_PROGRAM_BUILD_LOG>());
+        return detail::buildErrHandler(error, __COMPILE_PROGRAM_ERR,
+                [this]() { return getBuildInfo<CL_PROGRAM_BUILD_LOG>(); });
     }
 #endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
 
@@ -6903,764 +9005,1091 @@ inline Kernel::Kernel(const Program& program, const char* name, cl_int* err)
 
 }
 
-#ifdef cl_khr_external_memory
-enum class ExternalMemoryType : cl_external_memory_handle_type_khr
+/*! \class KernelPool
+ * \brief Lends Kernel instances to one thread at a time.
+ *
+ * Kernel arguments are part of the state of a cl_kernel, so threads that set
+ * arguments on and enqueue the same Kernel have to serialize. A KernelPool
+ * instead gives each caller of acquire() a cl_kernel of its own, which goes
+ * back to the pool when the returned Lease goes out of scope.
+ *
+ * When targeting OpenCL 2.1 or later new instances are cloned from a
+ * prototype with clCloneKernel, so they start with the arguments set on the
+ * prototype. Otherwise, or once clCloneKernel has failed with
+ * CL_INVALID_OPERATION because the platform does not support it, they are
+ * created from the program by name and start without arguments. Instances
+ * returned to the pool keep the arguments set by their last user.
+ */
+class KernelPool
 {
-    None = 0,
+private:
+    struct State
+    {
+        std::mutex mutex_;
+        vector<Kernel> idle_;
+        Program program_;
+        string name_;
+        bool argShadowing_;
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        // Only ever cloned, never lent out
+        Kernel prototype_;
+        // Cleared when the platform turns out not to support clCloneKernel
+        bool cloning_;
 
-    OpaqueFd = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_FD_KHR,
-    OpaqueWin32 = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_WIN32_KHR,
-    OpaqueWin32Kmt = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_WIN32_KMT_KHR,
+        State() : argShadowing_(false), cloning_(true) { }
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        State() : argShadowing_(false) { }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    };
 
-    D3D11Texture = CL_EXTERNAL_MEMORY_HANDLE_D3D11_TEXTURE_KHR,
-    D3D11TextureKmt = CL_EXTERNAL_MEMORY_HANDLE_D3D11_TEXTURE_KMT_KHR,
+    std::shared_ptr<State> state_;
 
-    D3D12Heap = CL_EXTERNAL_MEMORY_HANDLE_D3D12_HEAP_KHR,
-    D3D12Resource = CL_EXTERNAL_MEMORY_HANDLE_D3D12_RESOURCE_KHR,
+    Kernel createInstance(cl_int* err) const
+    {
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        {
+            // clCloneKernel must not run concurrently on the same kernel
+            std::lock_guard<std::mutex> lock(state_->mutex_);
+            if (state_->cloning_) {
+                cl_int error;
+                Kernel kernel = state_->prototype_.cloneHelper(&error);
+                if (error != CL_INVALID_OPERATION) {
+                    detail::errHandler(error, __CLONE_KERNEL_ERR);
+                    if (err != nullptr) {
+                        *err = error;
+                    }
+                    return kernel;
+                }
 
-    DmaBuf = CL_EXTERNAL_MEMORY_HANDLE_DMA_BUF_KHR,
-};
-#endif
+                // Create instances by name from now on
+                state_->cloning_ = false;
+                state_->argShadowing_ = state_->prototype_.isArgShadowingEnabled();
+                if (state_->program_() == nullptr) {
+                    error = detail::getInfo(&::clGetKernelInfo, state_->prototype_(), CL_KERNEL_PROGRAM, &state_->program_);
+                    if (error == CL_SUCCESS) {
+                        error = detail::getInfo(&::clGetKernelInfo, state_->prototype_(), CL_KERNEL_FUNCTION_NAME, &state_->name_);
+                    }
+                    if (error != CL_SUCCESS) {
+                        state_->program_ = Program();
+                        state_->cloning_ = true;
+                        detail::errHandler(error, __GET_KERNEL_INFO_ERR);
+                        if (err != nullptr) {
+                            *err = error;
+                        }
+                        return Kernel();
+                    }
+                }
+            }
+        }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        // The program and name are no longer modified once in use here
+        Kernel kernel(state_->program_, state_->name_.c_str(), err);
+        kernel.enableArgShadowing(state_->argShadowing_);
+        return kernel;
+    }
 
-enum class QueueProperties : cl_command_queue_properties
-{
-    None = 0,
-    Profiling = CL_QUEUE_PROFILING_ENABLE,
-    OutOfOrder = CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,
-};
+public:
+    /*! \brief A Kernel lent out by a KernelPool.
+     *
+     *  The kernel is returned to its pool on destruction.
+     */
+    class Lease
+    {
+    private:
+        std::shared_ptr<State> state_;
+        Kernel kernel_;
 
-inline QueueProperties operator|(QueueProperties lhs, QueueProperties rhs)
-{
-    return static_cast<QueueProperties>(static_cast<cl_command_queue_properties>(lhs) | static_cast<cl_command_queue_properties>(rhs));
-}
+        friend class KernelPool;
 
-inline QueueProperties operator&(QueueProperties lhs, QueueProperties rhs)
-{
-    return static_cast<QueueProperties>(static_cast<cl_command_queue_properties>(lhs) & static_cast<cl_command_queue_properties>(rhs));
-}
+        Lease(const std::shared_ptr<State>& state, Kernel&& kernel) :
+            state_(state), kernel_(std::move(kernel)) { }
 
-/*! \class CommandQueue
- * \brief CommandQueue interface for cl_command_queue.
- */
-class CommandQueue : public detail::Wrapper<cl_command_queue>
-{
-private:
-    static std::once_flag default_initialized_;
-    static CommandQueue default_;
-    static cl_int default_error_;
+    public:
+        Lease() { }
 
-    /*! \brief Create the default command queue returned by @ref getDefault.
-     *
-     * It sets default_error_ to indicate success or failure. It does not throw
-     * @c cl::Error.
-     */
-    static void makeDefault()
-    {
-        /* We don't want to throw an error from this function, so we have to
-         * catch and set the error flag.
-         */
-#if defined(CL_HPP_ENABLE_EXCEPTIONS)
-        try
-#endif
-        {
-            int error;
-            Context context = Context::getDefault(&error);
+        Lease(const Lease&) = delete;
+        Lease& operator = (const Lease&) = delete;
 
-            if (error != CL_SUCCESS) {
-                default_error_ = error;
+        Lease(Lease&& rhs) noexcept :
+            state_(std::move(rhs.state_)), kernel_(std::move(rhs.kernel_)) { }
+
+        Lease& operator = (Lease&& rhs)
+        {
+            if (this != &rhs) {
+                release();
+                state_ = std::move(rhs.state_);
+                kernel_ = std::move(rhs.kernel_);
             }
-            else {
-                Device device = Device::getDefault();
-                default_ = CommandQueue(context, device, 0, &default_error_);
+            return *this;
+        }
+
+        ~Lease()
+        {
+            release();
+        }
+
+        //! \brief Returns the kernel to its pool early.
+        void release()
+        {
+            if (state_ && kernel_() != nullptr) {
+                std::lock_guard<std::mutex> lock(state_->mutex_);
+                state_->idle_.push_back(std::move(kernel_));
             }
+            state_.reset();
+            kernel_ = Kernel();
         }
-#if defined(CL_HPP_ENABLE_EXCEPTIONS)
-        catch (cl::Error &e) {
-            default_error_ = e.err();
+
+        Kernel& get() { return kernel_; }
+
+        Kernel& operator * () { return kernel_; }
+
+        Kernel* operator -> () { return &kernel_; }
+    };
+
+    //! \brief Creates a pool of instances of the named kernel in program.
+    KernelPool(const Program& program, const string& name, cl_int* err = nullptr) :
+        state_(std::make_shared<State>())
+    {
+        cl_int error;
+        Kernel kernel(program, name.c_str(), &error);
+        state_->program_ = program;
+        state_->name_ = name;
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        state_->prototype_ = std::move(kernel);
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        if (error == CL_SUCCESS) {
+            state_->idle_.push_back(std::move(kernel));
+        }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+
+        if (err != nullptr) {
+            *err = error;
         }
-#endif
     }
 
-    /*! \brief Create the default command queue.
+    /*! \brief Creates a pool of instances of the same kernel as prototype.
      *
-     * This sets @c default_. It does not throw
-     * @c cl::Error.
+     *  Without clCloneKernel only the program, kernel name and argument
+     *  shadowing mode are taken from the prototype.
      */
-    static void makeDefaultProvided(const CommandQueue &c) {
-        default_ = c;
+    explicit KernelPool(const Kernel& prototype, cl_int* err = nullptr) :
+        state_(std::make_shared<State>())
+    {
+        cl_int error = CL_SUCCESS;
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        state_->prototype_ = prototype;
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        error = prototype.getInfo(CL_KERNEL_PROGRAM, &state_->program_);
+        if (error == CL_SUCCESS) {
+            error = prototype.getInfo(CL_KERNEL_FUNCTION_NAME, &state_->name_);
+        }
+        state_->argShadowing_ = prototype.isArgShadowingEnabled();
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+
+        if (err != nullptr) {
+            *err = error;
+        }
     }
 
-#ifdef cl_khr_external_memory
-    static std::once_flag ext_memory_initialized_;
+    /*! \brief Lends out an idle instance, creating one if there is none.
+     *
+     *  The returned Lease is empty if a new instance could not be created.
+     */
+    Lease acquire(cl_int* err = nullptr)
+    {
+        cl_int error = CL_SUCCESS;
+        Kernel kernel;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex_);
+            if (!state_->idle_.empty()) {
+                kernel = std::move(state_->idle_.back());
+                state_->idle_.pop_back();
+            }
+        }
+        if (kernel() == nullptr) {
+            kernel = createInstance(&error);
+        }
+
+        if (err != nullptr) {
+            *err = error;
+        }
+        if (error != CL_SUCCESS) {
+            return Lease();
+        }
+        return Lease(state_, std::move(kernel));
+    }
+
+    //! \brief Returns the number of instances waiting in the pool.
+    size_type idleCount() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex_);
+        return state_->idle_.size();
+    }
+};
+
+#if defined(CL_HPP_ENABLE_PROGRAM_BINARY_CACHE)
+/*! \class ProgramBinaryCache
+ * \brief Persistent on-disk cache of program binaries.
+ *
+ * Programs built through the cache are keyed on their sources, the build
+ * options and the name, driver version and platform version of every target
+ * device. The first build of a program compiles it from source and stores
+ * the result of getInfo<CL_PROGRAM_BINARIES>() in the cache directory. Later
+ * builds, in this or any other process, recreate the program from those
+ * binaries and skip compilation. Binaries that the implementation rejects
+ * are evicted and the program is rebuilt from source.
+ *
+ * Entries are written to a temporary file and renamed into place, so other
+ * processes sharing the directory never observe a partially written entry.
+ * Updates of the index are serialized across threads and processes by a
+ * lock file in the cache directory. A lock file that has not been modified
+ * for several seconds is assumed to belong to a process that died and is
+ * broken. An update that cannot take the lock is skipped.
+ *
+ * When a maximum size is given, the least recently used entries are removed
+ * until the cache fits. The cache directory must already exist. Failures to
+ * read or write the cache are not reported; they only cost a source build.
+ */
+class ProgramBinaryCache
+{
+private:
+    string directory_;
+    size_type maxSize_;
 
-    static void initMemoryExtension(const cl::Device& device) 
+    struct Entry
     {
-        auto platform = device.getInfo<CL_DEVICE_PLATFORM>()();
+        string name;
+        unsigned long long size;
+        unsigned long long stamp;
+    };
 
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueAcquireExternalMemObjectsKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueReleaseExternalMemObjectsKHR);
+    static void appendKeyField(string& key, const char* data, size_type length)
+    {
+        key += std::to_string(static_cast<unsigned long long>(length));
+        key += ':';
+        key.append(data, length);
+    }
 
-        if ((pfn_clEnqueueAcquireExternalMemObjectsKHR == nullptr)
-            && (pfn_clEnqueueReleaseExternalMemObjectsKHR == nullptr))
-        {
-            detail::errHandler(CL_INVALID_VALUE, __ENQUEUE_ACQUIRE_EXTERNAL_MEMORY_ERR);
+    static string hashKey(const string& key)
+    {
+        // 64-bit FNV-1a
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_type i = 0; i < key.size(); ++i) {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 1099511628211ULL;
         }
+
+        static const char digits[] = "0123456789abcdef";
+        string name(16, '0');
+        for (int i = 15; i >= 0; --i) {
+            name[i] = digits[hash & 0xf];
+            hash >>= 4;
+        }
+        return name;
     }
-#endif // cl_khr_external_memory
 
-public:
-#ifdef CL_HPP_UNIT_TEST_ENABLE
-    /*! \brief Reset the default.
-    *
-    * This sets @c default_ to an empty value to support cleanup in
-    * the unit test framework.
-    * This function is not thread safe.
-    */
-    static void unitTestClearDefault() {
-        default_ = CommandQueue();
+    static bool makeKey(
+        const vector<Device>& devices,
+        const Program::Sources& sources,
+        const char* options,
+        string* key)
+    {
+        for (const Program::Sources::value_type& source : sources) {
+#if !defined(CL_HPP_ENABLE_PROGRAM_CONSTRUCTION_FROM_ARRAY_COMPATIBILITY)
+            appendKeyField(*key, source.data(), source.length());
+#else // #if !defined(CL_HPP_ENABLE_PROGRAM_CONSTRUCTION_FROM_ARRAY_COMPATIBILITY)
+            appendKeyField(*key, source.first, source.second);
+#endif // #if !defined(CL_HPP_ENABLE_PROGRAM_CONSTRUCTION_FROM_ARRAY_COMPATIBILITY)
+        }
+        appendKeyField(*key, options ? options : "", options ? std::strlen(options) : 0);
+
+        for (const Device& device : devices) {
+            string name, driverVersion, platformVersion;
+            cl_platform_id platform;
+            if (detail::getInfo(&::clGetDeviceInfo, device(), CL_DEVICE_NAME, &name) != CL_SUCCESS ||
+                detail::getInfo(&::clGetDeviceInfo, device(), CL_DRIVER_VERSION, &driverVersion) != CL_SUCCESS ||
+                detail::getInfo(&::clGetDeviceInfo, device(), CL_DEVICE_PLATFORM, &platform) != CL_SUCCESS ||
+                detail::getInfo(&::clGetPlatformInfo, platform, CL_PLATFORM_VERSION, &platformVersion) != CL_SUCCESS) {
+                return false;
+            }
+            appendKeyField(*key, name.data(), name.size());
+            appendKeyField(*key, driverVersion.data(), driverVersion.size());
+            appendKeyField(*key, platformVersion.data(), platformVersion.size());
+        }
+        return true;
     }
-#endif // #ifdef CL_HPP_UNIT_TEST_ENABLE
-        
 
-    /*!
-     * \brief Constructs a CommandQueue based on passed properties.
-     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+    string path(const string& file) const
+    {
+        return directory_ + "/" + file;
+    }
+
+    static void writeSize(std::ostream& out, unsigned long long value)
+    {
+        char bytes[8];
+        for (int i = 0; i < 8; ++i) {
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xff);
+        }
+        out.write(bytes, sizeof(bytes));
+    }
+
+    static bool readSize(std::istream& in, unsigned long long* value)
+    {
+        unsigned char bytes[8];
+        if (!in.read(reinterpret_cast<char*>(bytes), sizeof(bytes))) {
+            return false;
+        }
+        *value = 0;
+        for (int i = 7; i >= 0; --i) {
+            *value = (*value << 8) | bytes[i];
+        }
+        return true;
+    }
+
+    /*! \brief Writes a file under a unique temporary name and renames it
+     *         into place, so that readers see either the old or the new
+     *         contents.
      */
-   CommandQueue(
-        cl_command_queue_properties properties,
-        cl_int* err = nullptr)
+    template <typename Writer>
+    bool writeAtomic(const string& file, Writer writer) const
     {
-        cl_int error;
+        static std::atomic<unsigned long long> counter(0);
+        const string target = path(file);
+        const string temporary = target + ".tmp" +
+            std::to_string(static_cast<unsigned long long>(
+                std::chrono::high_resolution_clock::now().time_since_epoch().count())) +
+            "." + std::to_string(counter++);
 
-        Context context = Context::getDefault(&error);
-        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+        {
+            std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out) {
+                return false;
+            }
+            writer(out);
+            out.flush();
+            if (!out) {
+                out.close();
+                std::remove(temporary.c_str());
+                return false;
+            }
+        }
 
-        if (error != CL_SUCCESS) {
-            if (err != nullptr) {
-                *err = error;
+        if (std::rename(temporary.c_str(), target.c_str()) != 0) {
+            // rename() does not replace existing files on every platform
+            std::remove(target.c_str());
+            if (std::rename(temporary.c_str(), target.c_str()) != 0) {
+                std::remove(temporary.c_str());
+                return false;
             }
         }
-        else {
-            Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
-            bool useWithProperties;
+        return true;
+    }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-            // Run-time decision based on the actual platform
-            {
-                cl_uint version = detail::getContextPlatformVersion(context());
-                useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
-            }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-            useWithProperties = true;
-#else
-            useWithProperties = false;
-#endif
+    static const char* indexName()
+    {
+        return "index.txt";
+    }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-            if (useWithProperties) {
-                cl_queue_properties queue_properties[] = {
-                    CL_QUEUE_PROPERTIES, properties, 0 };
-                if ((properties & CL_QUEUE_ON_DEVICE) == 0) {
-                    object_ = ::clCreateCommandQueueWithProperties(
-                        context(), device(), queue_properties, &error);
-                }
-                else {
-                    error = CL_INVALID_QUEUE_PROPERTIES;
-                }
+    // Serializes read-modify-write cycles of the index between threads and
+    // processes
+    class IndexLock
+    {
+    private:
+        string path_;
+        bool locked_;
 
-                detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-                if (err != nullptr) {
-                    *err = error;
-                }
+        bool tryLock()
+        {
+            // "x" fails if the file exists, which makes creation the lock
+            std::FILE* file = std::fopen(path_.c_str(), "wx");
+            if (file == nullptr) {
+                return false;
             }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-            if (!useWithProperties) {
-                object_ = ::clCreateCommandQueue(
-                    context(), device(), properties, &error);
+            std::fclose(file);
+            return true;
+        }
 
-                detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
-                if (err != nullptr) {
-                    *err = error;
-                }
+        // Index updates take milliseconds, so a lock file this old was left
+        // behind by a process that died while holding it
+        bool stale() const
+        {
+            struct stat status;
+            if (stat(path_.c_str(), &status) != 0) {
+                return false;
             }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+            return std::difftime(std::time(nullptr), status.st_mtime) > 5.0;
         }
-    }
-
-   /*!
-    * \brief Constructs a CommandQueue based on passed properties.
-    * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
-    */
-   CommandQueue(
-       QueueProperties properties,
-       cl_int* err = nullptr)
-   {
-       cl_int error;
-
-       Context context = Context::getDefault(&error);
-       detail::errHandler(error, __CREATE_CONTEXT_ERR);
-
-       if (error != CL_SUCCESS) {
-           if (err != nullptr) {
-               *err = error;
-           }
-       }
-       else {
-           Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
-           bool useWithProperties;
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-           // Run-time decision based on the actual platform
-           {
-               cl_uint version = detail::getContextPlatformVersion(context());
-               useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
-           }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-           useWithProperties = true;
-#else
-           useWithProperties = false;
-#endif
+    public:
+        explicit IndexLock(const string& path) : path_(path), locked_(false)
+        {
+            // Gives up after about ten seconds if a live holder keeps it
+            for (int attempt = 0; attempt < 10000 && !locked_; ++attempt) {
+                locked_ = tryLock();
+                if (!locked_) {
+                    if (stale()) {
+                        std::remove(path_.c_str());
+                        continue;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            }
+        }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-           if (useWithProperties) {
-               cl_queue_properties queue_properties[] = {
-                   CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
+        IndexLock(const IndexLock&) = delete;
+        IndexLock& operator=(const IndexLock&) = delete;
 
-               object_ = ::clCreateCommandQueueWithProperties(
-                   context(), device(), queue_properties, &error);
+        ~IndexLock()
+        {
+            if (locked_) {
+                std::remove(path_.c_str());
+            }
+        }
 
-               detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-               if (err != nullptr) {
-                   *err = error;
-               }
-           }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-           if (!useWithProperties) {
-               object_ = ::clCreateCommandQueue(
-                   context(), device(), static_cast<cl_command_queue_properties>(properties), &error);
+        bool locked() const
+        {
+            return locked_;
+        }
+    };
 
-               detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
-               if (err != nullptr) {
-                   *err = error;
-               }
-           }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+    string lockPath() const
+    {
+        return path("index.lock");
+    }
 
-       }
-   }
+    vector<Entry> readIndex() const
+    {
+        vector<Entry> entries;
+        std::ifstream in(path(indexName()).c_str());
+        std::string name;
+        Entry entry;
+        while (in >> name >> entry.size >> entry.stamp) {
+            entry.name = name.c_str();
+            entries.push_back(entry);
+        }
+        return entries;
+    }
 
-    /*!
-     * \brief Constructs a CommandQueue for an implementation defined device in the given context
-     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
-     */
-    explicit CommandQueue(
-        const Context& context,
-        cl_command_queue_properties properties = 0,
-        cl_int* err = nullptr)
+    void writeIndex(const vector<Entry>& entries) const
     {
-        cl_int error;
-        bool useWithProperties;
-        vector<cl::Device> devices;
-        error = context.getInfo(CL_CONTEXT_DEVICES, &devices);
+        writeAtomic(indexName(), [&entries](std::ostream& out) {
+            for (const Entry& entry : entries) {
+                out << entry.name.c_str() << ' ' << entry.size << ' ' << entry.stamp << '\n';
+            }
+        });
+    }
 
-        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+    //! \brief Marks an entry as most recently used and applies the size bound.
+    void touch(const string& name, unsigned long long size)
+    {
+        IndexLock indexLock(lockPath());
+        if (!indexLock.locked()) {
+            return;
+        }
+        vector<Entry> entries = readIndex();
 
-        if (error != CL_SUCCESS)
-        {
-            if (err != nullptr) {
-                *err = error;
+        unsigned long long stamp = 0;
+        size_type current = entries.size();
+        for (size_type i = 0; i < entries.size(); ++i) {
+            if (entries[i].stamp > stamp) {
+                stamp = entries[i].stamp;
+            }
+            if (entries[i].name == name) {
+                current = i;
             }
+        }
+        if (current != entries.size() &&
+            entries[current].stamp == stamp && entries[current].size == size) {
+            // Already the most recently used entry
             return;
         }
-
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        // Run-time decision based on the actual platform
-        {
-            cl_uint version = detail::getContextPlatformVersion(context());
-            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        if (current == entries.size()) {
+            Entry entry;
+            entry.name = name;
+            entries.push_back(entry);
         }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-        useWithProperties = true;
-#else
-        useWithProperties = false;
-#endif
+        entries[current].size = size;
+        entries[current].stamp = stamp + 1;
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-        if (useWithProperties) {
-            cl_queue_properties queue_properties[] = {
-                CL_QUEUE_PROPERTIES, properties, 0 };
-            if ((properties & CL_QUEUE_ON_DEVICE) == 0) {
-                object_ = ::clCreateCommandQueueWithProperties(
-                    context(), devices[0](), queue_properties, &error);
-            }
-            else {
-                error = CL_INVALID_QUEUE_PROPERTIES;
+        if (maxSize_ > 0) {
+            unsigned long long total = 0;
+            for (const Entry& entry : entries) {
+                total += entry.size;
             }
-
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-            if (err != nullptr) {
-                *err = error;
+            // Evict least recently used entries, but never the one just used
+            while (total > maxSize_ && entries.size() > 1) {
+                size_type oldest = 0;
+                for (size_type i = 1; i < entries.size(); ++i) {
+                    if (entries[i].stamp < entries[oldest].stamp) {
+                        oldest = i;
+                    }
+                }
+                total -= entries[oldest].size;
+                std::remove(path(entries[oldest].name).c_str());
+                entries.erase(entries.begin() + oldest);
             }
         }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        if (!useWithProperties) {
-            object_ = ::clCreateCommandQueue(
-                context(), devices[0](), properties, &error);
 
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
-            if (err != nullptr) {
-                *err = error;
+        writeIndex(entries);
+    }
+
+    void evict(const string& name)
+    {
+        IndexLock indexLock(lockPath());
+        std::remove(path(name).c_str());
+        if (!indexLock.locked()) {
+            return;
+        }
+        vector<Entry> entries = readIndex();
+        for (size_type i = 0; i < entries.size(); ++i) {
+            if (entries[i].name == name) {
+                entries.erase(entries.begin() + i);
+                break;
             }
         }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        writeIndex(entries);
     }
 
-    /*!
-    * \brief Constructs a CommandQueue for an implementation defined device in the given context
-    * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
-    */
-    explicit CommandQueue(
-        const Context& context,
-        QueueProperties properties,
-        cl_int* err = nullptr)
+    static const char* magic()
     {
-        cl_int error;
-        bool useWithProperties;
-        vector<cl::Device> devices;
-        error = context.getInfo(CL_CONTEXT_DEVICES, &devices);
-
-        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+        return "CLHPPBC1";
+    }
 
-        if (error != CL_SUCCESS)
-        {
-            if (err != nullptr) {
-                *err = error;
-            }
-            return;
+    bool load(
+        const string& name,
+        const string& key,
+        size_type numDevices,
+        vector<vector<unsigned char>>* binaries) const
+    {
+        std::ifstream in(path(name).c_str(), std::ios::binary);
+        char header[8];
+        if (!in.read(header, sizeof(header)) ||
+            std::memcmp(header, magic(), sizeof(header)) != 0) {
+            return false;
         }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        // Run-time decision based on the actual platform
-        {
-            cl_uint version = detail::getContextPlatformVersion(context());
-            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        // The full key is stored to guard against hash collisions
+        unsigned long long length;
+        if (!readSize(in, &length) || length != key.size()) {
+            return false;
+        }
+        vector<char> storedKey(key.size());
+        if (length > 0 &&
+            (!in.read(storedKey.data(), storedKey.size()) ||
+             std::memcmp(storedKey.data(), key.data(), key.size()) != 0)) {
+            return false;
         }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-        useWithProperties = true;
-#else
-        useWithProperties = false;
-#endif
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-        if (useWithProperties) {
-            cl_queue_properties queue_properties[] = {
-                CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
-            object_ = ::clCreateCommandQueueWithProperties(
-                context(), devices[0](), queue_properties, &error);
+        unsigned long long count;
+        if (!readSize(in, &count) || count != numDevices) {
+            return false;
+        }
+        binaries->resize(numDevices);
+        for (vector<unsigned char>& binary : *binaries) {
+            if (!readSize(in, &length) || length == 0) {
+                return false;
+            }
+            binary.resize(static_cast<size_type>(length));
+            if (!in.read(reinterpret_cast<char*>(binary.data()), binary.size())) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-            if (err != nullptr) {
-                *err = error;
+    void store(
+        const string& name,
+        const string& key,
+        const vector<vector<unsigned char>>& binaries)
+    {
+        unsigned long long size = 0;
+        for (const vector<unsigned char>& binary : binaries) {
+            if (binary.empty()) {
+                return;
             }
+            size += binary.size();
         }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        if (!useWithProperties) {
-            object_ = ::clCreateCommandQueue(
-                context(), devices[0](), static_cast<cl_command_queue_properties>(properties), &error);
 
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
-            if (err != nullptr) {
-                *err = error;
+        bool written = writeAtomic(name, [&](std::ostream& out) {
+            out.write(magic(), 8);
+            writeSize(out, key.size());
+            out.write(key.data(), key.size());
+            writeSize(out, binaries.size());
+            for (const vector<unsigned char>& binary : binaries) {
+                writeSize(out, binary.size());
+                out.write(reinterpret_cast<const char*>(binary.data()), binary.size());
             }
+        });
+        if (written) {
+            touch(name, size);
         }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
     }
 
-    /*!
-     * \brief Constructs a CommandQueue for a passed device and context
-     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
-     */
-    CommandQueue(
+    static cl_program createFromBinaries(
         const Context& context,
-        const Device& device,
-        cl_command_queue_properties properties = 0,
-        cl_int* err = nullptr)
+        const vector<Device>& devices,
+        const vector<vector<unsigned char>>& binaries,
+        const char* options)
     {
+        const size_type numDevices = devices.size();
+        vector<cl_device_id> deviceIDs(numDevices);
+        vector<size_type> lengths(numDevices);
+        vector<const unsigned char*> images(numDevices);
+        vector<cl_int> binaryStatus(numDevices);
+        for (size_type i = 0; i < numDevices; ++i) {
+            deviceIDs[i] = devices[i]();
+            lengths[i] = binaries[i].size();
+            images[i] = binaries[i].data();
+        }
+
         cl_int error;
-        bool useWithProperties;
-
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        // Run-time decision based on the actual platform
-        {
-            cl_uint version = detail::getContextPlatformVersion(context());
-            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        cl_program program = ::clCreateProgramWithBinary(
+            context(), (cl_uint)numDevices, deviceIDs.data(),
+            lengths.data(), images.data(), binaryStatus.data(), &error);
+        if (error == CL_SUCCESS) {
+            error = ::clBuildProgram(
+                program, (cl_uint)numDevices, deviceIDs.data(),
+                options, nullptr, nullptr);
         }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-        useWithProperties = true;
-#else
-        useWithProperties = false;
-#endif
+        if (error != CL_SUCCESS) {
+            if (program != nullptr) {
+                ::clReleaseProgram(program);
+            }
+            return nullptr;
+        }
+        return program;
+    }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-        if (useWithProperties) {
-            cl_queue_properties queue_properties[] = {
-                CL_QUEUE_PROPERTIES, properties, 0 };
-            object_ = ::clCreateCommandQueueWithProperties(
-                context(), device(), queue_properties, &error);
+public:
+    /*! \brief Opens a cache stored in an existing directory.
+     *
+     *  \param maxSize Upper bound, in bytes, for the binaries kept in the
+     *                 cache. Zero means unbounded.
+     */
+    explicit ProgramBinaryCache(const string& directory, size_type maxSize = 0) :
+        directory_(directory), maxSize_(maxSize) { }
 
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-            if (err != nullptr) {
-                *err = error;
+    ProgramBinaryCache(const ProgramBinaryCache&) = delete;
+    ProgramBinaryCache& operator=(const ProgramBinaryCache&) = delete;
+
+    /*! \brief Returns a program built from sources for the given devices,
+     *         reusing cached binaries when possible.
+     *
+     *  Errors from the source build are reported exactly as by
+     *  Program(context, sources) followed by Program::build(devices, options).
+     */
+    Program build(
+        const Context& context,
+        const vector<Device>& devices,
+        const Program::Sources& sources,
+        const char* options = nullptr,
+        cl_int* err = nullptr)
+    {
+        string key;
+        const bool cacheable = !devices.empty() &&
+            makeKey(devices, sources, options, &key);
+        const string name = cacheable ? hashKey(key) + ".clbin" : string();
+
+        if (cacheable) {
+            vector<vector<unsigned char>> binaries;
+            if (load(name, key, devices.size(), &binaries)) {
+                cl_program program = createFromBinaries(
+                    context, devices, binaries, options);
+                if (program != nullptr) {
+                    // Recency only matters when entries can be evicted
+                    if (maxSize_ > 0) {
+                        unsigned long long size = 0;
+                        for (const vector<unsigned char>& binary : binaries) {
+                            size += binary.size();
+                        }
+                        touch(name, size);
+                    }
+                    if (err != nullptr) {
+                        *err = CL_SUCCESS;
+                    }
+                    return Program(program);
+                }
+                evict(name);
             }
         }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        if (!useWithProperties) {
-            object_ = ::clCreateCommandQueue(
-                context(), device(), properties, &error);
 
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
-            if (err != nullptr) {
-                *err = error;
+        cl_int error;
+        Program program(context, sources, &error);
+        if (error == CL_SUCCESS) {
+            error = program.build(devices, options);
+        }
+        if (error == CL_SUCCESS && cacheable) {
+            vector<size_type> sizes;
+            if (detail::getInfo(&::clGetProgramInfo, program(), CL_PROGRAM_BINARY_SIZES, &sizes) == CL_SUCCESS &&
+                sizes.size() == devices.size()) {
+                vector<vector<unsigned char>> binaries(sizes.size());
+                for (size_type i = 0; i < sizes.size(); ++i) {
+                    binaries[i].resize(sizes[i]);
+                }
+                if (detail::getInfo(&::clGetProgramInfo, program(), CL_PROGRAM_BINARIES, &binaries) == CL_SUCCESS) {
+                    store(name, key, binaries);
+                }
             }
         }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+
+        if (err != nullptr) {
+            *err = error;
+        }
+        return program;
     }
 
-    /*!
-     * \brief Constructs a CommandQueue for a passed device and context
-     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+    /*! \brief Returns a program built from sources for all devices in the
+     *         context, reusing cached binaries when possible.
      */
-    CommandQueue(
+    Program build(
         const Context& context,
-        const Device& device,
-        QueueProperties properties,
+        const Program::Sources& sources,
+        const char* options = nullptr,
         cl_int* err = nullptr)
     {
         cl_int error;
-        bool useWithProperties;
-
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        // Run-time decision based on the actual platform
-        {
-            cl_uint version = detail::getContextPlatformVersion(context());
-            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
-        }
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
-        useWithProperties = true;
-#else
-        useWithProperties = false;
-#endif
-
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-        if (useWithProperties) {
-            cl_queue_properties queue_properties[] = {
-                CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
-            object_ = ::clCreateCommandQueueWithProperties(
-                context(), device(), queue_properties, &error);
-
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-            if (err != nullptr) {
-                *err = error;
-            }
-        }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
-        if (!useWithProperties) {
-            object_ = ::clCreateCommandQueue(
-                context(), device(), static_cast<cl_command_queue_properties>(properties), &error);
-
-            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+        vector<Device> devices = context.getInfo<CL_CONTEXT_DEVICES>(&error);
+        if (error != CL_SUCCESS) {
             if (err != nullptr) {
                 *err = error;
             }
+            return Program();
         }
-#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        return build(context, devices, sources, options, err);
     }
 
-    static CommandQueue getDefault(cl_int * err = nullptr) 
+    //! \brief Removes every entry of the cache.
+    void clear()
     {
-        std::call_once(default_initialized_, makeDefault);
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-        detail::errHandler(default_error_, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-#else // CL_HPP_TARGET_OPENCL_VERSION >= 200
-        detail::errHandler(default_error_, __CREATE_COMMAND_QUEUE_ERR);
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
-        if (err != nullptr) {
-            *err = default_error_;
+        IndexLock indexLock(lockPath());
+        if (!indexLock.locked()) {
+            return;
         }
-        return default_;
+        for (const Entry& entry : readIndex()) {
+            std::remove(path(entry.name).c_str());
+        }
+        std::remove(path(indexName()).c_str());
     }
 
-    /**
-     * Modify the default command queue to be used by
-     * subsequent operations.
-     * Will only set the default if no default was previously created.
-     * @return updated default command queue.
-     *         Should be compared to the passed value to ensure that it was updated.
-     */
-    static CommandQueue setDefault(const CommandQueue &default_queue)
+    //! \brief Returns the total size in bytes of the cached binaries.
+    size_type size()
     {
-        std::call_once(default_initialized_, makeDefaultProvided, std::cref(default_queue));
-        detail::errHandler(default_error_);
-        return default_;
+        // The index is replaced atomically, so reading it needs no lock
+        unsigned long long total = 0;
+        for (const Entry& entry : readIndex()) {
+            total += entry.size;
+        }
+        return static_cast<size_type>(total);
     }
+};
+#endif // #if defined(CL_HPP_ENABLE_PROGRAM_BINARY_CACHE)
 
-    CommandQueue() { }
+#ifdef cl_khr_external_memory
+enum class ExternalMemoryType : cl_external_memory_handle_type_khr
+{
+    None = 0,
 
+    OpaqueFd = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_FD_KHR,
+    OpaqueWin32 = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_WIN32_KHR,
+    OpaqueWin32Kmt = CL_EXTERNAL_MEMORY_HANDLE_OPAQUE_WIN32_KMT_KHR,
 
-    /*! \brief Constructor from cl_command_queue - takes ownership.
-     *
-     * \param retainObject will cause the constructor to retain its cl object.
-     *                     Defaults to false to maintain compatibility with
-     *                     earlier versions.
-     */
-    explicit CommandQueue(const cl_command_queue& commandQueue, bool retainObject = false) : 
-        detail::Wrapper<cl_type>(commandQueue, retainObject) { }
+    D3D11Texture = CL_EXTERNAL_MEMORY_HANDLE_D3D11_TEXTURE_KHR,
+    D3D11TextureKmt = CL_EXTERNAL_MEMORY_HANDLE_D3D11_TEXTURE_KMT_KHR,
 
-    CommandQueue& operator = (const cl_command_queue& rhs)
+    D3D12Heap = CL_EXTERNAL_MEMORY_HANDLE_D3D12_HEAP_KHR,
+    D3D12Resource = CL_EXTERNAL_MEMORY_HANDLE_D3D12_RESOURCE_KHR,
+
+    DmaBuf = CL_EXTERNAL_MEMORY_HANDLE_DMA_BUF_KHR,
+};
+#endif
+
+enum class QueueProperties : cl_command_queue_properties
+{
+    None = 0,
+    Profiling = CL_QUEUE_PROFILING_ENABLE,
+    OutOfOrder = CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE,
+};
+
+inline QueueProperties operator|(QueueProperties lhs, QueueProperties rhs)
+{
+    return static_cast<QueueProperties>(static_cast<cl_command_queue_properties>(lhs) | static_cast<cl_command_queue_properties>(rhs));
+}
+
+inline QueueProperties operator&(QueueProperties lhs, QueueProperties rhs)
+{
+    return static_cast<QueueProperties>(static_cast<cl_command_queue_properties>(lhs) & static_cast<cl_command_queue_properties>(rhs));
+}
+
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+namespace detail {
+
+/*! \brief Records commands enqueued to one queue into a command buffer.
+ *
+ *  Active captures form a stack per thread, which CommandQueue consults on
+ *  the enqueue calls that have a command buffer equivalent. Started and
+ *  stopped by CommandBufferCapture.
+ */
+class CommandCapture
+{
+private:
+    cl_command_queue queue_;
+    cl_command_buffer_khr commandBuffer_;
+    const ExtensionDispatch* dispatch_;
+    Context context_;
+    bool inOrder_;
+    CommandCapture* outer_;
+    bool active_;
+
+    // Placeholder events handed out for recorded commands
+    vector<std::pair<Event, cl_sync_point_khr>> events_;
+    // Commands recorded since the last barrier
+    vector<cl_sync_point_khr> sinceBarrier_;
+    cl_sync_point_khr barrier_;
+    bool hasBarrier_;
+    cl_sync_point_khr last_;
+    bool hasLast_;
+    vector<cl_sync_point_khr> waits_;
+
+    static CommandCapture*& innermost()
     {
-        detail::Wrapper<cl_type>::operator=(rhs);
-        return *this;
+        static thread_local CommandCapture* capture = nullptr;
+        return capture;
     }
 
-    template <typename T>
-    cl_int getInfo(cl_command_queue_info name, T* param) const
+    void addWait(cl_sync_point_khr point)
     {
-        return detail::errHandler(
-            detail::getInfo(
-                &::clGetCommandQueueInfo, object_, name, param),
-                __GET_COMMAND_QUEUE_INFO_ERR);
+        if (std::find(waits_.begin(), waits_.end(), point) == waits_.end()) {
+            waits_.push_back(point);
+        }
     }
 
-    template <cl_command_queue_info name> typename
-    detail::param_traits<detail::cl_command_queue_info, name>::param_type
-    getInfo(cl_int* err = nullptr) const
+    // Translates the wait list of a command into waits_
+    cl_int translate(EventWaitList events, bool waitForAll)
     {
-        typename detail::param_traits<
-            detail::cl_command_queue_info, name>::param_type param;
-        cl_int result = getInfo(name, &param);
-        if (err != nullptr) {
-            *err = result;
+        waits_.clear();
+        for (size_type i = 0; i < events.size(); ++i) {
+            cl_event handle = events.data()[i]();
+            auto it = std::find_if(events_.begin(), events_.end(),
+                [handle](const std::pair<Event, cl_sync_point_khr>& e) {
+                    return e.first() == handle;
+                });
+            if (it == events_.end()) {
+                // Not an event of a command recorded by this capture
+                return CL_INVALID_EVENT_WAIT_LIST;
+            }
+            addWait(it->second);
         }
-        return param;
+        if (waitForAll && events.empty()) {
+            for (cl_sync_point_khr point : sinceBarrier_) {
+                addWait(point);
+            }
+        }
+        // Recorded commands are only ordered by their sync points
+        if (inOrder_ && hasLast_) {
+            addWait(last_);
+        }
+        else if (hasBarrier_) {
+            addWait(barrier_);
+        }
+        return CL_SUCCESS;
     }
 
-    cl_int enqueueReadBuffer(
-        const Buffer& buffer,
-        cl_bool blocking,
-        size_type offset,
-        size_type size,
-        void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueReadBuffer(
-                object_, buffer(), blocking, offset, size,
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_READ_BUFFER_ERR);
+    /*! \brief Records one command.
+     *
+     *  \param waitForAll Whether an empty wait list means all commands
+     *  recorded since the last barrier, as for markers and barriers.
+     *  \param isBarrier Whether later commands must wait for this one.
+     *  \param command Callable taking the number of sync points to wait for,
+     *  the sync points and a pointer receiving the sync point of the command.
+     */
+    template <typename Command>
+    cl_int record(
+        EventWaitList events,
+        Event* event,
+        bool waitForAll,
+        bool isBarrier,
+        const char* errStr,
+        Command command)
+    {
+        cl_int err = translate(events, waitForAll);
+        if (err != CL_SUCCESS) {
+            return detail::errHandler(err, errStr);
+        }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        // Created first so that a failure leaves nothing recorded
+        Event placeholder;
+        if (event != nullptr) {
+            placeholder = Event(::clCreateUserEvent(context_(), &err));
+            if (err != CL_SUCCESS) {
+                return detail::errHandler(err, __CREATE_USER_EVENT_ERR);
+            }
+        }
 
-        return err;
+        cl_sync_point_khr point = 0;
+        err = command(
+            (cl_uint) waits_.size(),
+            waits_.empty() ? nullptr : waits_.data(),
+            &point);
+        if (err != CL_SUCCESS) {
+            return detail::errHandler(err, errStr);
+        }
+        if (event != nullptr) {
+            *event = placeholder;
+            events_.emplace_back(std::move(placeholder), point);
+        }
+
+        last_ = point;
+        hasLast_ = true;
+        if (isBarrier) {
+            barrier_ = point;
+            hasBarrier_ = true;
+            sinceBarrier_.clear();
+        }
+        else {
+            sinceBarrier_.push_back(point);
+        }
+        return CL_SUCCESS;
     }
 
-    cl_int enqueueWriteBuffer(
-        const Buffer& buffer,
-        cl_bool blocking,
-        size_type offset,
-        size_type size,
-        const void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+public:
+    CommandCapture(
+        cl_command_queue queue,
+        cl_command_buffer_khr commandBuffer,
+        const ExtensionDispatch* dispatch,
+        const Context& context,
+        bool inOrder) :
+        queue_(queue),
+        commandBuffer_(commandBuffer),
+        dispatch_(dispatch),
+        context_(context),
+        inOrder_(inOrder),
+        outer_(nullptr),
+        active_(false),
+        barrier_(0),
+        hasBarrier_(false),
+        last_(0),
+        hasLast_(false)
+    { }
+
+    CommandCapture(const CommandCapture&) = delete;
+    CommandCapture& operator = (const CommandCapture&) = delete;
+
+    ~CommandCapture()
+    {
+        end();
+    }
+
+    //! \brief Whether any of events is a placeholder of a capture on the calling thread.
+    static bool holds(const cl_event* events, size_type count)
+    {
+        for (CommandCapture* capture = innermost(); capture != nullptr; capture = capture->outer_) {
+            for (size_type i = 0; i < count; ++i) {
+                for (const auto& e : capture->events_) {
+                    if (e.first() == events[i]) {
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    //! \brief Returns the innermost capture of queue on the calling thread.
+    static CommandCapture* find(cl_command_queue queue)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueWriteBuffer(
-                object_, buffer(), blocking, offset, size,
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-                __ENQUEUE_WRITE_BUFFER_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
-
-        return err;
+        for (CommandCapture* capture = innermost(); capture != nullptr; capture = capture->outer_) {
+            if (capture->queue_ == queue) {
+                return capture;
+            }
+        }
+        return nullptr;
     }
 
-    cl_int enqueueCopyBuffer(
-        const Buffer& src,
-        const Buffer& dst,
-        size_type src_offset,
-        size_type dst_offset,
-        size_type size,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    void begin()
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueCopyBuffer(
-                object_, src(), dst(), src_offset, dst_offset, size,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQEUE_COPY_BUFFER_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
-
-        return err;
+        if (!active_) {
+            outer_ = innermost();
+            innermost() = this;
+            active_ = true;
+        }
     }
-#if CL_HPP_TARGET_OPENCL_VERSION >= 110
-    cl_int enqueueReadBufferRect(
-        const Buffer& buffer,
-        cl_bool blocking,
-        const array<size_type, 3>& buffer_offset,
-        const array<size_type, 3>& host_offset,
-        const array<size_type, 3>& region,
-        size_type buffer_row_pitch,
-        size_type buffer_slice_pitch,
-        size_type host_row_pitch,
-        size_type host_slice_pitch,
-        void *ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueReadBufferRect(
-                object_, 
-                buffer(), 
-                blocking,
-                buffer_offset.data(),
-                host_offset.data(),
-                region.data(),
-                buffer_row_pitch,
-                buffer_slice_pitch,
-                host_row_pitch,
-                host_slice_pitch,
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-                __ENQUEUE_READ_BUFFER_RECT_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
 
-        return err;
-    }
+    /*! \brief Stops recording.
+     *
+     *  Completes the placeholder events so that nothing outside the capture
+     *  can block on them.
+     */
+    void end()
+    {
+        if (!active_) {
+            return;
+        }
+        for (CommandCapture** link = &innermost(); *link != nullptr; link = &(*link)->outer_) {
+            if (*link == this) {
+                *link = outer_;
+                break;
+            }
+        }
+        active_ = false;
 
-    cl_int enqueueReadBufferRect(
-        const Buffer& buffer,
-        cl_bool blocking,
-        const array<size_type, 2>& buffer_offset,
-        const array<size_type, 2>& host_offset,
-        const array<size_type, 2>& region,
-        size_type buffer_row_pitch,
-        size_type buffer_slice_pitch,
-        size_type host_row_pitch,
-        size_type host_slice_pitch,
-        void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    { 
-        return enqueueReadBufferRect(
-            buffer,
-            blocking,
-            { buffer_offset[0], buffer_offset[1], 0 },
-            { host_offset[0], host_offset[1], 0 },
-            { region[0], region[1], 1 },
-            buffer_row_pitch,
-            buffer_slice_pitch,
-            host_row_pitch,
-            host_slice_pitch,
-            ptr,
-            events,
-            event);
+        for (auto& e : events_) {
+            ::clSetUserEventStatus(e.first(), CL_COMPLETE);
+        }
+        events_.clear();
     }
 
-    cl_int enqueueWriteBufferRect(
-        const Buffer& buffer,
-        cl_bool blocking,
-        const array<size_type, 3>& buffer_offset,
-        const array<size_type, 3>& host_offset,
-        const array<size_type, 3>& region,
-        size_type buffer_row_pitch,
-        size_type buffer_slice_pitch,
-        size_type host_row_pitch,
-        size_type host_slice_pitch,
-        const void *ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    bool isActive() const
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueWriteBufferRect(
-                object_, 
-                buffer(), 
-                blocking,
-                buffer_offset.data(),
-                host_offset.data(),
-                region.data(),
-                buffer_row_pitch,
-                buffer_slice_pitch,
-                host_row_pitch,
-                host_slice_pitch,
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-                __ENQUEUE_WRITE_BUFFER_RECT_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        return active_;
+    }
 
-        return err;
+    cl_int ndRangeKernel(
+        const Kernel& kernel,
+        const NDRange& offset,
+        const NDRange& global,
+        const NDRange& local,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_NDRANGE_KERNEL_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandNDRangeKernelKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandNDRangeKernelKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, nullptr, kernel(),
+                    (cl_uint) global.dimensions(),
+                    offset.dimensions() != 0 ? (const size_type*) offset : nullptr,
+                    (const size_type*) global,
+                    local.dimensions() != 0 ? (const size_type*) local : nullptr,
+                    numWaits, waits, point, nullptr);
+            });
     }
 
-    cl_int enqueueWriteBufferRect(
-        const Buffer& buffer,
-        cl_bool blocking,
-        const array<size_type, 2>& buffer_offset,
-        const array<size_type, 2>& host_offset,
-        const array<size_type, 2>& region,
-        size_type buffer_row_pitch,
-        size_type buffer_slice_pitch,
-        size_type host_row_pitch,
-        size_type host_slice_pitch,
-        const void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        return enqueueWriteBufferRect(
-            buffer, 
-            blocking,
-            { buffer_offset[0], buffer_offset[1], 0 },
-            { host_offset[0], host_offset[1], 0 },
-            { region[0], region[1], 1 },
-            buffer_row_pitch,
-            buffer_slice_pitch,
-            host_row_pitch,
-            host_slice_pitch,
-            ptr,
-            events,
-            event);
+    cl_int copyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
+        size_type size,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_COPY_BUFFER_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandCopyBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, src(), dst(),
+                    src_offset, dst_offset, size,
+                    numWaits, waits, point, nullptr);
+            });
     }
 
-    cl_int enqueueCopyBufferRect(
+    cl_int copyBufferRect(
         const Buffer& src,
         const Buffer& dst,
         const array<size_type, 3>& src_origin,
@@ -7670,129 +10099,2858 @@ public:
         size_type src_slice_pitch,
         size_type dst_row_pitch,
         size_type dst_slice_pitch,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueCopyBufferRect(
-                object_, 
-                src(), 
-                dst(), 
-                src_origin.data(),
-                dst_origin.data(),
-                region.data(),
-                src_row_pitch,
-                src_slice_pitch,
-                dst_row_pitch,
-                dst_slice_pitch,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQEUE_COPY_BUFFER_RECT_ERR);
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_COPY_BUFFER_RECT_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandCopyBufferRectKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferRectKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, src(), dst(),
+                    src_origin.data(), dst_origin.data(), region.data(),
+                    src_row_pitch, src_slice_pitch, dst_row_pitch, dst_slice_pitch,
+                    numWaits, waits, point, nullptr);
+            });
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    cl_int copyImage(
+        const Image& src,
+        const Image& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_COPY_IMAGE_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandCopyImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyImageKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, src(), dst(),
+                    src_origin.data(), dst_origin.data(), region.data(),
+                    numWaits, waits, point, nullptr);
+            });
+    }
 
-        return err;
+    cl_int copyImageToBuffer(
+        const Image& src,
+        const Buffer& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& region,
+        size_type dst_offset,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_COPY_IMAGE_TO_BUFFER_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandCopyImageToBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyImageToBufferKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, src(), dst(),
+                    src_origin.data(), region.data(), dst_offset,
+                    numWaits, waits, point, nullptr);
+            });
     }
 
-    cl_int enqueueCopyBufferRect(
+    cl_int copyBufferToImage(
         const Buffer& src,
-        const Buffer& dst,
-        const array<size_type, 2>& src_origin,
-        const array<size_type, 2>& dst_origin,
-        const array<size_type, 2>& region,
-        size_type src_row_pitch,
-        size_type src_slice_pitch,
-        size_type dst_row_pitch,
-        size_type dst_slice_pitch,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        return enqueueCopyBufferRect(
-            src,
-            dst,
-            { src_origin[0], src_origin[1], 0 },
-            { dst_origin[0], dst_origin[1], 0 },
-            { region[0], region[1], 1 },
-            src_row_pitch,
-            src_slice_pitch,
-            dst_row_pitch,
-            dst_slice_pitch,
-            events,
-            event);
+        const Image& dst,
+        size_type src_offset,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_COPY_BUFFER_TO_IMAGE_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandCopyBufferToImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferToImageKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, src(), dst(),
+                    src_offset, dst_origin.data(), region.data(),
+                    numWaits, waits, point, nullptr);
+            });
     }
 
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-    /**
-     * Enqueue a command to fill a buffer object with a pattern
-     * of a given size. The pattern is specified as a vector type.
-     * \tparam PatternType The datatype of the pattern field. 
-     *     The pattern type must be an accepted OpenCL data type.
-     * \tparam offset Is the offset in bytes into the buffer at 
-     *     which to start filling. This must be a multiple of 
-     *     the pattern size.
-     * \tparam size Is the size in bytes of the region to fill.
-     *     This must be a multiple of the pattern size.
-     */
-    template<typename PatternType>
-    cl_int enqueueFillBuffer(
+    cl_int fillBuffer(
         const Buffer& buffer,
-        PatternType pattern,
+        const void* pattern,
+        size_type pattern_size,
         size_type offset,
         size_type size,
-        const vector<Event>* events = nullptr,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_FILL_BUFFER_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandFillBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandFillBufferKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, buffer(),
+                    pattern, pattern_size, offset, size,
+                    numWaits, waits, point, nullptr);
+            });
+    }
+
+    cl_int fillImage(
+        const Image& image,
+        const void* fillColor,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        EventWaitList events,
+        Event* event)
+    {
+        return record(events, event, false, false, __COMMAND_FILL_IMAGE_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandFillImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandFillImageKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr, image(),
+                    fillColor, origin.data(), region.data(),
+                    numWaits, waits, point, nullptr);
+            });
+    }
+
+    //! \brief Records a marker or barrier, which with an empty wait list
+    //! waits for all commands recorded before it.
+    cl_int barrier(EventWaitList events, Event* event, bool isBarrier)
+    {
+        return record(events, event, true, isBarrier, __COMMAND_BARRIER_WITH_WAIT_LIST_KHR_ERR,
+            [&](cl_uint numWaits, const cl_sync_point_khr* waits, cl_sync_point_khr* point) -> cl_int {
+                PFN_clCommandBarrierWithWaitListKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandBarrierWithWaitListKHR);
+                if (pfn == nullptr) {
+                    return CL_INVALID_OPERATION;
+                }
+                return pfn(
+                    commandBuffer_, nullptr,
+                    numWaits, waits, point, nullptr);
+            });
+    }
+};
+
+inline bool isCapturePlaceholder(const cl_event* events, size_type count)
+{
+    return CommandCapture::holds(events, count);
+}
+
+} // namespace detail
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+/*! \class CommandQueue
+ * \brief CommandQueue interface for cl_command_queue.
+ */
+class CommandQueue : public detail::Wrapper<cl_command_queue>
+{
+private:
+    static std::once_flag default_initialized_;
+    static CommandQueue default_;
+    static cl_int default_error_;
+
+    /*! \brief Create the default command queue returned by @ref getDefault.
+     *
+     * It sets default_error_ to indicate success or failure. It does not throw
+     * @c cl::Error.
+     */
+    static void makeDefault()
+    {
+        /* We don't want to throw an error from this function, so we have to
+         * catch and set the error flag.
+         */
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        try
+#endif
+        {
+            int error;
+            const Context& context = Context::getDefaultRef(&error);
+
+            if (error != CL_SUCCESS) {
+                default_error_ = error;
+            }
+            else {
+                const Device& device = Device::getDefaultRef();
+                default_ = CommandQueue(context, device, 0, &default_error_);
+            }
+        }
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        catch (cl::Error &e) {
+            default_error_ = e.err();
+        }
+#endif
+    }
+
+    /*! \brief Create the default command queue.
+     *
+     * This sets @c default_. It does not throw
+     * @c cl::Error.
+     */
+    static void makeDefaultProvided(const CommandQueue &c) {
+        default_ = c;
+    }
+
+    struct ThreadDefault;
+    static ThreadDefault& threadDefault();
+    static void makeThreadDefault(ThreadDefault& state);
+
+    /*! \brief Whether commands enqueued to this queue are being recorded.
+     *
+     *  Commands without a command buffer equivalent fail while the queue is
+     *  captured, rather than running ahead of the commands being recorded.
+     */
+    bool isCaptured() const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        return detail::CommandCapture::find(object_) != nullptr;
+#else
+        return false;
+#endif
+    }
+
+public:
+#ifdef CL_HPP_UNIT_TEST_ENABLE
+    /*! \brief Reset the default.
+    *
+    * This sets @c default_ to an empty value to support cleanup in
+    * the unit test framework.
+    * This function is not thread safe.
+    */
+    static void unitTestClearDefault() {
+        default_ = CommandQueue();
+    }
+
+    /*! \brief Reset the queue of the calling thread.
+    *
+    * This releases the queue returned by @ref getThreadDefault to support
+    * cleanup in the unit test framework.
+    */
+    static void unitTestClearThreadDefault();
+#endif // #ifdef CL_HPP_UNIT_TEST_ENABLE
+        
+
+    /*!
+     * \brief Constructs a CommandQueue based on passed properties.
+     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+     */
+   CommandQueue(
+        cl_command_queue_properties properties,
+        cl_int* err = nullptr)
+    {
+        cl_int error;
+
+        const Context& context = Context::getDefaultRef(&error);
+        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+
+        if (error != CL_SUCCESS) {
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+        else {
+            Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+            bool useWithProperties;
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+            // Run-time decision based on the actual platform
+            {
+                cl_uint version = detail::getContextPlatformVersion(context());
+                useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+            }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+            useWithProperties = true;
+#else
+            useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+            if (useWithProperties) {
+                cl_queue_properties queue_properties[] = {
+                    CL_QUEUE_PROPERTIES, properties, 0 };
+                if ((properties & CL_QUEUE_ON_DEVICE) == 0) {
+                    object_ = ::clCreateCommandQueueWithProperties(
+                        context(), device(), queue_properties, &error);
+                }
+                else {
+                    error = CL_INVALID_QUEUE_PROPERTIES;
+                }
+
+                detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+                if (err != nullptr) {
+                    *err = error;
+                }
+            }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+            if (!useWithProperties) {
+                object_ = ::clCreateCommandQueue(
+                    context(), device(), properties, &error);
+
+                detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+                if (err != nullptr) {
+                    *err = error;
+                }
+            }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        }
+    }
+
+   /*!
+    * \brief Constructs a CommandQueue based on passed properties.
+    * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+    */
+   CommandQueue(
+       QueueProperties properties,
+       cl_int* err = nullptr)
+   {
+       cl_int error;
+
+       const Context& context = Context::getDefaultRef(&error);
+       detail::errHandler(error, __CREATE_CONTEXT_ERR);
+
+       if (error != CL_SUCCESS) {
+           if (err != nullptr) {
+               *err = error;
+           }
+       }
+       else {
+           Device device = context.getInfo<CL_CONTEXT_DEVICES>()[0];
+           bool useWithProperties;
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+           // Run-time decision based on the actual platform
+           {
+               cl_uint version = detail::getContextPlatformVersion(context());
+               useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+           }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+           useWithProperties = true;
+#else
+           useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+           if (useWithProperties) {
+               cl_queue_properties queue_properties[] = {
+                   CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
+
+               object_ = ::clCreateCommandQueueWithProperties(
+                   context(), device(), queue_properties, &error);
+
+               detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+               if (err != nullptr) {
+                   *err = error;
+               }
+           }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+           if (!useWithProperties) {
+               object_ = ::clCreateCommandQueue(
+                   context(), device(), static_cast<cl_command_queue_properties>(properties), &error);
+
+               detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+               if (err != nullptr) {
+                   *err = error;
+               }
+           }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+
+       }
+   }
+
+    /*!
+     * \brief Constructs a CommandQueue for an implementation defined device in the given context
+     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+     */
+    explicit CommandQueue(
+        const Context& context,
+        cl_command_queue_properties properties = 0,
+        cl_int* err = nullptr)
+    {
+        cl_int error;
+        bool useWithProperties;
+        vector<cl::Device> devices;
+        error = context.getInfo(CL_CONTEXT_DEVICES, &devices);
+
+        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+
+        if (error != CL_SUCCESS)
+        {
+            if (err != nullptr) {
+                *err = error;
+            }
+            return;
+        }
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        // Run-time decision based on the actual platform
+        {
+            cl_uint version = detail::getContextPlatformVersion(context());
+            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+        useWithProperties = true;
+#else
+        useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+        if (useWithProperties) {
+            cl_queue_properties queue_properties[] = {
+                CL_QUEUE_PROPERTIES, properties, 0 };
+            if ((properties & CL_QUEUE_ON_DEVICE) == 0) {
+                object_ = ::clCreateCommandQueueWithProperties(
+                    context(), devices[0](), queue_properties, &error);
+            }
+            else {
+                error = CL_INVALID_QUEUE_PROPERTIES;
+            }
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        if (!useWithProperties) {
+            object_ = ::clCreateCommandQueue(
+                context(), devices[0](), properties, &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+    }
+
+    /*!
+    * \brief Constructs a CommandQueue for an implementation defined device in the given context
+    * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+    */
+    explicit CommandQueue(
+        const Context& context,
+        QueueProperties properties,
+        cl_int* err = nullptr)
+    {
+        cl_int error;
+        bool useWithProperties;
+        vector<cl::Device> devices;
+        error = context.getInfo(CL_CONTEXT_DEVICES, &devices);
+
+        detail::errHandler(error, __CREATE_CONTEXT_ERR);
+
+        if (error != CL_SUCCESS)
+        {
+            if (err != nullptr) {
+                *err = error;
+            }
+            return;
+        }
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        // Run-time decision based on the actual platform
+        {
+            cl_uint version = detail::getContextPlatformVersion(context());
+            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+        useWithProperties = true;
+#else
+        useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+        if (useWithProperties) {
+            cl_queue_properties queue_properties[] = {
+                CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
+            object_ = ::clCreateCommandQueueWithProperties(
+                context(), devices[0](), queue_properties, &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        if (!useWithProperties) {
+            object_ = ::clCreateCommandQueue(
+                context(), devices[0](), static_cast<cl_command_queue_properties>(properties), &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+    }
+
+    /*!
+     * \brief Constructs a CommandQueue for a passed device and context
+     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+     */
+    CommandQueue(
+        const Context& context,
+        const Device& device,
+        cl_command_queue_properties properties = 0,
+        cl_int* err = nullptr)
+    {
+        cl_int error;
+        bool useWithProperties;
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        // Run-time decision based on the actual platform
+        {
+            cl_uint version = detail::getContextPlatformVersion(context());
+            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+        useWithProperties = true;
+#else
+        useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+        if (useWithProperties) {
+            cl_queue_properties queue_properties[] = {
+                CL_QUEUE_PROPERTIES, properties, 0 };
+            object_ = ::clCreateCommandQueueWithProperties(
+                context(), device(), queue_properties, &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        if (!useWithProperties) {
+            object_ = ::clCreateCommandQueue(
+                context(), device(), properties, &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+    }
+
+    /*!
+     * \brief Constructs a CommandQueue for a passed device and context
+     * Will return an CL_INVALID_QUEUE_PROPERTIES error if CL_QUEUE_ON_DEVICE is specified.
+     */
+    CommandQueue(
+        const Context& context,
+        const Device& device,
+        QueueProperties properties,
+        cl_int* err = nullptr)
+    {
+        cl_int error;
+        bool useWithProperties;
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        // Run-time decision based on the actual platform
+        {
+            cl_uint version = detail::getContextPlatformVersion(context());
+            useWithProperties = (version >= 0x20000); // OpenCL 2.0 or above
+        }
+#elif CL_HPP_TARGET_OPENCL_VERSION >= 200
+        useWithProperties = true;
+#else
+        useWithProperties = false;
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+        if (useWithProperties) {
+            cl_queue_properties queue_properties[] = {
+                CL_QUEUE_PROPERTIES, static_cast<cl_queue_properties>(properties), 0 };
+            object_ = ::clCreateCommandQueueWithProperties(
+                context(), device(), queue_properties, &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 200
+        if (!useWithProperties) {
+            object_ = ::clCreateCommandQueue(
+                context(), device(), static_cast<cl_command_queue_properties>(properties), &error);
+
+            detail::errHandler(error, __CREATE_COMMAND_QUEUE_ERR);
+            if (err != nullptr) {
+                *err = error;
+            }
+        }
+#endif // CL_HPP_MINIMUM_OPENCL_VERSION < 200
+    }
+
+    static CommandQueue getDefault(cl_int * err = nullptr) 
+    {
+        return getDefaultRef(err);
+    }
+
+    /*! \brief Returns the default command queue without adding a reference
+     *  to it.
+     *
+     *  The returned object stays valid until the process exits.
+     *
+     *  \see getDefault()
+     */
+    static const CommandQueue& getDefaultRef(cl_int * err = nullptr)
+    {
+        std::call_once(default_initialized_, makeDefault);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+        detail::errHandler(default_error_, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 200
+        detail::errHandler(default_error_, __CREATE_COMMAND_QUEUE_ERR);
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+        if (err != nullptr) {
+            *err = default_error_;
+        }
+        return default_;
+    }
+
+    /*! \brief Returns the command queue of the calling thread.
+     *
+     *  The queue is an in-order queue on the default context and device,
+     *  created the first time a thread asks for it and released when the
+     *  thread exits. Threads submitting through their own queue neither
+     *  contend on a shared queue nor on its reference count.
+     *
+     *  \see CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE
+     */
+    static const CommandQueue& getThreadDefault(cl_int * err = nullptr);
+
+    /**
+     * Modify the default command queue to be used by
+     * subsequent operations.
+     * Will only set the default if no default was previously created.
+     * @return updated default command queue.
+     *         Should be compared to the passed value to ensure that it was updated.
+     */
+    static CommandQueue setDefault(const CommandQueue &default_queue)
+    {
+        std::call_once(default_initialized_, makeDefaultProvided, std::cref(default_queue));
+        detail::errHandler(default_error_);
+        return default_;
+    }
+
+    CommandQueue() { }
+
+
+    /*! \brief Constructor from cl_command_queue - takes ownership.
+     *
+     * \param retainObject will cause the constructor to retain its cl object.
+     *                     Defaults to false to maintain compatibility with
+     *                     earlier versions.
+     */
+    explicit CommandQueue(const cl_command_queue& commandQueue, bool retainObject = false) : 
+        detail::Wrapper<cl_type>(commandQueue, retainObject) { }
+
+    CommandQueue& operator = (const cl_command_queue& rhs)
+    {
+        detail::Wrapper<cl_type>::operator=(rhs);
+        return *this;
+    }
+
+    template <typename T>
+    cl_int getInfo(cl_command_queue_info name, T* param) const
+    {
+        return detail::errHandler(
+            detail::getInfo(
+                &::clGetCommandQueueInfo, object_, name, param),
+                __GET_COMMAND_QUEUE_INFO_ERR);
+    }
+
+    template <cl_command_queue_info name> typename
+    detail::param_traits<detail::cl_command_queue_info, name>::param_type
+    getInfo(cl_int* err = nullptr) const
+    {
+        typename detail::param_traits<
+            detail::cl_command_queue_info, name>::param_type param;
+        cl_int result = getInfo(name, &param);
+        if (err != nullptr) {
+            *err = result;
+        }
+        return param;
+    }
+
+    cl_int enqueueReadBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_READ_BUFFER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueReadBuffer(
+                object_, buffer(), blocking, offset, size,
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_READ_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueReadBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueReadBuffer(buffer, blocking, offset, size, ptr, EventWaitList(events), event);
+    }
+
+    cl_int enqueueWriteBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        const void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WRITE_BUFFER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueWriteBuffer(
+                object_, buffer(), blocking, offset, size,
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+                __ENQUEUE_WRITE_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueWriteBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        const void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteBuffer(
+            buffer, blocking, offset, size, ptr, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->copyBuffer(src, dst, src_offset, dst_offset, size, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueCopyBuffer(
+                object_, src(), dst(), src_offset, dst_offset, size,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQEUE_COPY_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueCopyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBuffer(
+            src, dst, src_offset, dst_offset, size, EventWaitList(events), event);
+    }
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+    cl_int enqueueReadBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 3>& buffer_offset,
+        const array<size_type, 3>& host_offset,
+        const array<size_type, 3>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        void *ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_READ_BUFFER_RECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueReadBufferRect(
+                object_, 
+                buffer(), 
+                blocking,
+                buffer_offset.data(),
+                host_offset.data(),
+                region.data(),
+                buffer_row_pitch,
+                buffer_slice_pitch,
+                host_row_pitch,
+                host_slice_pitch,
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+                __ENQUEUE_READ_BUFFER_RECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueReadBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 3>& buffer_offset,
+        const array<size_type, 3>& host_offset,
+        const array<size_type, 3>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        void *ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueReadBufferRect(
+            buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch,
+            buffer_slice_pitch, host_row_pitch, host_slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueReadBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 2>& buffer_offset,
+        const array<size_type, 2>& host_offset,
+        const array<size_type, 2>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    { 
+        return enqueueReadBufferRect(
+            buffer,
+            blocking,
+            { buffer_offset[0], buffer_offset[1], 0 },
+            { host_offset[0], host_offset[1], 0 },
+            { region[0], region[1], 1 },
+            buffer_row_pitch,
+            buffer_slice_pitch,
+            host_row_pitch,
+            host_slice_pitch,
+            ptr,
+            events,
+            event);
+    }
+
+    cl_int enqueueReadBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 2>& buffer_offset,
+        const array<size_type, 2>& host_offset,
+        const array<size_type, 2>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueReadBufferRect(
+            buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch,
+            buffer_slice_pitch, host_row_pitch, host_slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueWriteBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 3>& buffer_offset,
+        const array<size_type, 3>& host_offset,
+        const array<size_type, 3>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        const void *ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WRITE_BUFFER_RECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueWriteBufferRect(
+                object_, 
+                buffer(), 
+                blocking,
+                buffer_offset.data(),
+                host_offset.data(),
+                region.data(),
+                buffer_row_pitch,
+                buffer_slice_pitch,
+                host_row_pitch,
+                host_slice_pitch,
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+                __ENQUEUE_WRITE_BUFFER_RECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueWriteBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 3>& buffer_offset,
+        const array<size_type, 3>& host_offset,
+        const array<size_type, 3>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        const void *ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteBufferRect(
+            buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch,
+            buffer_slice_pitch, host_row_pitch, host_slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueWriteBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 2>& buffer_offset,
+        const array<size_type, 2>& host_offset,
+        const array<size_type, 2>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        const void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteBufferRect(
+            buffer, 
+            blocking,
+            { buffer_offset[0], buffer_offset[1], 0 },
+            { host_offset[0], host_offset[1], 0 },
+            { region[0], region[1], 1 },
+            buffer_row_pitch,
+            buffer_slice_pitch,
+            host_row_pitch,
+            host_slice_pitch,
+            ptr,
+            events,
+            event);
+    }
+
+    cl_int enqueueWriteBufferRect(
+        const Buffer& buffer,
+        cl_bool blocking,
+        const array<size_type, 2>& buffer_offset,
+        const array<size_type, 2>& host_offset,
+        const array<size_type, 2>& region,
+        size_type buffer_row_pitch,
+        size_type buffer_slice_pitch,
+        size_type host_row_pitch,
+        size_type host_slice_pitch,
+        const void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteBufferRect(
+            buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch,
+            buffer_slice_pitch, host_row_pitch, host_slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueCopyBufferRect(
+        const Buffer& src,
+        const Buffer& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        size_type src_row_pitch,
+        size_type src_slice_pitch,
+        size_type dst_row_pitch,
+        size_type dst_slice_pitch,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->copyBufferRect(
+                src, dst, src_origin, dst_origin, region,
+                src_row_pitch, src_slice_pitch, dst_row_pitch, dst_slice_pitch,
+                events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueCopyBufferRect(
+                object_, 
+                src(), 
+                dst(), 
+                src_origin.data(),
+                dst_origin.data(),
+                region.data(),
+                src_row_pitch,
+                src_slice_pitch,
+                dst_row_pitch,
+                dst_slice_pitch,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQEUE_COPY_BUFFER_RECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueCopyBufferRect(
+        const Buffer& src,
+        const Buffer& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        size_type src_row_pitch,
+        size_type src_slice_pitch,
+        size_type dst_row_pitch,
+        size_type dst_slice_pitch,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferRect(
+            src, dst, src_origin, dst_origin, region, src_row_pitch, src_slice_pitch, dst_row_pitch,
+            dst_slice_pitch, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyBufferRect(
+        const Buffer& src,
+        const Buffer& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        size_type src_row_pitch,
+        size_type src_slice_pitch,
+        size_type dst_row_pitch,
+        size_type dst_slice_pitch,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferRect(
+            src,
+            dst,
+            { src_origin[0], src_origin[1], 0 },
+            { dst_origin[0], dst_origin[1], 0 },
+            { region[0], region[1], 1 },
+            src_row_pitch,
+            src_slice_pitch,
+            dst_row_pitch,
+            dst_slice_pitch,
+            events,
+            event);
+    }
+
+    cl_int enqueueCopyBufferRect(
+        const Buffer& src,
+        const Buffer& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        size_type src_row_pitch,
+        size_type src_slice_pitch,
+        size_type dst_row_pitch,
+        size_type dst_slice_pitch,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferRect(
+            src, dst, src_origin, dst_origin, region, src_row_pitch, src_slice_pitch, dst_row_pitch,
+            dst_slice_pitch, EventWaitList(events), event);
+    }
+
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    /**
+     * Enqueue a command to fill a buffer object with a pattern
+     * of a given size. The pattern is specified as a vector type.
+     * \tparam PatternType The datatype of the pattern field. 
+     *     The pattern type must be an accepted OpenCL data type.
+     * \tparam offset Is the offset in bytes into the buffer at 
+     *     which to start filling. This must be a multiple of 
+     *     the pattern size.
+     * \tparam size Is the size in bytes of the region to fill.
+     *     This must be a multiple of the pattern size.
+     */
+    template<typename PatternType>
+    cl_int enqueueFillBuffer(
+        const Buffer& buffer,
+        PatternType pattern,
+        size_type offset,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->fillBuffer(
+                buffer, &pattern, sizeof(PatternType), offset, size, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueFillBuffer(
+                object_, 
+                buffer(),
+                static_cast<void*>(&pattern),
+                sizeof(PatternType), 
+                offset, 
+                size,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+                __ENQUEUE_FILL_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename PatternType>
+    cl_int enqueueFillBuffer(
+        const Buffer& buffer,
+        PatternType pattern,
+        size_type offset,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueFillBuffer(buffer, pattern, offset, size, EventWaitList(events), event);
+    }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+    cl_int enqueueReadImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_READ_IMAGE_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueReadImage(
+                object_, 
+                image(), 
+                blocking, 
+                origin.data(),
+                region.data(), 
+                row_pitch, 
+                slice_pitch, 
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_READ_IMAGE_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueReadImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueReadImage(
+            image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueReadImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueReadImage(
+            image,
+            blocking,
+            { origin[0], origin[1], 0 },
+            { region[0], region[1], 1 },
+            row_pitch,
+            slice_pitch,
+            ptr,
+            events,
+            event);
+    }
+
+    cl_int enqueueReadImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueReadImage(
+            image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueWriteImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        const void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WRITE_IMAGE_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueWriteImage(
+                object_, 
+                image(), 
+                blocking, 
+                origin.data(),
+                region.data(), 
+                row_pitch, 
+                slice_pitch, 
+                ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_WRITE_IMAGE_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueWriteImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        const void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteImage(
+            image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueWriteImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        const void* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteImage(
+            image,
+            blocking,
+            { origin[0], origin[1], 0 },
+            { region[0], region[1], 1 },
+            row_pitch,
+            slice_pitch,
+            ptr,
+            events,
+            event);
+    }
+
+    cl_int enqueueWriteImage(
+        const Image& image,
+        cl_bool blocking,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        size_type row_pitch,
+        size_type slice_pitch,
+        const void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueWriteImage(
+            image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events),
+            event);
+    }
+
+    cl_int enqueueCopyImage(
+        const Image& src,
+        const Image& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->copyImage(
+                src, dst, src_origin, dst_origin, region, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueCopyImage(
+                object_, 
+                src(), 
+                dst(), 
+                src_origin.data(),
+                dst_origin.data(), 
+                region.data(),
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_COPY_IMAGE_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueCopyImage(
+        const Image& src,
+        const Image& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyImage(
+            src, dst, src_origin, dst_origin, region, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyImage(
+        const Image& src,
+        const Image& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyImage(
+            src,
+            dst,
+            { src_origin[0], src_origin[1], 0 },
+            { dst_origin[0], dst_origin[1], 0 },
+            { region[0], region[1], 1 },
+            events,
+            event);
+    }
+
+    cl_int enqueueCopyImage(
+        const Image& src,
+        const Image& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyImage(
+            src, dst, src_origin, dst_origin, region, EventWaitList(events), event);
+    }
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    /**
+     * Enqueue a command to fill an image object with a specified color.
+     * \param fillColor is the color to use to fill the image.
+     *     This is a four component RGBA floating-point, signed integer
+     *     or unsigned integer color value if  the image channel data
+     *     type is an unnormalized signed integer type.   
+     */
+    template <typename T>
+    typename std::enable_if<std::is_same<T, cl_float4>::value ||
+                            std::is_same<T, cl_int4  >::value ||
+                            std::is_same<T, cl_uint4 >::value,
+                            cl_int>::type 
+     enqueueFillImage(
+         const Image& image, 
+         T fillColor,
+         const array<size_type, 3>& origin,
+         const array<size_type, 3>& region,
+         EventWaitList events,
+         Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->fillImage(image, &fillColor, origin, region, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueFillImage(
+                object_,
+                image(),
+                static_cast<void*>(&fillColor),
+                origin.data(),
+                region.data(),
+                (cl_uint) events.size(),
+                events.get(),
+                (event != NULL) ? &tmp : nullptr),
+            __ENQUEUE_FILL_IMAGE_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS) *event = tmp;
+
+        return err;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, cl_float4>::value ||
+                            std::is_same<T, cl_int4  >::value ||
+                            std::is_same<T, cl_uint4 >::value,
+                            cl_int>::type 
+     enqueueFillImage(
+         const Image& image, 
+         T fillColor,
+         const array<size_type, 3>& origin,
+         const array<size_type, 3>& region,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr) const
+     {
+         return enqueueFillImage(image, fillColor, origin, region, EventWaitList(events), event);
+     }
+
+   /**
+     * Enqueue a command to fill an image object with a specified color.
+     * \param fillColor is the color to use to fill the image.
+     *     This is a four component RGBA floating-point, signed integer
+     *     or unsigned integer color value if  the image channel data
+     *     type is an unnormalized signed integer type.
+     */
+    template <typename T>
+    typename std::enable_if<std::is_same<T, cl_float4>::value ||
+                            std::is_same<T, cl_int4  >::value ||
+                            std::is_same<T, cl_uint4 >::value, cl_int>::type
+    enqueueFillImage(
+        const Image& image,
+        T fillColor,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueFillImage(
+            image,
+            fillColor,
+            { origin[0], origin[1], 0 },
+            { region[0], region[1], 1 },
+            events,
+            event
+            );
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<T, cl_float4>::value ||
+                            std::is_same<T, cl_int4  >::value ||
+                            std::is_same<T, cl_uint4 >::value, cl_int>::type
+    enqueueFillImage(
+        const Image& image,
+        T fillColor,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueFillImage(image, fillColor, origin, region, EventWaitList(events), event);
+    }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+    cl_int enqueueCopyImageToBuffer(
+        const Image& src,
+        const Buffer& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& region,
+        size_type dst_offset,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->copyImageToBuffer(
+                src, dst, src_origin, region, dst_offset, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueCopyImageToBuffer(
+                object_, 
+                src(), 
+                dst(), 
+                src_origin.data(),
+                region.data(), 
+                dst_offset,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_COPY_IMAGE_TO_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueCopyImageToBuffer(
+        const Image& src,
+        const Buffer& dst,
+        const array<size_type, 3>& src_origin,
+        const array<size_type, 3>& region,
+        size_type dst_offset,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyImageToBuffer(
+            src, dst, src_origin, region, dst_offset, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyImageToBuffer(
+        const Image& src,
+        const Buffer& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& region,
+        size_type dst_offset,
+        EventWaitList events,
+        Event* event = nullptr) const
+    { 
+        return enqueueCopyImageToBuffer(
+            src,
+            dst,
+            { src_origin[0], src_origin[1], 0 },
+            { region[0], region[1], 1 },
+            dst_offset,
+            events,
+            event);
+    }
+
+    cl_int enqueueCopyImageToBuffer(
+        const Image& src,
+        const Buffer& dst,
+        const array<size_type, 2>& src_origin,
+        const array<size_type, 2>& region,
+        size_type dst_offset,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyImageToBuffer(
+            src, dst, src_origin, region, dst_offset, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyBufferToImage(
+        const Buffer& src,
+        const Image& dst,
+        size_type src_offset,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->copyBufferToImage(
+                src, dst, src_offset, dst_origin, region, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueCopyBufferToImage(
+                object_, 
+                src(), 
+                dst(), 
+                src_offset,
+                dst_origin.data(), 
+                region.data(),
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_COPY_BUFFER_TO_IMAGE_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueCopyBufferToImage(
+        const Buffer& src,
+        const Image& dst,
+        size_type src_offset,
+        const array<size_type, 3>& dst_origin,
+        const array<size_type, 3>& region,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferToImage(
+            src, dst, src_offset, dst_origin, region, EventWaitList(events), event);
+    }
+
+    cl_int enqueueCopyBufferToImage(
+        const Buffer& src,
+        const Image& dst,
+        size_type src_offset,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferToImage(
+            src,
+            dst, 
+            src_offset,
+            { dst_origin[0], dst_origin[1], 0 },
+            { region[0], region[1], 1 },
+            events,
+            event);
+    }
+
+    cl_int enqueueCopyBufferToImage(
+        const Buffer& src,
+        const Image& dst,
+        size_type src_offset,
+        const array<size_type, 2>& dst_origin,
+        const array<size_type, 2>& region,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueCopyBufferToImage(
+            src, dst, src_offset, dst_origin, region, EventWaitList(events), event);
+    }
+
+    void* enqueueMapBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type offset,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr,
+        cl_int* err = nullptr) const
+    {
+        if (isCaptured()) {
+            detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MAP_BUFFER_ERR);
+            if (err != nullptr) {
+                *err = CL_INVALID_OPERATION;
+            }
+            return nullptr;
+        }
+        cl_event tmp;
+        cl_int error;
+        void * result = ::clEnqueueMapBuffer(
+            object_, buffer(), blocking, flags, offset, size,
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr,
+            &error);
+
+        detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
+        if (event != nullptr && error == CL_SUCCESS)
+            *event = tmp;
+
+        return result;
+    }
+
+    void* enqueueMapBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type offset,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr,
+        cl_int* err = nullptr) const
+    {
+        return enqueueMapBuffer(
+            buffer, blocking, flags, offset, size, EventWaitList(events), event, err);
+    }
+
+    void* enqueueMapImage(
+        const Image& image,
+        cl_bool blocking,
+        cl_map_flags flags,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type * row_pitch,
+        size_type * slice_pitch,
+        EventWaitList events,
+        Event* event = nullptr,
+        cl_int* err = nullptr) const
+    {
+        if (isCaptured()) {
+            detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MAP_IMAGE_ERR);
+            if (err != nullptr) {
+                *err = CL_INVALID_OPERATION;
+            }
+            return nullptr;
+        }
+        cl_event tmp;
+        cl_int error;
+        void * result = ::clEnqueueMapImage(
+            object_, image(), blocking, flags,
+            origin.data(), 
+            region.data(),
+            row_pitch, slice_pitch,
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr,
+            &error);
+
+        detail::errHandler(error, __ENQUEUE_MAP_IMAGE_ERR);
+        if (err != nullptr) {
+              *err = error;
+        }
+        if (event != nullptr && error == CL_SUCCESS)
+            *event = tmp;
+        return result;
+    }
+
+    void* enqueueMapImage(
+        const Image& image,
+        cl_bool blocking,
+        cl_map_flags flags,
+        const array<size_type, 3>& origin,
+        const array<size_type, 3>& region,
+        size_type * row_pitch,
+        size_type * slice_pitch,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr,
+        cl_int* err = nullptr) const
+    {
+        return enqueueMapImage(
+            image, blocking, flags, origin, region, row_pitch, slice_pitch, EventWaitList(events),
+            event, err);
+    }
+
+    void* enqueueMapImage(
+         const Image& image,
+         cl_bool blocking,
+         cl_map_flags flags,
+         const array<size_type, 2>& origin,
+         const array<size_type, 2>& region,
+         size_type* row_pitch,
+         size_type* slice_pitch,
+         EventWaitList events,
+         Event* event = nullptr,
+         cl_int* err = nullptr) const
+    {
+        return enqueueMapImage(image, blocking, flags,
+                               { origin[0], origin[1], 0 },
+                               { region[0], region[1], 1 }, row_pitch,
+                               slice_pitch, events, event, err);
+    }
+
+    void* enqueueMapImage(
+         const Image& image,
+         cl_bool blocking,
+         cl_map_flags flags,
+         const array<size_type, 2>& origin,
+         const array<size_type, 2>& region,
+         size_type* row_pitch,
+         size_type* slice_pitch,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr,
+         cl_int* err = nullptr) const
+    {
+        return enqueueMapImage(
+            image, blocking, flags, origin, region, row_pitch, slice_pitch, EventWaitList(events),
+            event, err);
+    }
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    /**
+     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
+     * This variant takes a raw SVM pointer.
+     */
+    template<typename T>
+    cl_int enqueueMapSVM(
+        T* ptr,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MAP_BUFFER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(::clEnqueueSVMMap(
+            object_, blocking, flags, static_cast<void*>(ptr), size,
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MAP_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T>
+    cl_int enqueueMapSVM(
+        T* ptr,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMapSVM(ptr, blocking, flags, size, EventWaitList(events), event);
+    }
+
+
+    /**
+     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
+     * This variant takes a cl::pointer instance.
+     */
+    template<typename T, class D>
+    cl_int enqueueMapSVM(
+        cl::pointer<T, D> &ptr,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MAP_BUFFER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(::clEnqueueSVMMap(
+            object_, blocking, flags, static_cast<void*>(ptr.get()), size,
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MAP_BUFFER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T, class D>
+    cl_int enqueueMapSVM(
+        cl::pointer<T, D> &ptr,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMapSVM(ptr, blocking, flags, size, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
+     * This variant takes a cl::vector instance.
+     */
+    template<typename T, class Alloc>
+    cl_int enqueueMapSVM(
+        cl::vector<T, Alloc> &container,
+        cl_bool blocking,
+        cl_map_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MAP_BUFFER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(::clEnqueueSVMMap(
+            object_, blocking, flags, static_cast<void*>(container.data()), container.size()*sizeof(T),
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MAP_BUFFER_ERR);
+
+        if (err == CL_SUCCESS) {
+            detail::SVMMapState<Alloc>::set(
+                container.get_allocator(), container.data(), true);
+        }
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T, class Alloc>
+    cl_int enqueueMapSVM(
+        cl::vector<T, Alloc> &container,
+        cl_bool blocking,
+        cl_map_flags flags,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMapSVM(container, blocking, flags, EventWaitList(events), event);
+    }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+    cl_int enqueueUnmapMemObject(
+        const Memory& memory,
+        void* mapped_ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueUnmapMemObject(
+                object_, memory(), mapped_ptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueUnmapMemObject(
+        const Memory& memory,
+        void* mapped_ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueUnmapMemObject(memory, mapped_ptr, EventWaitList(events), event);
+    }
+
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    /**
+     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
+     * This variant takes a raw SVM pointer.
+     */
+    template<typename T>
+    cl_int enqueueUnmapSVM(
+        T* ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueSVMUnmap(
+            object_, static_cast<void*>(ptr),
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T>
+    cl_int enqueueUnmapSVM(
+        T* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueUnmapSVM(ptr, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
+     * This variant takes a cl::pointer instance.
+     */
+    template<typename T, class D>
+    cl_int enqueueUnmapSVM(
+        cl::pointer<T, D> &ptr,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueSVMUnmap(
+            object_, static_cast<void*>(ptr.get()),
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T, class D>
+    cl_int enqueueUnmapSVM(
+        cl::pointer<T, D> &ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueUnmapSVM(ptr, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
+     * This variant takes a cl::vector instance.
+     */
+    template<typename T, class Alloc>
+    cl_int enqueueUnmapSVM(
+        cl::vector<T, Alloc> &container,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueSVMUnmap(
+            object_, static_cast<void*>(container.data()),
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+
+        if (err == CL_SUCCESS) {
+            detail::SVMMapState<Alloc>::set(
+                container.get_allocator(), container.data(), false);
+        }
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T, class Alloc>
+    cl_int enqueueUnmapSVM(
+        cl::vector<T, Alloc> &container,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueUnmapSVM(container, EventWaitList(events), event);
+    }
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    /**
+     * Enqueues a marker command which waits for either a list of events to complete, 
+     * or all previously enqueued commands to complete.
+     *
+     * Enqueues a marker command which waits for either a list of events to complete, 
+     * or if the list is empty it waits for all commands previously enqueued in command_queue 
+     * to complete before it completes. This command returns an event which can be waited on, 
+     * i.e. this event can be waited on to insure that all events either in the event_wait_list 
+     * or all previously enqueued commands, queued before this command to command_queue, 
+     * have completed.
+     */
+    cl_int enqueueMarkerWithWaitList(
+        EventWaitList events,
+        Event *event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->barrier(events, event, false);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueMarkerWithWaitList(
+                object_,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MARKER_WAIT_LIST_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueMarkerWithWaitList(
+        const vector<Event>* events = nullptr,
+        Event *event = nullptr) const
+    {
+        return enqueueMarkerWithWaitList(EventWaitList(events), event);
+    }
+
+    /**
+     * A synchronization point that enqueues a barrier operation.
+     *
+     * Enqueues a barrier command which waits for either a list of events to complete, 
+     * or if the list is empty it waits for all commands previously enqueued in command_queue 
+     * to complete before it completes. This command blocks command execution, that is, any 
+     * following commands enqueued after it do not execute until it completes. This command 
+     * returns an event which can be waited on, i.e. this event can be waited on to insure that 
+     * all events either in the event_wait_list or all previously enqueued commands, queued 
+     * before this command to command_queue, have completed.
+     */
+    cl_int enqueueBarrierWithWaitList(
+        EventWaitList events,
+        Event *event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->barrier(events, event, true);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueBarrierWithWaitList(
+                object_,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_BARRIER_WAIT_LIST_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueBarrierWithWaitList(
+        const vector<Event>* events = nullptr,
+        Event *event = nullptr) const
+    {
+        return enqueueBarrierWithWaitList(EventWaitList(events), event);
+    }
+    
+    /**
+     * Enqueues a command to indicate with which device a set of memory objects
+     * should be associated.
+     */
+    cl_int enqueueMigrateMemObjects(
+        const vector<Memory> &memObjects,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr
+        ) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        }
+        cl_event tmp;
+        
+        vector<cl_mem> localMemObjects(memObjects.size());
+
+        for( int i = 0; i < (int)memObjects.size(); ++i ) {
+            localMemObjects[i] = memObjects[i]();
+        }
+        
+        cl_int err = detail::errHandler(
+            ::clEnqueueMigrateMemObjects(
+                object_, 
+                (cl_uint)memObjects.size(), 
+                localMemObjects.data(),
+                flags,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueMigrateMemObjects(
+        const vector<Memory> &memObjects,
+        cl_mem_migration_flags flags,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr
+        ) const
+    {
+        return enqueueMigrateMemObjects(memObjects, flags, EventWaitList(events), event);
+    }
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    /**
+     * Enqueues a command that will allow the host associate ranges within a set of
+     * SVM allocations with a device.
+     * @param sizes - The length from each pointer to migrate.
+     */
+    template<typename T>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<T*> &svmRawPointers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MIGRATE_SVM_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(::clEnqueueSVMMigrateMem(
+            object_,
+            svmRawPointers.size(), static_cast<void**>(svmRawPointers.data()),
+            sizes.data(), // array of sizes not passed
+            flags,
+            (cl_uint) events.size(),
+            events.get(),
+            (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MIGRATE_SVM_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    template<typename T>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<T*> &svmRawPointers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmRawPointers, sizes, flags, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will allow the host associate a set of SVM allocations with
+     * a device.
+     */
+    template<typename T>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<T*> &svmRawPointers,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmRawPointers, cl::vector<size_type>(svmRawPointers.size()), flags, events, event);
+    }
+
+    template<typename T>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<T*> &svmRawPointers,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmRawPointers, flags, EventWaitList(events), event);
+    }
+
+
+    /**
+     * Enqueues a command that will allow the host associate ranges within a set of
+     * SVM allocations with a device.
+     * @param sizes - The length from each pointer to migrate.
+     */
+    template<typename T, class D>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::pointer<T, D>> &svmPointers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        cl::vector<void*> svmRawPointers;
+        svmRawPointers.reserve(svmPointers.size());
+        for (auto p : svmPointers) {
+            svmRawPointers.push_back(static_cast<void*>(p.get()));
+        }
+
+        return enqueueMigrateSVM(svmRawPointers, sizes, flags, events, event);
+    }
+
+    template<typename T, class D>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::pointer<T, D>> &svmPointers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmPointers, sizes, flags, EventWaitList(events), event);
+    }
+
+
+    /**
+     * Enqueues a command that will allow the host associate a set of SVM allocations with
+     * a device.
+     */
+    template<typename T, class D>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::pointer<T, D>> &svmPointers,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmPointers, cl::vector<size_type>(svmPointers.size()), flags, events, event);
+    }
+
+    template<typename T, class D>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::pointer<T, D>> &svmPointers,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmPointers, flags, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will allow the host associate ranges within a set of
+     * SVM allocations with a device.
+     * @param sizes - The length from the beginning of each container to migrate.
+     */
+    template<typename T, class Alloc>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        cl::vector<void*> svmRawPointers;
+        svmRawPointers.reserve(svmContainers.size());
+        for (auto p : svmContainers) {
+            svmRawPointers.push_back(static_cast<void*>(p.data()));
+        }
+
+        return enqueueMigrateSVM(svmRawPointers, sizes, flags, events, event);
+    }
+
+    template<typename T, class Alloc>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
+        const cl::vector<size_type> &sizes,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmContainers, sizes, flags, EventWaitList(events), event);
+    }
+
+    /**
+     * Enqueues a command that will allow the host associate a set of SVM allocations with
+     * a device.
+     */
+    template<typename T, class Alloc>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
+        cl_mem_migration_flags flags,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmContainers, cl::vector<size_type>(svmContainers.size()), flags, events, event);
+    }
+
+    template<typename T, class Alloc>
+    cl_int enqueueMigrateSVM(
+        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
+        cl_mem_migration_flags flags = 0,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueMigrateSVM(svmContainers, flags, EventWaitList(events), event);
+    }
+
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    
+    cl_int enqueueNDRangeKernel(
+        const Kernel& kernel,
+        const NDRange& offset,
+        const NDRange& global,
+        const NDRange& local,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        if (detail::CommandCapture* capture = detail::CommandCapture::find(object_)) {
+            return capture->ndRangeKernel(kernel, offset, global, local, events, event);
+        }
+#endif // defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueNDRangeKernel(
+                object_, kernel(), (cl_uint) global.dimensions(),
+                offset.dimensions() != 0 ? (const size_type*) offset : nullptr,
+                (const size_type*) global,
+                local.dimensions() != 0 ? (const size_type*) local : nullptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_NDRANGE_KERNEL_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueNDRangeKernel(
+        const Kernel& kernel,
+        const NDRange& offset,
+        const NDRange& global,
+        const NDRange& local = NullRange,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const
+    {
+        return enqueueNDRangeKernel(kernel, offset, global, local, EventWaitList(events), event);
+    }
+
+#if defined(CL_USE_DEPRECATED_OPENCL_1_2_APIS)
+    CL_API_PREFIX__VERSION_1_2_DEPRECATED cl_int enqueueTask(
+        const Kernel& kernel,
+        EventWaitList events,
+        Event* event = nullptr) const CL_API_SUFFIX__VERSION_1_2_DEPRECATED
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_TASK_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueTask(
+                object_, kernel(),
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_TASK_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    CL_API_PREFIX__VERSION_1_2_DEPRECATED cl_int enqueueTask(
+        const Kernel& kernel,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr) const CL_API_SUFFIX__VERSION_1_2_DEPRECATED
+    {
+        return enqueueTask(kernel, EventWaitList(events), event);
+    }
+#endif // #if defined(CL_USE_DEPRECATED_OPENCL_1_2_APIS)
+
+    cl_int enqueueNativeKernel(
+        void (CL_CALLBACK *userFptr)(void *),
+        std::pair<void*, size_type> args,
+        const vector<Memory>* mem_objects,
+        const vector<const void*>* mem_locs,
+        EventWaitList events,
+        Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_NATIVE_KERNEL);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueNativeKernel(
+                object_, userFptr, args.first, args.second,
+                (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
+                (mem_objects->size() > 0 ) ? reinterpret_cast<const cl_mem *>(mem_objects->data()) : nullptr,
+                (mem_locs != nullptr && mem_locs->size() > 0) ? (const void **) &mem_locs->front() : nullptr,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_NATIVE_KERNEL);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueNativeKernel(
+        void (CL_CALLBACK *userFptr)(void *),
+        std::pair<void*, size_type> args,
+        const vector<Memory>* mem_objects = nullptr,
+        const vector<const void*>* mem_locs = nullptr,
+        const vector<Event>* events = nullptr,
         Event* event = nullptr) const
     {
+        return enqueueNativeKernel(
+            userFptr, args, mem_objects, mem_locs, EventWaitList(events), event);
+    }
+
+/**
+ * Deprecated APIs for 1.2
+ */
+#if defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
+    CL_API_PREFIX__VERSION_1_1_DEPRECATED 
+    cl_int enqueueMarker(Event* event = nullptr) const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_MARKER_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            ::clEnqueueMarker(
+                object_, 
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_MARKER_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    CL_API_PREFIX__VERSION_1_1_DEPRECATED
+    cl_int enqueueWaitForEvents(const vector<Event>& events) const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WAIT_FOR_EVENTS_ERR);
+        }
+        return detail::errHandler(
+            ::clEnqueueWaitForEvents(
+                object_,
+                (cl_uint) events.size(),
+                events.size() > 0 ? (const cl_event*) &events.front() : nullptr),
+            __ENQUEUE_WAIT_FOR_EVENTS_ERR);
+    }
+#endif // defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
+
+    cl_int enqueueAcquireGLObjects(
+         const vector<Memory>* mem_objects,
+         EventWaitList events,
+         Event* event = nullptr) const
+     {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_ACQUIRE_GL_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+             ::clEnqueueAcquireGLObjects(
+                 object_,
+                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
+                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
+                 (cl_uint) events.size(),
+                 events.get(),
+                 (event != nullptr) ? &tmp : nullptr),
+             __ENQUEUE_ACQUIRE_GL_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+     }
+
+    cl_int enqueueAcquireGLObjects(
+         const vector<Memory>* mem_objects = nullptr,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr) const
+    {
+        return enqueueAcquireGLObjects(mem_objects, EventWaitList(events), event);
+    }
+
+    cl_int enqueueReleaseGLObjects(
+         const vector<Memory>* mem_objects,
+         EventWaitList events,
+         Event* event = nullptr) const
+     {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_RELEASE_GL_ERR);
+        }
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+             ::clEnqueueReleaseGLObjects(
+                 object_,
+                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
+                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
+                 (cl_uint) events.size(),
+                 events.get(),
+                 (event != nullptr) ? &tmp : nullptr),
+             __ENQUEUE_RELEASE_GL_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+     }
+
+    cl_int enqueueReleaseGLObjects(
+         const vector<Memory>* mem_objects = nullptr,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr) const
+    {
+        return enqueueReleaseGLObjects(mem_objects, EventWaitList(events), event);
+    }
+
+#if defined (CL_HPP_USE_DX_INTEROP)
+typedef CL_API_ENTRY cl_int (CL_API_CALL *PFN_clEnqueueAcquireD3D10ObjectsKHR)(
+    cl_command_queue command_queue, cl_uint num_objects,
+    const cl_mem* mem_objects, cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list, cl_event* event);
+typedef CL_API_ENTRY cl_int (CL_API_CALL *PFN_clEnqueueReleaseD3D10ObjectsKHR)(
+    cl_command_queue command_queue, cl_uint num_objects,
+    const cl_mem* mem_objects,  cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list, cl_event* event);
+
+    cl_int enqueueAcquireD3D10Objects(
+         const vector<Memory>* mem_objects,
+         EventWaitList events,
+         Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_ACQUIRE_GL_ERR);
+        }
+        static PFN_clEnqueueAcquireD3D10ObjectsKHR pfn_clEnqueueAcquireD3D10ObjectsKHR = nullptr;
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_context context = getInfo<CL_QUEUE_CONTEXT>();
+        cl::Device device(getInfo<CL_QUEUE_DEVICE>());
+        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>();
+        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueAcquireD3D10ObjectsKHR);
+#endif
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 120
+        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueAcquireD3D10ObjectsKHR);
+#endif
+        
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+             pfn_clEnqueueAcquireD3D10ObjectsKHR(
+                 object_,
+                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
+                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
+                 (cl_uint) events.size(),
+                 events.get(),
+                 (event != nullptr) ? &tmp : nullptr),
+             __ENQUEUE_ACQUIRE_GL_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+     }
+
+    cl_int enqueueAcquireD3D10Objects(
+         const vector<Memory>* mem_objects = nullptr,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr) const
+    {
+        return enqueueAcquireD3D10Objects(mem_objects, EventWaitList(events), event);
+    }
+
+    cl_int enqueueReleaseD3D10Objects(
+         const vector<Memory>* mem_objects,
+         EventWaitList events,
+         Event* event = nullptr) const
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_RELEASE_GL_ERR);
+        }
+        static PFN_clEnqueueReleaseD3D10ObjectsKHR pfn_clEnqueueReleaseD3D10ObjectsKHR = nullptr;
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+        cl_context context = getInfo<CL_QUEUE_CONTEXT>();
+        cl::Device device(getInfo<CL_QUEUE_DEVICE>());
+        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>();
+        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueReleaseD3D10ObjectsKHR);
+#endif
+#if CL_HPP_MINIMUM_OPENCL_VERSION < 120
+        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueReleaseD3D10ObjectsKHR);
+#endif
+
         cl_event tmp;
         cl_int err = detail::errHandler(
-            ::clEnqueueFillBuffer(
-                object_, 
-                buffer(),
-                static_cast<void*>(&pattern),
-                sizeof(PatternType), 
-                offset, 
-                size,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
+            pfn_clEnqueueReleaseD3D10ObjectsKHR(
+                object_,
+                (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
+                (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
+                (cl_uint) events.size(),
+                events.get(),
                 (event != nullptr) ? &tmp : nullptr),
-                __ENQUEUE_FILL_BUFFER_ERR);
+            __ENQUEUE_RELEASE_GL_ERR);
 
         if (event != nullptr && err == CL_SUCCESS)
             *event = tmp;
 
         return err;
     }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
 
-    cl_int enqueueReadImage(
-        const Image& image,
-        cl_bool blocking,
-        const array<size_type, 3>& origin,
-        const array<size_type, 3>& region,
-        size_type row_pitch,
-        size_type slice_pitch,
-        void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    cl_int enqueueReleaseD3D10Objects(
+         const vector<Memory>* mem_objects = nullptr,
+         const vector<Event>* events = nullptr,
+         Event* event = nullptr) const
+    {
+        return enqueueReleaseD3D10Objects(mem_objects, EventWaitList(events), event);
+    }
+#endif
+
+/**
+ * Deprecated APIs for 1.2
+ */
+#if defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
+    CL_API_PREFIX__VERSION_1_1_DEPRECATED
+    cl_int enqueueBarrier() const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
+    {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_BARRIER_ERR);
+        }
+        return detail::errHandler(
+            ::clEnqueueBarrier(object_),
+            __ENQUEUE_BARRIER_ERR);
+    }
+#endif // CL_USE_DEPRECATED_OPENCL_1_1_APIS
+
+    cl_int flush() const
+    {
+        return detail::errHandler(::clFlush(object_), __FLUSH_ERR);
+    }
+
+    cl_int finish() const
+    {
+        return detail::errHandler(::clFinish(object_), __FINISH_ERR);
+    }
+
+#ifdef cl_khr_external_memory
+    cl_int enqueueAcquireExternalMemObjects(
+        const vector<Memory>& mem_objects,
+        EventWaitList events_wait,
+        Event *event = nullptr)
     {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_ACQUIRE_EXTERNAL_MEMORY_ERR);
+        }
+        cl_int err = CL_INVALID_OPERATION;
         cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueReadImage(
-                object_, 
-                image(), 
-                blocking, 
-                origin.data(),
-                region.data(), 
-                row_pitch, 
-                slice_pitch, 
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_READ_IMAGE_ERR);
+
+        const detail::ExtensionDispatch* dispatch = detail::ExtensionDispatch::getForQueue(object_);
+
+        PFN_clEnqueueAcquireExternalMemObjectsKHR pfn = CL_HPP_EXT_FCN_(dispatch, clEnqueueAcquireExternalMemObjectsKHR);
+        if (pfn != nullptr)
+        {
+            err = pfn(
+                object_,
+                static_cast<cl_uint>(mem_objects.size()),
+                (mem_objects.size() > 0) ? reinterpret_cast<const cl_mem *>(mem_objects.data()) : nullptr,
+                static_cast<cl_uint>(events_wait.size()),
+                events_wait.get(),
+                &tmp);
+        }
+
+        detail::errHandler(err, __ENQUEUE_ACQUIRE_EXTERNAL_MEMORY_ERR);
 
         if (event != nullptr && err == CL_SUCCESS)
             *event = tmp;
@@ -7800,1841 +12958,2576 @@ public:
         return err;
     }
 
-    cl_int enqueueReadImage(
-        const Image& image,
-        cl_bool blocking,
-        const array<size_type, 2>& origin,
-        const array<size_type, 2>& region,
-        size_type row_pitch,
-        size_type slice_pitch,
-        void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    cl_int enqueueAcquireExternalMemObjects(
+        const vector<Memory>& mem_objects,
+        const vector<Event>* events_wait = nullptr,
+        Event *event = nullptr)
     {
-        return enqueueReadImage(
-            image,
-            blocking,
-            { origin[0], origin[1], 0 },
-            { region[0], region[1], 1 },
-            row_pitch,
-            slice_pitch,
-            ptr,
-            events,
-            event);
+        return enqueueAcquireExternalMemObjects(mem_objects, EventWaitList(events_wait), event);
     }
 
-    cl_int enqueueWriteImage(
-        const Image& image,
-        cl_bool blocking,
-        const array<size_type, 3>& origin,
-        const array<size_type, 3>& region,
-        size_type row_pitch,
-        size_type slice_pitch,
-        const void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    cl_int enqueueReleaseExternalMemObjects(
+        const vector<Memory>& mem_objects,
+        EventWaitList events_wait,
+        Event *event = nullptr)
     {
+        if (isCaptured()) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_RELEASE_EXTERNAL_MEMORY_ERR);
+        }
+        cl_int err = CL_INVALID_OPERATION;
         cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueWriteImage(
-                object_, 
-                image(), 
-                blocking, 
-                origin.data(),
-                region.data(), 
-                row_pitch, 
-                slice_pitch, 
-                ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_WRITE_IMAGE_ERR);
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        const detail::ExtensionDispatch* dispatch = detail::ExtensionDispatch::getForQueue(object_);
+
+        PFN_clEnqueueReleaseExternalMemObjectsKHR pfn = CL_HPP_EXT_FCN_(dispatch, clEnqueueReleaseExternalMemObjectsKHR);
+        if (pfn != nullptr)
+        {
+            err = pfn(
+                object_,
+                static_cast<cl_uint>(mem_objects.size()),
+                (mem_objects.size() > 0) ? reinterpret_cast<const cl_mem *>(mem_objects.data()) : nullptr,
+                static_cast<cl_uint>(events_wait.size()),
+                events_wait.get(),
+                &tmp);
+        }
+
+        detail::errHandler(err, __ENQUEUE_RELEASE_EXTERNAL_MEMORY_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
+    cl_int enqueueReleaseExternalMemObjects(
+        const vector<Memory>& mem_objects,
+        const vector<Event>* events_wait = nullptr,
+        Event *event = nullptr)
+    {
+        return enqueueReleaseExternalMemObjects(mem_objects, EventWaitList(events_wait), event);
+    }
+#endif // cl_khr_external_memory && CL_HPP_TARGET_OPENCL_VERSION >= 300
+
+#ifdef cl_khr_semaphore
+    cl_int enqueueWaitSemaphores(
+        const vector<Semaphore> &sema_objects,
+        const vector<cl_semaphore_payload_khr> &sema_payloads,
+        EventWaitList events_wait_list,
+        Event *event = nullptr) const;
+
+    cl_int enqueueWaitSemaphores(
+        const vector<Semaphore> &sema_objects,
+        const vector<cl_semaphore_payload_khr> &sema_payloads = {},
+        const vector<Event>* events_wait_list = nullptr,
+        Event *event = nullptr) const
+    {
+        return enqueueWaitSemaphores(
+            sema_objects, sema_payloads, EventWaitList(events_wait_list), event);
+    }
+
+    cl_int enqueueSignalSemaphores(
+        const vector<Semaphore> &sema_objects,
+        const vector<cl_semaphore_payload_khr>& sema_payloads,
+        EventWaitList events_wait_list,
+        Event* event = nullptr);
+
+    cl_int enqueueSignalSemaphores(
+        const vector<Semaphore> &sema_objects,
+        const vector<cl_semaphore_payload_khr>& sema_payloads = {},
+        const vector<Event>* events_wait_list = nullptr,
+        Event* event = nullptr)
+    {
+        return enqueueSignalSemaphores(
+            sema_objects, sema_payloads, EventWaitList(events_wait_list), event);
+    }
+#endif // cl_khr_semaphore
+}; // CommandQueue
+
+CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag CommandQueue::default_initialized_;
+CL_HPP_DEFINE_STATIC_MEMBER_ CommandQueue CommandQueue::default_;
+CL_HPP_DEFINE_STATIC_MEMBER_ cl_int CommandQueue::default_error_ = CL_SUCCESS;
+
+struct CommandQueue::ThreadDefault
+{
+    CommandQueue queue_;
+    cl_int error_;
+    bool initialized_;
+
+    ThreadDefault() : error_(CL_SUCCESS), initialized_(false) { }
+};
+
+inline CommandQueue::ThreadDefault& CommandQueue::threadDefault()
+{
+    static thread_local ThreadDefault state;
+    return state;
+}
+
+/*! \brief Create the queue returned by @ref CommandQueue::getThreadDefault.
+ *
+ * It sets the error of state to indicate success or failure. It does not
+ * throw @c cl::Error.
+ */
+inline void CommandQueue::makeThreadDefault(ThreadDefault& state)
+{
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    try
+#endif
+    {
+        const Context& context = Context::getDefaultRef(&state.error_);
+        if (state.error_ == CL_SUCCESS) {
+            const Device& device = Device::getDefaultRef(&state.error_);
+            if (state.error_ == CL_SUCCESS) {
+                state.queue_ = CommandQueue(context, device, 0, &state.error_);
+            }
+        }
+    }
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    catch (cl::Error &e) {
+        state.error_ = e.err();
+    }
+#endif
+}
+
+inline const CommandQueue& CommandQueue::getThreadDefault(cl_int * err)
+{
+    ThreadDefault& state = threadDefault();
+    if (!state.initialized_) {
+        state.initialized_ = true;
+        makeThreadDefault(state);
+    }
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    detail::errHandler(state.error_, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 200
+    detail::errHandler(state.error_, __CREATE_COMMAND_QUEUE_ERR);
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 200
+    if (err != nullptr) {
+        *err = state.error_;
+    }
+    return state.queue_;
+}
+
+#ifdef CL_HPP_UNIT_TEST_ENABLE
+inline void CommandQueue::unitTestClearThreadDefault()
+{
+    threadDefault() = ThreadDefault();
+}
+#endif // #ifdef CL_HPP_UNIT_TEST_ENABLE
+
+namespace detail {
 
-        return err;
-    }
+/*! \brief Returns the queue used by commands that are not given one.
+ *
+ * \see CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE
+ */
+inline const CommandQueue& getImplicitQueue(cl_int * err = nullptr)
+{
+#if defined(CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE)
+    return CommandQueue::getThreadDefault(err);
+#else
+    return CommandQueue::getDefaultRef(err);
+#endif
+}
 
-    cl_int enqueueWriteImage(
-        const Image& image,
-        cl_bool blocking,
-        const array<size_type, 2>& origin,
-        const array<size_type, 2>& region,
-        size_type row_pitch,
-        size_type slice_pitch,
-        const void* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        return enqueueWriteImage(
-            image,
-            blocking,
-            { origin[0], origin[1], 0 },
-            { region[0], region[1], 1 },
-            row_pitch,
-            slice_pitch,
-            ptr,
-            events,
-            event);
-    }
+} // namespace detail
 
-    cl_int enqueueCopyImage(
-        const Image& src,
-        const Image& dst,
-        const array<size_type, 3>& src_origin,
-        const array<size_type, 3>& dst_origin,
-        const array<size_type, 3>& region,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+/*! \class StagingRing
+ * \brief Uploads host data through a ring of pinned staging buffers.
+ *
+ * The staging buffers are created with CL_MEM_ALLOC_HOST_PTR, which most
+ * implementations back with page-locked memory, and stay mapped for the
+ * lifetime of the ring. write() copies the data into the next slot and
+ * enqueues a non-blocking write from it, so the transfer runs at DMA speed
+ * without the hidden copy a write from pageable memory takes. A slot is
+ * reused once the write reading from it has completed; write() only blocks
+ * when every slot is still in flight.
+ *
+ * The writes read from the mapped pointers. Commands must not access a
+ * mapped buffer, so the staging buffers themselves are never copied from.
+ */
+class StagingRing
+{
+private:
+    struct Slot
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueCopyImage(
-                object_, 
-                src(), 
-                dst(), 
-                src_origin.data(),
-                dst_origin.data(), 
-                region.data(),
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_COPY_IMAGE_ERR);
+        Buffer buffer_;
+        void* ptr_;
+        // The last write reading from the slot
+        Event event_;
+    };
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    std::mutex mutex_;
+    CommandQueue queue_;
+    size_type slotSize_;
+    vector<Slot> slots_;
+    size_type next_;
 
-        return err;
+public:
+    /*! \brief Creates slotCount staging buffers of slotSize bytes.
+     *
+     *  The data is written to buffers with queue.
+     */
+    StagingRing(
+        const CommandQueue& queue,
+        size_type slotSize,
+        size_type slotCount,
+        cl_int* err = nullptr) :
+        queue_(queue),
+        slotSize_(slotSize),
+        next_(0)
+    {
+        cl_int error;
+        Context context = queue.getInfo<CL_QUEUE_CONTEXT>(&error);
+        for (size_type i = 0; i < slotCount && error == CL_SUCCESS; ++i) {
+            Slot slot;
+            slot.buffer_ = Buffer(
+                context, CL_MEM_ALLOC_HOST_PTR | CL_MEM_READ_ONLY, slotSize, nullptr, &error);
+            if (error == CL_SUCCESS) {
+                slot.ptr_ = queue_.enqueueMapBuffer(
+                    slot.buffer_,
+                    CL_TRUE,
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+                    CL_MAP_WRITE_INVALIDATE_REGION,
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 120
+                    CL_MAP_WRITE,
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+                    0,
+                    slotSize,
+                    EventWaitList(),
+                    nullptr,
+                    &error);
+            }
+            if (error == CL_SUCCESS) {
+                slots_.push_back(std::move(slot));
+            }
+        }
+
+        if (err != nullptr) {
+            *err = error;
+        }
     }
 
-    cl_int enqueueCopyImage(
-        const Image& src,
-        const Image& dst,
-        const array<size_type, 2>& src_origin,
-        const array<size_type, 2>& dst_origin,
-        const array<size_type, 2>& region,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    StagingRing(const StagingRing&) = delete;
+    StagingRing& operator = (const StagingRing&) = delete;
+
+    //! \brief Unmaps the staging buffers once their writes have completed.
+    ~StagingRing()
     {
-        return enqueueCopyImage(
-            src,
-            dst,
-            { src_origin[0], src_origin[1], 0 },
-            { dst_origin[0], dst_origin[1], 0 },
-            { region[0], region[1], 1 },
-            events,
-            event);
+        for (const Slot& slot : slots_) {
+            cl_event event = slot.event_();
+            ::clEnqueueUnmapMemObject(
+                queue_(), slot.buffer_(), slot.ptr_,
+                event != nullptr ? 1 : 0, event != nullptr ? &event : nullptr,
+                nullptr);
+        }
     }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-    /**
-     * Enqueue a command to fill an image object with a specified color.
-     * \param fillColor is the color to use to fill the image.
-     *     This is a four component RGBA floating-point, signed integer
-     *     or unsigned integer color value if  the image channel data
-     *     type is an unnormalized signed integer type.   
+    /*! \brief Writes size bytes from ptr to buffer at offset.
+     *
+     *  The data is copied before the call returns, in slotSize chunks that
+     *  are written one after the other. Each chunk waits for events.
+     *
+     *  \param event Set to an event that completes once every chunk has
+     *  been written.
      */
-    template <typename T>
-    typename std::enable_if<std::is_same<T, cl_float4>::value ||
-                            std::is_same<T, cl_int4  >::value ||
-                            std::is_same<T, cl_uint4 >::value,
-                            cl_int>::type 
-     enqueueFillImage(
-         const Image& image, 
-         T fillColor,
-         const array<size_type, 3>& origin,
-         const array<size_type, 3>& region,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr) const
+    cl_int write(
+        const Buffer& buffer,
+        size_type offset,
+        const void* ptr,
+        size_type size,
+        EventWaitList events = EventWaitList(),
+        Event* event = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueFillImage(
-                object_,
-                image(),
-                static_cast<void*>(&fillColor),
-                origin.data(),
-                region.data(),
-                (events != nullptr) ? (cl_uint)events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : NULL,
-                (event != NULL) ? &tmp : nullptr),
-            __ENQUEUE_FILL_IMAGE_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS) *event = tmp;
-
-        return err;
+        const char* src = static_cast<const char*>(ptr);
+        return write(buffer, offset, src, src + size, events, event);
     }
 
-   /**
-     * Enqueue a command to fill an image object with a specified color.
-     * \param fillColor is the color to use to fill the image.
-     *     This is a four component RGBA floating-point, signed integer
-     *     or unsigned integer color value if  the image channel data
-     *     type is an unnormalized signed integer type.
+    /*! \brief Writes the elements of a host range to buffer at offset bytes.
+     *
+     *  The range is read once, front to back, so any input iterator works.
+     *  Filling the next slot from the range overlaps the transfer of the
+     *  previous one, which makes a ring of two or more slots a pipelined
+     *  upload for data much larger than the slots.
+     *
+     *  \param event Set to an event that completes once every chunk has
+     *  been written. The writes of several chunks are joined by a marker,
+     *  as they may complete in any order on an out-of-order queue.
      */
-    template <typename T>
-    typename std::enable_if<std::is_same<T, cl_float4>::value ||
-                            std::is_same<T, cl_int4  >::value ||
-                            std::is_same<T, cl_uint4 >::value, cl_int>::type
-    enqueueFillImage(
-        const Image& image,
-        T fillColor,
-        const array<size_type, 2>& origin,
-        const array<size_type, 2>& region,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    template< typename IteratorType >
+    cl_int write(
+        const Buffer& buffer,
+        size_type offset,
+        IteratorType startIterator,
+        IteratorType endIterator,
+        EventWaitList events = EventWaitList(),
+        Event* event = nullptr)
     {
-        return enqueueFillImage(
-            image,
-            fillColor,
-            { origin[0], origin[1], 0 },
-            { region[0], region[1], 1 },
-            events,
-            event
-            );
-    }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+        typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+        typedef typename std::iterator_traits<IteratorType>::iterator_category Category;
 
-    cl_int enqueueCopyImageToBuffer(
-        const Image& src,
-        const Buffer& dst,
-        const array<size_type, 3>& src_origin,
-        const array<size_type, 3>& region,
-        size_type dst_offset,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueCopyImageToBuffer(
-                object_, 
-                src(), 
-                dst(), 
-                src_origin.data(),
-                region.data(), 
-                dst_offset,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_COPY_IMAGE_TO_BUFFER_ERR);
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_type chunkLength = slotSize_ / sizeof(DataType);
+        if (slots_.empty() || chunkLength == 0) {
+            return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WRITE_BUFFER_ERR);
+        }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        cl_int error = CL_SUCCESS;
+        // Kept for the marker, slots reused by later chunks drop theirs
+        vector<Event> chunks;
+        while (startIterator != endIterator) {
+            Slot* slot = &slots_[next_];
+            next_ = (next_ + 1) % slots_.size();
+            if (slot->event_() != nullptr) {
+                // Only blocks if the ring is full
+                error = slot->event_.wait();
+                if (error != CL_SUCCESS) {
+                    return error;
+                }
+            }
 
-        return err;
+            size_type length = fill(
+                static_cast<DataType*>(slot->ptr_), chunkLength,
+                startIterator, endIterator, Category());
+            size_type chunk = length * sizeof(DataType);
+            error = queue_.enqueueWriteBuffer(
+                buffer, CL_FALSE, offset, chunk, slot->ptr_, events, &slot->event_);
+            if (error != CL_SUCCESS) {
+                slot->event_ = Event();
+                return error;
+            }
+            if (event != nullptr) {
+                chunks.push_back(slot->event_);
+            }
+            offset += chunk;
+        }
+
+        if (chunks.size() == 1) {
+            *event = std::move(chunks.front());
+        }
+        else if (chunks.size() > 1) {
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+            error = queue_.enqueueMarkerWithWaitList(EventWaitList(&chunks), event);
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 120
+            // Waits for every command enqueued before it
+            error = queue_.enqueueMarker(event);
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+        }
+        return error;
     }
 
-    cl_int enqueueCopyImageToBuffer(
-        const Image& src,
-        const Buffer& dst,
-        const array<size_type, 2>& src_origin,
-        const array<size_type, 2>& region,
-        size_type dst_offset,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    { 
-        return enqueueCopyImageToBuffer(
-            src,
-            dst,
-            { src_origin[0], src_origin[1], 0 },
-            { region[0], region[1], 1 },
-            dst_offset,
-            events,
-            event);
+    //! \brief Writes the elements of data to buffer at offset bytes.
+    template <typename T, class Alloc>
+    cl_int write(
+        const Buffer& buffer,
+        size_type offset,
+        const vector<T, Alloc>& data,
+        EventWaitList events = EventWaitList(),
+        Event* event = nullptr)
+    {
+        return write(buffer, offset, data.data(), data.size() * sizeof(T), events, event);
     }
 
-    cl_int enqueueCopyBufferToImage(
-        const Buffer& src,
-        const Image& dst,
-        size_type src_offset,
-        const array<size_type, 3>& dst_origin,
-        const array<size_type, 3>& region,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    //! \brief Returns the size of the staging buffers in bytes.
+    size_type getSlotSize() const
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueCopyBufferToImage(
-                object_, 
-                src(), 
-                dst(), 
-                src_offset,
-                dst_origin.data(), 
-                region.data(),
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_COPY_BUFFER_TO_IMAGE_ERR);
+        return slotSize_;
+    }
+
+    //! \brief Returns the queue the writes are enqueued on.
+    const CommandQueue& getQueue() const
+    {
+        return queue_;
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+private:
+    // Copies up to length elements into pointer and advances startIterator
+    // past them. Returns the number of elements copied.
+    template< typename DataType, typename IteratorType >
+    static size_type fill(
+        DataType* pointer, size_type length,
+        IteratorType& startIterator, IteratorType endIterator,
+        std::random_access_iterator_tag)
+    {
+        size_type remaining = static_cast<size_type>(endIterator - startIterator);
+        if (remaining < length) {
+            length = remaining;
+        }
+        std::copy(startIterator, startIterator + length, pointer);
+        startIterator += length;
+        return length;
+    }
 
-        return err;
+    template< typename DataType, typename IteratorType >
+    static size_type fill(
+        DataType* pointer, size_type length,
+        IteratorType& startIterator, IteratorType endIterator,
+        std::input_iterator_tag)
+    {
+        size_type count = 0;
+        for (; count < length && startIterator != endIterator; ++count, ++startIterator) {
+            pointer[count] = *startIterator;
+        }
+        return count;
     }
+};
 
-    cl_int enqueueCopyBufferToImage(
-        const Buffer& src,
-        const Image& dst,
-        size_type src_offset,
-        const array<size_type, 2>& dst_origin,
-        const array<size_type, 2>& region,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+
+/*! \class MappedView
+ * \brief Maps a range of a Buffer or a region of an Image as elements of
+ *        type T and unmaps it when the view is destroyed.
+ *
+ * The map is blocking, so the data can be accessed as soon as the view is
+ * constructed. On devices that share memory with the host the map usually
+ * gives direct access to the memory object, without a copy.
+ *
+ * Image rows may be padded, so image views are indexed with
+ * operator()(x, y, z), which applies the row and slice pitch. data(),
+ * operator[] and the iterators assume the elements are contiguous, which
+ * always holds for buffer views.
+ *
+ * The unmap is enqueued without waiting for it. Call unmap() to get its
+ * event, otherwise the destructor enqueues it.
+ */
+template< typename T >
+class MappedView
+{
+private:
+    typedef typename std::conditional<
+        std::is_const<T>::value, const char, char>::type ByteType;
+
+    CommandQueue queue_;
+    Memory memory_;
+    T* ptr_;
+    size_type width_;
+    size_type height_;
+    size_type depth_;
+    size_type rowPitch_;
+    size_type slicePitch_;
+
+    void clear()
     {
-        return enqueueCopyBufferToImage(
-            src,
-            dst, 
-            src_offset,
-            { dst_origin[0], dst_origin[1], 0 },
-            { region[0], region[1], 1 },
-            events,
-            event);
+        ptr_ = nullptr;
+        width_ = height_ = depth_ = 0;
+        rowPitch_ = slicePitch_ = 0;
     }
 
-    void* enqueueMapBuffer(
+public:
+    typedef T element_type;
+    typedef typename std::remove_cv<T>::type value_type;
+    typedef T* pointer;
+    typedef T& reference;
+    typedef T* iterator;
+
+    //! \brief Default constructor - initializes to an empty view.
+    MappedView() :
+        ptr_(nullptr), width_(0), height_(0), depth_(0), rowPitch_(0), slicePitch_(0)
+    {
+    }
+
+    /*! \brief Maps count elements of buffer, starting at element offset.
+     *
+     *  Wraps clEnqueueMapBuffer().
+     */
+    MappedView(
+        const CommandQueue& queue,
         const Buffer& buffer,
-        cl_bool blocking,
         cl_map_flags flags,
         size_type offset,
-        size_type size,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr,
-        cl_int* err = nullptr) const
+        size_type count,
+        EventWaitList events = EventWaitList(),
+        cl_int* err = nullptr) :
+        queue_(queue), memory_(buffer), ptr_(nullptr),
+        width_(count), height_(1), depth_(1),
+        rowPitch_(count * sizeof(T)), slicePitch_(count * sizeof(T))
     {
-        cl_event tmp;
         cl_int error;
-        void * result = ::clEnqueueMapBuffer(
-            object_, buffer(), blocking, flags, offset, size,
-            (events != nullptr) ? (cl_uint) events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr,
-            &error);
-
-        detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+        ptr_ = static_cast<T*>(queue.enqueueMapBuffer(
+            buffer, CL_TRUE, flags, offset * sizeof(T), count * sizeof(T),
+            events, nullptr, &error));
+        if (error != CL_SUCCESS) {
+            clear();
+        }
         if (err != nullptr) {
             *err = error;
         }
-        if (event != nullptr && error == CL_SUCCESS)
-            *event = tmp;
+    }
 
-        return result;
+    /*! \brief Maps the whole of buffer.
+     *
+     *  Wraps clEnqueueMapBuffer().
+     */
+    MappedView(
+        const CommandQueue& queue,
+        const Buffer& buffer,
+        cl_map_flags flags,
+        cl_int* err = nullptr) : MappedView()
+    {
+        cl_int error;
+        size_type size = buffer.getInfo<CL_MEM_SIZE>(&error);
+        if (error == CL_SUCCESS) {
+            *this = MappedView(
+                queue, buffer, flags, 0, size / sizeof(T), EventWaitList(), &error);
+        }
+        if (err != nullptr) {
+            *err = error;
+        }
     }
 
-    void* enqueueMapImage(
+    /*! \brief Maps region pixels of image, starting at origin.
+     *
+     *  Wraps clEnqueueMapImage().
+     */
+    MappedView(
+        const CommandQueue& queue,
         const Image& image,
-        cl_bool blocking,
         cl_map_flags flags,
         const array<size_type, 3>& origin,
         const array<size_type, 3>& region,
-        size_type * row_pitch,
-        size_type * slice_pitch,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr,
-        cl_int* err = nullptr) const
+        EventWaitList events = EventWaitList(),
+        cl_int* err = nullptr) :
+        queue_(queue), memory_(image), ptr_(nullptr),
+        width_(region[0]), height_(region[1]), depth_(region[2]),
+        rowPitch_(0), slicePitch_(0)
     {
-        cl_event tmp;
         cl_int error;
-        void * result = ::clEnqueueMapImage(
-            object_, image(), blocking, flags,
-            origin.data(), 
-            region.data(),
-            row_pitch, slice_pitch,
-            (events != nullptr) ? (cl_uint) events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr,
-            &error);
-
-        detail::errHandler(error, __ENQUEUE_MAP_IMAGE_ERR);
+        ptr_ = static_cast<T*>(queue.enqueueMapImage(
+            image, CL_TRUE, flags, origin, region, &rowPitch_, &slicePitch_,
+            events, nullptr, &error));
+        if (error != CL_SUCCESS) {
+            clear();
+        }
+        else if (slicePitch_ == 0) {
+            // 1D and 2D images report no slice pitch
+            slicePitch_ = rowPitch_ * height_;
+        }
         if (err != nullptr) {
-              *err = error;
+            *err = error;
         }
-        if (event != nullptr && error == CL_SUCCESS)
-            *event = tmp;
-        return result;
     }
 
-    void* enqueueMapImage(
-         const Image& image,
-         cl_bool blocking,
-         cl_map_flags flags,
-         const array<size_type, 2>& origin,
-         const array<size_type, 2>& region,
-         size_type* row_pitch,
-         size_type* slice_pitch,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr,
-         cl_int* err = nullptr) const
+    /*! \brief Maps region pixels of image, starting at origin.
+     *
+     *  Wraps clEnqueueMapImage().
+     */
+    MappedView(
+        const CommandQueue& queue,
+        const Image& image,
+        cl_map_flags flags,
+        const array<size_type, 2>& origin,
+        const array<size_type, 2>& region,
+        EventWaitList events = EventWaitList(),
+        cl_int* err = nullptr) :
+        MappedView(
+            queue, image, flags,
+            array<size_type, 3>{{origin[0], origin[1], 0}},
+            array<size_type, 3>{{region[0], region[1], 1}},
+            events, err)
+    {
+    }
+
+    MappedView(const MappedView&) = delete;
+    MappedView& operator = (const MappedView&) = delete;
+
+    MappedView(MappedView&& other) noexcept :
+        queue_(std::move(other.queue_)),
+        memory_(std::move(other.memory_)),
+        ptr_(other.ptr_),
+        width_(other.width_),
+        height_(other.height_),
+        depth_(other.depth_),
+        rowPitch_(other.rowPitch_),
+        slicePitch_(other.slicePitch_)
+    {
+        other.clear();
+    }
+
+    //! \brief Unmaps the current view before taking over other.
+    MappedView& operator = (MappedView&& other)
+    {
+        if (this != &other) {
+            unmap();
+            queue_ = std::move(other.queue_);
+            memory_ = std::move(other.memory_);
+            ptr_ = other.ptr_;
+            width_ = other.width_;
+            height_ = other.height_;
+            depth_ = other.depth_;
+            rowPitch_ = other.rowPitch_;
+            slicePitch_ = other.slicePitch_;
+            other.clear();
+        }
+        return *this;
+    }
+
+    //! \brief Enqueues the unmap if unmap() has not been called.
+    ~MappedView()
     {
-        return enqueueMapImage(image, blocking, flags,
-                               { origin[0], origin[1], 0 },
-                               { region[0], region[1], 1 }, row_pitch,
-                               slice_pitch, events, event, err);
+        if (ptr_ != nullptr) {
+            ::clEnqueueUnmapMemObject(
+                queue_(), memory_(), const_cast<void*>(static_cast<const void*>(ptr_)),
+                0, nullptr, nullptr);
+        }
     }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    /**
-     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
-     * This variant takes a raw SVM pointer.
+    /*! \brief Enqueues the unmap and leaves the view empty.
+     *
+     *  \param event Set to the unmap, which completes once the data is
+     *               visible to commands on the device.
      */
-    template<typename T>
-    cl_int enqueueMapSVM(
-        T* ptr,
-        cl_bool blocking,
-        cl_map_flags flags,
-        size_type size,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    cl_int unmap(EventWaitList events = EventWaitList(), Event* event = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(::clEnqueueSVMMap(
-            object_, blocking, flags, static_cast<void*>(ptr), size,
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MAP_BUFFER_ERR);
+        if (ptr_ == nullptr) {
+            return CL_SUCCESS;
+        }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        void* ptr = const_cast<void*>(static_cast<const void*>(ptr_));
+        clear();
+        return queue_.enqueueUnmapMemObject(memory_, ptr, events, event);
+    }
 
-        return err;
+    //! \brief Returns the mapped pointer, or nullptr for an empty view.
+    T* data() const
+    {
+        return ptr_;
     }
 
+    //! \brief Returns the number of elements in the view.
+    size_type size() const
+    {
+        return width_ * height_ * depth_;
+    }
 
-    /**
-     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
-     * This variant takes a cl::pointer instance.
-     */
-    template<typename T, class D>
-    cl_int enqueueMapSVM(
-        cl::pointer<T, D> &ptr,
-        cl_bool blocking,
-        cl_map_flags flags,
-        size_type size,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    bool empty() const
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(::clEnqueueSVMMap(
-            object_, blocking, flags, static_cast<void*>(ptr.get()), size,
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MAP_BUFFER_ERR);
+        return ptr_ == nullptr || size() == 0;
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    T& operator [] (size_type index) const
+    {
+        return ptr_[index];
+    }
 
-        return err;
+    iterator begin() const
+    {
+        return ptr_;
     }
 
-    /**
-     * Enqueues a command that will allow the host to update a region of a coarse-grained SVM buffer.
-     * This variant takes a cl::vector instance.
-     */
-    template<typename T, class Alloc>
-    cl_int enqueueMapSVM(
-        cl::vector<T, Alloc> &container,
-        cl_bool blocking,
-        cl_map_flags flags,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    iterator end() const
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(::clEnqueueSVMMap(
-            object_, blocking, flags, static_cast<void*>(container.data()), container.size()*sizeof(T),
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MAP_BUFFER_ERR);
+        return ptr_ + size();
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    //! \brief Returns the first element of row y in slice z.
+    T* row(size_type y, size_type z = 0) const
+    {
+        return reinterpret_cast<T*>(
+            reinterpret_cast<ByteType*>(ptr_) + z * slicePitch_ + y * rowPitch_);
+    }
+
+    T& operator () (size_type x, size_type y = 0, size_type z = 0) const
+    {
+        return row(y, z)[x];
+    }
+
+    size_type getWidth() const
+    {
+        return width_;
+    }
+
+    size_type getHeight() const
+    {
+        return height_;
+    }
+
+    size_type getDepth() const
+    {
+        return depth_;
+    }
+
+    //! \brief Returns the distance between rows in bytes.
+    size_type getRowPitch() const
+    {
+        return rowPitch_;
+    }
+
+    //! \brief Returns the distance between slices in bytes.
+    size_type getSlicePitch() const
+    {
+        return slicePitch_;
+    }
+};
+
+#if defined(CL_HPP_ENABLE_FILE_BUFFER) && CL_HPP_TARGET_OPENCL_VERSION >= 110
+namespace detail {
+
+// Copy-on-write mapping of a whole file
+class MappedFile
+{
+private:
+    void* data_;
+    size_type size_;
+
+    MappedFile(void* data, size_type size) : data_(data), size_(size) { }
+
+public:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+#if defined(_WIN32)
+        ::UnmapViewOfFile(data_);
+#else // #if defined(_WIN32)
+        ::munmap(data_, size_);
+#endif // #if defined(_WIN32)
+    }
+
+    //! \brief Maps the file at path. Returns nullptr if it cannot be mapped or is empty.
+    static MappedFile* open(const string& path)
+    {
+        void* data = nullptr;
+        unsigned long long size = 0;
+#if defined(_WIN32)
+        HANDLE handle = ::CreateFileA(
+            path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return nullptr;
+        }
+        LARGE_INTEGER fileSize;
+        if (::GetFileSizeEx(handle, &fileSize) && fileSize.QuadPart > 0) {
+            size = static_cast<unsigned long long>(fileSize.QuadPart);
+            HANDLE mapping = ::CreateFileMappingA(handle, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            if (mapping != nullptr) {
+                // The view keeps the mapping alive
+                data = ::MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+                ::CloseHandle(mapping);
+            }
+        }
+        ::CloseHandle(handle);
+#else // #if defined(_WIN32)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return nullptr;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0 &&
+            static_cast<unsigned long long>(info.st_size) <= (std::numeric_limits<size_type>::max)()) {
+            size = static_cast<unsigned long long>(info.st_size);
+            data = ::mmap(
+                nullptr, static_cast<size_type>(size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                data = nullptr;
+            }
+        }
+        ::close(fd);
+#endif // #if defined(_WIN32)
+        if (data == nullptr) {
+            return nullptr;
+        }
+        return new MappedFile(data, static_cast<size_type>(size));
+    }
+
+    static void CL_CALLBACK release(cl_mem, void* user_data)
+    {
+        delete static_cast<MappedFile*>(user_data);
+    }
+
+    void* data() const
+    {
+        return data_;
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+};
+
+} // namespace detail
+
+inline Buffer Buffer::createFromFile(
+    const CommandQueue &queue,
+    const string &path,
+    cl_mem_flags flags,
+    cl_int* err)
+{
+    // Large enough for DMA speed, small enough to keep the two slots cheap
+    const size_type stagingSlotSize = 4 << 20;
 
-        return err;
+    // Declared before the buffer, so that a failed buffer is released first
+    std::unique_ptr<detail::MappedFile> file(detail::MappedFile::open(path));
+    Buffer buffer;
+    cl_int error = CL_SUCCESS;
+    if (!file) {
+        error = detail::errHandler(CL_INVALID_VALUE, __CREATE_BUFFER_ERR);
     }
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
-    cl_int enqueueUnmapMemObject(
-        const Memory& memory,
-        void* mapped_ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueUnmapMemObject(
-                object_, memory(), mapped_ptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    Context context;
+    cl_device_id device = nullptr;
+    if (error == CL_SUCCESS) {
+        context = queue.getInfo<CL_QUEUE_CONTEXT>(&error);
+    }
+    if (error == CL_SUCCESS) {
+        error = detail::errHandler(
+            ::clGetCommandQueueInfo(queue(), CL_QUEUE_DEVICE, sizeof(device), &device, nullptr),
+            __GET_COMMAND_QUEUE_INFO_ERR);
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    // Queried directly, the parameter trait is not declared for all target versions
+    cl_bool unified = CL_FALSE;
+    if (error == CL_SUCCESS &&
+        ::clGetDeviceInfo(
+            device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr) != CL_SUCCESS) {
+        unified = CL_FALSE;
+    }
 
-        return err;
+    if (error == CL_SUCCESS && unified) {
+        buffer = Buffer(context, flags | CL_MEM_USE_HOST_PTR, file->size(), file->data(), &error);
+        if (error == CL_SUCCESS) {
+            error = buffer.setDestructorCallback(detail::MappedFile::release, file.get());
+        }
+        if (error == CL_SUCCESS) {
+            // Unmapped by the destructor callback
+            file.release();
+        }
+    }
+    else if (error == CL_SUCCESS) {
+        buffer = Buffer(context, flags, file->size(), nullptr, &error);
+        if (error == CL_SUCCESS) {
+            StagingRing ring(
+                queue, (std::min)(file->size(), stagingSlotSize), 2, &error);
+            Event event;
+            if (error == CL_SUCCESS) {
+                error = ring.write(buffer, 0, file->data(), file->size(), EventWaitList(), &event);
+            }
+            if (error == CL_SUCCESS) {
+                error = event.wait();
+            }
+        }
     }
 
+    if (error != CL_SUCCESS) {
+        buffer = Buffer();
+    }
+    if (err != nullptr) {
+        *err = error;
+    }
+    return buffer;
+}
+#endif // #if defined(CL_HPP_ENABLE_FILE_BUFFER) && CL_HPP_TARGET_OPENCL_VERSION >= 110
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    /**
-     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
-     * This variant takes a raw SVM pointer.
-     */
-    template<typename T>
-    cl_int enqueueUnmapSVM(
-        T* ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueSVMUnmap(
-            object_, static_cast<void*>(ptr),
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+enum class DeviceQueueProperties : cl_command_queue_properties
+{
+    None = 0,
+    Profiling = CL_QUEUE_PROFILING_ENABLE,
+};
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+inline DeviceQueueProperties operator|(DeviceQueueProperties lhs, DeviceQueueProperties rhs)
+{
+    return static_cast<DeviceQueueProperties>(static_cast<cl_command_queue_properties>(lhs) | static_cast<cl_command_queue_properties>(rhs));
+}
 
-        return err;
-    }
+/*! \class DeviceCommandQueue
+ * \brief DeviceCommandQueue interface for device cl_command_queues.
+ */
+class DeviceCommandQueue : public detail::Wrapper<cl_command_queue>
+{
+public:
 
-    /**
-     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
-     * This variant takes a cl::pointer instance.
+    /*!
+     * Trivial empty constructor to create a null queue.
      */
-    template<typename T, class D>
-    cl_int enqueueUnmapSVM(
-        cl::pointer<T, D> &ptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    DeviceCommandQueue() { }
+
+    /*!
+     * Default construct device command queue on default context and device
+     */
+    DeviceCommandQueue(DeviceQueueProperties properties, cl_int* err = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueSVMUnmap(
-            object_, static_cast<void*>(ptr.get()),
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        cl_int error;
+        cl::Context context = cl::Context::getDefault();
+        cl::Device device = cl::Device::getDefault();
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        cl_command_queue_properties mergedProperties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
 
-        return err;
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, mergedProperties, 0 };
+        object_ = ::clCreateCommandQueueWithProperties(
+            context(), device(), queue_properties, &error);
+
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
     }
 
-    /**
-     * Enqueues a command that will release a coarse-grained SVM buffer back to the OpenCL runtime.
-     * This variant takes a cl::vector instance.
+    /*!
+     * Create a device command queue for a specified device in the passed context.
      */
-    template<typename T, class Alloc>
-    cl_int enqueueUnmapSVM(
-        cl::vector<T, Alloc> &container,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    DeviceCommandQueue(
+        const Context& context,
+        const Device& device,
+        DeviceQueueProperties properties = DeviceQueueProperties::None,
+        cl_int* err = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueSVMUnmap(
-            object_, static_cast<void*>(container.data()),
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        cl_int error;
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        cl_command_queue_properties mergedProperties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, mergedProperties, 0 };
+        object_ = ::clCreateCommandQueueWithProperties(
+            context(), device(), queue_properties, &error);
 
-        return err;
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
     }
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-    /**
-     * Enqueues a marker command which waits for either a list of events to complete, 
-     * or all previously enqueued commands to complete.
-     *
-     * Enqueues a marker command which waits for either a list of events to complete, 
-     * or if the list is empty it waits for all commands previously enqueued in command_queue 
-     * to complete before it completes. This command returns an event which can be waited on, 
-     * i.e. this event can be waited on to insure that all events either in the event_wait_list 
-     * or all previously enqueued commands, queued before this command to command_queue, 
-     * have completed.
+    /*!
+     * Create a device command queue for a specified device in the passed context.
      */
-    cl_int enqueueMarkerWithWaitList(
-        const vector<Event> *events = nullptr,
-        Event *event = nullptr) const
+    DeviceCommandQueue(
+        const Context& context,
+        const Device& device,
+        cl_uint queueSize,
+        DeviceQueueProperties properties = DeviceQueueProperties::None,
+        cl_int* err = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueMarkerWithWaitList(
-                object_,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MARKER_WAIT_LIST_ERR);
+        cl_int error;
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        cl_command_queue_properties mergedProperties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, mergedProperties,
+            CL_QUEUE_SIZE, queueSize, 
+            0 };
+        object_ = ::clCreateCommandQueueWithProperties(
+            context(), device(), queue_properties, &error);
 
-        return err;
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
     }
 
-    /**
-     * A synchronization point that enqueues a barrier operation.
-     *
-     * Enqueues a barrier command which waits for either a list of events to complete, 
-     * or if the list is empty it waits for all commands previously enqueued in command_queue 
-     * to complete before it completes. This command blocks command execution, that is, any 
-     * following commands enqueued after it do not execute until it completes. This command 
-     * returns an event which can be waited on, i.e. this event can be waited on to insure that 
-     * all events either in the event_wait_list or all previously enqueued commands, queued 
-     * before this command to command_queue, have completed.
-     */
-    cl_int enqueueBarrierWithWaitList(
-        const vector<Event> *events = nullptr,
-        Event *event = nullptr) const
+    /*! \brief Constructor from cl_command_queue - takes ownership.
+    *
+    * \param retainObject will cause the constructor to retain its cl object.
+    *                     Defaults to false to maintain compatibility with
+    *                     earlier versions.
+    */
+    explicit DeviceCommandQueue(const cl_command_queue& commandQueue, bool retainObject = false) :
+        detail::Wrapper<cl_type>(commandQueue, retainObject) { }
+
+    DeviceCommandQueue& operator = (const cl_command_queue& rhs)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueBarrierWithWaitList(
-                object_,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_BARRIER_WAIT_LIST_ERR);
+        detail::Wrapper<cl_type>::operator=(rhs);
+        return *this;
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    template <typename T>
+    cl_int getInfo(cl_command_queue_info name, T* param) const
+    {
+        return detail::errHandler(
+            detail::getInfo(
+            &::clGetCommandQueueInfo, object_, name, param),
+            __GET_COMMAND_QUEUE_INFO_ERR);
+    }
 
-        return err;
+    template <cl_command_queue_info name> typename
+        detail::param_traits<detail::cl_command_queue_info, name>::param_type
+        getInfo(cl_int* err = nullptr) const
+    {
+        typename detail::param_traits<
+            detail::cl_command_queue_info, name>::param_type param;
+        cl_int result = getInfo(name, &param);
+        if (err != nullptr) {
+            *err = result;
+        }
+        return param;
     }
-    
-    /**
-     * Enqueues a command to indicate with which device a set of memory objects
-     * should be associated.
+
+    /*!
+     * Create a new default device command queue for the default device,
+     * in the default context and of the default size.
+     * If there is already a default queue for the specified device this
+     * function will return the pre-existing queue.
      */
-    cl_int enqueueMigrateMemObjects(
-        const vector<Memory> &memObjects,
-        cl_mem_migration_flags flags,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr
-        ) const
+    static DeviceCommandQueue makeDefault(
+        cl_int *err = nullptr)
     {
-        cl_event tmp;
-        
-        vector<cl_mem> localMemObjects(memObjects.size());
+        cl_int error;
+        cl::Context context = cl::Context::getDefault();
+        cl::Device device = cl::Device::getDefault();
 
-        for( int i = 0; i < (int)memObjects.size(); ++i ) {
-            localMemObjects[i] = memObjects[i]();
-        }
-        
-        cl_int err = detail::errHandler(
-            ::clEnqueueMigrateMemObjects(
-                object_, 
-                (cl_uint)memObjects.size(), 
-                localMemObjects.data(),
-                flags,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+        cl_command_queue_properties properties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, properties,
+            0 };
+        DeviceCommandQueue deviceQueue(
+            ::clCreateCommandQueueWithProperties(
+            context(), device(), queue_properties, &error));
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
 
-        return err;
+        return deviceQueue;
     }
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
-
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-    /**
-     * Enqueues a command that will allow the host associate ranges within a set of
-     * SVM allocations with a device.
-     * @param sizes - The length from each pointer to migrate.
+    /*!
+     * Create a new default device command queue for the specified device
+     * and of the default size.
+     * If there is already a default queue for the specified device this
+     * function will return the pre-existing queue.
      */
-    template<typename T>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<T*> &svmRawPointers,
-        const cl::vector<size_type> &sizes,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    static DeviceCommandQueue makeDefault(
+        const Context &context, const Device &device, cl_int *err = nullptr)
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(::clEnqueueSVMMigrateMem(
-            object_,
-            svmRawPointers.size(), static_cast<void**>(svmRawPointers.data()),
-            sizes.data(), // array of sizes not passed
-            flags,
-            (events != nullptr) ? (cl_uint)events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-            (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MIGRATE_SVM_ERR);
+        cl_int error;
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+        cl_command_queue_properties properties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, properties,
+            0 };
+        DeviceCommandQueue deviceQueue(
+            ::clCreateCommandQueueWithProperties(
+            context(), device(), queue_properties, &error));
 
-        return err;
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
+
+        return deviceQueue;
     }
 
-    /**
-     * Enqueues a command that will allow the host associate a set of SVM allocations with
-     * a device.
+    /*!
+     * Create a new default device command queue for the specified device 
+     * and of the requested size in bytes.
+     * If there is already a default queue for the specified device this
+     * function will return the pre-existing queue.
      */
-    template<typename T>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<T*> &svmRawPointers,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    static DeviceCommandQueue makeDefault(
+        const Context &context, const Device &device, cl_uint queueSize, cl_int *err = nullptr)
     {
-        return enqueueMigrateSVM(svmRawPointers, cl::vector<size_type>(svmRawPointers.size()), flags, events, event);
-    }
+        cl_int error;
 
+        cl_command_queue_properties properties =
+            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
+        cl_queue_properties queue_properties[] = {
+            CL_QUEUE_PROPERTIES, properties,
+            CL_QUEUE_SIZE, queueSize,
+            0 };
+        DeviceCommandQueue deviceQueue(
+            ::clCreateCommandQueueWithProperties(
+                context(), device(), queue_properties, &error));
 
-    /**
-     * Enqueues a command that will allow the host associate ranges within a set of
-     * SVM allocations with a device.
-     * @param sizes - The length from each pointer to migrate.
-     */
-    template<typename T, class D>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<cl::pointer<T, D>> &svmPointers,
-        const cl::vector<size_type> &sizes,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl::vector<void*> svmRawPointers;
-        svmRawPointers.reserve(svmPointers.size());
-        for (auto p : svmPointers) {
-            svmRawPointers.push_back(static_cast<void*>(p.get()));
+        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
+        if (err != nullptr) {
+            *err = error;
         }
 
-        return enqueueMigrateSVM(svmRawPointers, sizes, flags, events, event);
+        return deviceQueue;
     }
 
 
-    /**
-     * Enqueues a command that will allow the host associate a set of SVM allocations with
-     * a device.
-     */
-    template<typename T, class D>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<cl::pointer<T, D>> &svmPointers,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        return enqueueMigrateSVM(svmPointers, cl::vector<size_type>(svmPointers.size()), flags, events, event);
-    }
 
-    /**
-     * Enqueues a command that will allow the host associate ranges within a set of
-     * SVM allocations with a device.
-     * @param sizes - The length from the beginning of each container to migrate.
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    /*!
+     * Modify the default device command queue to be used for subsequent kernels.
+     * This can update the default command queue for a device repeatedly to account
+     * for kernels that rely on the default.
+     * @return updated default device command queue.
      */
-    template<typename T, class Alloc>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
-        const cl::vector<size_type> &sizes,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    static DeviceCommandQueue updateDefault(const Context &context, const Device &device, const DeviceCommandQueue &default_queue, cl_int *err = nullptr)
     {
-        cl::vector<void*> svmRawPointers;
-        svmRawPointers.reserve(svmContainers.size());
-        for (auto p : svmContainers) {
-            svmRawPointers.push_back(static_cast<void*>(p.data()));
-        }
+        cl_int error;
+        error = clSetDefaultDeviceCommandQueue(context.get(), device.get(), default_queue.get());
 
-        return enqueueMigrateSVM(svmRawPointers, sizes, flags, events, event);
+        detail::errHandler(error, __SET_DEFAULT_DEVICE_COMMAND_QUEUE_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
+        return default_queue;
     }
 
-    /**
-     * Enqueues a command that will allow the host associate a set of SVM allocations with
-     * a device.
+    /*!
+     * Return the current default command queue for the specified command queue
      */
-    template<typename T, class Alloc>
-    cl_int enqueueMigrateSVM(
-        const cl::vector<cl::vector<T, Alloc>> &svmContainers,
-        cl_mem_migration_flags flags = 0,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+    static DeviceCommandQueue getDefault(const CommandQueue &queue, cl_int * err = nullptr)
     {
-        return enqueueMigrateSVM(svmContainers, cl::vector<size_type>(svmContainers.size()), flags, events, event);
+        return queue.getInfo<CL_QUEUE_DEVICE_DEFAULT>(err);
     }
 
 #endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
-    
-    cl_int enqueueNDRangeKernel(
-        const Kernel& kernel,
-        const NDRange& offset,
-        const NDRange& global,
-        const NDRange& local = NullRange,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
+}; // DeviceCommandQueue
+
+namespace detail
+{
+    // Specialization for device command queue
+    template <>
+    struct KernelArgumentHandler<cl::DeviceCommandQueue, void>
     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueNDRangeKernel(
-                object_, kernel(), (cl_uint) global.dimensions(),
-                offset.dimensions() != 0 ? (const size_type*) offset : nullptr,
-                (const size_type*) global,
-                local.dimensions() != 0 ? (const size_type*) local : nullptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_NDRANGE_KERNEL_ERR);
+        static size_type size(const cl::DeviceCommandQueue&) { return sizeof(cl_command_queue); }
+        static const cl_command_queue* ptr(const cl::DeviceCommandQueue& value) { return &(value()); }
+    };
+} // namespace detail
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
-        return err;
-    }
 
-#if defined(CL_USE_DEPRECATED_OPENCL_1_2_APIS)
-    CL_API_PREFIX__VERSION_1_2_DEPRECATED cl_int enqueueTask(
-        const Kernel& kernel,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const CL_API_SUFFIX__VERSION_1_2_DEPRECATED
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueTask(
-                object_, kernel(),
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_TASK_ERR);
+template< typename IteratorType >
+Buffer::Buffer(
+    const Context &context,
+    IteratorType startIterator,
+    IteratorType endIterator,
+    bool readOnly,
+    bool useHostPtr,
+    cl_int* err)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    cl_int error;
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    cl_mem_flags flags = 0;
+    if( readOnly ) {
+        flags |= CL_MEM_READ_ONLY;
+    }
+    else {
+        flags |= CL_MEM_READ_WRITE;
+    }
+    if( useHostPtr ) {
+        flags |= CL_MEM_USE_HOST_PTR;
+    }
+    
+    size_type size = sizeof(DataType)*(endIterator - startIterator);
 
-        return err;
+    if( useHostPtr ) {
+        object_ = ::clCreateBuffer(context(), flags, size, const_cast<DataType*>(&*startIterator), &error);
+    } else {
+        object_ = ::clCreateBuffer(context(), flags, size, 0, &error);
     }
-#endif // #if defined(CL_USE_DEPRECATED_OPENCL_1_2_APIS)
 
-    cl_int enqueueNativeKernel(
-        void (CL_CALLBACK *userFptr)(void *),
-        std::pair<void*, size_type> args,
-        const vector<Memory>* mem_objects = nullptr,
-        const vector<const void*>* mem_locs = nullptr,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr) const
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueNativeKernel(
-                object_, userFptr, args.first, args.second,
-                (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
-                (mem_objects->size() > 0 ) ? reinterpret_cast<const cl_mem *>(mem_objects->data()) : nullptr,
-                (mem_locs != nullptr && mem_locs->size() > 0) ? (const void **) &mem_locs->front() : nullptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_NATIVE_KERNEL);
+    detail::errHandler(error, __CREATE_BUFFER_ERR);
+    if (err != nullptr) {
+        *err = error;
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    if( !useHostPtr ) {
+        CommandQueue queue(context, 0, &error);
+        detail::errHandler(error, __CREATE_BUFFER_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
 
-        return err;
+        error = cl::copy(queue, startIterator, endIterator, *this);
+        detail::errHandler(error, __CREATE_BUFFER_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
     }
+}
 
-/**
- * Deprecated APIs for 1.2
- */
-#if defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
-    CL_API_PREFIX__VERSION_1_1_DEPRECATED 
-    cl_int enqueueMarker(Event* event = nullptr) const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
-    {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            ::clEnqueueMarker(
-                object_, 
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_MARKER_ERR);
-
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+template< typename IteratorType >
+Buffer::Buffer(
+    const CommandQueue &queue,
+    IteratorType startIterator,
+    IteratorType endIterator,
+    bool readOnly,
+    bool useHostPtr,
+    cl_int* err)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    cl_int error;
 
-        return err;
+    cl_mem_flags flags = 0;
+    if (readOnly) {
+        flags |= CL_MEM_READ_ONLY;
     }
-
-    CL_API_PREFIX__VERSION_1_1_DEPRECATED
-    cl_int enqueueWaitForEvents(const vector<Event>& events) const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
-    {
-        return detail::errHandler(
-            ::clEnqueueWaitForEvents(
-                object_,
-                (cl_uint) events.size(),
-                events.size() > 0 ? (const cl_event*) &events.front() : nullptr),
-            __ENQUEUE_WAIT_FOR_EVENTS_ERR);
+    else {
+        flags |= CL_MEM_READ_WRITE;
+    }
+    if (useHostPtr) {
+        flags |= CL_MEM_USE_HOST_PTR;
     }
-#endif // defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
 
-    cl_int enqueueAcquireGLObjects(
-         const vector<Memory>* mem_objects = nullptr,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr) const
-     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-             ::clEnqueueAcquireGLObjects(
-                 object_,
-                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
-                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
-                 (events != nullptr) ? (cl_uint) events->size() : 0,
-                 (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                 (event != nullptr) ? &tmp : nullptr),
-             __ENQUEUE_ACQUIRE_GL_ERR);
+    size_type size = sizeof(DataType)*(endIterator - startIterator);
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
 
-        return err;
-     }
+    if (useHostPtr) {
+        object_ = ::clCreateBuffer(context(), flags, size, const_cast<DataType*>(&*startIterator), &error);
+    }
+    else {
+        object_ = ::clCreateBuffer(context(), flags, size, 0, &error);
+    }
 
-    cl_int enqueueReleaseGLObjects(
-         const vector<Memory>* mem_objects = nullptr,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr) const
-     {
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-             ::clEnqueueReleaseGLObjects(
-                 object_,
-                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
-                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
-                 (events != nullptr) ? (cl_uint) events->size() : 0,
-                 (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                 (event != nullptr) ? &tmp : nullptr),
-             __ENQUEUE_RELEASE_GL_ERR);
+    detail::errHandler(error, __CREATE_BUFFER_ERR);
+    if (err != nullptr) {
+        *err = error;
+    }
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+    if (!useHostPtr) {
+        error = cl::copy(queue, startIterator, endIterator, *this);
+        detail::errHandler(error, __CREATE_BUFFER_ERR);
+        if (err != nullptr) {
+            *err = error;
+        }
+    }
+}
 
-        return err;
-     }
+template< typename IteratorType >
+Buffer::Buffer(
+    StagingRing &ring,
+    IteratorType startIterator,
+    IteratorType endIterator,
+    bool readOnly,
+    cl_int* err)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    cl_int error;
 
-#if defined (CL_HPP_USE_DX_INTEROP)
-typedef CL_API_ENTRY cl_int (CL_API_CALL *PFN_clEnqueueAcquireD3D10ObjectsKHR)(
-    cl_command_queue command_queue, cl_uint num_objects,
-    const cl_mem* mem_objects, cl_uint num_events_in_wait_list,
-    const cl_event* event_wait_list, cl_event* event);
-typedef CL_API_ENTRY cl_int (CL_API_CALL *PFN_clEnqueueReleaseD3D10ObjectsKHR)(
-    cl_command_queue command_queue, cl_uint num_objects,
-    const cl_mem* mem_objects,  cl_uint num_events_in_wait_list,
-    const cl_event* event_wait_list, cl_event* event);
+    cl_mem_flags flags = readOnly ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE;
+    size_type size = sizeof(DataType)*(endIterator - startIterator);
 
-    cl_int enqueueAcquireD3D10Objects(
-         const vector<Memory>* mem_objects = nullptr,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr) const
-    {
-        static PFN_clEnqueueAcquireD3D10ObjectsKHR pfn_clEnqueueAcquireD3D10ObjectsKHR = nullptr;
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-        cl_context context = getInfo<CL_QUEUE_CONTEXT>();
-        cl::Device device(getInfo<CL_QUEUE_DEVICE>());
-        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>();
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueAcquireD3D10ObjectsKHR);
-#endif
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 120
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueAcquireD3D10ObjectsKHR);
-#endif
-        
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-             pfn_clEnqueueAcquireD3D10ObjectsKHR(
-                 object_,
-                 (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
-                 (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
-                 (events != nullptr) ? (cl_uint) events->size() : 0,
-                 (events != nullptr) ? (cl_event*) &events->front() : nullptr,
-                 (event != nullptr) ? &tmp : nullptr),
-             __ENQUEUE_ACQUIRE_GL_ERR);
+    Context context = ring.getQueue().getInfo<CL_QUEUE_CONTEXT>(&error);
+    if (error == CL_SUCCESS) {
+        object_ = ::clCreateBuffer(context(), flags, size, 0, &error);
+        detail::errHandler(error, __CREATE_BUFFER_ERR);
+    }
+    if (error == CL_SUCCESS) {
+        error = cl::copy(ring, startIterator, endIterator, *this);
+        detail::errHandler(error, __ENQUEUE_WRITE_BUFFER_ERR);
+    }
+    if (err != nullptr) {
+        *err = error;
+    }
+}
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+inline cl_int enqueueReadBuffer(
+    const Buffer& buffer,
+    cl_bool blocking,
+    size_type offset,
+    size_type size,
+    void* ptr,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
-        return err;
-     }
+    if (error != CL_SUCCESS) {
+        return error;
+    }
 
-    cl_int enqueueReleaseD3D10Objects(
-         const vector<Memory>* mem_objects = nullptr,
-         const vector<Event>* events = nullptr,
-         Event* event = nullptr) const
-    {
-        static PFN_clEnqueueReleaseD3D10ObjectsKHR pfn_clEnqueueReleaseD3D10ObjectsKHR = nullptr;
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-        cl_context context = getInfo<CL_QUEUE_CONTEXT>();
-        cl::Device device(getInfo<CL_QUEUE_DEVICE>());
-        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>();
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueReleaseD3D10ObjectsKHR);
-#endif
-#if CL_HPP_MINIMUM_OPENCL_VERSION < 120
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueReleaseD3D10ObjectsKHR);
-#endif
+    return queue.enqueueReadBuffer(buffer, blocking, offset, size, ptr, events, event);
+}
 
-        cl_event tmp;
-        cl_int err = detail::errHandler(
-            pfn_clEnqueueReleaseD3D10ObjectsKHR(
-                object_,
-                (mem_objects != nullptr) ? (cl_uint) mem_objects->size() : 0,
-                (mem_objects != nullptr && mem_objects->size() > 0) ? (const cl_mem *) &mem_objects->front(): nullptr,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-                (event != nullptr) ? &tmp : nullptr),
-            __ENQUEUE_RELEASE_GL_ERR);
+inline cl_int enqueueReadBuffer(
+    const Buffer& buffer,
+    cl_bool blocking,
+    size_type offset,
+    size_type size,
+    void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueReadBuffer(buffer, blocking, offset, size, ptr, EventWaitList(events), event);
+}
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+inline cl_int enqueueWriteBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        const void* ptr,
+        EventWaitList events,
+        Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
-        return err;
+    if (error != CL_SUCCESS) {
+        return error;
     }
-#endif
 
-/**
- * Deprecated APIs for 1.2
- */
-#if defined(CL_USE_DEPRECATED_OPENCL_1_1_APIS)
-    CL_API_PREFIX__VERSION_1_1_DEPRECATED
-    cl_int enqueueBarrier() const CL_API_SUFFIX__VERSION_1_1_DEPRECATED
-    {
-        return detail::errHandler(
-            ::clEnqueueBarrier(object_),
-            __ENQUEUE_BARRIER_ERR);
-    }
-#endif // CL_USE_DEPRECATED_OPENCL_1_1_APIS
+    return queue.enqueueWriteBuffer(buffer, blocking, offset, size, ptr, events, event);
+}
 
-    cl_int flush() const
-    {
-        return detail::errHandler(::clFlush(object_), __FLUSH_ERR);
+inline cl_int enqueueWriteBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        size_type offset,
+        size_type size,
+        const void* ptr,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr)
+{
+    return enqueueWriteBuffer(buffer, blocking, offset, size, ptr, EventWaitList(events), event);
+}
+
+inline void* enqueueMapBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type offset,
+        size_type size,
+        EventWaitList events,
+        Event* event = nullptr,
+        cl_int* err = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+    if (err != nullptr) {
+        *err = error;
     }
 
-    cl_int finish() const
-    {
-        return detail::errHandler(::clFinish(object_), __FINISH_ERR);
+    void * result = ::clEnqueueMapBuffer(
+            queue(), buffer(), blocking, flags, offset, size,
+            (cl_uint) events.size(),
+            events.get(),
+            (cl_event*) event,
+            &error);
+
+    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+    if (err != nullptr) {
+        *err = error;
     }
+    return result;
+}
 
-#ifdef cl_khr_external_memory
-    cl_int enqueueAcquireExternalMemObjects(
-        const vector<Memory>& mem_objects,
-        const vector<Event>* events_wait = nullptr,
-        Event *event = nullptr)
-    {
-        cl_int err = CL_INVALID_OPERATION;
-        cl_event tmp;
+inline void* enqueueMapBuffer(
+        const Buffer& buffer,
+        cl_bool blocking,
+        cl_map_flags flags,
+        size_type offset,
+        size_type size,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr,
+        cl_int* err = nullptr)
+{
+    return enqueueMapBuffer(
+        buffer, blocking, flags, offset, size, EventWaitList(events), event, err);
+}
 
-        std::call_once(ext_memory_initialized_, initMemoryExtension, this->getInfo<CL_QUEUE_DEVICE>());
 
-        if (pfn_clEnqueueAcquireExternalMemObjectsKHR)
-        {
-            err = pfn_clEnqueueAcquireExternalMemObjectsKHR(
-                object_,
-                static_cast<cl_uint>(mem_objects.size()),
-                (mem_objects.size() > 0) ? reinterpret_cast<const cl_mem *>(mem_objects.data()) : nullptr,
-                (events_wait != nullptr) ? static_cast<cl_uint>(events_wait->size()) : 0,
-                (events_wait != nullptr && events_wait->size() > 0) ? reinterpret_cast<const cl_event*>(events_wait->data()) : nullptr,
-                &tmp);
-        }
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+/**
+ * Enqueues to the default queue a command that will allow the host to
+ * update a region of a coarse-grained SVM buffer.
+ * This variant takes a raw SVM pointer.
+ */
+template<typename T>
+inline cl_int enqueueMapSVM(
+    T* ptr,
+    cl_bool blocking,
+    cl_map_flags flags,
+    size_type size,
+    EventWaitList events,
+    Event* event)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+    }
 
-        detail::errHandler(err, __ENQUEUE_ACQUIRE_EXTERNAL_MEMORY_ERR);
+    return queue.enqueueMapSVM(
+        ptr, blocking, flags, size, events, event);
+}
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+template<typename T>
+inline cl_int enqueueMapSVM(
+    T* ptr,
+    cl_bool blocking,
+    cl_map_flags flags,
+    size_type size,
+    const vector<Event>* events,
+    Event* event)
+{
+    return enqueueMapSVM(ptr, blocking, flags, size, EventWaitList(events), event);
+}
 
-        return err;
+/**
+ * Enqueues to the default queue a command that will allow the host to 
+ * update a region of a coarse-grained SVM buffer.
+ * This variant takes a cl::pointer instance.
+ */
+template<typename T, class D>
+inline cl_int enqueueMapSVM(
+    cl::pointer<T, D> &ptr,
+    cl_bool blocking,
+    cl_map_flags flags,
+    size_type size,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
     }
 
-    cl_int enqueueReleaseExternalMemObjects(
-        const vector<Memory>& mem_objects,
-        const vector<Event>* events_wait = nullptr,
-        Event *event = nullptr)
-    {
-        cl_int err = CL_INVALID_OPERATION;
-        cl_event tmp;
+    return queue.enqueueMapSVM(
+        ptr, blocking, flags, size, events, event);
+}
 
-        std::call_once(ext_memory_initialized_, initMemoryExtension, this->getInfo<CL_QUEUE_DEVICE>());
+template<typename T, class D>
+inline cl_int enqueueMapSVM(
+    cl::pointer<T, D> &ptr,
+    cl_bool blocking,
+    cl_map_flags flags,
+    size_type size,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueMapSVM(ptr, blocking, flags, size, EventWaitList(events), event);
+}
 
-        if (pfn_clEnqueueReleaseExternalMemObjectsKHR)
-        {
-            err = pfn_clEnqueueReleaseExternalMemObjectsKHR(
-                object_,
-                static_cast<cl_uint>(mem_objects.size()),
-                (mem_objects.size() > 0) ? reinterpret_cast<const cl_mem *>(mem_objects.data()) : nullptr,
-                (events_wait != nullptr) ? static_cast<cl_uint>(events_wait->size()) : 0,
-                (events_wait != nullptr && events_wait->size() > 0) ? reinterpret_cast<const cl_event*>(events_wait->data()) : nullptr,
-                &tmp);
-        }
+/**
+ * Enqueues to the default queue a command that will allow the host to
+ * update a region of a coarse-grained SVM buffer.
+ * This variant takes a cl::vector instance.
+ */
+template<typename T, class Alloc>
+inline cl_int enqueueMapSVM(
+    cl::vector<T, Alloc> &container,
+    cl_bool blocking,
+    cl_map_flags flags,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+    }
 
-        detail::errHandler(err, __ENQUEUE_RELEASE_EXTERNAL_MEMORY_ERR);
+    return queue.enqueueMapSVM(
+        container, blocking, flags, events, event);
+}
 
-        if (event != nullptr && err == CL_SUCCESS)
-            *event = tmp;
+template<typename T, class Alloc>
+inline cl_int enqueueMapSVM(
+    cl::vector<T, Alloc> &container,
+    cl_bool blocking,
+    cl_map_flags flags,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueMapSVM(container, blocking, flags, EventWaitList(events), event);
+}
 
-        return err;
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+inline cl_int enqueueUnmapMemObject(
+    const Memory& memory,
+    void* mapped_ptr,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
+    if (error != CL_SUCCESS) {
+        return error;
     }
-#endif // cl_khr_external_memory && CL_HPP_TARGET_OPENCL_VERSION >= 300
 
-#ifdef cl_khr_semaphore
-    cl_int enqueueWaitSemaphores(
-        const vector<Semaphore> &sema_objects,
-        const vector<cl_semaphore_payload_khr> &sema_payloads = {},
-        const vector<Event>* events_wait_list = nullptr,
-        Event *event = nullptr) const;
+    cl_event tmp;
+    cl_int err = detail::errHandler(
+        ::clEnqueueUnmapMemObject(
+        queue(), memory(), mapped_ptr,
+        (cl_uint) events.size(),
+        events.get(),
+        (event != nullptr) ? &tmp : nullptr),
+        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
 
-    cl_int enqueueSignalSemaphores(
-        const vector<Semaphore> &sema_objects,
-        const vector<cl_semaphore_payload_khr>& sema_payloads = {},
-        const vector<Event>* events_wait_list = nullptr,
-        Event* event = nullptr);
-#endif // cl_khr_semaphore
-}; // CommandQueue
+    if (event != nullptr && err == CL_SUCCESS)
+        *event = tmp;
 
-#ifdef cl_khr_external_memory
-CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag CommandQueue::ext_memory_initialized_;
-#endif
+    return err;
+}
 
-CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag CommandQueue::default_initialized_;
-CL_HPP_DEFINE_STATIC_MEMBER_ CommandQueue CommandQueue::default_;
-CL_HPP_DEFINE_STATIC_MEMBER_ cl_int CommandQueue::default_error_ = CL_SUCCESS;
+inline cl_int enqueueUnmapMemObject(
+    const Memory& memory,
+    void* mapped_ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueUnmapMemObject(memory, mapped_ptr, EventWaitList(events), event);
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+/**
+ * Enqueues to the default queue a command that will release a coarse-grained 
+ * SVM buffer back to the OpenCL runtime.
+ * This variant takes a raw SVM pointer.
+ */
+template<typename T>
+inline cl_int enqueueUnmapSVM(
+    T* ptr,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    }
 
+    return detail::errHandler(queue.enqueueUnmapSVM(ptr, events, event), 
+        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-enum class DeviceQueueProperties : cl_command_queue_properties
-{
-    None = 0,
-    Profiling = CL_QUEUE_PROFILING_ENABLE,
-};
+}
 
-inline DeviceQueueProperties operator|(DeviceQueueProperties lhs, DeviceQueueProperties rhs)
+template<typename T>
+inline cl_int enqueueUnmapSVM(
+    T* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
 {
-    return static_cast<DeviceQueueProperties>(static_cast<cl_command_queue_properties>(lhs) | static_cast<cl_command_queue_properties>(rhs));
+    return enqueueUnmapSVM(ptr, EventWaitList(events), event);
 }
 
-/*! \class DeviceCommandQueue
- * \brief DeviceCommandQueue interface for device cl_command_queues.
+/**
+ * Enqueues to the default queue a command that will release a coarse-grained 
+ * SVM buffer back to the OpenCL runtime.
+ * This variant takes a cl::pointer instance.
  */
-class DeviceCommandQueue : public detail::Wrapper<cl_command_queue>
+template<typename T, class D>
+inline cl_int enqueueUnmapSVM(
+    cl::pointer<T, D> &ptr,
+    EventWaitList events,
+    Event* event = nullptr)
 {
-public:
-
-    /*!
-     * Trivial empty constructor to create a null queue.
-     */
-    DeviceCommandQueue() { }
-
-    /*!
-     * Default construct device command queue on default context and device
-     */
-    DeviceCommandQueue(DeviceQueueProperties properties, cl_int* err = nullptr)
-    {
-        cl_int error;
-        cl::Context context = cl::Context::getDefault();
-        cl::Device device = cl::Device::getDefault();
-
-        cl_command_queue_properties mergedProperties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
-
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, mergedProperties, 0 };
-        object_ = ::clCreateCommandQueueWithProperties(
-            context(), device(), queue_properties, &error);
-
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
     }
 
-    /*!
-     * Create a device command queue for a specified device in the passed context.
-     */
-    DeviceCommandQueue(
-        const Context& context,
-        const Device& device,
-        DeviceQueueProperties properties = DeviceQueueProperties::None,
-        cl_int* err = nullptr)
-    {
-        cl_int error;
+    return detail::errHandler(queue.enqueueUnmapSVM(ptr, events, event),
+        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+}
 
-        cl_command_queue_properties mergedProperties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, mergedProperties, 0 };
-        object_ = ::clCreateCommandQueueWithProperties(
-            context(), device(), queue_properties, &error);
+template<typename T, class D>
+inline cl_int enqueueUnmapSVM(
+    cl::pointer<T, D> &ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueUnmapSVM(ptr, EventWaitList(events), event);
+}
 
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
+/**
+ * Enqueues to the default queue a command that will release a coarse-grained 
+ * SVM buffer back to the OpenCL runtime.
+ * This variant takes a cl::vector instance.
+ */
+template<typename T, class Alloc>
+inline cl_int enqueueUnmapSVM(
+    cl::vector<T, Alloc> &container,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
     }
 
-    /*!
-     * Create a device command queue for a specified device in the passed context.
-     */
-    DeviceCommandQueue(
-        const Context& context,
-        const Device& device,
-        cl_uint queueSize,
-        DeviceQueueProperties properties = DeviceQueueProperties::None,
-        cl_int* err = nullptr)
-    {
-        cl_int error;
-
-        cl_command_queue_properties mergedProperties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | static_cast<cl_command_queue_properties>(properties);
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, mergedProperties,
-            CL_QUEUE_SIZE, queueSize, 
-            0 };
-        object_ = ::clCreateCommandQueueWithProperties(
-            context(), device(), queue_properties, &error);
+    return detail::errHandler(queue.enqueueUnmapSVM(container, events, event),
+        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+}
 
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
-    }
+template<typename T, class Alloc>
+inline cl_int enqueueUnmapSVM(
+    cl::vector<T, Alloc> &container,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueUnmapSVM(container, EventWaitList(events), event);
+}
 
-    /*! \brief Constructor from cl_command_queue - takes ownership.
-    *
-    * \param retainObject will cause the constructor to retain its cl object.
-    *                     Defaults to false to maintain compatibility with
-    *                     earlier versions.
-    */
-    explicit DeviceCommandQueue(const cl_command_queue& commandQueue, bool retainObject = false) :
-        detail::Wrapper<cl_type>(commandQueue, retainObject) { }
+namespace detail {
 
-    DeviceCommandQueue& operator = (const cl_command_queue& rhs)
+/*! \brief SVM memory shared by the copies of a PooledSVMAllocator.
+ *
+ *  Requests are rounded up to power-of-two size classes of at least the
+ *  alignment and carved out of slabs allocated with clSVMAlloc. Freed blocks
+ *  wait in a free list per size class and are never returned to the OpenCL
+ *  implementation before the pool is destroyed.
+ *
+ *  Coarse-grained blocks are mapped when they are handed out unmapped.
+ *  Containers unmapped through CommandQueue::enqueueUnmapSVM are recorded
+ *  through SVMMapState, and their blocks are mapped again when reused.
+ *  Other blocks are still mapped when they are freed, so reusing them takes
+ *  no map command.
+ */
+class SVMPool
+{
+private:
+    struct Block
     {
-        detail::Wrapper<cl_type>::operator=(rhs);
-        return *this;
-    }
+        void* ptr_;
+        bool mapped_;
+    };
 
-    template <typename T>
-    cl_int getInfo(cl_command_queue_info name, T* param) const
+    struct Slab
     {
-        return detail::errHandler(
-            detail::getInfo(
-            &::clGetCommandQueueInfo, object_, name, param),
-            __GET_COMMAND_QUEUE_INFO_ERR);
-    }
+        void* base_;
+        size_type size_;
+        // Blocks past this offset have never been handed out
+        size_type used_;
+    };
 
-    template <cl_command_queue_info name> typename
-        detail::param_traits<detail::cl_command_queue_info, name>::param_type
-        getInfo(cl_int* err = nullptr) const
-    {
-        typename detail::param_traits<
-            detail::cl_command_queue_info, name>::param_type param;
-        cl_int result = getInfo(name, &param);
-        if (err != nullptr) {
-            *err = result;
+    std::mutex mutex_;
+    Context context_;
+    CommandQueue queue_;
+    cl_svm_mem_flags flags_;
+    size_type alignment_;
+    size_type slabSize_;
+    vector<Slab> slabs_;
+    // Keyed by size class
+    std::map<size_type, vector<Block>> free_;
+    // Blocks in use that were unmapped through a container
+    vector<void*> unmapped_;
+
+    // Called with the lock held
+    bool forgetUnmapped(void* ptr)
+    {
+        vector<void*>::iterator it = std::find(unmapped_.begin(), unmapped_.end(), ptr);
+        if (it == unmapped_.end()) {
+            return false;
         }
-        return param;
+        *it = unmapped_.back();
+        unmapped_.pop_back();
+        return true;
     }
 
-    /*!
-     * Create a new default device command queue for the default device,
-     * in the default context and of the default size.
-     * If there is already a default queue for the specified device this
-     * function will return the pre-existing queue.
-     */
-    static DeviceCommandQueue makeDefault(
-        cl_int *err = nullptr)
+    // Called with the lock held
+    bool reserve(size_type sizeClass, Block* block)
     {
-        cl_int error;
-        cl::Context context = cl::Context::getDefault();
-        cl::Device device = cl::Device::getDefault();
-
-        cl_command_queue_properties properties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, properties,
-            0 };
-        DeviceCommandQueue deviceQueue(
-            ::clCreateCommandQueueWithProperties(
-            context(), device(), queue_properties, &error));
+        std::map<size_type, vector<Block>>::iterator list = free_.find(sizeClass);
+        if (list != free_.end() && !list->second.empty()) {
+            *block = list->second.back();
+            list->second.pop_back();
+            return true;
+        }
 
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
+        block->mapped_ = false;
+        for (Slab& slab : slabs_) {
+            if (slab.size_ - slab.used_ >= sizeClass) {
+                block->ptr_ = static_cast<char*>(slab.base_) + slab.used_;
+                slab.used_ += sizeClass;
+                return true;
+            }
         }
 
-        return deviceQueue;
+        // Requests larger than a slab get a slab of their own
+        size_type size = sizeClass > slabSize_ ? sizeClass : slabSize_;
+        void* base = ::clSVMAlloc(
+            context_(), flags_, size, static_cast<cl_uint>(alignment_));
+        if (base == nullptr) {
+            return false;
+        }
+        Slab slab = { base, size, sizeClass };
+        slabs_.push_back(slab);
+        block->ptr_ = base;
+        return true;
     }
 
-    /*!
-     * Create a new default device command queue for the specified device
-     * and of the default size.
-     * If there is already a default queue for the specified device this
-     * function will return the pre-existing queue.
-     */
-    static DeviceCommandQueue makeDefault(
-        const Context &context, const Device &device, cl_int *err = nullptr)
+    void release(const Block& block, size_type sizeClass)
     {
-        cl_int error;
-
-        cl_command_queue_properties properties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, properties,
-            0 };
-        DeviceCommandQueue deviceQueue(
-            ::clCreateCommandQueueWithProperties(
-            context(), device(), queue_properties, &error));
-
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
-
-        return deviceQueue;
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_[sizeClass].push_back(block);
     }
 
-    /*!
-     * Create a new default device command queue for the specified device 
-     * and of the requested size in bytes.
-     * If there is already a default queue for the specified device this
-     * function will return the pre-existing queue.
+public:
+    /*! \param queue Used to map coarse-grained blocks, the default queue is
+     *  used if it is empty.
+     *  \param alignment Alignment of the blocks in bytes, a power of two.
+     *  If 0 the blocks are aligned to the largest OpenCL C type.
      */
-    static DeviceCommandQueue makeDefault(
-        const Context &context, const Device &device, cl_uint queueSize, cl_int *err = nullptr)
+    SVMPool(
+        const Context& context,
+        const CommandQueue& queue,
+        cl_svm_mem_flags flags,
+        size_type alignment,
+        size_type slabSize) :
+        context_(context),
+        queue_(queue),
+        flags_(flags),
+        // The size of long16
+        alignment_(alignment != 0 ? alignment : 16 * sizeof(cl_long)),
+        slabSize_(slabSize)
     {
-        cl_int error;
-
-        cl_command_queue_properties properties =
-            CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT;
-        cl_queue_properties queue_properties[] = {
-            CL_QUEUE_PROPERTIES, properties,
-            CL_QUEUE_SIZE, queueSize,
-            0 };
-        DeviceCommandQueue deviceQueue(
-            ::clCreateCommandQueueWithProperties(
-                context(), device(), queue_properties, &error));
-
-        detail::errHandler(error, __CREATE_COMMAND_QUEUE_WITH_PROPERTIES_ERR);
-        if (err != nullptr) {
-            *err = error;
+    }
+
+    SVMPool(const SVMPool&) = delete;
+    SVMPool& operator = (const SVMPool&) = delete;
+
+    ~SVMPool()
+    {
+        for (const Slab& slab : slabs_) {
+            ::clSVMFree(context_(), slab.base_);
         }
+    }
 
-        return deviceQueue;
+    const Context& getContext() const
+    {
+        return context_;
     }
 
+    size_type getAlignment() const
+    {
+        return alignment_;
+    }
 
+    //! \brief Returns 0 when size cannot be rounded up to a power of two.
+    size_type sizeClass(size_type size) const
+    {
+        if (size > (std::numeric_limits<size_type>::max)() / 2 + 1) {
+            return 0;
+        }
+        size_type sizeClass = alignment_;
+        while (sizeClass < size) {
+            sizeClass <<= 1;
+        }
+        return sizeClass;
+    }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-    /*!
-     * Modify the default device command queue to be used for subsequent kernels.
-     * This can update the default command queue for a device repeatedly to account
-     * for kernels that rely on the default.
-     * @return updated default device command queue.
-     */
-    static DeviceCommandQueue updateDefault(const Context &context, const Device &device, const DeviceCommandQueue &default_queue, cl_int *err = nullptr)
+    //! \brief Returns a block of at least size bytes, or nullptr on failure.
+    void* allocate(size_type size)
     {
-        cl_int error;
-        error = clSetDefaultDeviceCommandQueue(context.get(), device.get(), default_queue.get());
+        size_type sizeClass = this->sizeClass(size);
+        if (sizeClass == 0) {
+            return nullptr;
+        }
+        Block block;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!reserve(sizeClass, &block)) {
+                return nullptr;
+            }
+        }
 
-        detail::errHandler(error, __SET_DEFAULT_DEVICE_COMMAND_QUEUE_ERR);
-        if (err != nullptr) {
-            *err = error;
+        if (!(flags_ & CL_MEM_SVM_FINE_GRAIN_BUFFER) && !block.mapped_) {
+            cl_int error;
+            const CommandQueue& queue =
+                queue_() != nullptr ? queue_ : getImplicitQueue(&error);
+            error = ::clEnqueueSVMMap(
+                queue(), CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                block.ptr_, sizeClass, 0, nullptr, nullptr);
+            if (error != CL_SUCCESS) {
+                release(block, sizeClass);
+                return nullptr;
+            }
+            block.mapped_ = true;
         }
-        return default_queue;
+        return block.ptr_;
     }
 
-    /*!
-     * Return the current default command queue for the specified command queue
-     */
-    static DeviceCommandQueue getDefault(const CommandQueue &queue, cl_int * err = nullptr)
+    //! \brief Returns a block of size bytes to its free list.
+    void deallocate(void* ptr, size_type size)
     {
-        return queue.getInfo<CL_QUEUE_DEVICE_DEFAULT>(err);
+        std::lock_guard<std::mutex> lock(mutex_);
+        Block block = { ptr, !forgetUnmapped(ptr) };
+        free_[sizeClass(size)].push_back(block);
     }
 
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 210
-}; // DeviceCommandQueue
+    //! \brief Records whether the block at ptr is mapped on the host.
+    void setMapped(void* ptr, bool mapped)
+    {
+        if (flags_ & CL_MEM_SVM_FINE_GRAIN_BUFFER) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        forgetUnmapped(ptr);
+        if (!mapped) {
+            unmapped_.push_back(ptr);
+        }
+    }
+};
 
-namespace detail
+//! \brief Returns the pool of default-constructed PooledSVMAllocators.
+template <class SVMTrait>
+inline const std::shared_ptr<SVMPool>& getDefaultSVMPool()
 {
-    // Specialization for device command queue
-    template <>
-    struct KernelArgumentHandler<cl::DeviceCommandQueue, void>
+    static const std::shared_ptr<SVMPool> pool = std::make_shared<SVMPool>(
+        Context::getDefault(), CommandQueue(), SVMTrait::getSVMMemFlags(), 0, 1 << 20);
+    return pool;
+}
+
+} // namespace detail
+
+/**
+ * STL-like allocator that reuses SVM memory.
+ *
+ * Allocations come from a detail::SVMPool shared by all copies of the
+ * allocator, including rebound ones, so growing and destroying containers
+ * neither calls clSVMAlloc and clSVMFree nor, for coarse-grained traits,
+ * maps memory again that is still mapped. Coarse-grained containers
+ * unmapped with CommandQueue::enqueueUnmapSVM or cl::unmapSVM are mapped
+ * again when their memory is reused. Memory unmapped through a raw pointer
+ * or a cl::pointer must be mapped again before it is freed.
+ *
+ * Default-constructed allocators share a pool on the default context per
+ * trait. Memory handed out by a pool is only freed when the pool is.
+ */
+template<typename T, class SVMTrait>
+class PooledSVMAllocator {
+private:
+    std::shared_ptr<detail::SVMPool> pool_;
+
+public:
+    typedef T value_type;
+    typedef value_type* pointer;
+    typedef const value_type* const_pointer;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind
     {
-        static size_type size(const cl::DeviceCommandQueue&) { return sizeof(cl_command_queue); }
-        static const cl_command_queue* ptr(const cl::DeviceCommandQueue& value) { return &(value()); }
+        typedef PooledSVMAllocator<U, SVMTrait> other;
     };
-} // namespace detail
 
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    template<typename U, typename V>
+    friend class PooledSVMAllocator;
 
+    friend struct detail::SVMMapState<PooledSVMAllocator>;
 
-template< typename IteratorType >
-Buffer::Buffer(
-    const Context &context,
-    IteratorType startIterator,
-    IteratorType endIterator,
-    bool readOnly,
-    bool useHostPtr,
-    cl_int* err)
-{
-    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
-    cl_int error;
+    PooledSVMAllocator() :
+        pool_(detail::getDefaultSVMPool<SVMTrait>())
+    {
+    }
 
-    cl_mem_flags flags = 0;
-    if( readOnly ) {
-        flags |= CL_MEM_READ_ONLY;
+    /*! \brief Creates an allocator with a pool of its own.
+     *
+     *  \param alignment Alignment of allocations in bytes, a power of two.
+     *  If 0 allocations are aligned to the largest OpenCL C type.
+     *  \param slabSize Size of the SVM allocations the pool carves up.
+     */
+    explicit PooledSVMAllocator(
+        const Context& context,
+        size_type alignment = 0,
+        size_type slabSize = 1 << 20) :
+        pool_(std::make_shared<detail::SVMPool>(
+            context, CommandQueue(), SVMTrait::getSVMMemFlags(), alignment, slabSize))
+    {
     }
-    else {
-        flags |= CL_MEM_READ_WRITE;
+
+    /*! \brief Creates an allocator with a pool of its own that maps
+     *  coarse-grained memory with queue.
+     */
+    PooledSVMAllocator(
+        const Context& context,
+        const CommandQueue& queue,
+        size_type alignment = 0,
+        size_type slabSize = 1 << 20) :
+        pool_(std::make_shared<detail::SVMPool>(
+            context, queue, SVMTrait::getSVMMemFlags(), alignment, slabSize))
+    {
     }
-    if( useHostPtr ) {
-        flags |= CL_MEM_USE_HOST_PTR;
+
+    template<typename U>
+    PooledSVMAllocator(const PooledSVMAllocator<U, SVMTrait> &other) :
+        pool_(other.pool_)
+    {
     }
-    
-    size_type size = sizeof(DataType)*(endIterator - startIterator);
 
-    if( useHostPtr ) {
-        object_ = ::clCreateBuffer(context(), flags, size, const_cast<DataType*>(&*startIterator), &error);
-    } else {
-        object_ = ::clCreateBuffer(context(), flags, size, 0, &error);
+    pointer address(reference r) noexcept
+    {
+        return std::addressof(r);
     }
 
-    detail::errHandler(error, __CREATE_BUFFER_ERR);
-    if (err != nullptr) {
-        *err = error;
+    const_pointer address(const_reference r) noexcept
+    {
+        return std::addressof(r);
     }
 
-    if( !useHostPtr ) {
-        CommandQueue queue(context, 0, &error);
-        detail::errHandler(error, __CREATE_BUFFER_ERR);
-        if (err != nullptr) {
-            *err = error;
+    /**
+     * Allocate an SVM pointer.
+     *
+     * If the allocator is coarse-grained, the memory is mapped for reading
+     * and writing on the host.
+     */
+    pointer allocate(
+        size_type size,
+        const void* = 0)
+    {
+        // size * sizeof(T) must not wrap around
+        pointer retValue = size > (std::numeric_limits<size_type>::max)() / sizeof(T) ?
+            nullptr : static_cast<pointer>(pool_->allocate(size*sizeof(T)));
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        if (!retValue) {
+            std::bad_alloc excep;
+            throw excep;
         }
+#endif // #if defined(CL_HPP_ENABLE_EXCEPTIONS)
 
-        error = cl::copy(queue, startIterator, endIterator, *this);
-        detail::errHandler(error, __CREATE_BUFFER_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
+        // If exceptions disabled, return null pointer from allocator
+        return retValue;
     }
-}
-
-template< typename IteratorType >
-Buffer::Buffer(
-    const CommandQueue &queue,
-    IteratorType startIterator,
-    IteratorType endIterator,
-    bool readOnly,
-    bool useHostPtr,
-    cl_int* err)
-{
-    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
-    cl_int error;
 
-    cl_mem_flags flags = 0;
-    if (readOnly) {
-        flags |= CL_MEM_READ_ONLY;
-    }
-    else {
-        flags |= CL_MEM_READ_WRITE;
-    }
-    if (useHostPtr) {
-        flags |= CL_MEM_USE_HOST_PTR;
+    void deallocate(pointer p, size_type size)
+    {
+        pool_->deallocate(p, size*sizeof(T));
     }
 
-    size_type size = sizeof(DataType)*(endIterator - startIterator);
+    /**
+     * Return the maximum possible allocation size.
+     * This is the minimum of the maximum sizes of all devices in the context.
+     */
+    size_type max_size() const noexcept
+    {
+        size_type maxSize = (std::numeric_limits<size_type>::max)() / sizeof(T);
 
-    Context context = queue.getInfo<CL_QUEUE_CONTEXT>();
+        for (const Device &d : pool_->getContext().getInfo<CL_CONTEXT_DEVICES>()) {
+            maxSize = (std::min)(
+                maxSize, 
+                static_cast<size_type>(d.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>()));
+        }
 
-    if (useHostPtr) {
-        object_ = ::clCreateBuffer(context(), flags, size, const_cast<DataType*>(&*startIterator), &error);
+        return maxSize;
     }
-    else {
-        object_ = ::clCreateBuffer(context(), flags, size, 0, &error);
+
+    template< class U, class... Args >
+    void construct(U* p, Args&&... args)
+    {
+        new(p)U(std::forward<Args>(args)...);
     }
 
-    detail::errHandler(error, __CREATE_BUFFER_ERR);
-    if (err != nullptr) {
-        *err = error;
+    template< class U >
+    void destroy(U* p)
+    {
+        p->~U();
     }
 
-    if (!useHostPtr) {
-        error = cl::copy(queue, startIterator, endIterator, *this);
-        detail::errHandler(error, __CREATE_BUFFER_ERR);
-        if (err != nullptr) {
-            *err = error;
-        }
+    //! \brief Returns the alignment of allocations in bytes.
+    size_type getAlignment() const
+    {
+        return pool_->getAlignment();
     }
-}
 
-inline cl_int enqueueReadBuffer(
-    const Buffer& buffer,
-    cl_bool blocking,
-    size_type offset,
-    size_type size,
-    void* ptr,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
-{
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    /**
+     * Returns true if the allocators share a pool.
+     */
+    template<typename U>
+    inline bool operator==(PooledSVMAllocator<U, SVMTrait> const& rhs) const
+    {
+        return pool_ == rhs.pool_;
+    }
 
-    if (error != CL_SUCCESS) {
-        return error;
+    template<typename U>
+    inline bool operator!=(PooledSVMAllocator<U, SVMTrait> const& rhs) const
+    {
+        return !operator==(rhs);
     }
+}; // class PooledSVMAllocator
 
-    return queue.enqueueReadBuffer(buffer, blocking, offset, size, ptr, events, event);
-}
+namespace detail {
 
-inline cl_int enqueueWriteBuffer(
-        const Buffer& buffer,
-        cl_bool blocking,
-        size_type offset,
-        size_type size,
-        const void* ptr,
-        const vector<Event>* events = nullptr,
+template<typename T, class SVMTrait>
+struct SVMMapState<PooledSVMAllocator<T, SVMTrait>>
+{
+    static void set(const PooledSVMAllocator<T, SVMTrait>& alloc, void* ptr, bool mapped)
+    {
+        alloc.pool_->setMapped(ptr, mapped);
+    }
+};
+
+} // namespace detail
+
+/*! \brief Vector alias to simplify contruction of coarse-grained SVM
+ *  containers that reuse SVM memory.
+ */
+template < class T >
+using pooled_coarse_svm_vector = vector<T, cl::PooledSVMAllocator<T, cl::SVMTraitCoarse<>>>;
+
+/*! \brief Vector alias to simplify contruction of fine-grained SVM
+ *  containers that reuse SVM memory.
+ */
+template < class T >
+using pooled_fine_svm_vector = vector<T, cl::PooledSVMAllocator<T, cl::SVMTraitFine<>>>;
+
+
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+inline cl_int enqueueCopyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
+        size_type size,
+        EventWaitList events,
         Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
     }
 
-    return queue.enqueueWriteBuffer(buffer, blocking, offset, size, ptr, events, event);
+    return queue.enqueueCopyBuffer(src, dst, src_offset, dst_offset, size, events, event);
 }
 
-inline void* enqueueMapBuffer(
-        const Buffer& buffer,
-        cl_bool blocking,
-        cl_map_flags flags,
-        size_type offset,
+inline cl_int enqueueCopyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
         size_type size,
         const vector<Event>* events = nullptr,
-        Event* event = nullptr,
-        cl_int* err = nullptr)
+        Event* event = nullptr)
 {
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    if (err != nullptr) {
-        *err = error;
+    return enqueueCopyBuffer(src, dst, src_offset, dst_offset, size, EventWaitList(events), event);
+}
+
+namespace detail {
+
+/*! \brief Copies host ranges into and out of mapped memory.
+ *
+ *  A single thread rarely saturates the memory bandwidth of a multi-socket
+ *  host, so large copies between random access ranges can be split across
+ *  several threads, see cl::setHostCopyThreads(). The range is cut into one
+ *  contiguous, page-aligned chunk per thread: every page of the destination
+ *  is written by a single thread, which keeps first-touch placement on that
+ *  thread's node and avoids sharing pages between sockets. Chunks no thread
+ *  can be started for are copied by the calling thread.
+ */
+class HostCopy
+{
+private:
+    static std::atomic<unsigned int> threads_;
+
+    // Each thread copies at least this many bytes
+    static const size_type minChunkSize = 1 << 20;
+    static const size_type pageSize = 4096;
+
+    template< typename InputIterator, typename OutputIterator >
+    static void copy(
+        InputIterator first, size_type length, OutputIterator result, std::false_type)
+    {
+        std::copy_n(first, length, result);
     }
 
-    void * result = ::clEnqueueMapBuffer(
-            queue(), buffer(), blocking, flags, offset, size,
-            (events != nullptr) ? (cl_uint) events->size() : 0,
-            (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
-            (cl_event*) event,
-            &error);
+    template< typename InputIterator, typename OutputIterator >
+    static void copy(
+        InputIterator first, size_type length, OutputIterator result, std::true_type)
+    {
+        typedef typename std::iterator_traits<InputIterator>::value_type DataType;
+        typedef typename std::iterator_traits<InputIterator>::difference_type InputDifference;
+        typedef typename std::iterator_traits<OutputIterator>::difference_type OutputDifference;
 
-    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    if (err != nullptr) {
-        *err = error;
+        size_type threads = threads_.load(std::memory_order_relaxed);
+        size_type maxThreads = length * sizeof(DataType) / minChunkSize;
+        if (threads > maxThreads) {
+            threads = maxThreads;
+        }
+        if (threads <= 1) {
+            std::copy_n(first, length, result);
+            return;
+        }
+
+        size_type pageLength = sizeof(DataType) < pageSize ? pageSize / sizeof(DataType) : 1;
+        size_type chunkLength = (length / threads + pageLength - 1) / pageLength * pageLength;
+
+        // The calling thread copies the first chunk
+        vector<std::thread> workers;
+        size_type offset = chunkLength;
+        {
+            ThreadJoiner<vector<std::thread>> joiner(workers);
+            // std::thread throws when no thread can be started, whether or
+            // not CL_HPP_ENABLE_EXCEPTIONS is defined
+            try {
+                workers.reserve(threads - 1);
+                for (; offset < length; offset += chunkLength) {
+                    size_type count = (std::min)(chunkLength, length - offset);
+                    InputIterator chunkFirst = first + static_cast<InputDifference>(offset);
+                    OutputIterator chunkResult = result + static_cast<OutputDifference>(offset);
+                    workers.emplace_back([chunkFirst, count, chunkResult]() {
+                        std::copy_n(chunkFirst, count, chunkResult);
+                    });
+                }
+            }
+            catch (...) {
+                // Copies the chunks no thread could be started for below
+            }
+
+            std::copy_n(first, (std::min)(chunkLength, length), result);
+            if (offset < length) {
+                std::copy_n(
+                    first + static_cast<InputDifference>(offset), length - offset,
+                    result + static_cast<OutputDifference>(offset));
+            }
+        }
     }
-    return result;
+
+public:
+    static void setThreads(unsigned int count)
+    {
+        if (count == 0) {
+            count = std::thread::hardware_concurrency();
+        }
+        threads_.store(count > 0 ? count : 1, std::memory_order_relaxed);
+    }
+
+    static unsigned int getThreads()
+    {
+        return threads_.load(std::memory_order_relaxed);
+    }
+
+    //! \brief Copies length elements from first to result.
+    template< typename InputIterator, typename OutputIterator >
+    static void copy(InputIterator first, size_type length, OutputIterator result)
+    {
+        typedef std::random_access_iterator_tag RandomAccess;
+        typedef std::integral_constant<bool,
+            std::is_base_of<RandomAccess,
+                typename std::iterator_traits<InputIterator>::iterator_category>::value &&
+            std::is_base_of<RandomAccess,
+                typename std::iterator_traits<OutputIterator>::iterator_category>::value> Parallel;
+        copy(first, length, result, Parallel());
+    }
+};
+
+CL_HPP_DEFINE_STATIC_MEMBER_ std::atomic<unsigned int> HostCopy::threads_(1);
+
+} // namespace detail
+
+/*! \brief Sets the number of threads the blocking and non-blocking copies
+ *  between iterators and memory objects use for their host side copy.
+ *
+ *  Only copies between random access ranges of at least 1 MiB per thread
+ *  are split. 0 selects std::thread::hardware_concurrency(). Defaults to 1.
+ */
+inline void setHostCopyThreads(unsigned int count)
+{
+    detail::HostCopy::setThreads(count);
 }
 
+//! \brief Returns the number of threads used for host side copies.
+inline unsigned int getHostCopyThreads()
+{
+    return detail::HostCopy::getThreads();
+}
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
 /**
- * Enqueues to the default queue a command that will allow the host to
- * update a region of a coarse-grained SVM buffer.
- * This variant takes a raw SVM pointer.
+ * Blocking copy operation between iterators and a buffer.
+ * Host to Device.
+ * Uses default command queue.
  */
-template<typename T>
-inline cl_int enqueueMapSVM(
-    T* ptr,
-    cl_bool blocking,
-    cl_map_flags flags,
-    size_type size,
-    const vector<Event>* events,
-    Event* event)
+template< typename IteratorType >
+inline cl_int copy( IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer )
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    }
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS)
+        return error;
 
-    return queue.enqueueMapSVM(
-        ptr, blocking, flags, size, events, event);
+    return cl::copy(queue, startIterator, endIterator, buffer);
 }
 
 /**
- * Enqueues to the default queue a command that will allow the host to 
- * update a region of a coarse-grained SVM buffer.
- * This variant takes a cl::pointer instance.
+ * Blocking copy operation between iterators and a buffer.
+ * Device to Host.
+ * Uses default command queue.
  */
-template<typename T, class D>
-inline cl_int enqueueMapSVM(
-    cl::pointer<T, D> &ptr,
-    cl_bool blocking,
-    cl_map_flags flags,
-    size_type size,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+template< typename IteratorType >
+inline cl_int copy( const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator )
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    }
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS)
+        return error;
 
-    return queue.enqueueMapSVM(
-        ptr, blocking, flags, size, events, event);
+    return cl::copy(queue, buffer, startIterator, endIterator);
 }
 
 /**
- * Enqueues to the default queue a command that will allow the host to
- * update a region of a coarse-grained SVM buffer.
- * This variant takes a cl::vector instance.
+ * Blocking copy operation between iterators and a buffer.
+ * Host to Device.
+ * Uses specified queue.
  */
-template<typename T, class Alloc>
-inline cl_int enqueueMapSVM(
-    cl::vector<T, Alloc> &container,
-    cl_bool blocking,
-    cl_map_flags flags,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+template< typename IteratorType >
+inline cl_int copy( const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer )
 {
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    }
+    
+    size_type length = endIterator-startIterator;
+    size_type byteLength = length*sizeof(DataType);
 
-    return queue.enqueueMapSVM(
-        container, blocking, flags, events, event);
+    DataType *pointer = 
+        static_cast<DataType*>(queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_WRITE, 0, byteLength, 0, 0, &error));
+    // if exceptions enabled, enqueueMapBuffer will throw
+    if( error != CL_SUCCESS ) {
+        return error;
+    }
+#if defined(_MSC_VER)
+    detail::HostCopy::copy(
+        startIterator, 
+        length, 
+        stdext::checked_array_iterator<DataType*>(
+            pointer, length));
+#else
+    detail::HostCopy::copy(startIterator, length, pointer);
+#endif
+    Event endEvent;
+    error = queue.enqueueUnmapMemObject(buffer, pointer, 0, &endEvent);
+    // if exceptions enabled, enqueueUnmapMemObject will throw
+    if( error != CL_SUCCESS ) { 
+        return error;
+    }
+    endEvent.wait();
+    return CL_SUCCESS;
 }
 
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
-
-inline cl_int enqueueUnmapMemObject(
-    const Memory& memory,
-    void* mapped_ptr,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+/**
+ * Blocking copy operation between iterators and a buffer.
+ * Device to Host.
+ * Uses specified queue.
+ */
+template< typename IteratorType >
+inline cl_int copy( const CommandQueue &queue, const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator )
 {
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    detail::errHandler(error, __ENQUEUE_MAP_BUFFER_ERR);
-    if (error != CL_SUCCESS) {
+        
+    size_type length = endIterator-startIterator;
+    size_type byteLength = length*sizeof(DataType);
+
+    DataType *pointer = 
+        static_cast<DataType*>(queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_READ, 0, byteLength, 0, 0, &error));
+    // if exceptions enabled, enqueueMapBuffer will throw
+    if( error != CL_SUCCESS ) {
+        return error;
+    }
+    detail::HostCopy::copy(pointer, length, startIterator);
+    Event endEvent;
+    error = queue.enqueueUnmapMemObject(buffer, pointer, 0, &endEvent);
+    // if exceptions enabled, enqueueUnmapMemObject will throw
+    if( error != CL_SUCCESS ) { 
         return error;
     }
+    endEvent.wait();
+    return CL_SUCCESS;
+}
 
-    cl_event tmp;
-    cl_int err = detail::errHandler(
-        ::clEnqueueUnmapMemObject(
-        queue(), memory(), mapped_ptr,
-        (events != nullptr) ? (cl_uint)events->size() : 0,
-        (events != nullptr && events->size() > 0) ? (cl_event*)&events->front() : nullptr,
-        (event != nullptr) ? &tmp : nullptr),
-        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+namespace detail {
 
-    if (event != nullptr && err == CL_SUCCESS)
-        *event = tmp;
+/*! \brief Whether IteratorType refers to elements stored one after the other.
+ *
+ *  Before C++20 only pointers and the iterators of std::vector with the
+ *  default allocator are recognised.
+ */
+template< typename IteratorType >
+struct IsContiguousIterator
+{
+#if __cplusplus >= 202002L && defined(__cpp_lib_concepts)
+    static const bool value = std::contiguous_iterator<IteratorType>;
+#else
+private:
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
 
-    return err;
+public:
+    static const bool value =
+        std::is_pointer<IteratorType>::value ||
+        (!std::is_same<DataType, bool>::value &&
+         (std::is_same<IteratorType, typename std::vector<DataType>::iterator>::value ||
+          std::is_same<IteratorType, typename std::vector<DataType>::const_iterator>::value));
+#endif
+};
+
+// Host to device, contiguous range
+template< typename IteratorType >
+inline cl_int copyAsync(
+    const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator,
+    cl::Buffer &buffer, EventWaitList events, Event *event, std::true_type)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    size_type byteLength = (endIterator - startIterator) * sizeof(DataType);
+    return queue.enqueueWriteBuffer(
+        buffer, CL_FALSE, 0, byteLength, std::addressof(*startIterator), events, event);
 }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-/**
- * Enqueues to the default queue a command that will release a coarse-grained 
- * SVM buffer back to the OpenCL runtime.
- * This variant takes a raw SVM pointer.
- */
-template<typename T>
-inline cl_int enqueueUnmapSVM(
-    T* ptr,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+// Host to device, mapping the buffer
+template< typename IteratorType >
+inline cl_int copyAsync(
+    const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator,
+    cl::Buffer &buffer, EventWaitList events, Event *event, std::false_type)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    cl_int error;
+
+    size_type length = std::distance(startIterator, endIterator);
+    size_type byteLength = length*sizeof(DataType);
+
+    DataType *pointer = static_cast<DataType*>(queue.enqueueMapBuffer(
+        buffer, CL_TRUE, CL_MAP_WRITE, 0, byteLength, events, nullptr, &error));
+    if( error != CL_SUCCESS ) {
+        return error;
+    }
+#if defined(_MSC_VER)
+    detail::HostCopy::copy(
+        startIterator, 
+        length, 
+        stdext::checked_array_iterator<DataType*>(
+            pointer, length));
+#else
+    detail::HostCopy::copy(startIterator, length, pointer);
+#endif
+    return queue.enqueueUnmapMemObject(buffer, pointer, EventWaitList(), event);
+}
+
+// Device to host, contiguous range
+template< typename IteratorType >
+inline cl_int copyAsync(
+    const CommandQueue &queue, const cl::Buffer &buffer,
+    IteratorType startIterator, IteratorType endIterator,
+    EventWaitList events, Event *event, std::true_type)
+{
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
+    size_type byteLength = (endIterator - startIterator) * sizeof(DataType);
+    return queue.enqueueReadBuffer(
+        buffer, CL_FALSE, 0, byteLength, std::addressof(*startIterator), events, event);
+}
+
+// Device to host, mapping the buffer
+template< typename IteratorType >
+inline cl_int copyAsync(
+    const CommandQueue &queue, const cl::Buffer &buffer,
+    IteratorType startIterator, IteratorType endIterator,
+    EventWaitList events, Event *event, std::false_type)
 {
+    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
-    }
 
-    return detail::errHandler(queue.enqueueUnmapSVM(ptr, events, event), 
-        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    size_type length = std::distance(startIterator, endIterator);
+    size_type byteLength = length*sizeof(DataType);
 
+    DataType *pointer = static_cast<DataType*>(queue.enqueueMapBuffer(
+        buffer, CL_TRUE, CL_MAP_READ, 0, byteLength, events, nullptr, &error));
+    if( error != CL_SUCCESS ) {
+        return error;
+    }
+    detail::HostCopy::copy(pointer, length, startIterator);
+    return queue.enqueueUnmapMemObject(buffer, pointer, EventWaitList(), event);
 }
 
+} // namespace detail
+
 /**
- * Enqueues to the default queue a command that will release a coarse-grained 
- * SVM buffer back to the OpenCL runtime.
- * This variant takes a cl::pointer instance.
+ * Non-blocking copy operation between iterators and a buffer.
+ * Host to Device.
+ * Uses specified queue.
+ *
+ * Contiguous ranges are written directly and must neither be modified nor
+ * go away before the returned event completes. Other ranges are copied into
+ * the mapped buffer before the call returns. The returned event is empty if
+ * the range is.
  */
-template<typename T, class D>
-inline cl_int enqueueUnmapSVM(
-    cl::pointer<T, D> &ptr,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+template< typename IteratorType >
+inline Event copyAsync(
+    const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator,
+    cl::Buffer &buffer, EventWaitList events = EventWaitList(), cl_int *err = nullptr)
 {
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    Event event;
+    cl_int error = CL_SUCCESS;
+    if (startIterator != endIterator) {
+        error = detail::copyAsync(
+            queue, startIterator, endIterator, buffer, events, &event,
+            std::integral_constant<bool, detail::IsContiguousIterator<IteratorType>::value>());
     }
-
-    return detail::errHandler(queue.enqueueUnmapSVM(ptr, events, event),
-        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    if (err != nullptr) {
+        *err = error;
+    }
+    return event;
 }
 
 /**
- * Enqueues to the default queue a command that will release a coarse-grained 
- * SVM buffer back to the OpenCL runtime.
- * This variant takes a cl::vector instance.
+ * Non-blocking copy operation between iterators and a buffer.
+ * Device to Host.
+ * Uses specified queue.
+ *
+ * Contiguous ranges are read into directly and must not be accessed before
+ * the returned event completes. Other ranges are filled from the mapped
+ * buffer before the call returns. The returned event is empty if the range
+ * is.
  */
-template<typename T, class Alloc>
-inline cl_int enqueueUnmapSVM(
-    cl::vector<T, Alloc> &container,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
+template< typename IteratorType >
+inline Event copyAsync(
+    const CommandQueue &queue, const cl::Buffer &buffer,
+    IteratorType startIterator, IteratorType endIterator,
+    EventWaitList events = EventWaitList(), cl_int *err = nullptr)
 {
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS) {
-        return detail::errHandler(error, __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    Event event;
+    cl_int error = CL_SUCCESS;
+    if (startIterator != endIterator) {
+        error = detail::copyAsync(
+            queue, buffer, startIterator, endIterator, events, &event,
+            std::integral_constant<bool, detail::IsContiguousIterator<IteratorType>::value>());
     }
-
-    return detail::errHandler(queue.enqueueUnmapSVM(container, events, event),
-        __ENQUEUE_UNMAP_MEM_OBJECT_ERR);
+    if (err != nullptr) {
+        *err = error;
+    }
+    return event;
 }
 
-#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
-
-inline cl_int enqueueCopyBuffer(
-        const Buffer& src,
-        const Buffer& dst,
-        size_type src_offset,
-        size_type dst_offset,
-        size_type size,
-        const vector<Event>* events = nullptr,
-        Event* event = nullptr)
+/**
+ * Non-blocking copy operation between iterators and a buffer.
+ * Host to Device.
+ * Uses default command queue.
+ */
+template< typename IteratorType >
+inline Event copyAsync(
+    IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer,
+    EventWaitList events = EventWaitList(), cl_int *err = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
     if (error != CL_SUCCESS) {
-        return error;
+        if (err != nullptr) {
+            *err = error;
+        }
+        return Event();
     }
 
-    return queue.enqueueCopyBuffer(src, dst, src_offset, dst_offset, size, events, event);
+    return cl::copyAsync(queue, startIterator, endIterator, buffer, events, err);
 }
 
 /**
- * Blocking copy operation between iterators and a buffer.
- * Host to Device.
+ * Non-blocking copy operation between iterators and a buffer.
+ * Device to Host.
  * Uses default command queue.
  */
 template< typename IteratorType >
-inline cl_int copy( IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer )
+inline Event copyAsync(
+    const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator,
+    EventWaitList events = EventWaitList(), cl_int *err = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS)
-        return error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+    if (error != CL_SUCCESS) {
+        if (err != nullptr) {
+            *err = error;
+        }
+        return Event();
+    }
 
-    return cl::copy(queue, startIterator, endIterator, buffer);
+    return cl::copyAsync(queue, buffer, startIterator, endIterator, events, err);
 }
 
 /**
  * Blocking copy operation between iterators and a buffer.
- * Device to Host.
- * Uses default command queue.
+ * Host to Device.
+ * Pipelined through the staging buffers of ring: the range is copied
+ * into one staging buffer while the previous one is being transferred.
+ * Returns once the writes of all chunks have completed.
  */
 template< typename IteratorType >
-inline cl_int copy( const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator )
+inline cl_int copy( StagingRing &ring, IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer )
 {
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
-    if (error != CL_SUCCESS)
+    Event endEvent;
+    cl_int error = ring.write(buffer, 0, startIterator, endIterator, EventWaitList(), &endEvent);
+    // if exceptions enabled, write will throw
+    if( error != CL_SUCCESS ) {
         return error;
-
-    return cl::copy(queue, buffer, startIterator, endIterator);
+    }
+    if( endEvent() != nullptr ) {
+        return endEvent.wait();
+    }
+    return CL_SUCCESS;
 }
 
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+namespace detail {
+
+template< class Alloc >
+struct IsSVMAllocator : std::false_type {};
+
+template< typename T, class SVMTrait >
+struct IsSVMAllocator<SVMAllocator<T, SVMTrait>> : std::true_type {};
+
+template< typename T, class SVMTrait >
+struct IsSVMAllocator<PooledSVMAllocator<T, SVMTrait>> : std::true_type {};
+
+} // namespace detail
+
 /**
- * Blocking copy operation between iterators and a buffer.
+ * Blocking copy operation between iterators and an SVM container.
  * Host to Device.
- * Uses specified queue.
+ * The container is mapped with enqueueMapSVM for the duration of the copy
+ * and must hold at least as many elements as the range.
  */
-template< typename IteratorType >
-inline cl_int copy( const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator, cl::Buffer &buffer )
+template< typename IteratorType, typename T, class Alloc >
+inline typename std::enable_if<detail::IsSVMAllocator<Alloc>::value, cl_int>::type
+copy( const CommandQueue &queue, IteratorType startIterator, IteratorType endIterator, cl::vector<T, Alloc> &container )
 {
-    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
-    cl_int error;
-    
     size_type length = endIterator-startIterator;
-    size_type byteLength = length*sizeof(DataType);
+    if( length > container.size() ) {
+        return detail::errHandler(CL_INVALID_VALUE, __ENQUEUE_MAP_BUFFER_ERR);
+    }
 
-    DataType *pointer = 
-        static_cast<DataType*>(queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_WRITE, 0, byteLength, 0, 0, &error));
-    // if exceptions enabled, enqueueMapBuffer will throw
+    cl_int error = queue.enqueueMapSVM(container.data(), CL_TRUE, CL_MAP_WRITE, length*sizeof(T));
+    // if exceptions enabled, enqueueMapSVM will throw
     if( error != CL_SUCCESS ) {
         return error;
     }
-#if defined(_MSC_VER)
-    std::copy(
-        startIterator, 
-        endIterator, 
-        stdext::checked_array_iterator<DataType*>(
-            pointer, length));
-#else
-    std::copy(startIterator, endIterator, pointer);
-#endif
+    detail::HostCopy::copy(startIterator, length, container.data());
     Event endEvent;
-    error = queue.enqueueUnmapMemObject(buffer, pointer, 0, &endEvent);
-    // if exceptions enabled, enqueueUnmapMemObject will throw
-    if( error != CL_SUCCESS ) { 
+    error = queue.enqueueUnmapSVM(container.data(), EventWaitList(), &endEvent);
+    // if exceptions enabled, enqueueUnmapSVM will throw
+    if( error != CL_SUCCESS ) {
         return error;
     }
-    endEvent.wait();
-    return CL_SUCCESS;
+    return endEvent.wait();
 }
 
 /**
- * Blocking copy operation between iterators and a buffer.
+ * Blocking copy operation between iterators and an SVM container.
  * Device to Host.
- * Uses specified queue.
+ * The container is mapped with enqueueMapSVM for the duration of the copy
+ * and must hold at least as many elements as the range.
  */
-template< typename IteratorType >
-inline cl_int copy( const CommandQueue &queue, const cl::Buffer &buffer, IteratorType startIterator, IteratorType endIterator )
+template< typename IteratorType, typename T, class Alloc >
+inline typename std::enable_if<detail::IsSVMAllocator<Alloc>::value, cl_int>::type
+copy( const CommandQueue &queue, cl::vector<T, Alloc> &container, IteratorType startIterator, IteratorType endIterator )
 {
-    typedef typename std::iterator_traits<IteratorType>::value_type DataType;
-    cl_int error;
-        
     size_type length = endIterator-startIterator;
-    size_type byteLength = length*sizeof(DataType);
+    if( length > container.size() ) {
+        return detail::errHandler(CL_INVALID_VALUE, __ENQUEUE_MAP_BUFFER_ERR);
+    }
 
-    DataType *pointer = 
-        static_cast<DataType*>(queue.enqueueMapBuffer(buffer, CL_TRUE, CL_MAP_READ, 0, byteLength, 0, 0, &error));
-    // if exceptions enabled, enqueueMapBuffer will throw
+    cl_int error = queue.enqueueMapSVM(container.data(), CL_TRUE, CL_MAP_READ, length*sizeof(T));
+    // if exceptions enabled, enqueueMapSVM will throw
     if( error != CL_SUCCESS ) {
         return error;
     }
-    std::copy(pointer, pointer + length, startIterator);
+    detail::HostCopy::copy(container.data(), length, startIterator);
     Event endEvent;
-    error = queue.enqueueUnmapMemObject(buffer, pointer, 0, &endEvent);
-    // if exceptions enabled, enqueueUnmapMemObject will throw
-    if( error != CL_SUCCESS ) { 
+    error = queue.enqueueUnmapSVM(container.data(), EventWaitList(), &endEvent);
+    // if exceptions enabled, enqueueUnmapSVM will throw
+    if( error != CL_SUCCESS ) {
         return error;
     }
-    endEvent.wait();
-    return CL_SUCCESS;
+    return endEvent.wait();
 }
-
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
 /**
@@ -9669,11 +15562,11 @@ inline cl_int enqueueReadBufferRect(
     size_type host_row_pitch,
     size_type host_slice_pitch,
     void *ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9694,6 +15587,25 @@ inline cl_int enqueueReadBufferRect(
         event);
 }
 
+inline cl_int enqueueReadBufferRect(
+    const Buffer& buffer,
+    cl_bool blocking,
+    const array<size_type, 3>& buffer_offset,
+    const array<size_type, 3>& host_offset,
+    const array<size_type, 3>& region,
+    size_type buffer_row_pitch,
+    size_type buffer_slice_pitch,
+    size_type host_row_pitch,
+    size_type host_slice_pitch,
+    void *ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueReadBufferRect(
+        buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch, buffer_slice_pitch,
+        host_row_pitch, host_slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueReadBufferRect(
     const Buffer& buffer, 
     cl_bool blocking,
@@ -9705,7 +15617,7 @@ inline cl_int enqueueReadBufferRect(
     size_type host_row_pitch,
     size_type host_slice_pitch,
     void* ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueReadBufferRect(
@@ -9723,6 +15635,25 @@ inline cl_int enqueueReadBufferRect(
         event);
 }
 
+inline cl_int enqueueReadBufferRect(
+    const Buffer& buffer, 
+    cl_bool blocking,
+    const array<size_type, 2>& buffer_offset,
+    const array<size_type, 2>& host_offset, 
+    const array<size_type, 2>& region,
+    size_type buffer_row_pitch,
+    size_type buffer_slice_pitch,
+    size_type host_row_pitch,
+    size_type host_slice_pitch,
+    void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueReadBufferRect(
+        buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch, buffer_slice_pitch,
+        host_row_pitch, host_slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueWriteBufferRect(
     const Buffer& buffer,
     cl_bool blocking,
@@ -9734,11 +15665,11 @@ inline cl_int enqueueWriteBufferRect(
     size_type host_row_pitch,
     size_type host_slice_pitch,
     const void *ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9759,6 +15690,25 @@ inline cl_int enqueueWriteBufferRect(
         event);
 }
 
+inline cl_int enqueueWriteBufferRect(
+    const Buffer& buffer,
+    cl_bool blocking,
+    const array<size_type, 3>& buffer_offset,
+    const array<size_type, 3>& host_offset,
+    const array<size_type, 3>& region,
+    size_type buffer_row_pitch,
+    size_type buffer_slice_pitch,
+    size_type host_row_pitch,
+    size_type host_slice_pitch,
+    const void *ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueWriteBufferRect(
+        buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch, buffer_slice_pitch,
+        host_row_pitch, host_slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueWriteBufferRect(
     const Buffer& buffer,
     cl_bool blocking,
@@ -9770,7 +15720,7 @@ inline cl_int enqueueWriteBufferRect(
     size_type host_row_pitch,
     size_type host_slice_pitch,
     const void* ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueWriteBufferRect(
@@ -9788,6 +15738,25 @@ inline cl_int enqueueWriteBufferRect(
         event);
 }
 
+inline cl_int enqueueWriteBufferRect(
+    const Buffer& buffer,
+    cl_bool blocking,
+    const array<size_type, 2>& buffer_offset,
+    const array<size_type, 2>& host_offset,
+    const array<size_type, 2>& region,
+    size_type buffer_row_pitch,
+    size_type buffer_slice_pitch,
+    size_type host_row_pitch,
+    size_type host_slice_pitch,
+    const void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueWriteBufferRect(
+        buffer, blocking, buffer_offset, host_offset, region, buffer_row_pitch, buffer_slice_pitch,
+        host_row_pitch, host_slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyBufferRect(
     const Buffer& src,
     const Buffer& dst,
@@ -9798,11 +15767,11 @@ inline cl_int enqueueCopyBufferRect(
     size_type src_slice_pitch,
     size_type dst_row_pitch,
     size_type dst_slice_pitch,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9822,6 +15791,24 @@ inline cl_int enqueueCopyBufferRect(
         event);
 }
 
+inline cl_int enqueueCopyBufferRect(
+    const Buffer& src,
+    const Buffer& dst,
+    const array<size_type, 3>& src_origin,
+    const array<size_type, 3>& dst_origin,
+    const array<size_type, 3>& region,
+    size_type src_row_pitch,
+    size_type src_slice_pitch,
+    size_type dst_row_pitch,
+    size_type dst_slice_pitch,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyBufferRect(
+        src, dst, src_origin, dst_origin, region, src_row_pitch, src_slice_pitch, dst_row_pitch,
+        dst_slice_pitch, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyBufferRect(
     const Buffer& src,
     const Buffer& dst,
@@ -9832,7 +15819,7 @@ inline cl_int enqueueCopyBufferRect(
     size_type src_slice_pitch,
     size_type dst_row_pitch,
     size_type dst_slice_pitch,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueCopyBufferRect(
@@ -9848,6 +15835,24 @@ inline cl_int enqueueCopyBufferRect(
         events,
         event);
 }
+
+inline cl_int enqueueCopyBufferRect(
+    const Buffer& src,
+    const Buffer& dst,
+    const array<size_type, 2>& src_origin,
+    const array<size_type, 2>& dst_origin,
+    const array<size_type, 2>& region,
+    size_type src_row_pitch,
+    size_type src_slice_pitch,
+    size_type dst_row_pitch,
+    size_type dst_slice_pitch,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyBufferRect(
+        src, dst, src_origin, dst_origin, region, src_row_pitch, src_slice_pitch, dst_row_pitch,
+        dst_slice_pitch, EventWaitList(events), event);
+}
 #endif // CL_HPP_TARGET_OPENCL_VERSION >= 110
 
 inline cl_int enqueueReadImage(
@@ -9858,11 +15863,11 @@ inline cl_int enqueueReadImage(
     size_type row_pitch,
     size_type slice_pitch,
     void* ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr) 
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9880,6 +15885,21 @@ inline cl_int enqueueReadImage(
         event);
 }
 
+inline cl_int enqueueReadImage(
+    const Image& image,
+    cl_bool blocking,
+    const array<size_type, 3>& origin,
+    const array<size_type, 3>& region,
+    size_type row_pitch,
+    size_type slice_pitch,
+    void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueReadImage(
+        image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueReadImage(
     const Image& image, 
     cl_bool blocking,
@@ -9888,7 +15908,7 @@ inline cl_int enqueueReadImage(
     size_type row_pitch,
     size_type slice_pitch,
     void* ptr, 
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueReadImage(
@@ -9903,6 +15923,21 @@ inline cl_int enqueueReadImage(
         event);
 }
 
+inline cl_int enqueueReadImage(
+    const Image& image, 
+    cl_bool blocking,
+    const array<size_type, 2>& origin,
+    const array<size_type, 2>& region,
+    size_type row_pitch,
+    size_type slice_pitch,
+    void* ptr, 
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueReadImage(
+        image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueWriteImage(
     const Image& image,
     cl_bool blocking,
@@ -9911,11 +15946,11 @@ inline cl_int enqueueWriteImage(
     size_type row_pitch,
     size_type slice_pitch,
     const void* ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9933,6 +15968,21 @@ inline cl_int enqueueWriteImage(
         event);
 }
 
+inline cl_int enqueueWriteImage(
+    const Image& image,
+    cl_bool blocking,
+    const array<size_type, 3>& origin,
+    const array<size_type, 3>& region,
+    size_type row_pitch,
+    size_type slice_pitch,
+    const void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueWriteImage(
+        image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueWriteImage(
     const Image& image, 
     cl_bool blocking,
@@ -9941,7 +15991,7 @@ inline cl_int enqueueWriteImage(
     size_type row_pitch, 
     size_type slice_pitch,
     const void* ptr,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueWriteImage(
@@ -9956,17 +16006,32 @@ inline cl_int enqueueWriteImage(
         event);    
 }
 
+inline cl_int enqueueWriteImage(
+    const Image& image, 
+    cl_bool blocking,
+    const array<size_type, 2>& origin,
+    const array<size_type, 2>& region,
+    size_type row_pitch, 
+    size_type slice_pitch,
+    const void* ptr,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueWriteImage(
+        image, blocking, origin, region, row_pitch, slice_pitch, ptr, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyImage(
     const Image& src,
     const Image& dst,
     const array<size_type, 3>& src_origin,
     const array<size_type, 3>& dst_origin,
     const array<size_type, 3>& region,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -9982,13 +16047,25 @@ inline cl_int enqueueCopyImage(
         event);
 }
 
+inline cl_int enqueueCopyImage(
+    const Image& src,
+    const Image& dst,
+    const array<size_type, 3>& src_origin,
+    const array<size_type, 3>& dst_origin,
+    const array<size_type, 3>& region,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyImage(src, dst, src_origin, dst_origin, region, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyImage(
     const Image& src, 
     const Image& dst,
     const array<size_type, 2>& src_origin,
     const array<size_type, 2>& dst_origin,
     const array<size_type, 2>& region,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueCopyImage(
@@ -10001,17 +16078,29 @@ inline cl_int enqueueCopyImage(
         event);
 }
 
+inline cl_int enqueueCopyImage(
+    const Image& src, 
+    const Image& dst,
+    const array<size_type, 2>& src_origin,
+    const array<size_type, 2>& dst_origin,
+    const array<size_type, 2>& region,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyImage(src, dst, src_origin, dst_origin, region, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyImageToBuffer(
     const Image& src,
     const Buffer& dst,
     const array<size_type, 3>& src_origin,
     const array<size_type, 3>& region,
     size_type dst_offset,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
 
     if (error != CL_SUCCESS) {
         return error;
@@ -10027,13 +16116,26 @@ inline cl_int enqueueCopyImageToBuffer(
         event);
 }
 
+inline cl_int enqueueCopyImageToBuffer(
+    const Image& src,
+    const Buffer& dst,
+    const array<size_type, 3>& src_origin,
+    const array<size_type, 3>& region,
+    size_type dst_offset,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyImageToBuffer(
+        src, dst, src_origin, region, dst_offset, EventWaitList(events), event);
+}
+
 inline cl_int enqueueCopyImageToBuffer(
     const Image& src, 
     const Buffer& dst,
     const array<size_type, 2>& src_origin,
     const array<size_type, 2>& region,
     size_type dst_offset,
-    const vector<Event>* events = nullptr,
+    EventWaitList events,
     Event* event = nullptr)
 {
     return enqueueCopyImageToBuffer(
@@ -10046,6 +16148,45 @@ inline cl_int enqueueCopyImageToBuffer(
         event);
 }
 
+inline cl_int enqueueCopyImageToBuffer(
+    const Image& src, 
+    const Buffer& dst,
+    const array<size_type, 2>& src_origin,
+    const array<size_type, 2>& region,
+    size_type dst_offset,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyImageToBuffer(
+        src, dst, src_origin, region, dst_offset, EventWaitList(events), event);
+}
+
+inline cl_int enqueueCopyBufferToImage(
+    const Buffer& src,
+    const Image& dst,
+    size_type src_offset,
+    const array<size_type, 3>& dst_origin,
+    const array<size_type, 3>& region,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+
+    if (error != CL_SUCCESS) {
+        return error;
+    }
+
+    return queue.enqueueCopyBufferToImage(
+        src,
+        dst,
+        src_offset,
+        dst_origin,
+        region,
+        events,
+        event);
+}
+
 inline cl_int enqueueCopyBufferToImage(
     const Buffer& src,
     const Image& dst,
@@ -10054,90 +16195,414 @@ inline cl_int enqueueCopyBufferToImage(
     const array<size_type, 3>& region,
     const vector<Event>* events = nullptr,
     Event* event = nullptr)
+{
+    return enqueueCopyBufferToImage(
+        src, dst, src_offset, dst_origin, region, EventWaitList(events), event);
+}
+
+inline cl_int enqueueCopyBufferToImage(
+    const Buffer& src,
+    const Image& dst,
+    size_type src_offset,
+    const array<size_type, 2>& dst_origin,
+    const array<size_type, 2>& region,
+    EventWaitList events,
+    Event* event = nullptr)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+
+    if (error != CL_SUCCESS) {
+        return error;
+    }
+
+    return queue.enqueueCopyBufferToImage(
+        src,
+        dst,
+        src_offset,
+        dst_origin,
+        region,
+        events,
+        event);
+}
+
+inline cl_int enqueueCopyBufferToImage(
+    const Buffer& src,
+    const Image& dst,
+    size_type src_offset,
+    const array<size_type, 2>& dst_origin,
+    const array<size_type, 2>& region,
+    const vector<Event>* events = nullptr,
+    Event* event = nullptr)
+{
+    return enqueueCopyBufferToImage(
+        src, dst, src_offset, dst_origin, region, EventWaitList(events), event);
+}
+
+inline cl_int flush(void)
+{
+    cl_int error;
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+
+    if (error != CL_SUCCESS) {
+        return error;
+    }
+
+    return queue.flush();
+}
+
+inline cl_int finish(void)
 {
     cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    const CommandQueue& queue = detail::getImplicitQueue(&error);
+
+    if (error != CL_SUCCESS) {
+        return error;
+    } 
+
+
+    return queue.finish();
+}
+
+//! \brief How a command accesses a memory object.
+enum class MemoryAccessMode
+{
+    Read,
+    Write,
+    ReadWrite
+};
+
+//! \brief A memory object handle together with how a command accesses it.
+struct MemoryDependency
+{
+    cl_mem memory;
+    MemoryAccessMode mode;
+};
+
+/*! \brief A memory object annotated with how a kernel accesses it.
+ *
+ *  Use it through ReadAccess, WriteAccess and ReadWriteAccess as KernelFunctor
+ *  argument types. It is set as a kernel argument exactly like the memory
+ *  object itself, and lets the functor derive the wait list of each launch
+ *  from a DependencyTracker.
+ */
+template <typename T, MemoryAccessMode Mode>
+class MemoryAccess : public T
+{
+    static_assert(std::is_base_of<Memory, T>::value,
+        "Only memory objects can be annotated with an access mode");
+
+public:
+    MemoryAccess() { }
+
+    MemoryAccess(const T& memory) : T(memory) { }
+
+    static constexpr MemoryAccessMode mode() { return Mode; }
+
+    operator MemoryDependency() const
+    {
+        return MemoryDependency{ (*this)(), Mode };
+    }
+};
+
+template <typename T>
+using ReadAccess = MemoryAccess<T, MemoryAccessMode::Read>;
+
+template <typename T>
+using WriteAccess = MemoryAccess<T, MemoryAccessMode::Write>;
+
+template <typename T>
+using ReadWriteAccess = MemoryAccess<T, MemoryAccessMode::ReadWrite>;
+
+namespace detail {
+
+template <typename T>
+inline void addMemoryDependency(MemoryDependency*, size_type&, const T&) { }
+
+template <typename T, MemoryAccessMode Mode>
+inline void addMemoryDependency(
+    MemoryDependency* dependencies,
+    size_type& count,
+    const MemoryAccess<T, Mode>& access)
+{
+    dependencies[count++] = access;
+}
+
+} // namespace detail
+
+/*! \class DependencyTracker
+ * \brief Orders commands by the memory objects they read and write.
+ *
+ * For every memory object the tracker remembers the event of the last
+ * command that wrote it and the events of the commands that read it since.
+ * A command that reads an object waits for its last writer, and a command
+ * that writes an object also waits for its readers. Commands that only read
+ * the same objects do not wait for each other.
+ *
+ * Objects are tracked by handle, so sub-buffers and buffers sharing host
+ * memory are not known to alias. Call forget() before releasing an object
+ * whose handle may be reused by a later allocation.
+ *
+ * Objects whose recorded commands have all completed are dropped once the
+ * number of tracked objects doubles, so the tracker does not grow with the
+ * number of objects it has ever seen.
+ */
+class DependencyTracker
+{
+private:
+    struct State
+    {
+        Event writer_;
+        vector<Event> readers_;
+    };
+
+    // Readers are only checked for completion once this many accumulate
+    static const size_type readerPruneThreshold_ = 16;
+    // Completed objects are only dropped once at least this many are tracked
+    static const size_type minPruneThreshold_ = 64;
+
+    std::mutex mutex_;
+    std::map<cl_mem, State> states_;
+    size_type pruneThreshold_;
+
+    static DependencyTracker default_;
+
+    static void addWait(vector<Event>& waits, const Event& event)
+    {
+        if (event() == nullptr) {
+            return;
+        }
+        for (const Event& e : waits) {
+            if (e() == event()) {
+                return;
+            }
+        }
+        waits.push_back(event);
+    }
+
+    static bool isComplete(const Event& event)
+    {
+        cl_int status;
+        return event.getInfo(CL_EVENT_COMMAND_EXECUTION_STATUS, &status) == CL_SUCCESS &&
+            status == CL_COMPLETE;
+    }
 
-    if (error != CL_SUCCESS) {
-        return error;
+    static void pruneReaders(vector<Event>& readers)
+    {
+        readers.erase(
+            std::remove_if(readers.begin(), readers.end(), isComplete),
+            readers.end());
     }
 
-    return queue.enqueueCopyBufferToImage(
-        src,
-        dst,
-        src_offset,
-        dst_origin,
-        region,
-        events,
-        event);
-}
+    void pruneStates()
+    {
+        for (std::map<cl_mem, State>::iterator it = states_.begin(); it != states_.end();) {
+            State& state = it->second;
+            if (state.writer_() != nullptr && !isComplete(state.writer_)) {
+                ++it;
+                continue;
+            }
+            pruneReaders(state.readers_);
+            if (state.readers_.empty()) {
+                it = states_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        pruneThreshold_ = 2 * states_.size();
+        if (pruneThreshold_ < minPruneThreshold_) {
+            pruneThreshold_ = minPruneThreshold_;
+        }
+    }
 
-inline cl_int enqueueCopyBufferToImage(
-    const Buffer& src,
-    const Image& dst,
-    size_type src_offset,
-    const array<size_type, 2>& dst_origin,
-    const array<size_type, 2>& region,
-    const vector<Event>* events = nullptr,
-    Event* event = nullptr)
-{
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+public:
+    DependencyTracker() : pruneThreshold_(minPruneThreshold_) { }
 
-    if (error != CL_SUCCESS) {
-        return error;
+    DependencyTracker(const DependencyTracker&) = delete;
+    DependencyTracker& operator = (const DependencyTracker&) = delete;
+
+    //! \brief Returns the tracker KernelFunctor uses unless told otherwise.
+    static DependencyTracker& getDefault()
+    {
+        return default_;
     }
 
-    return enqueueCopyBufferToImage(
-        src,
-        dst,
-        src_offset,
-        { dst_origin[0], dst_origin[1], 0 },
-        { region[0], region[1], 1 },
-        events,
-        event);
-}
+    /*! \brief Runs a command after the commands it depends on.
+     *
+     *  \param dependencies The memory objects the command accesses.
+     *  \param count Number of entries in dependencies.
+     *  \param waitList Events to wait for in addition to the inferred ones.
+     *  \param command Callable taking (EventWaitList, Event*) that enqueues
+     *  the command and returns its error code. It must return an event.
+     *  \param event Receives the event of the command if not null.
+     *
+     *  The tracker is locked while command runs, so commands tracked by the
+     *  same tracker are enqueued in the order they are recorded.
+     */
+    template <typename Command>
+    cl_int track(
+        const MemoryDependency* dependencies,
+        size_type count,
+        EventWaitList waitList,
+        Command command,
+        Event* event = nullptr)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
 
-inline cl_int flush(void)
-{
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+        vector<Event> waits(waitList.data(), waitList.data() + waitList.size());
+        for (size_type i = 0; i < count; ++i) {
+            State& state = states_[dependencies[i].memory];
+            addWait(waits, state.writer_);
+            if (dependencies[i].mode != MemoryAccessMode::Read) {
+                for (const Event& reader : state.readers_) {
+                    addWait(waits, reader);
+                }
+            }
+        }
 
-    if (error != CL_SUCCESS) {
-        return error;
+        Event tmp;
+        cl_int err = command(EventWaitList(&waits), &tmp);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+
+        for (size_type i = 0; i < count; ++i) {
+            State& state = states_[dependencies[i].memory];
+            if (dependencies[i].mode == MemoryAccessMode::Read) {
+                if (state.readers_.size() >= readerPruneThreshold_) {
+                    pruneReaders(state.readers_);
+                }
+                addWait(state.readers_, tmp);
+            }
+            else {
+                state.writer_ = tmp;
+                state.readers_.clear();
+            }
+        }
+        if (states_.size() >= pruneThreshold_) {
+            pruneStates();
+        }
+
+        if (event != nullptr) {
+            *event = std::move(tmp);
+        }
+        return CL_SUCCESS;
     }
 
-    return queue.flush();
-}
+    /*! \brief Runs a command after the commands it depends on.
+     *
+     *  For example, to track a copy between two buffers:
+     *  \code
+     *  tracker.track(
+     *      { cl::ReadAccess<cl::Buffer>(src), cl::WriteAccess<cl::Buffer>(dst) },
+     *      [&](cl::EventWaitList waits, cl::Event* event) {
+     *          return queue.enqueueCopyBuffer(src, dst, 0, 0, size, waits, event);
+     *      });
+     *  \endcode
+     */
+    template <typename Command>
+    cl_int track(
+        std::initializer_list<MemoryDependency> dependencies,
+        Command command,
+        Event* event = nullptr)
+    {
+        return track(
+            dependencies.begin(), dependencies.size(), EventWaitList(),
+            command, event);
+    }
 
-inline cl_int finish(void)
-{
-    cl_int error;
-    CommandQueue queue = CommandQueue::getDefault(&error);
+    //! \brief Returns the number of memory objects currently tracked.
+    size_type size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return states_.size();
+    }
 
-    if (error != CL_SUCCESS) {
-        return error;
-    } 
+    //! \brief Stops tracking a memory object.
+    void forget(const Memory& memory)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_.erase(memory());
+    }
 
+    //! \brief Stops tracking all memory objects.
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        states_.clear();
+    }
+};
 
-    return queue.finish();
-}
+CL_HPP_DEFINE_STATIC_MEMBER_ DependencyTracker DependencyTracker::default_;
 
+/*! \brief Launch parameters of a KernelFunctor.
+ *
+ *  Wait lists given as a vector<Event> are copied. Wait lists given as an
+ *  EventWaitList are not, so their events must outlive the EnqueueArgs.
+ */
 class EnqueueArgs
 {
 private:
+    // Set when no queue is given, avoids holding a reference to the
+    // process-wide default queue for every launch
+    const CommandQueue* implicitQueue_;
     CommandQueue queue_;
     const NDRange offset_;
     const NDRange global_;
     const NDRange local_;
+    // At most one of these holds the wait list
+    Event event_;
     vector<Event> events_;
+    EventWaitList waitList_;
 
     template<typename... Ts>
     friend class KernelFunctor;
 
+    template<typename... Ts>
+    friend class KernelLaunchCache;
+
+    const CommandQueue& queue() const
+    {
+        return implicitQueue_ != nullptr ? *implicitQueue_ : queue_;
+    }
+
+    // The process-wide default queue lives until exit and is only pointed
+    // to. The queue of a thread is released when that thread exits and is
+    // copied instead, so the EnqueueArgs can be used from any thread.
+    static const CommandQueue* sharedImplicitQueue()
+    {
+#if defined(CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE)
+        return nullptr;
+#else
+        return &CommandQueue::getDefaultRef();
+#endif
+    }
+
+    static CommandQueue ownedImplicitQueue()
+    {
+#if defined(CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE)
+        return CommandQueue::getThreadDefault();
+#else
+        return CommandQueue();
+#endif
+    }
+
+    EventWaitList waitList() const
+    {
+        if (!waitList_.empty()) {
+            return waitList_;
+        }
+        if (event_() != nullptr) {
+            return EventWaitList(event_);
+        }
+        return EventWaitList(&events_);
+    }
+
 public:
     EnqueueArgs(NDRange global) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
       local_(NullRange)
@@ -10146,7 +16611,8 @@ public:
     }
 
     EnqueueArgs(NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
       local_(local)
@@ -10155,7 +16621,8 @@ public:
     }
 
     EnqueueArgs(NDRange offset, NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(offset), 
       global_(global),
       local_(local)
@@ -10164,34 +16631,41 @@ public:
     }
 
     EnqueueArgs(Event e, NDRange global) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
-      local_(NullRange)
+      local_(NullRange),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(Event e, NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
-      local_(local)
+      local_(local),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(Event e, NDRange offset, NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(offset), 
       global_(global),
-      local_(local)
+      local_(local),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(const vector<Event> &events, NDRange global) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
       local_(NullRange),
@@ -10200,8 +16674,20 @@ public:
 
     }
 
+    EnqueueArgs(EventWaitList events, NDRange global) : 
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
+      offset_(NullRange), 
+      global_(global),
+      local_(NullRange),
+      waitList_(events)
+    {
+
+    }
+
     EnqueueArgs(const vector<Event> &events, NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(NullRange), 
       global_(global),
       local_(local),
@@ -10210,8 +16696,20 @@ public:
 
     }
 
+    EnqueueArgs(EventWaitList events, NDRange global, NDRange local) : 
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
+      offset_(NullRange), 
+      global_(global),
+      local_(local),
+      waitList_(events)
+    {
+
+    }
+
     EnqueueArgs(const vector<Event> &events, NDRange offset, NDRange global, NDRange local) : 
-      queue_(CommandQueue::getDefault()),
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
       offset_(offset), 
       global_(global),
       local_(local),
@@ -10220,7 +16718,19 @@ public:
 
     }
 
+    EnqueueArgs(EventWaitList events, NDRange offset, NDRange global, NDRange local) : 
+      implicitQueue_(sharedImplicitQueue()),
+      queue_(ownedImplicitQueue()),
+      offset_(offset), 
+      global_(global),
+      local_(local),
+      waitList_(events)
+    {
+
+    }
+
     EnqueueArgs(CommandQueue &queue, NDRange global) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
@@ -10230,6 +16740,7 @@ public:
     }
 
     EnqueueArgs(CommandQueue &queue, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
@@ -10239,6 +16750,7 @@ public:
     }
 
     EnqueueArgs(CommandQueue &queue, NDRange offset, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(offset), 
       global_(global),
@@ -10248,33 +16760,40 @@ public:
     }
 
     EnqueueArgs(CommandQueue &queue, Event e, NDRange global) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
-      local_(NullRange)
+      local_(NullRange),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(CommandQueue &queue, Event e, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
-      local_(local)
+      local_(local),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(CommandQueue &queue, Event e, NDRange offset, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(offset), 
       global_(global),
-      local_(local)
+      local_(local),
+      event_(std::move(e))
     {
-        events_.push_back(e);
+
     }
 
     EnqueueArgs(CommandQueue &queue, const vector<Event> &events, NDRange global) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
@@ -10284,7 +16803,19 @@ public:
 
     }
 
+    EnqueueArgs(CommandQueue &queue, EventWaitList events, NDRange global) : 
+      implicitQueue_(nullptr),
+      queue_(queue),
+      offset_(NullRange), 
+      global_(global),
+      local_(NullRange),
+      waitList_(events)
+    {
+
+    }
+
     EnqueueArgs(CommandQueue &queue, const vector<Event> &events, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(NullRange), 
       global_(global),
@@ -10294,7 +16825,19 @@ public:
 
     }
 
+    EnqueueArgs(CommandQueue &queue, EventWaitList events, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
+      queue_(queue),
+      offset_(NullRange), 
+      global_(global),
+      local_(local),
+      waitList_(events)
+    {
+
+    }
+
     EnqueueArgs(CommandQueue &queue, const vector<Event> &events, NDRange offset, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
       queue_(queue),
       offset_(offset), 
       global_(global),
@@ -10303,22 +16846,46 @@ public:
     {
 
     }
+
+    EnqueueArgs(CommandQueue &queue, EventWaitList events, NDRange offset, NDRange global, NDRange local) : 
+      implicitQueue_(nullptr),
+      queue_(queue),
+      offset_(offset), 
+      global_(global),
+      local_(local),
+      waitList_(events)
+    {
+
+    }
 };
 
 
 //----------------------------------------------------------------------------------------------
 
 
-/**
- * Type safe kernel functor.
- * 
+namespace detail {
+
+/*! \brief Kernel argument setting and launch operators shared by the type
+ *         safe kernel functors.
+ *
+ *  Derived provides launch(args, event, ts...), which returns the error code.
  */
-template<typename... Ts>
-class KernelFunctor
+template<typename Derived, typename... Ts>
+class KernelLauncher
 {
-private:
+protected:
     Kernel kernel_;
 
+    KernelLauncher(const Kernel& kernel) : kernel_(kernel)
+    {}
+
+    KernelLauncher(
+        const Program& program,
+        const string name,
+        cl_int * err) :
+        kernel_(program, name.c_str(), err)
+    {}
+
     template<int index, typename T0, typename... T1s>
     void setArgs(T0&& t0, T1s&&... t1s)
     {
@@ -10332,72 +16899,140 @@ private:
         kernel_.setArg(index, t0);
     }
 
-    template<int index>
-    void setArgs()
-    {
+    template<int index>
+    void setArgs()
+    {
+    }
+
+public:
+    //! \brief Return type of the functor
+    typedef Event result_type;
+
+    /**
+     * Enqueue kernel.
+     * @param args Launch parameters of the kernel.
+     * @param t0... List of kernel arguments based on the template type of the functor.
+     */
+    Event operator() (
+        const EnqueueArgs& args,
+        Ts... ts)
+    {
+        Event event;
+        static_cast<Derived*>(this)->launch(args, &event, std::forward<Ts>(ts)...);
+
+        return event;
+    }
+
+    /**
+    * Enqueue kernel with support for error code.
+    * @param args Launch parameters of the kernel.
+    * @param t0... List of kernel arguments based on the template type of the functor.
+    * @param error Out parameter returning the error code from the execution.
+    */
+    Event operator() (
+        const EnqueueArgs& args,
+        Ts... ts,
+        cl_int &error)
+    {
+        Event event;
+        error = static_cast<Derived*>(this)->launch(args, &event, std::forward<Ts>(ts)...);
+
+        return event;
+    }
+
+    /**
+     * Enqueue kernel without creating an event for it.
+     * Cheaper than operator() when the caller does not need the event.
+     * @param args Launch parameters of the kernel.
+     * @param t0... List of kernel arguments based on the template type of the functor.
+     * @return The error code from the execution.
+     */
+    cl_int enqueue(
+        const EnqueueArgs& args,
+        Ts... ts)
+    {
+        return static_cast<Derived*>(this)->launch(args, nullptr, std::forward<Ts>(ts)...);
+    }
+
+    Kernel getKernel()
+    {
+        return kernel_;
+    }
+};
+
+} // namespace detail
+
+/**
+ * Type safe kernel functor.
+ *
+ * Memory object arguments declared as ReadAccess, WriteAccess or
+ * ReadWriteAccess make each launch wait for the commands it conflicts with,
+ * as recorded by the functor's DependencyTracker. Such launches always
+ * create an event, even through enqueue().
+ */
+template<typename... Ts>
+class KernelFunctor : public detail::KernelLauncher<KernelFunctor<Ts...>, Ts...>
+{
+private:
+    typedef detail::KernelLauncher<KernelFunctor<Ts...>, Ts...> Launcher;
+    friend Launcher;
+
+    using Launcher::kernel_;
+    DependencyTracker* tracker_ = &DependencyTracker::getDefault();
+
+    cl_int launch(const EnqueueArgs& args, Event* event, Ts&&... ts)
+    {
+        // Arguments annotated with an access mode, plus one to avoid an empty array
+        MemoryDependency dependencies[sizeof...(Ts) + 1];
+        size_type count = 0;
+        int expand[] = { 0, (detail::addMemoryDependency(dependencies, count, ts), 0)... };
+        (void)expand;
+
+        this->template setArgs<0>(std::forward<Ts>(ts)...);
+
+        if (count == 0) {
+            return args.queue().enqueueNDRangeKernel(
+                kernel_,
+                args.offset_,
+                args.global_,
+                args.local_,
+                args.waitList(),
+                event);
+        }
+
+        return tracker_->track(
+            dependencies, count, args.waitList(),
+            [&](EventWaitList waits, Event* e) {
+                return args.queue().enqueueNDRangeKernel(
+                    kernel_,
+                    args.offset_,
+                    args.global_,
+                    args.local_,
+                    waits,
+                    e);
+            },
+            event);
     }
 
-
 public:
-    KernelFunctor(Kernel kernel) : kernel_(kernel)
+    KernelFunctor(Kernel kernel) : Launcher(kernel)
     {}
 
     KernelFunctor(
         const Program& program,
         const string name,
         cl_int * err = nullptr) :
-        kernel_(program, name.c_str(), err)
+        Launcher(program, name, err)
     {}
 
-    //! \brief Return type of the functor
-    typedef Event result_type;
-
     /**
-     * Enqueue kernel.
-     * @param args Launch parameters of the kernel.
-     * @param t0... List of kernel arguments based on the template type of the functor.
+     * Sets the tracker that orders launches by the memory objects passed
+     * as ReadAccess, WriteAccess or ReadWriteAccess arguments.
+     * Defaults to DependencyTracker::getDefault().
      */
-    Event operator() (
-        const EnqueueArgs& args,
-        Ts... ts)
-    {
-        Event event;
-        setArgs<0>(std::forward<Ts>(ts)...);
-        
-        args.queue_.enqueueNDRangeKernel(
-            kernel_,
-            args.offset_,
-            args.global_,
-            args.local_,
-            &args.events_,
-            &event);
-
-        return event;
-    }
-
-    /**
-    * Enqueue kernel with support for error code.
-    * @param args Launch parameters of the kernel.
-    * @param t0... List of kernel arguments based on the template type of the functor.
-    * @param error Out parameter returning the error code from the execution.
-    */
-    Event operator() (
-        const EnqueueArgs& args,
-        Ts... ts,
-        cl_int &error)
+    void setDependencyTracker(DependencyTracker& tracker)
     {
-        Event event;
-        setArgs<0>(std::forward<Ts>(ts)...);
-
-        error = args.queue_.enqueueNDRangeKernel(
-            kernel_,
-            args.offset_,
-            args.global_,
-            args.local_,
-            &args.events_,
-            &event);
-        
-        return event;
+        tracker_ = &tracker;
     }
 
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
@@ -10412,11 +17047,6 @@ public:
         return kernel_.setSVMPointers(t0, ts...);
     }
 #endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
-
-    Kernel getKernel()
-    {
-        return kernel_;
-    }
 };
 
 namespace compatibility {
@@ -10443,23 +17073,518 @@ namespace compatibility {
             functor_(FunctorType(kernel))
         {}
 
-        //! \brief Return type of the functor
-        typedef Event result_type;
+        //! \brief Return type of the functor
+        typedef Event result_type;
+
+        //! \brief Function signature of kernel functor with no event dependency.
+        typedef Event type_(
+            const EnqueueArgs&,
+            Ts...);
+
+        Event operator()(
+            const EnqueueArgs& enqueueArgs,
+            Ts... args)
+        {
+            return functor_(
+                enqueueArgs, args...);
+        }
+    };
+} // namespace compatibility
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+/*! \class TaskGraph
+ * \brief Directed acyclic graph of commands that is submitted as a unit.
+ *
+ * Nodes wrap enqueue calls or host callbacks, and each node may depend on
+ * nodes added before it, which keeps the graph acyclic by construction.
+ *
+ * On submission the dependencies are transitively reduced, independent
+ * branches are spread over the given queues, and every command waits only
+ * for the events that in-order execution does not already imply. Events are
+ * only requested for nodes that something waits on. The resulting plan is
+ * reused while the graph and the queues stay the same, so resubmitting a
+ * graph costs little more than its enqueue calls.
+ *
+ * Kernel nodes use the arguments set on their kernel at submission time.
+ */
+class TaskGraph
+{
+public:
+    typedef size_type Node;
+
+    //! \brief Value returned in place of a node when adding one fails.
+    static Node npos() { return static_cast<Node>(-1); }
+
+    /*! \brief Enqueues a command on queue after waitList, returning its event
+     *         in event unless that is nullptr.
+     */
+    typedef std::function<cl_int(const CommandQueue& queue, EventWaitList waitList, Event* event)> Command;
+
+private:
+    struct NodeData
+    {
+        Command command_;
+        std::shared_ptr<std::function<void()>> callback_;
+        vector<Node> dependencies_;
+    };
+
+    /*! \brief A host callback waiting for its dependencies.
+     *
+     *  Runs the callback once every dependency has completed, then completes
+     *  its user event and deletes itself. If a dependency fails the callback
+     *  is skipped and the user event is failed with the same status.
+     */
+    class HostTask
+    {
+    private:
+        std::shared_ptr<std::function<void()>> callback_;
+        UserEvent done_;
+        std::atomic<size_type> pending_;
+        std::atomic<cl_int> status_;
+
+        HostTask(
+            const std::shared_ptr<std::function<void()>>& callback,
+            const UserEvent& done,
+            size_type pending) :
+            callback_(callback), done_(done), pending_(pending), status_(CL_COMPLETE) { }
+
+        void fail(cl_int status)
+        {
+            cl_int expected = CL_COMPLETE;
+            status_.compare_exchange_strong(expected, status);
+        }
+
+        void arrive()
+        {
+            if (--pending_ == 0) {
+                if (status_ == CL_COMPLETE) {
+                    (*callback_)();
+                }
+                ::clSetUserEventStatus(done_(), status_);
+                delete this;
+            }
+        }
+
+        static void CL_CALLBACK notify(cl_event, cl_int status, void* data)
+        {
+            HostTask* task = static_cast<HostTask*>(data);
+            if (status < 0) {
+                task->fail(status);
+            }
+            task->arrive();
+        }
+
+    public:
+        static cl_int start(
+            const Context& context,
+            const std::shared_ptr<std::function<void()>>& callback,
+            EventWaitList waitList,
+            Event* event)
+        {
+            cl_int error;
+            UserEvent done(context, &error);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+
+            // The extra count keeps the task alive until all callbacks are set
+            HostTask* task = new HostTask(callback, done, waitList.size() + 1);
+            cl_int result = CL_SUCCESS;
+            for (size_type i = 0; i < waitList.size(); ++i) {
+                error = ::clSetEventCallback(waitList.get()[i], CL_COMPLETE, notify, task);
+                if (error != CL_SUCCESS) {
+                    result = error;
+                    task->fail(error);
+                    task->arrive();
+                }
+            }
+            if (event != nullptr) {
+                *event = done;
+            }
+            task->arrive();
+
+            return detail::errHandler(result, __SET_EVENT_CALLBACK_ERR);
+        }
+    };
+
+    vector<NodeData> nodes_;
+
+    // Submission plan, valid while planned_ is set and the queues match
+    bool planned_;
+    vector<cl_command_queue> plannedQueues_;
+    Context context_;
+    vector<size_type> queueOf_;
+    vector<vector<Node>> waitFor_;
+    vector<bool> needEvent_;
+    Node finishNode_;
+    bool finishMarker_;
+    vector<Node> finishWaitFor_;
+
+    vector<Event> events_;
+    // Handles borrowed from events_, never retained or released
+    vector<cl_event> waitList_;
+
+    Node addNode(NodeData&& node, cl_int* err)
+    {
+        const Node index = nodes_.size();
+        for (Node dependency : node.dependencies_) {
+            if (dependency >= index) {
+                detail::errHandler(CL_INVALID_VALUE, __TASK_GRAPH_ADD_ERR);
+                if (err != nullptr) {
+                    *err = CL_INVALID_VALUE;
+                }
+                return npos();
+            }
+        }
+        std::sort(node.dependencies_.begin(), node.dependencies_.end());
+        node.dependencies_.erase(
+            std::unique(node.dependencies_.begin(), node.dependencies_.end()),
+            node.dependencies_.end());
+
+        nodes_.push_back(std::move(node));
+        planned_ = false;
+        if (err != nullptr) {
+            *err = CL_SUCCESS;
+        }
+        return index;
+    }
+
+    cl_int plan(const CommandQueue* queues, size_type numQueues)
+    {
+        const size_type numNodes = nodes_.size();
+
+        vector<bool> inOrder(numQueues);
+        for (size_type q = 0; q < numQueues; ++q) {
+            cl_command_queue_properties properties;
+            cl_int error = queues[q].getInfo(CL_QUEUE_PROPERTIES, &properties);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+            inOrder[q] = (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) == 0;
+        }
+        for (const NodeData& node : nodes_) {
+            if (node.callback_) {
+                cl_int error = queues[0].getInfo(CL_QUEUE_CONTEXT, &context_);
+                if (error != CL_SUCCESS) {
+                    return error;
+                }
+                break;
+            }
+        }
+
+        // ancestors[v][u] is set when u has to complete before v starts
+        vector<vector<bool>> ancestors(numNodes, vector<bool>(numNodes, false));
+        vector<bool> hasDependents(numNodes, false);
+        vector<Node> lastOnQueue(numQueues, npos());
+        size_type nextQueue = 0;
+
+        queueOf_.assign(numNodes, npos());
+        waitFor_.assign(numNodes, vector<Node>());
+        needEvent_.assign(numNodes, false);
+
+        for (Node v = 0; v < numNodes; ++v) {
+            const vector<Node>& dependencies = nodes_[v].dependencies_;
+            for (Node d : dependencies) {
+                hasDependents[d] = true;
+                ancestors[v][d] = true;
+                for (Node u = 0; u < d; ++u) {
+                    if (ancestors[d][u]) {
+                        ancestors[v][u] = true;
+                    }
+                }
+            }
+
+            // Transitive reduction: drop dependencies implied by another one
+            vector<Node> reduced;
+            for (Node d : dependencies) {
+                bool implied = false;
+                for (Node e : dependencies) {
+                    if (e != d && ancestors[e][d]) {
+                        implied = true;
+                        break;
+                    }
+                }
+                if (!implied) {
+                    reduced.push_back(d);
+                }
+            }
+
+            if (!nodes_[v].callback_) {
+                // Prefer continuing the chain of a dependency, then a queue
+                // whose commands all have to complete first anyway
+                size_type queue = npos();
+                for (Node d : reduced) {
+                    if (queueOf_[d] != npos() && lastOnQueue[queueOf_[d]] == d) {
+                        queue = queueOf_[d];
+                        break;
+                    }
+                }
+                for (size_type q = 0; queue == npos() && q < numQueues; ++q) {
+                    if (lastOnQueue[q] == npos() || ancestors[v][lastOnQueue[q]]) {
+                        queue = q;
+                    }
+                }
+                if (queue == npos()) {
+                    queue = nextQueue;
+                    nextQueue = (nextQueue + 1) % numQueues;
+                }
+                queueOf_[v] = queue;
+                lastOnQueue[queue] = v;
+            }
+
+            for (Node d : reduced) {
+                const bool implicit = queueOf_[v] != npos() &&
+                    queueOf_[d] == queueOf_[v] && inOrder[queueOf_[v]];
+                if (!implicit) {
+                    waitFor_[v].push_back(d);
+                    needEvent_[d] = true;
+                }
+            }
+        }
+
+        // A single sink is the finish event, several are joined by a marker
+        finishNode_ = npos();
+        finishMarker_ = false;
+        finishWaitFor_.clear();
+        vector<Node> sinks;
+        for (Node v = 0; v < numNodes; ++v) {
+            if (!hasDependents[v]) {
+                sinks.push_back(v);
+            }
+        }
+        if (sinks.size() == 1) {
+            finishNode_ = sinks[0];
+            needEvent_[finishNode_] = true;
+        }
+        else if (sinks.size() > 1) {
+            finishMarker_ = true;
+            for (Node v : sinks) {
+                if (queueOf_[v] != 0 || !inOrder[0]) {
+                    finishWaitFor_.push_back(v);
+                    needEvent_[v] = true;
+                }
+            }
+        }
+
+        events_.clear();
+        events_.resize(numNodes);
+        return CL_SUCCESS;
+    }
+
+    EventWaitList borrowEvents(const vector<Node>& nodes)
+    {
+        static_assert(sizeof(cl::Event) == sizeof(cl_event),
+        "Size of cl::Event must be equal to size of cl_event");
+
+        waitList_.resize(nodes.size());
+        for (size_type i = 0; i < nodes.size(); ++i) {
+            waitList_[i] = events_[nodes[i]]();
+        }
+        return EventWaitList(reinterpret_cast<const Event*>(waitList_.data()), waitList_.size());
+    }
+
+public:
+    TaskGraph() : planned_(false), finishNode_(npos()), finishMarker_(false) { }
+
+    //! \brief Returns the number of nodes in the graph.
+    size_type size() const
+    {
+        return nodes_.size();
+    }
+
+    /*! \brief Adds a node running an arbitrary command.
+     *
+     *  \return The new node, or npos on error.
+     */
+    Node addCommand(
+        Command command,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        NodeData node;
+        node.command_ = std::move(command);
+        node.dependencies_ = dependencies;
+        return addNode(std::move(node), err);
+    }
+
+    /*! \brief Adds a node running callback on the host.
+     *
+     *  The callback runs on a thread of the OpenCL implementation once its
+     *  dependencies have completed, or during submit() if it has none. It
+     *  must not throw.
+     */
+    Node addHostCallback(
+        std::function<void()> callback,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        NodeData node;
+        node.callback_ = std::make_shared<std::function<void()>>(std::move(callback));
+        node.dependencies_ = dependencies;
+        return addNode(std::move(node), err);
+    }
+
+    Node addKernel(
+        const Kernel& kernel,
+        const NDRange& offset,
+        const NDRange& global,
+        const NDRange& local = NullRange,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        return addCommand(
+            [kernel, offset, global, local](const CommandQueue& queue, EventWaitList waitList, Event* event) {
+                return queue.enqueueNDRangeKernel(kernel, offset, global, local, waitList, event);
+            },
+            dependencies, err);
+    }
+
+    Node addReadBuffer(
+        const Buffer& buffer,
+        size_type offset,
+        size_type size,
+        void* ptr,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        return addCommand(
+            [buffer, offset, size, ptr](const CommandQueue& queue, EventWaitList waitList, Event* event) {
+                return queue.enqueueReadBuffer(buffer, CL_FALSE, offset, size, ptr, waitList, event);
+            },
+            dependencies, err);
+    }
+
+    Node addWriteBuffer(
+        const Buffer& buffer,
+        size_type offset,
+        size_type size,
+        const void* ptr,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        return addCommand(
+            [buffer, offset, size, ptr](const CommandQueue& queue, EventWaitList waitList, Event* event) {
+                return queue.enqueueWriteBuffer(buffer, CL_FALSE, offset, size, ptr, waitList, event);
+            },
+            dependencies, err);
+    }
+
+    Node addCopyBuffer(
+        const Buffer& src,
+        const Buffer& dst,
+        size_type src_offset,
+        size_type dst_offset,
+        size_type size,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        return addCommand(
+            [src, dst, src_offset, dst_offset, size](const CommandQueue& queue, EventWaitList waitList, Event* event) {
+                return queue.enqueueCopyBuffer(src, dst, src_offset, dst_offset, size, waitList, event);
+            },
+            dependencies, err);
+    }
+
+    template<typename PatternType>
+    Node addFillBuffer(
+        const Buffer& buffer,
+        PatternType pattern,
+        size_type offset,
+        size_type size,
+        const vector<Node>& dependencies = vector<Node>(),
+        cl_int* err = nullptr)
+    {
+        return addCommand(
+            [buffer, pattern, offset, size](const CommandQueue& queue, EventWaitList waitList, Event* event) {
+                return queue.enqueueFillBuffer(buffer, pattern, offset, size, waitList, event);
+            },
+            dependencies, err);
+    }
+
+    /*! \brief Makes after wait for before, which must have been added first.
+     */
+    cl_int addDependency(Node before, Node after)
+    {
+        if (after >= nodes_.size() || before >= after) {
+            return detail::errHandler(CL_INVALID_VALUE, __TASK_GRAPH_ADD_ERR);
+        }
+        vector<Node>& dependencies = nodes_[after].dependencies_;
+        vector<Node>::iterator it = std::lower_bound(dependencies.begin(), dependencies.end(), before);
+        if (it == dependencies.end() || *it != before) {
+            dependencies.insert(it, before);
+            planned_ = false;
+        }
+        return CL_SUCCESS;
+    }
+
+    cl_int submit(const CommandQueue* queues, size_type numQueues, Event* finish)
+    {
+        if (numQueues == 0) {
+            return detail::errHandler(CL_INVALID_VALUE, __TASK_GRAPH_SUBMIT_ERR);
+        }
+
+        bool samePlan = planned_ && plannedQueues_.size() == numQueues;
+        for (size_type q = 0; samePlan && q < numQueues; ++q) {
+            samePlan = plannedQueues_[q] == queues[q]();
+        }
+        if (!samePlan) {
+            planned_ = false;
+            cl_int error = plan(queues, numQueues);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+            plannedQueues_.clear();
+            for (size_type q = 0; q < numQueues; ++q) {
+                plannedQueues_.push_back(queues[q]());
+            }
+            planned_ = true;
+        }
+
+        for (Node v = 0; v < nodes_.size(); ++v) {
+            EventWaitList waitList = borrowEvents(waitFor_[v]);
+            Event* event = needEvent_[v] ? &events_[v] : nullptr;
+
+            cl_int error = nodes_[v].callback_ ?
+                HostTask::start(context_, nodes_[v].callback_, waitList, event) :
+                nodes_[v].command_(queues[queueOf_[v]], waitList, event);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+        }
+
+        if (finishMarker_) {
+            Event marker;
+            cl_int error = queues[0].enqueueMarkerWithWaitList(
+                borrowEvents(finishWaitFor_), &marker);
+            if (error != CL_SUCCESS) {
+                return error;
+            }
+            if (finish != nullptr) {
+                *finish = std::move(marker);
+            }
+        }
+        else if (finish != nullptr) {
+            *finish = (finishNode_ != npos()) ? events_[finishNode_] : Event();
+        }
+        return CL_SUCCESS;
+    }
 
-        //! \brief Function signature of kernel functor with no event dependency.
-        typedef Event type_(
-            const EnqueueArgs&,
-            Ts...);
+    /*! \brief Enqueues the whole graph.
+     *
+     *  Independent branches are spread over queues. The event in finish
+     *  completes once every node has completed.
+     */
+    cl_int submit(const vector<CommandQueue>& queues, Event* finish = nullptr)
+    {
+        return submit(queues.data(), queues.size(), finish);
+    }
 
-        Event operator()(
-            const EnqueueArgs& enqueueArgs,
-            Ts... args)
-        {
-            return functor_(
-                enqueueArgs, args...);
-        }
-    };
-} // namespace compatibility
+    cl_int submit(const CommandQueue& queue, Event* finish = nullptr)
+    {
+        return submit(&queue, 1, finish);
+    }
+};
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
 
 #ifdef cl_khr_semaphore
 
@@ -10492,14 +17617,14 @@ public:
         const vector<cl_semaphore_properties_khr>& sema_props,
         cl_int *err = nullptr) 
     {
-        /* initialization of addresses to extension functions (it is done only once) */
-        std::call_once(ext_init_, initExtensions, context);
+        dispatch_ = detail::ExtensionDispatch::getForContext(context());
 
         cl_int error = CL_INVALID_OPERATION;
 
-        if (pfn_clCreateSemaphoreWithPropertiesKHR)
+        PFN_clCreateSemaphoreWithPropertiesKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCreateSemaphoreWithPropertiesKHR);
+        if (pfn != nullptr)
         {
-            object_ = pfn_clCreateSemaphoreWithPropertiesKHR(
+            object_ = pfn(
                 context(),
                 sema_props.data(),
                 &error);
@@ -10513,7 +17638,7 @@ public:
     }
     Semaphore(
         const vector<cl_semaphore_properties_khr>& sema_props,
-        cl_int* err = nullptr):Semaphore(Context::getDefault(err), sema_props, err) {}
+        cl_int* err = nullptr):Semaphore(Context::getDefaultRef(err), sema_props, err) {}
     
     explicit Semaphore(const cl_semaphore_khr& semaphore, bool retainObject = false) :
         detail::Wrapper<cl_type>(semaphore, retainObject) {}
@@ -10524,13 +17649,14 @@ public:
     template <typename T>
     cl_int getInfo(cl_semaphore_info_khr name, T* param) const
     {
-        if (pfn_clGetSemaphoreInfoKHR == nullptr) {
+        PFN_clGetSemaphoreInfoKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clGetSemaphoreInfoKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                                       __GET_SEMAPHORE_KHR_INFO_ERR);
         }
 
         return detail::errHandler(
-            detail::getInfo(pfn_clGetSemaphoreInfoKHR, object_, name, param),
+            detail::getInfo(pfn, object_, name, param),
             __GET_SEMAPHORE_KHR_INFO_ERR);
     }
     template <cl_semaphore_info_khr name> typename
@@ -10551,14 +17677,15 @@ public:
     cl_int getHandleForTypeKHR(
         const Device& device, cl_external_semaphore_handle_type_khr name, T* param) const
     {
-        if (pfn_clGetSemaphoreHandleForTypeKHR == nullptr) {
+        PFN_clGetSemaphoreHandleForTypeKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clGetSemaphoreHandleForTypeKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                                       __GET_SEMAPHORE_HANDLE_FOR_TYPE_KHR_ERR);
         }
 
         return detail::errHandler(
             detail::getInfo(
-                pfn_clGetSemaphoreHandleForTypeKHR, object_, device(), name, param),
+                pfn, object_, device(), name, param),
                 __GET_SEMAPHORE_HANDLE_FOR_TYPE_KHR_ERR);
     }
 
@@ -10578,87 +17705,89 @@ public:
 
     cl_int retain()
     { 
-        if (pfn_clRetainSemaphoreKHR == nullptr) {
+        PFN_clRetainSemaphoreKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clRetainSemaphoreKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                                       __RETAIN_SEMAPHORE_KHR_ERR);
         }
-        return pfn_clRetainSemaphoreKHR(object_);
+        return pfn(object_);
     }
 
     cl_int release()
     { 
-        if (pfn_clReleaseSemaphoreKHR == nullptr) {
+        PFN_clReleaseSemaphoreKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clReleaseSemaphoreKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                                       __RELEASE_SEMAPHORE_KHR_ERR);
         }
-        return pfn_clReleaseSemaphoreKHR(object_);
+        return pfn(object_);
     }
+};
 
+namespace detail {
+/*! \brief Raw handles of a list of semaphores.
+ *
+ *  Semaphore also holds the dispatch table of its platform, so the handles
+ *  are copied out for the C API. Short lists are copied to inline storage.
+ */
+class SemaphoreHandles
+{
 private:
-    static std::once_flag ext_init_;
-
-    static void initExtensions(const Context& context)
-    {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-        Device device = context.getInfo<CL_CONTEXT_DEVICES>().at(0);
-        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>()();
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCreateSemaphoreWithPropertiesKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clReleaseSemaphoreKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clRetainSemaphoreKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueWaitSemaphoresKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueSignalSemaphoresKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clGetSemaphoreInfoKHR);
-#ifdef cl_khr_external_semaphore
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clGetSemaphoreHandleForTypeKHR);
-#endif // cl_khr_external_semaphore
+    static const size_type inlineCount_ = 8;
 
-#else
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCreateSemaphoreWithPropertiesKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clReleaseSemaphoreKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clRetainSemaphoreKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueWaitSemaphoresKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueSignalSemaphoresKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clGetSemaphoreInfoKHR);
-#ifdef cl_khr_external_semaphore
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clGetSemaphoreHandleForTypeKHR);
-#endif // cl_khr_external_semaphore
+    cl_semaphore_khr inline_[inlineCount_];
+    vector<cl_semaphore_khr> overflow_;
+    cl_semaphore_khr* data_;
 
-#endif
-        if ((pfn_clCreateSemaphoreWithPropertiesKHR == nullptr) &&
-            (pfn_clReleaseSemaphoreKHR              == nullptr) &&
-            (pfn_clRetainSemaphoreKHR               == nullptr) &&
-            (pfn_clEnqueueWaitSemaphoresKHR         == nullptr) &&
-            (pfn_clEnqueueSignalSemaphoresKHR       == nullptr) &&
-#ifdef cl_khr_external_semaphore
-            (pfn_clGetSemaphoreHandleForTypeKHR     == nullptr) &&
-#endif // cl_khr_external_semaphore
-            (pfn_clGetSemaphoreInfoKHR              == nullptr))
-        {
-            detail::errHandler(CL_INVALID_VALUE, __CREATE_SEMAPHORE_KHR_WITH_PROPERTIES_ERR);
+public:
+    explicit SemaphoreHandles(const vector<Semaphore>& semaphores) : data_(inline_)
+    {
+        if (semaphores.size() > inlineCount_) {
+            overflow_.resize(semaphores.size());
+            data_ = overflow_.data();
+        }
+        for (size_type i = 0; i < semaphores.size(); ++i) {
+            data_[i] = semaphores[i]();
         }
     }
 
-};
+    SemaphoreHandles(const SemaphoreHandles&) = delete;
+    SemaphoreHandles& operator=(const SemaphoreHandles&) = delete;
 
-CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag Semaphore::ext_init_;
+    const cl_semaphore_khr* data() const
+    {
+        return data_;
+    }
+};
+} // namespace detail
 
 inline cl_int CommandQueue::enqueueWaitSemaphores(
     const vector<Semaphore> &sema_objects,
     const vector<cl_semaphore_payload_khr> &sema_payloads,
-    const vector<Event>* events_wait_list,
+    EventWaitList events_wait_list,
     Event *event) const
 {
+    if (isCaptured()) {
+        return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_WAIT_SEMAPHORE_KHR_ERR);
+    }
+
     cl_event tmp;
     cl_int err = CL_INVALID_OPERATION;
 
-    if (pfn_clEnqueueWaitSemaphoresKHR != nullptr) {
-        err = pfn_clEnqueueWaitSemaphoresKHR(
+    // Semaphores are enqueued through the entry points of their platform
+    const detail::ExtensionDispatch* dispatch =
+        sema_objects.empty() ? nullptr : sema_objects.front().getDispatch();
+    detail::SemaphoreHandles semaphores(sema_objects);
+
+    PFN_clEnqueueWaitSemaphoresKHR pfn = CL_HPP_EXT_FCN_(dispatch, clEnqueueWaitSemaphoresKHR);
+    if (pfn != nullptr) {
+        err = pfn(
                 object_,
                 (cl_uint)sema_objects.size(),
-                (const cl_semaphore_khr *) &sema_objects.front(),
+                semaphores.data(),
                 (sema_payloads.size() > 0) ? &sema_payloads.front() : nullptr,
-                (events_wait_list != nullptr) ? (cl_uint) events_wait_list->size() : 0,
-                (events_wait_list != nullptr && events_wait_list->size() > 0) ? (cl_event*) &events_wait_list->front() : nullptr,
+                (cl_uint) events_wait_list.size(),
+                events_wait_list.get(),
                 (event != nullptr) ? &tmp : nullptr);
     }
 
@@ -10673,20 +17802,30 @@ inline cl_int CommandQueue::enqueueWaitSemaphores(
 inline cl_int CommandQueue::enqueueSignalSemaphores(
     const vector<Semaphore> &sema_objects,
     const vector<cl_semaphore_payload_khr>& sema_payloads,
-    const vector<Event>* events_wait_list,
+    EventWaitList events_wait_list,
     Event* event)
 {
+    if (isCaptured()) {
+        return detail::errHandler(CL_INVALID_OPERATION, __ENQUEUE_SIGNAL_SEMAPHORE_KHR_ERR);
+    }
+
     cl_event tmp;
     cl_int err = CL_INVALID_OPERATION;
 
-    if (pfn_clEnqueueSignalSemaphoresKHR != nullptr) {
-        err = pfn_clEnqueueSignalSemaphoresKHR(
+    // Semaphores are enqueued through the entry points of their platform
+    const detail::ExtensionDispatch* dispatch =
+        sema_objects.empty() ? nullptr : sema_objects.front().getDispatch();
+    detail::SemaphoreHandles semaphores(sema_objects);
+
+    PFN_clEnqueueSignalSemaphoresKHR pfn = CL_HPP_EXT_FCN_(dispatch, clEnqueueSignalSemaphoresKHR);
+    if (pfn != nullptr) {
+        err = pfn(
                 object_,
                 (cl_uint)sema_objects.size(),
-                (const cl_semaphore_khr*) &sema_objects.front(),
+                semaphores.data(),
                 (sema_payloads.size() > 0) ? &sema_payloads.front() : nullptr,
-                (events_wait_list != nullptr) ? (cl_uint) events_wait_list->size() : 0,
-                (events_wait_list != nullptr && events_wait_list->size() > 0) ? (cl_event*) &events_wait_list->front() : nullptr,
+                (cl_uint) events_wait_list.size(),
+                events_wait_list.get(),
                 (event != nullptr) ? &tmp : nullptr);
     }
 
@@ -10718,16 +17857,16 @@ public:
             CL_COMMAND_BUFFER_FLAGS_KHR, properties, 0
         };
 
-        /* initialization of addresses to extension functions (it is done only once) */
-        std::call_once(ext_init_, [&] { initExtensions(queues[0].getInfo<CL_QUEUE_DEVICE>()); });
+        dispatch_ = queues.empty() ? nullptr : detail::ExtensionDispatch::getForQueue(queues[0]());
         cl_int error = CL_INVALID_OPERATION;
 
         static_assert(sizeof(cl::CommandQueue) == sizeof(cl_command_queue),
             "Size of cl::CommandQueue must be equal to size of cl_command_queue");
 
-        if (pfn_clCreateCommandBufferKHR)
+        PFN_clCreateCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCreateCommandBufferKHR);
+        if (pfn != nullptr)
         {
-            object_ = pfn_clCreateCommandBufferKHR((cl_uint) queues.size(),
+            object_ = pfn((cl_uint) queues.size(),
                 (cl_command_queue *) &queues.front(),
                 command_buffer_properties,
                 &error);
@@ -10751,12 +17890,13 @@ public:
     template <typename T>
     cl_int getInfo(cl_command_buffer_info_khr name, T* param) const
     {
-        if (pfn_clGetCommandBufferInfoKHR == nullptr) {
+        PFN_clGetCommandBufferInfoKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clGetCommandBufferInfoKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __GET_COMMAND_BUFFER_INFO_KHR_ERR);
         }
         return detail::errHandler(
-            detail::getInfo(pfn_clGetCommandBufferInfoKHR, object_, name, param),
+            detail::getInfo(pfn, object_, name, param),
                 __GET_COMMAND_BUFFER_INFO_KHR_ERR);
     }
 
@@ -10775,14 +17915,20 @@ public:
 
     cl_int finalizeCommandBuffer() const
     {
-        return detail::errHandler(::clFinalizeCommandBufferKHR(object_), __FINALIZE_COMMAND_BUFFER_KHR_ERR);
+        PFN_clFinalizeCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clFinalizeCommandBufferKHR);
+        if (pfn == nullptr) {
+            return detail::errHandler(CL_INVALID_OPERATION,
+                    __FINALIZE_COMMAND_BUFFER_KHR_ERR);
+        }
+        return detail::errHandler(pfn(object_), __FINALIZE_COMMAND_BUFFER_KHR_ERR);
     }
 
     cl_int enqueueCommandBuffer(vector<CommandQueue> &queues,
-        const vector<Event>* events = nullptr,
+        EventWaitList events,
         Event* event = nullptr)
     {
-        if (pfn_clEnqueueCommandBufferKHR == nullptr) {
+        PFN_clEnqueueCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clEnqueueCommandBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __ENQUEUE_COMMAND_BUFFER_KHR_ERR);
         }
@@ -10790,28 +17936,61 @@ public:
          static_assert(sizeof(cl::CommandQueue) == sizeof(cl_command_queue),
             "Size of cl::CommandQueue must be equal to size of cl_command_queue");
 
-        return detail::errHandler(pfn_clEnqueueCommandBufferKHR((cl_uint) queues.size(),
+        return detail::errHandler(pfn((cl_uint) queues.size(),
                 (cl_command_queue *) &queues.front(),
                 object_,
-                (events != nullptr) ? (cl_uint) events->size() : 0,
-                (events != nullptr && events->size() > 0) ? (cl_event*) &events->front() : nullptr,
+                (cl_uint) events.size(),
+                events.get(),
                 (cl_event*) event),
                 __ENQUEUE_COMMAND_BUFFER_KHR_ERR);
     }
 
+    cl_int enqueueCommandBuffer(vector<CommandQueue> &queues,
+        const vector<Event>* events = nullptr,
+        Event* event = nullptr)
+    {
+        return enqueueCommandBuffer(queues, EventWaitList(events), event);
+    }
+
+    //! \brief Enqueues the command buffer to the queues it was recorded for.
+    cl_int enqueueCommandBuffer(
+        EventWaitList events = EventWaitList(),
+        Event* event = nullptr) const
+    {
+        PFN_clEnqueueCommandBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clEnqueueCommandBufferKHR);
+        if (pfn == nullptr) {
+            return detail::errHandler(CL_INVALID_OPERATION,
+                    __ENQUEUE_COMMAND_BUFFER_KHR_ERR);
+        }
+
+        cl_event tmp;
+        cl_int err = detail::errHandler(
+            pfn(0, nullptr, object_,
+                (cl_uint) events.size(),
+                events.get(),
+                (event != nullptr) ? &tmp : nullptr),
+            __ENQUEUE_COMMAND_BUFFER_KHR_ERR);
+
+        if (event != nullptr && err == CL_SUCCESS)
+            *event = tmp;
+
+        return err;
+    }
+
     cl_int commandBarrierWithWaitList(const vector<cl_sync_point_khr>* sync_points_vec = nullptr,
         cl_sync_point_khr* sync_point = nullptr,
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandBarrierWithWaitListKHR == nullptr) {
+        PFN_clCommandBarrierWithWaitListKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandBarrierWithWaitListKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_BARRIER_WITH_WAIT_LIST_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandBarrierWithWaitListKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 (sync_points_vec != nullptr) ? (cl_uint) sync_points_vec->size() : 0,
                 (sync_points_vec != nullptr && sync_points_vec->size() > 0) ? &sync_points_vec->front() : nullptr,
@@ -10835,14 +18014,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandCopyBufferKHR == nullptr) {
+        PFN_clCommandCopyBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_COPY_BUFFER_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandCopyBufferKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 src(),
                 dst(),
@@ -10875,14 +18055,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandCopyBufferRectKHR == nullptr) {
+        PFN_clCommandCopyBufferRectKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferRectKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_COPY_BUFFER_RECT_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandCopyBufferRectKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 src(),
                 dst(),
@@ -10915,14 +18096,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandCopyBufferToImageKHR == nullptr) {
+        PFN_clCommandCopyBufferToImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyBufferToImageKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_COPY_BUFFER_TO_IMAGE_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandCopyBufferToImageKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 src(),
                 dst(),
@@ -10951,14 +18133,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandCopyImageKHR == nullptr) {
+        PFN_clCommandCopyImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyImageKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_COPY_IMAGE_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandCopyImageKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 src(),
                 dst(),
@@ -10987,14 +18170,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandCopyImageToBufferKHR == nullptr) {
+        PFN_clCommandCopyImageToBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandCopyImageToBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_COPY_IMAGE_TO_BUFFER_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandCopyImageToBufferKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 src(),
                 dst(),
@@ -11023,14 +18207,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandFillBufferKHR == nullptr) {
+        PFN_clCommandFillBufferKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandFillBufferKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_FILL_BUFFER_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandFillBufferKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 buffer(),
                 static_cast<void*>(&pattern),
@@ -11058,14 +18243,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandFillImageKHR == nullptr) {
+        PFN_clCommandFillImageKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandFillImageKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_FILL_IMAGE_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandFillImageKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 image(),
                 static_cast<void*>(&fillColor),
@@ -11093,14 +18279,15 @@ public:
         MutableCommandKhr* mutable_handle = nullptr,
         const CommandQueue* command_queue = nullptr)
     {
-        if (pfn_clCommandNDRangeKernelKHR == nullptr) {
+        PFN_clCommandNDRangeKernelKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clCommandNDRangeKernelKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __COMMAND_NDRANGE_KERNEL_KHR_ERR);
         }
 
         cl_sync_point_khr tmp_sync_point;
         cl_int error = detail::errHandler(
-            pfn_clCommandNDRangeKernelKHR(object_,
+            pfn(object_,
                 (command_queue != nullptr) ? (*command_queue)() : nullptr,
                 &properties[0],
                 kernel(),
@@ -11123,89 +18310,139 @@ public:
 #if defined(cl_khr_command_buffer_mutable_dispatch)
     cl_int updateMutableCommands(const cl_mutable_base_config_khr* mutable_config)
     {
-        if (pfn_clUpdateMutableCommandsKHR == nullptr) {
+        PFN_clUpdateMutableCommandsKHR pfn = CL_HPP_EXT_FCN_(dispatch_, clUpdateMutableCommandsKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __UPDATE_MUTABLE_COMMANDS_KHR_ERR);
         }
-        return detail::errHandler(pfn_clUpdateMutableCommandsKHR(object_, mutable_config),
+        return detail::errHandler(pfn(object_, mutable_config),
                         __UPDATE_MUTABLE_COMMANDS_KHR_ERR);
     }
 #endif /* cl_khr_command_buffer_mutable_dispatch */
+}; // CommandBufferKhr
 
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+/*! \class CommandBufferCapture
+ * \brief Records the commands enqueued to a CommandQueue into a CommandBufferKhr.
+ *
+ * While a capture is active, the calls below made on the calling thread to
+ * any CommandQueue referring to the captured queue are recorded into the
+ * command buffer instead of being enqueued:
+ * enqueueNDRangeKernel, enqueueCopyBuffer, enqueueCopyBufferRect,
+ * enqueueCopyImage, enqueueCopyImageToBuffer, enqueueCopyBufferToImage,
+ * enqueueFillBuffer, enqueueFillImage, enqueueMarkerWithWaitList and
+ * enqueueBarrierWithWaitList.
+ *
+ * The events these calls return stand for the recorded commands. Used in the
+ * wait list of a later recorded command they become sync points; waiting for
+ * any other event while capturing fails with CL_INVALID_EVENT_WAIT_LIST.
+ * When the capture ends the placeholder events are completed, so they do not
+ * track the execution of the command buffer. Recorded commands are ordered
+ * as they would be on the captured queue, in-order or not.
+ *
+ * Other enqueue calls on the captured queue from the capturing thread, such
+ * as enqueueReadBuffer or enqueueMapBuffer, fail with CL_INVALID_OPERATION
+ * since they would run before the recorded commands. Waiting on the calling
+ * thread for a placeholder event with Event::wait() or WaitForEvents() also
+ * fails with CL_INVALID_OPERATION. Commands enqueued from other threads go
+ * to the queue as usual, and other threads waiting for a placeholder block
+ * until the capture ends. Destroying a capture before end() stops recording
+ * without finalizing the command buffer.
+ */
+class CommandBufferCapture
+{
 private:
-    static std::once_flag ext_init_;
+    cl_int error_;
+    CommandBufferKhr commandBuffer_;
+    detail::CommandCapture capture_;
+
+    // The queries are skipped once error holds a failure
 
-    static void initExtensions(const cl::Device& device)
+    static Context getContext(const CommandQueue& queue, cl_int* error)
     {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-        cl_platform_id platform = device.getInfo<CL_DEVICE_PLATFORM>()();
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCreateCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clFinalizeCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clRetainCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clReleaseCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clGetCommandBufferInfoKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clEnqueueCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandBarrierWithWaitListKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandCopyBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandCopyBufferRectKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandCopyBufferToImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandCopyImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandCopyImageToBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandFillBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandFillImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clCommandNDRangeKernelKHR);
-#if defined(cl_khr_command_buffer_mutable_dispatch)
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clUpdateMutableCommandsKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_(platform, clGetMutableCommandInfoKHR);
-#endif /* cl_khr_command_buffer_mutable_dispatch */
-#elif CL_HPP_TARGET_OPENCL_VERSION >= 110
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCreateCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clFinalizeCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clRetainCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clReleaseCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clGetCommandBufferInfoKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clEnqueueCommandBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandBarrierWithWaitListKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandCopyBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandCopyBufferRectKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandCopyBufferToImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandCopyImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandCopyImageToBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandFillBufferKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandFillImageKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clCommandNDRangeKernelKHR);
-#if defined(cl_khr_command_buffer_mutable_dispatch)
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clUpdateMutableCommandsKHR);
-        CL_HPP_INIT_CL_EXT_FCN_PTR_(clGetMutableCommandInfoKHR);
-#endif /* cl_khr_command_buffer_mutable_dispatch */
-#endif
-        if ((pfn_clCreateCommandBufferKHR        == nullptr) &&
-            (pfn_clFinalizeCommandBufferKHR      == nullptr) &&
-            (pfn_clRetainCommandBufferKHR        == nullptr) &&
-            (pfn_clReleaseCommandBufferKHR       == nullptr) &&
-            (pfn_clGetCommandBufferInfoKHR       == nullptr) &&
-            (pfn_clEnqueueCommandBufferKHR       == nullptr) &&
-            (pfn_clCommandBarrierWithWaitListKHR == nullptr) &&
-            (pfn_clCommandCopyBufferKHR          == nullptr) &&
-            (pfn_clCommandCopyBufferRectKHR      == nullptr) &&
-            (pfn_clCommandCopyBufferToImageKHR   == nullptr) &&
-            (pfn_clCommandCopyImageKHR           == nullptr) &&
-            (pfn_clCommandCopyImageToBufferKHR   == nullptr) &&
-            (pfn_clCommandFillBufferKHR          == nullptr) &&
-            (pfn_clCommandFillImageKHR           == nullptr) &&
-            (pfn_clCommandNDRangeKernelKHR       == nullptr)
-#if defined(cl_khr_command_buffer_mutable_dispatch)
-            && (pfn_clUpdateMutableCommandsKHR      == nullptr)
-            && (pfn_clGetMutableCommandInfoKHR      == nullptr)
-#endif /* cl_khr_command_buffer_mutable_dispatch */
-            )
-        {
-            detail::errHandler(CL_INVALID_VALUE, __CREATE_COMMAND_BUFFER_KHR_ERR);
+        Context context;
+        if (*error == CL_SUCCESS) {
+            *error = queue.getInfo(CL_QUEUE_CONTEXT, &context);
         }
+        return context;
     }
-}; // CommandBufferKhr
 
-CL_HPP_DEFINE_STATIC_MEMBER_ std::once_flag CommandBufferKhr::ext_init_;
+    static bool isInOrder(const CommandQueue& queue, cl_int* error)
+    {
+        cl_command_queue_properties properties = 0;
+        if (*error == CL_SUCCESS) {
+            *error = queue.getInfo(CL_QUEUE_PROPERTIES, &properties);
+        }
+        return (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) == 0;
+    }
+
+    void begin(cl_int* err)
+    {
+        if (error_ == CL_SUCCESS) {
+            capture_.begin();
+        }
+        if (err != nullptr) {
+            *err = error_;
+        }
+    }
+
+public:
+    /*! \brief Starts recording the commands enqueued to queue into a new
+     *  command buffer created with the given flags.
+     */
+    explicit CommandBufferCapture(
+        const CommandQueue& queue,
+        cl_command_buffer_properties_khr properties = 0,
+        cl_int* err = nullptr) :
+        error_(CL_SUCCESS),
+        commandBuffer_(vector<CommandQueue>(1, queue), properties, &error_),
+        capture_(queue(), commandBuffer_(), commandBuffer_.getDispatch(), getContext(queue, &error_), isInOrder(queue, &error_))
+    {
+        begin(err);
+    }
+
+    //! \brief Starts recording the commands enqueued to queue into commandBuffer.
+    CommandBufferCapture(
+        const CommandQueue& queue,
+        const CommandBufferKhr& commandBuffer,
+        cl_int* err = nullptr) :
+        error_(CL_SUCCESS),
+        commandBuffer_(commandBuffer),
+        capture_(queue(), commandBuffer_(), commandBuffer_.getDispatch(), getContext(queue, &error_), isInOrder(queue, &error_))
+    {
+        begin(err);
+    }
+
+    CommandBufferCapture(const CommandBufferCapture&) = delete;
+    CommandBufferCapture& operator = (const CommandBufferCapture&) = delete;
+
+    bool isActive() const
+    {
+        return capture_.isActive();
+    }
+
+    /*! \brief Stops recording and finalizes the command buffer.
+     *
+     *  The returned command buffer can be enqueued any number of times.
+     */
+    CommandBufferKhr end(cl_int* err = nullptr)
+    {
+        cl_int error = CL_INVALID_OPERATION;
+        if (capture_.isActive()) {
+            capture_.end();
+            error = commandBuffer_.finalizeCommandBuffer();
+        }
+        else {
+            detail::errHandler(error, __FINALIZE_COMMAND_BUFFER_KHR_ERR);
+        }
+
+        if (err != nullptr) {
+            *err = error;
+        }
+        return commandBuffer_;
+    }
+};
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
 
 #if defined(cl_khr_command_buffer_mutable_dispatch)
 /*! \class MutableCommandKhr
@@ -11229,12 +18466,13 @@ public:
     template <typename T>
     cl_int getInfo(cl_mutable_command_info_khr name, T* param) const
     {
-        if (pfn_clGetMutableCommandInfoKHR == nullptr) {
+        PFN_clGetMutableCommandInfoKHR pfn = CL_HPP_FALLBACK_EXT_FCN_(clGetMutableCommandInfoKHR);
+        if (pfn == nullptr) {
             return detail::errHandler(CL_INVALID_OPERATION,
                     __GET_MUTABLE_COMMAND_INFO_KHR_ERR);
         }
         return detail::errHandler(
-            detail::getInfo(pfn_clGetMutableCommandInfoKHR, object_, name, param),
+            detail::getInfo(pfn, object_, name, param),
                 __GET_MUTABLE_COMMAND_INFO_KHR_ERR);
     }
 
@@ -11251,6 +18489,308 @@ public:
         return param;
     }
 }; // MutableCommandKhr
+
+/*! \class KernelLaunchCache
+ * \brief Type safe kernel functor that launches through mutable command buffers.
+ *
+ * Takes the same arguments as KernelFunctor. The first launch on a queue
+ * with a given NDRange shape records the kernel into a mutable command
+ * buffer. The shape is the number of dimensions, the local size and whether
+ * there is an offset. Later launches with the same shape patch the arguments,
+ * global size and offset that changed with a single
+ * clUpdateMutableCommandsKHR call and enqueue the command buffer, rather than
+ * setting kernel arguments and enqueueing the kernel.
+ *
+ * Memory objects and samplers are compared by handle and retained while
+ * the command buffer refers to them. SVM pointers are patched on every
+ * launch, as a freed allocation may be reused by a new one, through the SVM
+ * argument list, matching how Kernel::setArg sets them.
+ *
+ * Launches set the arguments and enqueue the kernel as usual when the device
+ * of the queue cannot update arguments and global sizes. They also do so when
+ * the command buffer is still executing and the device does not support
+ * simultaneous use of command buffers.
+ */
+template <typename... Ts>
+class KernelLaunchCache : public detail::KernelLauncher<KernelLaunchCache<Ts...>, Ts...>
+{
+private:
+    typedef detail::KernelLauncher<KernelLaunchCache<Ts...>, Ts...> Launcher;
+    friend Launcher;
+
+    struct Entry
+    {
+        CommandQueue queue_;
+        NDRange local_;
+        bool hasOffset_;
+        // Zero if the device cannot update arguments and global sizes
+        cl_mutable_dispatch_fields_khr fields_;
+        bool simultaneousUse_;
+        CommandBufferKhr commandBuffer_;
+        MutableCommandKhr command_;
+        NDRange offset_;
+        NDRange global_;
+        detail::KernelArgShadow args_;
+        // Last execution, only kept without simultaneous use
+        Event last_;
+
+        Entry() : hasOffset_(false), fields_(0), simultaneousUse_(false) { }
+    };
+
+    // Arguments to patch, plus one to avoid empty arrays
+    struct Changes
+    {
+        cl_mutable_dispatch_arg_khr args_[sizeof...(Ts) + 1];
+        cl_uint numArgs_;
+        cl_mutable_dispatch_arg_khr svmArgs_[sizeof...(Ts) + 1];
+        cl_uint numSVMArgs_;
+
+        Changes() : numArgs_(0), numSVMArgs_(0) { }
+    };
+
+    using Launcher::kernel_;
+    vector<Entry> entries_;
+
+    static bool sameRange(const NDRange& lhs, const NDRange& rhs)
+    {
+        return lhs.dimensions() == rhs.dimensions() &&
+            std::equal(lhs.get(), lhs.get() + lhs.dimensions(), rhs.get());
+    }
+
+    template <typename T>
+    static typename std::enable_if<detail::KernelSVMArg<T>::value>::type addArg(
+        Entry&, Changes& changes, cl_uint index, const T& value)
+    {
+        cl_mutable_dispatch_arg_khr& arg = changes.svmArgs_[changes.numSVMArgs_++];
+        arg.arg_index = index;
+        arg.arg_size = 0;
+        arg.arg_value = detail::KernelSVMArg<T>::get(value);
+    }
+
+    template <typename T>
+    static typename std::enable_if<!detail::KernelSVMArg<T>::value>::type addArg(
+        Entry& entry, Changes& changes, cl_uint index, const T& value)
+    {
+        size_type size = detail::KernelArgumentHandler<T>::size(value);
+        const void* ptr = detail::KernelArgumentHandler<T>::ptr(value);
+        if (entry.args_.matches(index, false, size, ptr)) {
+            return;
+        }
+        cl_mutable_dispatch_arg_khr& arg = changes.args_[changes.numArgs_++];
+        arg.arg_index = index;
+        arg.arg_size = size;
+        arg.arg_value = ptr;
+    }
+
+    // Only values compared by addArg are remembered
+    template <typename T>
+    static typename std::enable_if<detail::KernelSVMArg<T>::value>::type recordArg(
+        Entry&, cl_uint, const T&)
+    {
+    }
+
+    template <typename T>
+    static typename std::enable_if<!detail::KernelSVMArg<T>::value>::type recordArg(
+        Entry& entry, cl_uint index, const T& value)
+    {
+        entry.args_.update(
+            index,
+            false,
+            detail::KernelArgumentHandler<T>::size(value),
+            detail::KernelArgumentHandler<T>::ptr(value),
+            true);
+        entry.args_.hold(index, &value);
+    }
+
+    Entry& findEntry(const EnqueueArgs& args)
+    {
+        for (Entry& entry : entries_) {
+            if (entry.queue_() != args.queue()()) {
+                continue;
+            }
+            if (entry.fields_ == 0) {
+                return entry;
+            }
+            bool offsetMatches = (entry.fields_ & CL_MUTABLE_DISPATCH_GLOBAL_OFFSET_KHR) ?
+                entry.hasOffset_ == (args.offset_.dimensions() != 0) :
+                sameRange(entry.offset_, args.offset_);
+            if (entry.global_.dimensions() == args.global_.dimensions() &&
+                sameRange(entry.local_, args.local_) && offsetMatches) {
+                return entry;
+            }
+        }
+
+        Entry entry;
+        entry.queue_ = args.queue();
+        entry.local_ = args.local_;
+        entry.hasOffset_ = args.offset_.dimensions() != 0;
+
+        // Queried without errHandler, as failing queries only mean no support
+        cl_device_id device = nullptr;
+        cl_mutable_dispatch_fields_khr fields = 0;
+        cl_device_command_buffer_capabilities_khr capabilities = 0;
+        if (detail::getInfo(&::clGetCommandQueueInfo, args.queue()(), CL_QUEUE_DEVICE, &device) == CL_SUCCESS &&
+            detail::getInfo(&::clGetDeviceInfo, device, CL_DEVICE_MUTABLE_DISPATCH_CAPABILITIES_KHR, &fields) == CL_SUCCESS) {
+            const cl_mutable_dispatch_fields_khr required =
+                CL_MUTABLE_DISPATCH_ARGUMENTS_KHR | CL_MUTABLE_DISPATCH_GLOBAL_SIZE_KHR;
+            if ((fields & required) == required) {
+                entry.fields_ = required | (fields & CL_MUTABLE_DISPATCH_GLOBAL_OFFSET_KHR);
+            }
+            if (detail::getInfo(&::clGetDeviceInfo, device, CL_DEVICE_COMMAND_BUFFER_CAPABILITIES_KHR, &capabilities) == CL_SUCCESS) {
+                entry.simultaneousUse_ =
+                    (capabilities & CL_COMMAND_BUFFER_CAPABILITY_SIMULTANEOUS_USE_KHR) != 0;
+            }
+        }
+
+        entries_.push_back(std::move(entry));
+        return entries_.back();
+    }
+
+    cl_int enqueueDirect(const EnqueueArgs& args, Event* event, const Ts&... ts)
+    {
+        this->template setArgs<0>(ts...);
+
+        return args.queue().enqueueNDRangeKernel(
+            kernel_,
+            args.offset_,
+            args.global_,
+            args.local_,
+            args.waitList(),
+            event);
+    }
+
+    cl_int record(Entry& entry, const EnqueueArgs& args, const Ts&... ts)
+    {
+        this->template setArgs<0>(ts...);
+
+        cl_command_buffer_properties_khr flags = CL_COMMAND_BUFFER_MUTABLE_KHR;
+        if (entry.simultaneousUse_) {
+            flags |= CL_COMMAND_BUFFER_SIMULTANEOUS_USE_KHR;
+        }
+        cl_int err;
+        entry.commandBuffer_ = CommandBufferKhr(vector<CommandQueue>(1, entry.queue_), flags, &err);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+
+        vector<cl_ndrange_kernel_command_properties_khr> properties = {
+            CL_MUTABLE_DISPATCH_UPDATABLE_FIELDS_KHR, entry.fields_, 0
+        };
+        err = entry.commandBuffer_.commandNDRangeKernel(
+            properties, kernel_, args.offset_, args.global_, args.local_,
+            nullptr, nullptr, &entry.command_);
+        if (err == CL_SUCCESS) {
+            err = entry.commandBuffer_.finalizeCommandBuffer();
+        }
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+
+        // The command buffer holds the arguments set above
+        cl_uint index = 0;
+        int expand[] = { 0, (recordArg(entry, index++, ts), 0)... };
+        (void)expand;
+        entry.offset_ = args.offset_;
+        entry.global_ = args.global_;
+        return CL_SUCCESS;
+    }
+
+    cl_int update(Entry& entry, const EnqueueArgs& args, const Ts&... ts)
+    {
+        Changes changes;
+        cl_uint index = 0;
+        int expand[] = { 0, (addArg(entry, changes, index++, ts), 0)... };
+        (void)expand;
+
+        bool globalChanged = !sameRange(entry.global_, args.global_);
+        bool offsetChanged = !sameRange(entry.offset_, args.offset_);
+        if (changes.numArgs_ == 0 && changes.numSVMArgs_ == 0 && !globalChanged && !offsetChanged) {
+            return CL_SUCCESS;
+        }
+
+        cl_mutable_dispatch_config_khr dispatch = {};
+        dispatch.type = CL_STRUCTURE_TYPE_MUTABLE_DISPATCH_CONFIG_KHR;
+        dispatch.command = entry.command_();
+        dispatch.num_args = changes.numArgs_;
+        dispatch.num_svm_args = changes.numSVMArgs_;
+        dispatch.work_dim = (cl_uint) args.global_.dimensions();
+        dispatch.arg_list = changes.numArgs_ != 0 ? changes.args_ : nullptr;
+        dispatch.arg_svm_list = changes.numSVMArgs_ != 0 ? changes.svmArgs_ : nullptr;
+        dispatch.global_work_offset = offsetChanged ? (const size_type*) args.offset_ : nullptr;
+        dispatch.global_work_size = globalChanged ? (const size_type*) args.global_ : nullptr;
+
+        cl_mutable_base_config_khr config = {};
+        config.type = CL_STRUCTURE_TYPE_MUTABLE_BASE_CONFIG_KHR;
+        config.num_mutable_dispatch = 1;
+        config.mutable_dispatch_list = &dispatch;
+
+        cl_int err = entry.commandBuffer_.updateMutableCommands(&config);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+
+        for (cl_uint i = 0; i < changes.numArgs_; ++i) {
+            entry.args_.update(
+                changes.args_[i].arg_index, false, changes.args_[i].arg_size,
+                changes.args_[i].arg_value, true);
+        }
+        entry.offset_ = args.offset_;
+        entry.global_ = args.global_;
+        return CL_SUCCESS;
+    }
+
+    cl_int launch(const EnqueueArgs& args, Event* event, const Ts&... ts)
+    {
+        Entry& entry = findEntry(args);
+        if (entry.fields_ == 0) {
+            return enqueueDirect(args, event, ts...);
+        }
+
+        if (!entry.simultaneousUse_ && entry.last_() != nullptr) {
+            cl_int status = CL_COMPLETE;
+            detail::getInfo(&::clGetEventInfo, entry.last_(), CL_EVENT_COMMAND_EXECUTION_STATUS, &status);
+            if (status > CL_COMPLETE) {
+                // Still pending, so it can neither be updated nor enqueued again
+                return enqueueDirect(args, event, ts...);
+            }
+        }
+
+        cl_int err = entry.commandBuffer_() == nullptr ?
+            record(entry, args, ts...) :
+            update(entry, args, ts...);
+        if (err != CL_SUCCESS) {
+            // The recorded state is unknown, so record again next time
+            entries_.erase(entries_.begin() + (&entry - entries_.data()));
+            return err;
+        }
+
+        if (entry.simultaneousUse_) {
+            return entry.commandBuffer_.enqueueCommandBuffer(args.waitList(), event);
+        }
+        err = entry.commandBuffer_.enqueueCommandBuffer(args.waitList(), &entry.last_);
+        if (event != nullptr && err == CL_SUCCESS) {
+            *event = entry.last_;
+        }
+        return err;
+    }
+
+public:
+    KernelLaunchCache(Kernel kernel) : Launcher(kernel)
+    {}
+
+    KernelLaunchCache(
+        const Program& program,
+        const string name,
+        cl_int * err = nullptr) :
+        Launcher(program, name, err)
+    {}
+
+    //! \brief Releases all recorded command buffers.
+    void clear()
+    {
+        entries_.clear();
+    }
+};
 #endif /* cl_khr_command_buffer_mutable_dispatch */
 
 #endif // cl_khr_command_buffer
@@ -11310,6 +18850,9 @@ public:
 #undef __SET_USER_EVENT_STATUS_ERR         
 #undef __SET_EVENT_CALLBACK_ERR            
 #undef __WAIT_FOR_EVENTS_ERR               
+#undef __EVENT_LIST_FULL_ERR               
+#undef __TASK_GRAPH_ADD_ERR                
+#undef __TASK_GRAPH_SUBMIT_ERR             
 #undef __CREATE_KERNEL_ERR                 
 #undef __SET_KERNEL_ARGS_ERR               
 #undef __CREATE_PROGRAM_WITH_SOURCE_ERR    
@@ -11385,6 +18928,9 @@ public:
 #undef CL_HPP_CREATE_CL_EXT_FCN_PTR_ALIAS_
 #undef CL_HPP_INIT_CL_EXT_FCN_PTR_
 #undef CL_HPP_INIT_CL_EXT_FCN_PTR_PLATFORM_
+#undef CL_HPP_INIT_CL_EXT_FCN_PTR_DISPATCH_
+#undef CL_HPP_GET_EXT_FCN_ADDRESS_
+#undef CL_HPP_EXT_FCN_
 
 #undef CL_HPP_DEFINE_STATIC_MEMBER_
 
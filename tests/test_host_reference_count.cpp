@@ -0,0 +1,225 @@
+#define CL_HPP_UNIT_TEST_ENABLE
+
+// We want to support all versions
+#define CL_HPP_MINIMUM_OPENCL_VERSION 100
+#define CL_HPP_ENABLE_HOST_REFERENCE_COUNT
+# include <CL/opencl.hpp>
+
+extern "C"
+{
+#include <unity.h>
+#include <cmock.h>
+#include "Mockcl.h"
+#include "Mockcl_ext.h"
+
+/// Creates fake IDs that are easy to identify
+
+static inline cl_context make_context(int index)
+{
+    return (cl_context) (size_t) (0xcccccccc + index);
+}
+
+/****************************************************************************
+ * Stub functions shared by multiple tests
+ ****************************************************************************/
+
+static int contextRetains[2];
+static int contextReleases[2];
+
+static int contextIndex(cl_context context)
+{
+    TEST_ASSERT(context == make_context(0) || context == make_context(1));
+    return context == make_context(1) ? 1 : 0;
+}
+
+static cl_int clRetainContext_count(cl_context context, int num_calls)
+{
+    (void) num_calls;
+    ++contextRetains[contextIndex(context)];
+    return CL_SUCCESS;
+}
+
+static cl_int clReleaseContext_count(cl_context context, int num_calls)
+{
+    (void) num_calls;
+    ++contextReleases[contextIndex(context)];
+    return CL_SUCCESS;
+}
+
+void setUp(void)
+{
+    contextRetains[0] = contextRetains[1] = 0;
+    contextReleases[0] = contextReleases[1] = 0;
+    clRetainContext_StubWithCallback(clRetainContext_count);
+    clReleaseContext_StubWithCallback(clReleaseContext_count);
+}
+
+void tearDown(void)
+{
+}
+
+/****************************************************************************
+ * Tests for copies sharing an OpenCL reference
+ ****************************************************************************/
+
+void testCopySharesReference(void)
+{
+    {
+        cl::Context original(make_context(0));
+        {
+            cl::Context copy(original);
+            cl::Context copyOfCopy = copy;
+            TEST_ASSERT_EQUAL_PTR(make_context(0), copyOfCopy());
+        }
+        TEST_ASSERT_EQUAL(0, contextRetains[0]);
+        TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    }
+    TEST_ASSERT_EQUAL(1, contextReleases[0]);
+}
+
+void testCopyAssignReleasesPrevious(void)
+{
+    {
+        cl::Context first(make_context(0));
+        cl::Context second(make_context(1));
+
+        second = first;
+        TEST_ASSERT_EQUAL_PTR(make_context(0), second());
+        TEST_ASSERT_EQUAL(1, contextReleases[1]);
+
+        // Assigning to itself keeps the reference
+        second = *&second;
+        TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    }
+    TEST_ASSERT_EQUAL(0, contextRetains[0]);
+    TEST_ASSERT_EQUAL(1, contextReleases[0]);
+    TEST_ASSERT_EQUAL(1, contextReleases[1]);
+}
+
+void testMoveTransfersReference(void)
+{
+    {
+        cl::Context original(make_context(0));
+        cl::Context moved(std::move(original));
+        TEST_ASSERT_NULL(original());
+
+        cl::Context assigned(make_context(1));
+        assigned = std::move(moved);
+        TEST_ASSERT_EQUAL(1, contextReleases[1]);
+        TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    }
+    TEST_ASSERT_EQUAL(1, contextReleases[0]);
+}
+
+void testAdoptWithRetainTakesReference(void)
+{
+    {
+        cl::Context original(make_context(0));
+        cl::Context adopted(make_context(0), true);
+        TEST_ASSERT_EQUAL(1, contextRetains[0]);
+
+        cl::Context copy(adopted);
+        TEST_ASSERT_EQUAL(1, contextRetains[0]);
+    }
+    // Two OpenCL references were held, one per adopting wrapper
+    TEST_ASSERT_EQUAL(2, contextReleases[0]);
+}
+
+void testOriginalReleasedBeforeCopies(void)
+{
+    cl::Context *original = new cl::Context(make_context(0));
+    cl::Context *copy = new cl::Context(*original);
+    cl::Context *copyOfCopy = new cl::Context(*copy);
+
+    delete original;
+    TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    delete copyOfCopy;
+    TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    delete copy;
+    TEST_ASSERT_EQUAL(1, contextReleases[0]);
+}
+
+void testMixedReleaseOrder(void)
+{
+    cl::Context *original = new cl::Context(make_context(0));
+    cl::Context *adopted = new cl::Context(make_context(0), true);
+    cl::Context *copy = new cl::Context(*adopted);
+
+    // Whichever wrapper goes first consumes the recorded copy
+    delete adopted;
+    TEST_ASSERT_EQUAL(0, contextReleases[0]);
+    delete original;
+    TEST_ASSERT_EQUAL(1, contextReleases[0]);
+    delete copy;
+    TEST_ASSERT_EQUAL(2, contextReleases[0]);
+    TEST_ASSERT_EQUAL(1, contextRetains[0]);
+
+    // No copy is left over for a later wrapper of the same handle
+    {
+        cl::Context again(make_context(0));
+    }
+    TEST_ASSERT_EQUAL(3, contextReleases[0]);
+}
+
+static int windowRetains;
+static int windowReleases;
+
+static cl_int clRetainContext_window(cl_context context, int num_calls)
+{
+    (void) context;
+    (void) num_calls;
+    ++windowRetains;
+    return CL_SUCCESS;
+}
+
+static cl_int clReleaseContext_window(cl_context context, int num_calls)
+{
+    (void) context;
+    (void) num_calls;
+    ++windowReleases;
+    return CL_SUCCESS;
+}
+
+void testCopyRetainsWhenTableIsFull(void)
+{
+    clRetainContext_StubWithCallback(clRetainContext_window);
+    clReleaseContext_StubWithCallback(clReleaseContext_window);
+    windowRetains = windowReleases = 0;
+
+    const cl::size_type probeLength = cl::detail::HostReferenceTable::probeLength;
+    const cl::size_type numSlots = cl::detail::HostReferenceTable::numSlots;
+
+    // Handles 16 bytes apart probe neighbouring slots, so these take up
+    // the whole probe window of the first one
+    cl::vector<cl::Context> originals;
+    cl::vector<cl::Context> copies;
+    for (cl::size_type i = 0; i < probeLength; ++i) {
+        originals.push_back(cl::Context((cl_context) (0x100000 + 16 * i)));
+    }
+    for (cl::size_type i = 0; i < probeLength; ++i) {
+        copies.push_back(originals[i]);
+    }
+    TEST_ASSERT_EQUAL(0, windowRetains);
+
+    // Starts probing at the same slot as the first handle
+    cl::Context other((cl_context) (0x100000 + 16 * numSlots));
+    {
+        cl::Context copy(other);
+        TEST_ASSERT_EQUAL(1, windowRetains);
+    }
+    TEST_ASSERT_EQUAL(1, windowReleases);
+
+    copies.clear();
+    TEST_ASSERT_EQUAL(1, windowReleases);
+    originals.clear();
+    TEST_ASSERT_EQUAL(1 + probeLength, windowReleases);
+
+    // The freed slots take copies again
+    {
+        cl::Context copy(other);
+        TEST_ASSERT_EQUAL(1, windowRetains);
+    }
+    TEST_ASSERT_EQUAL(1 + probeLength, windowReleases);
+}
+
+} // extern "C"
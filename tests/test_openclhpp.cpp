@@ -2,7 +2,19 @@
 
 // We want to support all versions
 #define CL_HPP_MINIMUM_OPENCL_VERSION 100
+#define CL_HPP_ENABLE_PROGRAM_BINARY_CACHE
+#define CL_HPP_ENABLE_FILE_BUFFER
 # include <CL/opencl.hpp>
+# include <list>
+#if defined(_WIN32)
+# include <direct.h>
+# include <process.h>
+# include <sys/utime.h>
+#else
+# include <sys/stat.h>
+# include <unistd.h>
+# include <utime.h>
+#endif
 # define TEST_RVALUE_REFERENCES
 # define VECTOR_CLASS cl::vector
 # define STRING_CLASS cl::string
@@ -399,8 +411,62 @@ MAKE_REFCOUNT_STUBS(cl_command_buffer_khr, clRetainCommandBufferKHR, clReleaseCo
 #define MAKE_MOVE_TESTS(type, makeFunc, releaseFunc, pool) \
     MAKE_MOVE_TESTS2(test, type, makeFunc, releaseFunc, pool)
 
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+/* Resolves the extension entry points of every platform to the mocks */
+static void *clGetExtensionFunctionAddressForPlatform_mocks(
+    cl_platform_id platform,
+    const char *func_name,
+    int num_calls)
+{
+    (void) platform;
+    (void) num_calls;
+    static const std::pair<const char *, void *> mocks[] = {
+#if defined(cl_khr_command_buffer)
+        {"clCreateCommandBufferKHR", (void *) ::clCreateCommandBufferKHR},
+        {"clFinalizeCommandBufferKHR", (void *) ::clFinalizeCommandBufferKHR},
+        {"clRetainCommandBufferKHR", (void *) ::clRetainCommandBufferKHR},
+        {"clReleaseCommandBufferKHR", (void *) ::clReleaseCommandBufferKHR},
+        {"clGetCommandBufferInfoKHR", (void *) ::clGetCommandBufferInfoKHR},
+        {"clEnqueueCommandBufferKHR", (void *) ::clEnqueueCommandBufferKHR},
+        {"clCommandBarrierWithWaitListKHR", (void *) ::clCommandBarrierWithWaitListKHR},
+        {"clCommandCopyBufferKHR", (void *) ::clCommandCopyBufferKHR},
+        {"clCommandNDRangeKernelKHR", (void *) ::clCommandNDRangeKernelKHR},
+#endif
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+        {"clUpdateMutableCommandsKHR", (void *) ::clUpdateMutableCommandsKHR},
+#endif
+#if defined(cl_khr_semaphore)
+        {"clCreateSemaphoreWithPropertiesKHR", (void *) ::clCreateSemaphoreWithPropertiesKHR},
+        {"clReleaseSemaphoreKHR", (void *) ::clReleaseSemaphoreKHR},
+        {"clRetainSemaphoreKHR", (void *) ::clRetainSemaphoreKHR},
+        {"clEnqueueWaitSemaphoresKHR", (void *) ::clEnqueueWaitSemaphoresKHR},
+        {"clEnqueueSignalSemaphoresKHR", (void *) ::clEnqueueSignalSemaphoresKHR},
+        {"clGetSemaphoreInfoKHR", (void *) ::clGetSemaphoreInfoKHR},
+#endif
+#if defined(cl_khr_external_semaphore)
+        {"clGetSemaphoreHandleForTypeKHR", (void *) ::clGetSemaphoreHandleForTypeKHR},
+#endif
+#ifdef cl_khr_external_memory
+        {"clEnqueueAcquireExternalMemObjectsKHR", (void *) ::clEnqueueAcquireExternalMemObjectsKHR},
+        {"clEnqueueReleaseExternalMemObjectsKHR", (void *) ::clEnqueueReleaseExternalMemObjectsKHR},
+#endif
+        {"", nullptr},
+    };
+    for (const auto &mock : mocks) {
+        if (strcmp(mock.first, func_name) == 0) {
+            return mock.second;
+        }
+    }
+    return nullptr;
+}
+#endif
+
 void setUp(void)
 {
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    clGetExtensionFunctionAddressForPlatform_StubWithCallback(clGetExtensionFunctionAddressForPlatform_mocks);
+#endif
+
     /* init extensions addresses with mocked functions */
 #if defined(cl_khr_command_buffer)
     cl::pfn_clCreateCommandBufferKHR = ::clCreateCommandBufferKHR;
@@ -452,8 +518,12 @@ void setUp(void)
     memRefcounts.reset();
 }
 
+static void removeProgramBinaryCacheDirectory(void);
+
 void tearDown(void)
 {
+    removeProgramBinaryCacheDirectory();
+
     /* Wipe out the internal state to avoid a release call being made */
     for (int i = 0; i < POOL_MAX; i++)
     {
@@ -479,6 +549,13 @@ void tearDown(void)
     cl::pfn_clRetainCommandBufferKHR = nullptr;
     cl::pfn_clReleaseCommandBufferKHR = nullptr;
     cl::pfn_clGetCommandBufferInfoKHR = nullptr;
+    cl::pfn_clEnqueueCommandBufferKHR = nullptr;
+    cl::pfn_clCommandBarrierWithWaitListKHR = nullptr;
+    cl::pfn_clCommandCopyBufferKHR = nullptr;
+    cl::pfn_clCommandNDRangeKernelKHR = nullptr;
+#endif
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+    cl::pfn_clUpdateMutableCommandsKHR = nullptr;
 #endif
 #if defined(cl_khr_semaphore)
     cl::pfn_clCreateSemaphoreWithPropertiesKHR = nullptr;
@@ -492,6 +569,13 @@ void tearDown(void)
     cl::pfn_clEnqueueAcquireExternalMemObjectsKHR = nullptr;
     cl::pfn_clEnqueueReleaseExternalMemObjectsKHR = nullptr;
 #endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    /* Tests reuse the same platform handle with different versions */
+    cl::detail::PlatformVersionCache::unitTestClear();
+#endif
+    /* Tests reuse the same platform handle with different entry points */
+    cl::detail::ExtensionDispatch::unitTestClear();
 }
 
 /****************************************************************************
@@ -570,6 +654,75 @@ void testContextGetDevices1_2(void)
     devices[1]() = nullptr;
 }
 
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clGetDeviceInfo_unexpected(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) param_name;
+    (void) param_value_size;
+    (void) param_value;
+    (void) param_value_size_ret;
+    (void) num_calls;
+    TEST_FAIL_MESSAGE("clGetDeviceInfo should not be called");
+    return CL_INVALID_OPERATION;
+}
+
+static cl_int clGetPlatformInfo_unexpected(
+    cl_platform_id id,
+    cl_platform_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) param_name;
+    (void) param_value_size;
+    (void) param_value;
+    (void) param_value_size_ret;
+    (void) num_calls;
+    TEST_FAIL_MESSAGE("clGetPlatformInfo should not be called");
+    return CL_INVALID_OPERATION;
+}
+#endif
+
+/// Test that platform versions are cached and device copies do not query them
+void testDeviceCopyUsesCachedPlatformVersion(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clRetainDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    cl::Device device0(make_device_id(0), true);
+
+    // The version of the shared platform is already known
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_unexpected);
+    cl::Device device1(make_device_id(1));
+
+    // Copies only retain
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_unexpected);
+    clRetainDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    cl::Device copy(device0);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), copy());
+
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    copy = device1;
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), copy());
+
+    // Prevent release in the destructor
+    device0() = nullptr;
+    device1() = nullptr;
+    copy() = nullptr;
+#endif
+}
+
 #if !defined(__APPLE__) && !defined(__MACOS)
 // This is used to get a list of all platforms, so expect two calls
 // First, return to say we have two platforms
@@ -1134,6 +1287,131 @@ void testDestroyDevice1_2(void)
     cl::Device d(make_device_id(0));
 }
 
+static int deviceInfoCacheQueries;
+
+static cl_int clGetDeviceInfo_testDeviceInfoCache(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    switch (param_name) {
+    case CL_DEVICE_PLATFORM:
+        return clGetDeviceInfo_platform(
+            id, param_name, param_value_size, param_value, param_value_size_ret, num_calls);
+    case CL_DEVICE_MAX_WORK_GROUP_SIZE:
+        deviceInfoCacheQueries++;
+        TEST_ASSERT_EQUAL(sizeof(size_t), param_value_size);
+        *(size_t *) param_value = 256;
+        return CL_SUCCESS;
+    case CL_DEVICE_NAME:
+        deviceInfoCacheQueries++;
+        if (param_value_size_ret != nullptr)
+            *param_value_size_ret = sizeof("Mock Device");
+        if (param_value != nullptr)
+            strcpy((char *) param_value, "Mock Device");
+        return CL_SUCCESS;
+    default:
+        return CL_INVALID_VALUE;
+    }
+}
+
+void testDeviceGetCachedInfo(void)
+{
+    deviceInfoCacheQueries = 0;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_testDeviceInfoCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+
+    cl::Device d(make_device_id(0));
+    cl_int err;
+    const size_t &size = d.getCachedInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>(&err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL(256, size);
+    TEST_ASSERT_EQUAL(1, deviceInfoCacheQueries);
+
+    // Copies of the device share the cached value
+    cl::Device copy(d);
+    TEST_ASSERT_EQUAL_PTR(&size, &copy.getCachedInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+    TEST_ASSERT_EQUAL(1, deviceInfoCacheQueries);
+
+    d.clearInfoCache();
+    TEST_ASSERT_EQUAL(256, d.getCachedInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+    TEST_ASSERT_EQUAL(2, deviceInfoCacheQueries);
+    d.clearInfoCache();
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clCreateSubDevices_testSubDeviceInfoCache(
+    cl_device_id in_device,
+    const cl_device_partition_property *properties,
+    cl_uint num_devices,
+    cl_device_id *out_devices,
+    cl_uint *num_devices_ret,
+    int num_calls)
+{
+    (void) properties;
+    (void) num_calls;
+
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), in_device);
+    if (out_devices != nullptr) {
+        TEST_ASSERT_EQUAL(1, num_devices);
+        out_devices[0] = make_device_id(1);
+    }
+    if (num_devices_ret != nullptr)
+        *num_devices_ret = 1;
+    return CL_SUCCESS;
+}
+
+void testCreateSubDevicesClearsInfoCache(void)
+{
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_testDeviceInfoCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clCreateSubDevices_StubWithCallback(clCreateSubDevices_testSubDeviceInfoCache);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+
+    // Releasing a sub-device keeps its cached info without querying the
+    // driver
+    {
+        cl::Device released(make_device_id(1));
+        TEST_ASSERT_EQUAL(256, released.getCachedInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+    }
+    TEST_ASSERT(cl::detail::InfoCache<cl_device_id>::contains(make_device_id(1)));
+
+    // A new sub-device reusing the ID starts without cached info
+    cl::Device parent(make_device_id(0));
+    cl_device_partition_property properties[] = { 0 };
+    cl::vector<cl::Device> subDevices;
+    TEST_ASSERT_EQUAL(CL_SUCCESS, parent.createSubDevices(properties, &subDevices));
+    TEST_ASSERT_EQUAL(1, subDevices.size());
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), subDevices[0]());
+    TEST_ASSERT_FALSE(cl::detail::InfoCache<cl_device_id>::contains(make_device_id(1)));
+
+    subDevices[0]() = nullptr;
+    parent() = nullptr;
+}
+#else
+void testCreateSubDevicesClearsInfoCache(void) {}
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+void testDeviceCacheInfo(void)
+{
+    deviceInfoCacheQueries = 0;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_testDeviceInfoCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+
+    cl::Device d(make_device_id(0));
+    // Unsupported parameters are skipped
+    TEST_ASSERT_EQUAL(CL_SUCCESS, d.cacheInfo());
+    int queries = deviceInfoCacheQueries;
+
+    TEST_ASSERT_EQUAL_STRING("Mock Device", d.getCachedInfo<CL_DEVICE_NAME>().c_str());
+    TEST_ASSERT_EQUAL(256, d.getCachedInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+    TEST_ASSERT_EQUAL(queries, deviceInfoCacheQueries);
+    d.clearInfoCache();
+}
+
 static cl_int clGetDeviceIDs_PlatformWithZeroDevices(
     cl_platform_id  platform,
     cl_device_type  device_type,
@@ -1782,6 +2060,115 @@ void testKernelSetArgLocal(void)
     kernelPool[0].setArg(2, cl::Local(123));
 }
 
+void testKernelSetArgShadowing(void)
+{
+    cl::Kernel kernel(make_kernel(0));
+    // Copies made before shadowing is enabled share it too
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    cl::Kernel copy(kernel);
+    kernel.enableArgShadowing();
+    TEST_ASSERT_TRUE(kernel.isArgShadowingEnabled());
+    TEST_ASSERT_TRUE(copy.isArgShadowingEnabled());
+
+    scalarArg = 0xcafebabe;
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 3, 4, &scalarArg, CL_SUCCESS);
+    kernel.setArg(3, scalarArg);
+
+    // Identical values are skipped, including through copies
+    TEST_ASSERT_EQUAL(CL_SUCCESS, kernel.setArg(3, scalarArg));
+    TEST_ASSERT_EQUAL(CL_SUCCESS, copy.setArg(3, scalarArg));
+
+    // Other kernels are not shadowed
+    clSetKernelArg_ExpectAndReturn(make_kernel(1), 3, 4, &scalarArg, CL_SUCCESS);
+    clSetKernelArg_ExpectAndReturn(make_kernel(1), 3, 4, &scalarArg, CL_SUCCESS);
+    kernelPool[1].setArg(3, scalarArg);
+    kernelPool[1].setArg(3, scalarArg);
+
+    // Changed values are passed on
+    scalarArg = 0x12345678;
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 3, 4, &scalarArg, CL_SUCCESS);
+    kernel.setArg(3, scalarArg);
+
+    // Memory objects are compared by handle and retained while remembered
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 1, sizeof(cl_mem), &bufferPool[1](), CL_SUCCESS);
+    clRetainMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    kernel.setArg(1, bufferPool[1]);
+    copy.setArg(1, bufferPool[1]);
+
+    // Only skipped calls are counted
+    TEST_ASSERT_EQUAL(3, kernel.getArgShadowHits());
+    TEST_ASSERT_EQUAL(3, copy.getArgShadowHits());
+
+    // Failed calls are not remembered
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 2, 123, nullptr, CL_INVALID_ARG_SIZE);
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 2, 123, nullptr, CL_SUCCESS);
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    try {
+        kernel.setArg(2, cl::Local(123));
+        TEST_FAIL();
+    }
+    catch (cl::Error &e) {
+        TEST_ASSERT_EQUAL(CL_INVALID_ARG_SIZE, e.err());
+    }
+#else
+    TEST_ASSERT_EQUAL(CL_INVALID_ARG_SIZE, kernel.setArg(2, cl::Local(123)));
+#endif
+    kernel.setArg(2, cl::Local(123));
+    kernel.setArg(2, cl::Local(123));
+
+    // Forgetting the buffer releases it
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    kernel.invalidateArgShadow();
+    clSetKernelArg_ExpectAndReturn(make_kernel(0), 3, 4, &scalarArg, CL_SUCCESS);
+    kernel.setArg(3, scalarArg);
+
+    copy.enableArgShadowing(false);
+    TEST_ASSERT_FALSE(kernel.isArgShadowingEnabled());
+
+    kernel() = nullptr;
+    copy() = nullptr;
+}
+
+static cl_int clGetKernelInfo_testKernelArgShadowRelease(
+    cl_kernel kernel,
+    cl_kernel_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) param_value_size_ret;
+
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL_HEX(CL_KERNEL_REFERENCE_COUNT, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_uint), param_value_size);
+    // The first release leaves one reference behind
+    *(cl_uint *) param_value = num_calls == 0 ? 2 : 1;
+    return CL_SUCCESS;
+}
+
+void testKernelArgShadowReleasedWithKernel(void)
+{
+    clGetKernelInfo_StubWithCallback(clGetKernelInfo_testKernelArgShadowRelease);
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+
+    {
+        cl::Kernel kernel(make_kernel(0));
+        kernel.enableArgShadowing();
+        {
+            cl::Kernel copy(kernel);
+        }
+        TEST_ASSERT_TRUE(kernel.isArgShadowingEnabled());
+    }
+
+    // A new kernel reusing the handle starts without a shadow
+    cl::Kernel reused(make_kernel(0));
+    TEST_ASSERT_FALSE(reused.isArgShadowingEnabled());
+    reused() = nullptr;
+}
+
 void testKernelSetArgBySetKernelArgSVMPointerWithUniquePtrType()
 {
 #if CL_HPP_TARGET_OPENCL_VERSION >= 200
@@ -1828,1674 +2215,5800 @@ void testKernelSetExecInfo(void)
 #endif
 }
 
-/****************************************************************************
- * Tests for cl::copy
- ****************************************************************************/
-
-// This method should allocate some host accesible memory
-// so we must do this ourselves
-void *some_host_memory;
+static cl_int clSetKernelArg_testKernelFunctorEnqueue(
+    cl_kernel kernel,
+    cl_uint arg_index,
+    size_t arg_size,
+    const void *arg_value,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(0, arg_index);
+    TEST_ASSERT_EQUAL(sizeof(cl_int), arg_size);
+    TEST_ASSERT_EQUAL_HEX(scalarArg, *static_cast<const cl_int *>(arg_value));
+    return CL_SUCCESS;
+}
 
-static void * clEnqueueMapBuffer_testCopyHostToBuffer(
+static cl_int clEnqueueNDRangeKernel_testKernelFunctorEnqueue(
     cl_command_queue command_queue,
-    cl_mem buffer,
-    cl_bool blocking_map,
-    cl_map_flags map_flags,
-    size_t offset,
-    size_t size,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
     cl_uint num_events_in_wait_list,
     const cl_event *event_wait_list,
     cl_event *event,
-    cl_int *errcode_ret,
     int num_calls)
 {
-    (void) offset;
-    (void) num_events_in_wait_list;
-    (void) event_wait_list;
     (void) num_calls;
-
     TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
-    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
-    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
-    TEST_ASSERT_EQUAL(CL_MAP_WRITE, map_flags);
-    TEST_ASSERT_EQUAL(sizeof(int)*1024, size);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(1, work_dim);
+    TEST_ASSERT_NULL(global_work_offset);
+    TEST_ASSERT_EQUAL(64, global_work_size[0]);
+    TEST_ASSERT_NULL(local_work_size);
+    TEST_ASSERT_EQUAL(2, num_events_in_wait_list);
+    TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+    TEST_ASSERT_EQUAL_PTR(make_event(1), event_wait_list[1]);
+    TEST_ASSERT_NULL(event);
+    return CL_SUCCESS;
+}
 
-    some_host_memory = malloc(sizeof(int) * 1024);
+void testKernelFunctorEnqueueWithoutEvent(void)
+{
+    cl::Event events[2];
+    events[0]() = make_event(0);
+    events[1]() = make_event(1);
 
-    // Set the return event
-    if (event)
-        *event = nullptr;
+    // The functor takes the kernel by value and copies it
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    scalarArg = 0xcafebabe;
+    clSetKernelArg_StubWithCallback(clSetKernelArg_testKernelFunctorEnqueue);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_testKernelFunctorEnqueue);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
 
-    // Set the return error code
-    if (errcode_ret)
-        *errcode_ret = CL_SUCCESS;
+    {
+        cl::KernelFunctor<cl_int> functor(kernelPool[0]);
+        cl_int err = functor.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::EventWaitList(events, 2), cl::NDRange(64)),
+            scalarArg);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    }
 
-    return some_host_memory;
+    // Prevent release in the destructor
+    events[0]() = nullptr;
+    events[1]() = nullptr;
 }
 
-static cl_int clEnqueueUnmapMemObject_testCopyHostToBuffer(
-    cl_command_queue  command_queue ,
-    cl_mem  memobj,
-    void  *mapped_ptr,
-    cl_uint  num_events_in_wait_list ,
-    const cl_event  *event_wait_list ,
-    cl_event  *event,
-    int num_calls)
-{
-    (void) num_events_in_wait_list;
-    (void) event_wait_list;
-    (void) num_calls;
-
-    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
-    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
-    TEST_ASSERT_EQUAL_PTR(some_host_memory, mapped_ptr);
-    TEST_ASSERT_NOT_NULL(event);
-    return CL_SUCCESS;
-}
+static int eventWaitListRetains;
 
-static cl_int clWaitForEvents_testCopyHostToBuffer(
-    cl_uint num_events,
-    const cl_event *event_list,
-    int num_calls)
+static cl_int clRetainEvent_eventWaitList(cl_event event, int num_calls)
 {
+    (void) event;
     (void) num_calls;
-
-    TEST_ASSERT_NOT_NULL(event_list);
-    TEST_ASSERT_EQUAL(1, num_events);
+    ++eventWaitListRetains;
     return CL_SUCCESS;
 }
 
-static cl_int clReleaseEvent_testCopyHostToBuffer(
-    cl_event event,
-    int num_calls)
+static cl_int clReleaseEvent_eventWaitList(cl_event event, int num_calls)
 {
+    (void) event;
     (void) num_calls;
-
-    TEST_ASSERT_NOT_NULL(event);
+    --eventWaitListRetains;
     return CL_SUCCESS;
 }
 
-void testCopyHostToBuffer(void)
+void testKernelFunctorEnqueueWithBracedWaitList(void)
 {
-    cl_context context_expect = make_context(0);
-    int context_refcount = 1;
-    prepare_contextRefcounts(1, &context_expect, &context_refcount);
-    cl::Context context = contextPool[0];
-
-    cl_mem mem_expect = make_mem(0);
-    int mem_refcount = 1;
-    prepare_memRefcounts(1, &mem_expect, &mem_refcount);
-    cl::Buffer buffer(make_mem(0));
-
-    cl_command_queue queue_expect = make_command_queue(0);
-    cl::CommandQueue queue(queue_expect);
-    clReleaseCommandQueue_ExpectAndReturn(queue_expect, CL_SUCCESS);
-
-    // Returns the pointer to host memory
-    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_testCopyHostToBuffer);
-    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testCopyHostToBuffer);
+    cl::Event first;
+    cl::Event second;
+    first() = make_event(0);
+    second() = make_event(1);
 
-    clWaitForEvents_StubWithCallback(clWaitForEvents_testCopyHostToBuffer);
-    clReleaseEvent_StubWithCallback(clReleaseEvent_testCopyHostToBuffer);
-
-    std::vector<int> host(1024);
-    for (int i = 0; i < 1024; i++)
-        host[i] = i;
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clRetainKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    eventWaitListRetains = 0;
+    clRetainEvent_StubWithCallback(clRetainEvent_eventWaitList);
+    clReleaseEvent_StubWithCallback(clReleaseEvent_eventWaitList);
+    scalarArg = 0xcafebabe;
+    clSetKernelArg_StubWithCallback(clSetKernelArg_testKernelFunctorEnqueue);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_testKernelFunctorEnqueue);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
 
-    cl::copy(queue, host.begin(), host.end(), buffer);
+    {
+        cl::KernelFunctor<cl_int> functor(kernelPool[0]);
+        // A braced list selects the vector<Event> constructor, which keeps
+        // its own copy of the events
+        cl::EnqueueArgs args(commandQueuePool[0], { first, second }, cl::NDRange(64));
+        TEST_ASSERT_EQUAL(2, eventWaitListRetains);
+        cl_int err = functor.enqueue(args, scalarArg);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    }
+    TEST_ASSERT_EQUAL(0, eventWaitListRetains);
 
-    // Check that the memory was copied to some_host_memory
-    TEST_ASSERT_EQUAL_MEMORY(&host[0], some_host_memory, sizeof(int) * 1024);
+    first() = nullptr;
+    second() = nullptr;
+}
 
-    free(some_host_memory);
+static cl_int clRetainKernel_dependencyTracker(cl_kernel kernel, int num_calls)
+{
+    (void) kernel;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
 
+static cl_int clRetainMemObject_dependencyTracker(cl_mem memobj, int num_calls)
+{
+    (void) memobj;
+    (void) num_calls;
+    return CL_SUCCESS;
 }
 
-/****************************************************************************
-* Tests for building Programs
-****************************************************************************/
+static cl_int clRetainEvent_dependencyTracker(cl_event event, int num_calls)
+{
+    (void) event;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
 
-static cl_int clGetDeviceInfo_testGetBuildInfo(
-    cl_device_id device,
-    cl_device_info param_name,
-    size_t param_value_size,
-    void *param_value,
-    size_t *param_value_size_ret,
+static cl_int clSetKernelArg_dependencyTracker(
+    cl_kernel kernel,
+    cl_uint arg_index,
+    size_t arg_size,
+    const void *arg_value,
     int num_calls)
 {
-    (void) device;
-    (void) num_calls;
+    // Launches alternate the buffers: (0, 1), (1, 0), (0, 1)
+    cl_mem expected = make_mem(((num_calls / 2) + arg_index) % 2);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(sizeof(cl_mem), arg_size);
+    TEST_ASSERT_EQUAL_PTR(expected, *static_cast<const cl_mem *>(arg_value));
+    return CL_SUCCESS;
+}
 
-    TEST_ASSERT_EQUAL(param_name, CL_DEVICE_PLATFORM);
-    TEST_ASSERT_EQUAL(param_value_size, sizeof(cl_platform_id));
-    TEST_ASSERT_NOT_EQUAL(param_value, nullptr);
-    TEST_ASSERT_EQUAL(param_value_size_ret, nullptr);
-    cl_platform_id temp = make_platform_id(0);
-    memcpy(param_value, &temp, sizeof(cl_platform_id));
+static cl_int clEnqueueNDRangeKernel_dependencyTracker(
+    cl_command_queue command_queue,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) work_dim;
+    (void) global_work_offset;
+    (void) global_work_size;
+    (void) local_work_size;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    switch (num_calls) {
+    case 0:
+        // Nothing accessed the buffers yet
+        TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+        break;
+    case 1:
+        // Reads what launch 0 wrote, and overwrites what launch 0 read
+        TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+        break;
+    case 2:
+        // Reads what launch 1 wrote, and overwrites what launch 0 wrote
+        // and launch 1 read
+        TEST_ASSERT_EQUAL(2, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(1), event_wait_list[0]);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[1]);
+        break;
+    default:
+        TEST_FAIL();
+    }
+    // The tracker needs an event even when the caller does not
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(num_calls);
     return CL_SUCCESS;
 }
 
+void testKernelFunctorDependencyTracking(void)
+{
+    clRetainKernel_StubWithCallback(clRetainKernel_dependencyTracker);
+    clReleaseKernel_StubWithCallback(clRetainKernel_dependencyTracker);
+    clRetainMemObject_StubWithCallback(clRetainMemObject_dependencyTracker);
+    clReleaseMemObject_StubWithCallback(clRetainMemObject_dependencyTracker);
+    clRetainEvent_StubWithCallback(clRetainEvent_dependencyTracker);
+    clReleaseEvent_StubWithCallback(clRetainEvent_dependencyTracker);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clSetKernelArg_StubWithCallback(clSetKernelArg_dependencyTracker);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_dependencyTracker);
 
-static  cl_int clGetProgramBuildInfo_testGetBuildInfo(
-    cl_program program,
-    cl_device_id device,
-    cl_program_build_info param_name,
+    {
+        cl::DependencyTracker tracker;
+        cl::KernelFunctor<cl::ReadAccess<cl::Buffer>, cl::WriteAccess<cl::Buffer>> functor(kernelPool[0]);
+        functor.setDependencyTracker(tracker);
+        cl::EnqueueArgs args(commandQueuePool[0], cl::NDRange(64));
+
+        cl::Event event = functor(args, bufferPool[0], bufferPool[1]);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event());
+        event = functor(args, bufferPool[1], bufferPool[0]);
+        TEST_ASSERT_EQUAL_PTR(make_event(1), event());
+        TEST_ASSERT_EQUAL(CL_SUCCESS, functor.enqueue(args, bufferPool[0], bufferPool[1]));
+    }
+}
+
+static cl_int clGetEventInfo_dependencyTrackerPrune(
+    cl_event event,
+    cl_event_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) program;
-    (void) device;
     (void) num_calls;
-
-    TEST_ASSERT_EQUAL(param_name, CL_PROGRAM_BUILD_LOG);
-
-    const char returnString[] = 
-        "This is the string returned by the build info function.";
-    if (param_value) {
-        ::size_t returnSize = param_value_size;
-        if (sizeof(returnString) < returnSize) {
-            returnSize = sizeof(returnString);
-        }
-        memcpy(param_value, returnString, returnSize);
-    }
-    else {
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(returnString);
-        }
-    }
-
+    TEST_ASSERT_EQUAL_HEX(CL_EVENT_COMMAND_EXECUTION_STATUS, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_int), param_value_size);
+    // Only the command writing the first buffer is still running
+    *static_cast<cl_int *>(param_value) = event == make_event(0) ? CL_RUNNING : CL_COMPLETE;
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = param_value_size;
     return CL_SUCCESS;
 }
 
-void testGetBuildInfo(void)
+void testDependencyTrackerDropsCompletedObjects(void)
 {
-    cl_device_id fakeDevice = make_device_id(0);
-    clGetDeviceInfo_ExpectAndReturn(fakeDevice, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), nullptr, nullptr, CL_SUCCESS);
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_testGetBuildInfo);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
-    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
-    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
+    clRetainEvent_StubWithCallback(clRetainEvent_dependencyTracker);
+    clReleaseEvent_StubWithCallback(clRetainEvent_dependencyTracker);
+    clGetEventInfo_StubWithCallback(clGetEventInfo_dependencyTrackerPrune);
 
-    cl::Program prog(make_program(0));
-    cl::Device dev(fakeDevice);
-    
-    cl_int err;
-    std::string log = prog.getBuildInfo<CL_PROGRAM_BUILD_LOG>(dev, &err);
+    cl::DependencyTracker tracker;
+    for (int i = 0; i < 200; i++) {
+        cl::MemoryDependency dependency = { make_mem(i), cl::MemoryAccessMode::Write };
+        TEST_ASSERT_EQUAL(CL_SUCCESS, tracker.track(
+            &dependency, 1, cl::EventWaitList(),
+            [i](cl::EventWaitList waits, cl::Event* event) {
+                TEST_ASSERT_EQUAL(0, waits.size());
+                (*event)() = make_event(i);
+                return CL_SUCCESS;
+            }));
+    }
+    TEST_ASSERT_TRUE(tracker.size() >= 1);
+    TEST_ASSERT_TRUE(tracker.size() < 64);
 
-    prog() = nullptr;
-    dev() = nullptr;
+    // The running writer is still waited for
+    cl::MemoryDependency dependency = { make_mem(0), cl::MemoryAccessMode::Read };
+    TEST_ASSERT_EQUAL(CL_SUCCESS, tracker.track(
+        &dependency, 1, cl::EventWaitList(),
+        [](cl::EventWaitList waits, cl::Event* event) {
+            TEST_ASSERT_EQUAL(1, waits.size());
+            TEST_ASSERT_EQUAL_PTR(make_event(0), waits.get()[0]);
+            (*event)() = make_event(200);
+            return CL_SUCCESS;
+        }));
 }
 
-static cl_int clBuildProgram_testBuildProgram(
-    cl_program           program,
-    cl_uint              num_devices,
-    const cl_device_id * device_list,
-    const char *         options,
-    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
-    void *               user_data,
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clEnqueueMarkerWithWaitList_testEventWaitList(
+    cl_command_queue command_queue,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
     int num_calls)
 {
-    (void) num_calls;
-
-    TEST_ASSERT_EQUAL(program, make_program(0));
-    TEST_ASSERT_NOT_EQUAL(num_devices, 0);
-    TEST_ASSERT_NOT_EQUAL(device_list, nullptr);
-    TEST_ASSERT_EQUAL(options, nullptr);
-    TEST_ASSERT_EQUAL(pfn_notify, nullptr);
-    TEST_ASSERT_EQUAL(user_data, nullptr);
-
-    for (cl_uint i = 0; i < num_devices; i++) {
-        TEST_ASSERT_EQUAL(device_list[i], make_device_id(i));
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_NULL(event);
+    if (num_calls == 0) {
+        TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+        TEST_ASSERT_NULL(event_wait_list);
+    }
+    else {
+        TEST_ASSERT_EQUAL(2, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+        TEST_ASSERT_EQUAL_PTR(make_event(1), event_wait_list[1]);
     }
-
     return CL_SUCCESS;
 }
+#endif
 
-void testBuildProgramSingleDevice(void)
+void testEnqueueWithEventWaitLists(void)
 {
-    cl_program program = make_program(0);
-    cl_device_id device_id = make_device_id(0);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    cl::Event first;
+    cl::Event second;
+    first() = make_event(0);
+    second() = make_event(1);
 
-    // Creating a device queries the platform version:
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clEnqueueMarkerWithWaitList_StubWithCallback(clEnqueueMarkerWithWaitList_testEventWaitList);
 
-    clBuildProgram_StubWithCallback(clBuildProgram_testBuildProgram);
+    // Empty lists
+    commandQueuePool[0].enqueueMarkerWithWaitList();
+    // The vector<Event> pointer overload is still available
+    {
+        cl_int (cl::CommandQueue::*marker)(const cl::vector<cl::Event>*, cl::Event*) const =
+            &cl::CommandQueue::enqueueMarkerWithWaitList;
+        cl::vector<cl::Event> vector;
+        vector.reserve(2);
+        clRetainEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+        clRetainEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+        vector.push_back(first);
+        vector.push_back(second);
+        (commandQueuePool[0].*marker)(&vector, nullptr);
+        clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+        clReleaseEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+    }
+    // A pointer and count does not retain anything
+    cl::Event events[2];
+    events[0]() = make_event(0);
+    events[1]() = make_event(1);
+    commandQueuePool[0].enqueueMarkerWithWaitList(cl::EventWaitList(events, 2));
+    events[0]() = nullptr;
+    events[1]() = nullptr;
 
-    // Building the program queries the program build log:
-    clRetainDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
-    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
-    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    {
+        cl::EventList<2> list;
+        TEST_ASSERT_EQUAL(2, list.capacity());
+        clRetainEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+        clRetainEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, list.push_back(first));
+        TEST_ASSERT_EQUAL(CL_SUCCESS, list.push_back(second));
+        TEST_ASSERT_EQUAL(2, list.size());
+#if !defined(CL_HPP_ENABLE_EXCEPTIONS)
+        TEST_ASSERT_EQUAL(CL_OUT_OF_RESOURCES, list.push_back(cl::Event()));
+#endif
+        commandQueuePool[0].enqueueMarkerWithWaitList(list);
 
-    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+        clReleaseEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+        clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    }
 
-    cl::Program prog(program);
-    cl::Device dev(device_id);
+    first() = nullptr;
+    second() = nullptr;
+#endif
+}
 
-    cl_int errcode = prog.build(dev);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static int taskGraphQueueQueries;
+static bool taskGraphCallbackRan;
 
-    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
+static cl_int clRetainKernel_taskGraph(cl_kernel kernel, int num_calls)
+{
+    (void) kernel;
+    (void) num_calls;
+    return CL_SUCCESS;
 }
 
-/**
-* Stub implementation of clGetCommandQueueInfo that returns first one image then none
-*/
-static cl_int clGetSupportedImageFormats_testGetSupportedImageFormats(
-    cl_context context,
-    cl_mem_flags flags,
-    cl_mem_object_type image_type,
-    cl_uint num_entries,
-    cl_image_format *image_formats,
-    cl_uint *num_image_formats,
-    int num_calls)
+static cl_int clRetainEvent_taskGraph(cl_event event, int num_calls)
+{
+    (void) event;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
+
+static cl_int clRetainContext_taskGraph(cl_context context, int num_calls)
 {
     (void) context;
-    (void) flags;
-    (void) image_type;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
 
-    // Catch failure case that causes error in bugzilla 13355:
-    // returns CL_INVALID_VALUE if flags or image_type are not valid, 
-    // or if num_entries is 0 and image_formats is not nullptr.
-    if (num_entries == 0 && image_formats != nullptr) {
-        return CL_INVALID_VALUE;
-    }
-    if (num_entries == 0)  {
-        // If num_entries was 0 this is the query for number
-        if (num_image_formats) {
-            if (num_calls == 0) {
-                *num_image_formats = 1;
-            }
-            else {
-                *num_image_formats = 0;
-            }
-        }
+static cl_int clGetCommandQueueInfo_taskGraph(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) command_queue;
+    (void) num_calls;
+    taskGraphQueueQueries++;
+    if (param_name == CL_QUEUE_PROPERTIES) {
+        TEST_ASSERT_EQUAL(sizeof(cl_command_queue_properties), param_value_size);
+        *static_cast<cl_command_queue_properties *>(param_value) = 0;
     }
     else {
-        // Should return something
-        TEST_ASSERT_NOT_NULL(image_formats);
-        
-        // For first call we should return one format here
-        if (num_calls == 1) {
-            TEST_ASSERT_EQUAL(num_entries, 1);
-            image_formats[0] = cl::ImageFormat(CL_RGB, CL_FLOAT);
-        }
+        TEST_ASSERT_EQUAL_HEX(CL_QUEUE_CONTEXT, param_name);
+        TEST_ASSERT_EQUAL(sizeof(cl_context), param_value_size);
+        *static_cast<cl_context *>(param_value) = make_context(0);
     }
-
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = param_value_size;
     return CL_SUCCESS;
 }
 
-void testGetSupportedImageFormats(void)
+/* Kernel i stands for node i. Expects A -> B, A -> C and B, C -> D on two
+ * in-order queues, with A and B on the first queue and C on the second. */
+static cl_int clEnqueueNDRangeKernel_taskGraph(
+    cl_command_queue command_queue,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
 {
-    cl_context ctx_cl = make_context(0);
-
-    clGetSupportedImageFormats_StubWithCallback(clGetSupportedImageFormats_testGetSupportedImageFormats);
-    clGetSupportedImageFormats_StubWithCallback(clGetSupportedImageFormats_testGetSupportedImageFormats);
-    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    (void) work_dim;
+    (void) global_work_offset;
+    (void) global_work_size;
+    (void) local_work_size;
+
+    const int node = num_calls % 4;
+    TEST_ASSERT_EQUAL_PTR(make_kernel(node), kernel);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(node == 2 ? 1 : 0), command_queue);
+    switch (node) {
+    case 0:
+    case 1:
+        TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+        break;
+    case 2:
+        TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+        break;
+    case 3:
+        TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(2), event_wait_list[0]);
+        break;
+    }
+    // Only events that something waits on are requested
+    if (node == 1) {
+        TEST_ASSERT_NULL(event);
+    }
+    else {
+        TEST_ASSERT_NOT_NULL(event);
+        *event = make_event(node);
+    }
+    return CL_SUCCESS;
+}
 
-    cl::Context ctx(ctx_cl);
-    std::vector<cl::ImageFormat> formats;
-    cl_int ret = CL_SUCCESS;
+static cl_event clCreateUserEvent_taskGraph(
+    cl_context context,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_event(4);
+}
 
-    ret = ctx.getSupportedImageFormats(
-        CL_MEM_READ_WRITE,
-        CL_MEM_OBJECT_IMAGE2D,
-        &formats);
-    TEST_ASSERT_EQUAL(ret, CL_SUCCESS);
-    TEST_ASSERT_EQUAL(formats.size(), 1);
-    ret = ctx.getSupportedImageFormats(
-        CL_MEM_READ_WRITE,
-        CL_MEM_OBJECT_IMAGE2D,
-        &formats);
-    TEST_ASSERT_EQUAL(formats.size(), 0);
-    TEST_ASSERT_EQUAL(ret, CL_SUCCESS);
+static cl_int clSetEventCallback_taskGraph(
+    cl_event event,
+    cl_int command_exec_callback_type,
+    void (CL_CALLBACK *pfn_notify)(cl_event, cl_int, void *),
+    void *user_data,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_event(3), event);
+    TEST_ASSERT_EQUAL(CL_COMPLETE, command_exec_callback_type);
+    TEST_ASSERT_FALSE(taskGraphCallbackRan);
+    pfn_notify(event, CL_COMPLETE, user_data);
+    return CL_SUCCESS;
 }
 
-void testCreateSubDevice(void)
+static cl_int clSetUserEventStatus_taskGraph(
+    cl_event event,
+    cl_int execution_status,
+    int num_calls)
 {
-    // TODO
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_event(4), event);
+    TEST_ASSERT_EQUAL(CL_COMPLETE, execution_status);
+    TEST_ASSERT_TRUE(taskGraphCallbackRan);
+    return CL_SUCCESS;
+}
+#endif
+
+void testTaskGraphSubmit(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    taskGraphQueueQueries = 0;
+    clRetainKernel_StubWithCallback(clRetainKernel_taskGraph);
+    clReleaseKernel_StubWithCallback(clRetainKernel_taskGraph);
+    clRetainEvent_StubWithCallback(clRetainEvent_taskGraph);
+    clReleaseEvent_StubWithCallback(clRetainEvent_taskGraph);
+    clRetainContext_StubWithCallback(clRetainContext_taskGraph);
+    clReleaseContext_StubWithCallback(clRetainContext_taskGraph);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_taskGraph);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_taskGraph);
+    clCreateUserEvent_StubWithCallback(clCreateUserEvent_taskGraph);
+    clSetEventCallback_StubWithCallback(clSetEventCallback_taskGraph);
+    clSetUserEventStatus_StubWithCallback(clSetUserEventStatus_taskGraph);
+
+    {
+        cl::Kernel kernels[4];
+        for (int i = 0; i < 4; i++) {
+            kernels[i]() = make_kernel(i);
+        }
+
+        cl::TaskGraph graph;
+        cl::NDRange global(64);
+        cl::TaskGraph::Node a = graph.addKernel(kernels[0], cl::NullRange, global);
+        cl::TaskGraph::Node b = graph.addKernel(kernels[1], cl::NullRange, global, cl::NullRange, { a });
+        cl::TaskGraph::Node c = graph.addKernel(kernels[2], cl::NullRange, global, cl::NullRange, { a });
+        // The dependency on a is implied by b and c
+        cl::TaskGraph::Node d = graph.addKernel(kernels[3], cl::NullRange, global, cl::NullRange, { a, b });
+        TEST_ASSERT_EQUAL(CL_SUCCESS, graph.addDependency(c, d));
+        graph.addHostCallback([]() { taskGraphCallbackRan = true; }, { d });
+        TEST_ASSERT_EQUAL(5, graph.size());
+
+#if !defined(CL_HPP_ENABLE_EXCEPTIONS)
+        // Nodes can only depend on earlier nodes
+        TEST_ASSERT_EQUAL(CL_INVALID_VALUE, graph.addDependency(d, c));
+        cl_int err;
+        TEST_ASSERT_EQUAL(cl::TaskGraph::npos(), graph.addKernel(kernels[0], cl::NullRange, global, cl::NullRange, { 5 }, &err));
+        TEST_ASSERT_EQUAL(CL_INVALID_VALUE, err);
+#endif
+
+        VECTOR_CLASS<cl::CommandQueue> queues(2);
+        queues[0]() = make_command_queue(0);
+        queues[1]() = make_command_queue(1);
+
+        for (int i = 0; i < 2; i++) {
+            taskGraphCallbackRan = false;
+            cl::Event finish;
+            TEST_ASSERT_EQUAL(CL_SUCCESS, graph.submit(queues, &finish));
+            TEST_ASSERT_TRUE(taskGraphCallbackRan);
+            TEST_ASSERT_EQUAL_PTR(make_event(4), finish());
+            // The plan is only computed on the first submission
+            TEST_ASSERT_EQUAL(3, taskGraphQueueQueries);
+        }
 
+        queues[0]() = nullptr;
+        queues[1]() = nullptr;
+        for (int i = 0; i < 4; i++) {
+            kernels[i]() = nullptr;
+        }
+    }
+#endif
 }
 
-void testGetContextInfoDevices(void)
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static int taskGraphEventRefs[4];
+
+static cl_int clRetainEvent_taskGraphRefs(cl_event event, int num_calls)
 {
-    // TODO
+    (void) num_calls;
+    for (int i = 0; i < 4; i++) {
+        if (event == make_event(i)) {
+            taskGraphEventRefs[i]++;
+        }
+    }
+    return CL_SUCCESS;
 }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_mem clCreateImage_testCreateImage2DFromBuffer_2_0(
-    cl_context context,
-    cl_mem_flags flags,
-    const cl_image_format *image_format,
-    const cl_image_desc *image_desc,
-    void *host_ptr,
-    cl_int *errcode_ret,
+static cl_int clReleaseEvent_taskGraphRefs(cl_event event, int num_calls)
+{
+    (void) num_calls;
+    for (int i = 0; i < 4; i++) {
+        if (event == make_event(i)) {
+            taskGraphEventRefs[i]--;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+static cl_int clGetCommandQueueInfo_taskGraphOutOfOrder(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) context;
-    (void) flags;
+    (void) command_queue;
     (void) num_calls;
+    TEST_ASSERT_EQUAL_HEX(CL_QUEUE_PROPERTIES, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_command_queue_properties), param_value_size);
+    *static_cast<cl_command_queue_properties *>(param_value) =
+        CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = param_value_size;
+    return CL_SUCCESS;
+}
 
-    TEST_ASSERT_NOT_NULL(image_format);
-    TEST_ASSERT_NOT_NULL(image_desc);
-    TEST_ASSERT_NULL(host_ptr);
-    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
+/* Kernel i stands for node i. Expects node 2 to wait for nodes 0 and 1, and
+ * node 3 to wait for node 2, all on one out-of-order queue. */
+static cl_int clEnqueueNDRangeKernel_taskGraphOutOfOrder(
+    cl_command_queue command_queue,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) work_dim;
+    (void) global_work_offset;
+    (void) global_work_size;
+    (void) local_work_size;
 
-    // Return the passed buffer as the cl_mem and success for the error code
-    if (errcode_ret) {
-        *errcode_ret = CL_SUCCESS;
+    const int node = num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_kernel(node), kernel);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    switch (node) {
+    case 0:
+    case 1:
+        TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+        break;
+    case 2:
+        TEST_ASSERT_EQUAL(2, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+        TEST_ASSERT_EQUAL_PTR(make_event(1), event_wait_list[1]);
+        break;
+    case 3:
+        TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+        TEST_ASSERT_EQUAL_PTR(make_event(2), event_wait_list[0]);
+        break;
     }
-    return image_desc->buffer;
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(node);
+    return CL_SUCCESS;
 }
 #endif
 
-void testCreateImage2DFromBuffer_2_0(void)
+void testTaskGraphShrinkingWaitList(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2DFromBuffer_2_0);
-    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
-
-    cl_int err;
-    cl::Context context(make_context(0));
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    for (int i = 0; i < 4; i++) {
+        taskGraphEventRefs[i] = 0;
+    }
+    clRetainKernel_StubWithCallback(clRetainKernel_taskGraph);
+    clReleaseKernel_StubWithCallback(clRetainKernel_taskGraph);
+    clRetainEvent_StubWithCallback(clRetainEvent_taskGraphRefs);
+    clReleaseEvent_StubWithCallback(clReleaseEvent_taskGraphRefs);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_taskGraphOutOfOrder);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_taskGraphOutOfOrder);
 
-    // Create buffer
-    // Create image from buffer
-    cl::Buffer buffer(make_mem(0));
-    cl::Image2D imageFromBuffer(
-        context,
-        cl::ImageFormat(CL_R, CL_FLOAT), buffer, 64, 32, 256, &err);
+    {
+        cl::Kernel kernels[4];
+        for (int i = 0; i < 4; i++) {
+            kernels[i]() = make_kernel(i);
+        }
 
-    TEST_ASSERT_EQUAL_PTR(buffer(), imageFromBuffer());
-    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        cl::TaskGraph graph;
+        cl::NDRange global(64);
+        cl::TaskGraph::Node n0 = graph.addKernel(kernels[0], cl::NullRange, global);
+        cl::TaskGraph::Node n1 = graph.addKernel(kernels[1], cl::NullRange, global);
+        cl::TaskGraph::Node n2 = graph.addKernel(kernels[2], cl::NullRange, global, cl::NullRange, { n0, n1 });
+        graph.addKernel(kernels[3], cl::NullRange, global, cl::NullRange, { n2 });
+
+        cl::CommandQueue queue;
+        queue() = make_command_queue(0);
+        {
+            cl::Event finish;
+            TEST_ASSERT_EQUAL(CL_SUCCESS, graph.submit(queue, &finish));
+            TEST_ASSERT_EQUAL_PTR(make_event(3), finish());
+        }
+        // Building the wait lists must not release the events of the graph
+        for (int i = 0; i < 4; i++) {
+            TEST_ASSERT_EQUAL(0, taskGraphEventRefs[i]);
+        }
 
-    buffer() = nullptr;
+        queue() = nullptr;
+        for (int i = 0; i < 4; i++) {
+            kernels[i]() = nullptr;
+        }
+    }
+    // The graph releases each event it was given once
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(-1, taskGraphEventRefs[i]);
+    }
 #endif
 }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_mem clCreateImage_testCreateImage2D_2_0(
-    cl_context context,
-    cl_mem_flags flags,
-    const cl_image_format *image_format,
-    const cl_image_desc *image_desc,
-    void *host_ptr,
+/****************************************************************************
+ * Tests for cl::copy
+ ****************************************************************************/
+
+// This method should allocate some host accesible memory
+// so we must do this ourselves
+void *some_host_memory;
+
+static void * clEnqueueMapBuffer_testCopyHostToBuffer(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
     cl_int *errcode_ret,
     int num_calls)
 {
-    TEST_ASSERT_EQUAL(0, num_calls);
-    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
-    TEST_ASSERT_EQUAL_HEX(CL_MEM_READ_WRITE, flags);
+    (void) offset;
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    (void) num_calls;
 
-    TEST_ASSERT_NOT_NULL(image_format);
-    TEST_ASSERT_EQUAL_HEX(CL_RGBA, image_format->image_channel_order);
-    TEST_ASSERT_EQUAL_HEX(CL_FLOAT, image_format->image_channel_data_type);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(CL_MAP_WRITE, map_flags);
+    TEST_ASSERT_EQUAL(sizeof(int)*1024, size);
 
-    TEST_ASSERT_NOT_NULL(image_desc);
-    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
-    TEST_ASSERT_EQUAL(64, image_desc->image_width);
-    TEST_ASSERT_EQUAL(32, image_desc->image_height);
-    TEST_ASSERT_EQUAL(256, image_desc->image_row_pitch);
-    TEST_ASSERT_EQUAL(0, image_desc->num_mip_levels);
-    TEST_ASSERT_EQUAL(0, image_desc->num_samples);
-    TEST_ASSERT_NULL(image_desc->buffer);
+    some_host_memory = malloc(sizeof(int) * 1024);
 
-    TEST_ASSERT_NULL(host_ptr);
+    // Set the return event
+    if (event)
+        *event = nullptr;
 
-    if (errcode_ret != nullptr)
+    // Set the return error code
+    if (errcode_ret)
         *errcode_ret = CL_SUCCESS;
-    return make_mem(0);
+
+    return some_host_memory;
 }
-#endif
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_mem clCreateImage_testCreateImage2DFromImage_2_0(
-    cl_context context,
-    cl_mem_flags flags,
-    const cl_image_format *image_format,
-    const cl_image_desc *image_desc,
-    void *host_ptr,
-    cl_int *errcode_ret,
+static cl_int clEnqueueUnmapMemObject_testCopyHostToBuffer(
+    cl_command_queue  command_queue ,
+    cl_mem  memobj,
+    void  *mapped_ptr,
+    cl_uint  num_events_in_wait_list ,
+    const cl_event  *event_wait_list ,
+    cl_event  *event,
     int num_calls)
 {
-    (void) context;
-    (void) flags;
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
     (void) num_calls;
 
-    TEST_ASSERT_NOT_NULL(image_format);
-    TEST_ASSERT_NOT_NULL(image_desc);
-    TEST_ASSERT_NULL(host_ptr);
-    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
-
-    // Return the passed buffer as the cl_mem and success for the error code
-    if (errcode_ret) {
-        *errcode_ret = CL_SUCCESS;
-    }
-    return image_desc->buffer;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
+    TEST_ASSERT_EQUAL_PTR(some_host_memory, mapped_ptr);
+    TEST_ASSERT_NOT_NULL(event);
+    return CL_SUCCESS;
 }
-#endif
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_int clGetImageInfo_testCreateImage2DFromImage_2_0(
-    cl_mem image,
-    cl_image_info param_name,
-    size_t param_value_size,
-    void *param_value,
-    size_t *param_value_size_ret,
+static cl_int clWaitForEvents_testCopyHostToBuffer(
+    cl_uint num_events,
+    const cl_event *event_list,
     int num_calls)
 {
-    (void) image;
-    (void) param_name;
-    (void) param_value_size;
-    (void) param_value;
-    (void) param_value_size_ret;
+    (void) num_calls;
 
-    TEST_ASSERT_INT_WITHIN(6, 0, num_calls);
+    TEST_ASSERT_NOT_NULL(event_list);
+    TEST_ASSERT_EQUAL(1, num_events);
     return CL_SUCCESS;
 }
-#endif
 
-void testCreateImage2DFromImage_2_0(void)
+static cl_int clReleaseEvent_testCopyHostToBuffer(
+    cl_event event,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2D_2_0);
+    (void) num_calls;
 
+    TEST_ASSERT_NOT_NULL(event);
+    return CL_SUCCESS;
+}
 
-    cl_int err;
-    cl::Context context(make_context(0));
+void testCopyHostToBuffer(void)
+{
+    cl_context context_expect = make_context(0);
+    int context_refcount = 1;
+    prepare_contextRefcounts(1, &context_expect, &context_refcount);
+    cl::Context context = contextPool[0];
 
-    // As in 1.2 2D image test, needed as source for image-from-image
-    cl::Image2D image(
-        context, CL_MEM_READ_WRITE,
-        cl::ImageFormat(CL_RGBA, CL_FLOAT), 64, 32, 256, nullptr, &err);
+    cl_mem mem_expect = make_mem(0);
+    int mem_refcount = 1;
+    prepare_memRefcounts(1, &mem_expect, &mem_refcount);
+    cl::Buffer buffer(make_mem(0));
 
-    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
-    TEST_ASSERT_EQUAL_PTR(make_mem(0), image());
+    cl_command_queue queue_expect = make_command_queue(0);
+    cl::CommandQueue queue(queue_expect);
+    clReleaseCommandQueue_ExpectAndReturn(queue_expect, CL_SUCCESS);
 
-    // Continue state for next phase
-    clGetImageInfo_StubWithCallback(clGetImageInfo_testCreateImage2DFromImage_2_0);
-    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2DFromImage_2_0);
-    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
-    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    // Returns the pointer to host memory
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_testCopyHostToBuffer);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testCopyHostToBuffer);
 
-    // Create 2D image from 2D Image with a new channel order
-    cl::Image2D imageFromImage(
-        context,
-        CL_sRGB,
-        image,
-        &err
-        );
+    clWaitForEvents_StubWithCallback(clWaitForEvents_testCopyHostToBuffer);
+    clReleaseEvent_StubWithCallback(clReleaseEvent_testCopyHostToBuffer);
 
-    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
-    TEST_ASSERT_EQUAL_PTR(image(), imageFromImage());
+    std::vector<int> host(1024);
+    for (int i = 0; i < 1024; i++)
+        host[i] = i;
+
+    cl::copy(queue, host.begin(), host.end(), buffer);
+
+    // Check that the memory was copied to some_host_memory
+    TEST_ASSERT_EQUAL_MEMORY(&host[0], some_host_memory, sizeof(int) * 1024);
+
+    free(some_host_memory);
 
-    //imageFromImage() = nullptr;
-    //image() = nullptr;
-    //context() = nullptr;
-#endif
 }
 
-// Note that default tests maintain state when run from the same
-// unit process.
-// One default setting test will maintain the defaults until the end.
-void testSetDefaultPlatform(void)
+// Four chunks of 1 MiB
+static const int hostCopyLength = 1 << 20;
+static int hostCopyDevice[hostCopyLength];
+
+static void *clEnqueueMapBuffer_testHostCopyThreads(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    cl_int *errcode_ret,
+    int num_calls)
 {
-    cl::Platform p(make_platform_id(1));
-    cl::Platform p2 = cl::Platform::setDefault(p);
-    cl::Platform p3 = cl::Platform::getDefault();
-    TEST_ASSERT_EQUAL(p(), p2());
-    TEST_ASSERT_EQUAL(p(), p3());
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    (void) event;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(num_calls == 0 ? CL_MAP_WRITE : CL_MAP_READ, map_flags);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(sizeof(hostCopyDevice), size);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return hostCopyDevice;
 }
 
-// Note that default tests maintain state when run from the same
-// unit process.
-// One default setting test will maintain the defaults until the end.
-void testSetDefaultPlatformTwice(void)
+static cl_int clEnqueueUnmapMemObject_testHostCopyThreads(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
 {
-    cl::Platform p(make_platform_id(2));
-    cl::Platform p2 = cl::Platform::getDefault();
-    cl::Platform p3 = cl::Platform::setDefault(p);
-    // Set default should have failed
-    TEST_ASSERT_EQUAL(p2(), p3());
-    TEST_ASSERT_NOT_EQUAL(p(), p3());
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
+    TEST_ASSERT_EQUAL_PTR(hostCopyDevice, mapped_ptr);
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(num_calls);
+    return CL_SUCCESS;
 }
 
-// Note that default tests maintain state when run from the same
-// unit process.
-// One default setting test will maintain the defaults until the end.
-void testSetDefaultContext(void)
-{   
+void testHostCopyThreads(void)
+{
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_testHostCopyThreads);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testHostCopyThreads);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_testCopyHostToBuffer);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
 
-    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    TEST_ASSERT_EQUAL(1, cl::getHostCopyThreads());
+    cl::setHostCopyThreads(4);
+    TEST_ASSERT_EQUAL(4, cl::getHostCopyThreads());
 
-    cl::Context c(make_context(1));
-    cl::Context c2 = cl::Context::setDefault(c);
-    cl::Context c3 = cl::Context::getDefault();
-    TEST_ASSERT_EQUAL(c(), c2());
-    TEST_ASSERT_EQUAL(c(), c3());
-}
+    std::vector<int> host(hostCopyLength);
+    for (int i = 0; i < hostCopyLength; i++)
+        host[i] = i;
 
-// Note that default tests maintain state when run from the same
-// unit process.
-// One default setting test will maintain the defaults until the end.
-void testSetDefaultCommandQueue(void)
-{
-    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    cl_int err = cl::copy(commandQueuePool[0], host.begin(), host.end(), bufferPool[0]);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_MEMORY(host.data(), hostCopyDevice, sizeof(hostCopyDevice));
 
-    cl::CommandQueue c(make_command_queue(1));
-    cl::CommandQueue c2 = cl::CommandQueue::setDefault(c);
-    cl::CommandQueue c3 = cl::CommandQueue::getDefault();
-    TEST_ASSERT_EQUAL(c(), c2());
-    TEST_ASSERT_EQUAL(c(), c3());
-}
+    std::vector<int> result(hostCopyLength);
+    err = cl::copy(commandQueuePool[0], bufferPool[0], result.begin(), result.end());
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_TRUE(result == host);
 
-// Note that default tests maintain state when run from the same
-// unit process.
-// One default setting test will maintain the defaults until the end.
-void testSetDefaultDevice(void)
-{
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    cl::setHostCopyThreads(1);
+}
 
-    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+static int copyAsyncDevice[4] = { 10, 11, 12, 13 };
+static std::vector<int> *copyAsyncHost;
 
-    cl::Device d(make_device_id(1));
-    cl::Device  d2 = cl::Device::setDefault(d);
-    cl::Device  d3 = cl::Device::getDefault();
-    TEST_ASSERT_EQUAL(d(), d2());
-    TEST_ASSERT_EQUAL(d(), d3());
+static cl_int clEnqueueWriteBuffer_testCopyAsync(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_write,
+    size_t offset,
+    size_t size,
+    const void *ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_FALSE, blocking_write);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(4 * sizeof(int), size);
+    // Written straight from the vector
+    TEST_ASSERT_EQUAL_PTR(copyAsyncHost->data(), ptr);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(0);
+    return CL_SUCCESS;
 }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_command_queue clCreateCommandQueueWithProperties_testCommandQueueDevice(
-    cl_context context,
-    cl_device_id device,
-    const cl_queue_properties *properties,
+static void *clEnqueueMapBuffer_testCopyAsync(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
     cl_int *errcode_ret,
     int num_calls)
 {
-    (void)num_calls;
-    TEST_ASSERT_EQUAL_PTR(make_context(1), context);
-    TEST_ASSERT_EQUAL_PTR(make_device_id(1), device);
-    TEST_ASSERT_EQUAL(properties[0], CL_QUEUE_PROPERTIES);
-    static cl_command_queue default_ = 0;
-
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(CL_MAP_READ, map_flags);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(4 * sizeof(int), size);
+    // Waits for the write
+    TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+    TEST_ASSERT_EQUAL_PTR(make_event(0), event_wait_list[0]);
+    TEST_ASSERT_NULL(event);
     if (errcode_ret != nullptr)
         *errcode_ret = CL_SUCCESS;
+    return copyAsyncDevice;
+}
 
-    if ((properties[1] & CL_QUEUE_ON_DEVICE_DEFAULT) == 0) {
-        TEST_ASSERT_EQUAL(properties[1], (CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE));
-        if (properties[2] == CL_QUEUE_SIZE) {
-            TEST_ASSERT_EQUAL(properties[3], 256);
-            TEST_ASSERT_EQUAL(properties[4], 0);
-            return make_command_queue(2);
-        }
-        else {
-            TEST_ASSERT_EQUAL(properties[2], 0);
-            return make_command_queue(3);
-        }
-    }
-    else {
-        TEST_ASSERT_EQUAL(properties[1], (CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT));
-        if (default_ == 0) {
-            default_ = make_command_queue(4);
-        }
-        return default_;
-    }
+static cl_int clEnqueueUnmapMemObject_testCopyAsync(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
+    TEST_ASSERT_EQUAL_PTR(copyAsyncDevice, mapped_ptr);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(1);
+    return CL_SUCCESS;
 }
-#endif
 
-void testCreateDeviceCommandQueue(void)
+void testCopyAsync(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clCreateCommandQueueWithProperties_StubWithCallback(clCreateCommandQueueWithProperties_testCommandQueueDevice);       
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(4), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(4), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(3), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_testCopyAsync);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_testCopyAsync);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testCopyAsync);
+    // Neither copy waits for its event
+    clReleaseEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
 
-    cl::Context c(make_context(1));
-    cl::Context c2 = cl::Context::setDefault(c);
-    cl::Device d(make_device_id(1));
+    std::vector<int> host(4, 1);
+    copyAsyncHost = &host;
 
-    cl::DeviceCommandQueue dq(c, d);
-    cl::DeviceCommandQueue dq2(c, d, 256);    
+    cl_int err;
+    cl::Event write = cl::copyAsync(
+        commandQueuePool[0], host.begin(), host.end(), bufferPool[0], cl::EventWaitList(), &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_event(0), write());
 
-    cl::DeviceCommandQueue dqd = cl::DeviceCommandQueue::makeDefault(c, d);
-    cl::DeviceCommandQueue dqd2 = cl::DeviceCommandQueue::makeDefault(c, d);
-
-    TEST_ASSERT_EQUAL(dqd(), dqd2());
-#endif
-}
-
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_mem clCreatePipe_testCreatePipe(
-    cl_context context,
-    cl_mem_flags flags,
-    cl_uint packet_size,
-    cl_uint num_packets,
-    const cl_pipe_properties *props,
-    cl_int *errcode_ret,
-    int num_calls)
-{
-    (void) context;
-    (void) packet_size;
-    (void) num_packets;
-    (void) num_calls;
-
-    if (flags == 0) {
-        flags = CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS;
+    // Not contiguous, goes through a mapping
+    std::list<int> result(4);
+    cl::Event read = cl::copyAsync(
+        commandQueuePool[0], bufferPool[0], result.begin(), result.end(), cl::EventWaitList(write), &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_event(1), read());
+    int expected = 10;
+    for (int value : result) {
+        TEST_ASSERT_EQUAL(expected++, value);
     }
-    TEST_ASSERT_EQUAL(flags, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS);
-    TEST_ASSERT_NULL(props);
-
-    if (errcode_ret)
-        *errcode_ret = CL_SUCCESS;
-    return make_mem(0);
 }
-#endif
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-static cl_int clGetPipeInfo_testCreatePipe(
-    cl_mem pipe,
-    cl_pipe_info param_name,
+/****************************************************************************
+* Tests for building Programs
+****************************************************************************/
+
+static cl_int clGetDeviceInfo_testGetBuildInfo(
+    cl_device_id device,
+    cl_device_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) pipe;
+    (void) device;
     (void) num_calls;
 
-    TEST_ASSERT_NOT_NULL(param_value);
-    if (param_name == CL_PIPE_PACKET_SIZE) {
-        *static_cast<cl_uint*>(param_value) = 16;
-        if (param_value_size_ret) {
-            *param_value_size_ret = param_value_size;
-        }
-        return CL_SUCCESS;
-    }
-    else if (param_name == CL_PIPE_MAX_PACKETS) {
-        *static_cast<cl_uint*>(param_value) = 32;
-        if (param_value_size_ret) {
-            *param_value_size_ret = param_value_size;
-        }
-        return CL_SUCCESS;
-    }
-    else {
-        TEST_FAIL();
-        return CL_INVALID_VALUE;
-    }
+    TEST_ASSERT_EQUAL(param_name, CL_DEVICE_PLATFORM);
+    TEST_ASSERT_EQUAL(param_value_size, sizeof(cl_platform_id));
+    TEST_ASSERT_NOT_EQUAL(param_value, nullptr);
+    TEST_ASSERT_EQUAL(param_value_size_ret, nullptr);
+    cl_platform_id temp = make_platform_id(0);
+    memcpy(param_value, &temp, sizeof(cl_platform_id));
+    return CL_SUCCESS;
 }
-#endif
-
-void testCreatePipe(void)
-{    
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    clCreatePipe_StubWithCallback(clCreatePipe_testCreatePipe);
-    clGetPipeInfo_StubWithCallback(clGetPipeInfo_testCreatePipe);
-    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
-    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-
-    cl::Context c(make_context(1));
-    cl::Pipe p(c, 16, 32);
-    cl::Pipe p2(16, 32);
-
-    cl_uint size = p2.getInfo<CL_PIPE_PACKET_SIZE>();
-    cl_uint packets;
-    p2.getInfo(CL_PIPE_MAX_PACKETS, &packets);
 
-    TEST_ASSERT_EQUAL(size, 16);
-    TEST_ASSERT_EQUAL(packets, 32);
-#endif
-}
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-static cl_int clGetKernelSubGroupInfo_testSubGroups(cl_kernel kernel,
+static  cl_int clGetProgramBuildInfo_testGetBuildInfo(
+    cl_program program,
     cl_device_id device,
-    cl_kernel_sub_group_info param_name,
-    size_t input_value_size,
-    const void *input_value,
+    cl_program_build_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) kernel;
+    (void) program;
     (void) device;
-    (void) input_value_size;
-    (void) param_value_size;
     (void) num_calls;
 
-    TEST_ASSERT_NOT_NULL(input_value);
-    TEST_ASSERT_NOT_NULL(param_value);
+    TEST_ASSERT_EQUAL(param_name, CL_PROGRAM_BUILD_LOG);
 
-    if (param_name == CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR) {
-        *static_cast<size_t*>(param_value) = 32;
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(size_t);
+    const char returnString[] = 
+        "This is the string returned by the build info function.";
+    if (param_value) {
+        ::size_t returnSize = param_value_size;
+        if (sizeof(returnString) < returnSize) {
+            returnSize = sizeof(returnString);
         }
-        return CL_SUCCESS;
+        memcpy(param_value, returnString, returnSize);
     }
-    else if (param_name == CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR) {
-        *static_cast<size_t*>(param_value) = 2;
+    else {
         if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(size_t);
+            *param_value_size_ret = sizeof(returnString);
         }
-        return CL_SUCCESS;
-    }
-    else {
-        TEST_ABORT();
-        return CL_INVALID_OPERATION;
     }
+
+    return CL_SUCCESS;
 }
-#endif
 
-void testSubGroups(void)
+void testGetBuildInfo(void)
 {
-// TODO support testing cl_khr_subgroups on 2.0
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clGetKernelSubGroupInfo_StubWithCallback(clGetKernelSubGroupInfo_testSubGroups);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
-    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+    cl_device_id fakeDevice = make_device_id(0);
+    clGetDeviceInfo_ExpectAndReturn(fakeDevice, CL_DEVICE_PLATFORM, sizeof(cl_platform_id), nullptr, nullptr, CL_SUCCESS);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_testGetBuildInfo);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
 
-    cl::Kernel k(make_kernel(0));
-    cl::Device d(make_device_id(0));
+    cl::Program prog(make_program(0));
+    cl::Device dev(fakeDevice);
+    
     cl_int err;
-    cl::NDRange ndrange(8, 8);
-    size_t res1 = k.getSubGroupInfo<CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR>(
-        d, ndrange, &err);
-    size_t res2 = 0;
-    err = k.getSubGroupInfo(
-        d, CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR, ndrange, &res2);
+    std::string log = prog.getBuildInfo<CL_PROGRAM_BUILD_LOG>(dev, &err);
 
-    TEST_ASSERT_EQUAL(res1, 32);
-    TEST_ASSERT_EQUAL(res2, 2);
-#endif
+    prog() = nullptr;
+    dev() = nullptr;
 }
 
-/**
-* Stub implementation of clGetDeviceInfo that returns an absense of builtin kernels
-*/
-static cl_int clGetDeviceInfo_builtin(
-    cl_device_id id,
-    cl_device_info param_name,
-    size_t param_value_size,
-    void *param_value,
-    size_t *param_value_size_ret,
+static cl_int clBuildProgram_testBuildProgram(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
     int num_calls)
 {
-    (void) id;
-    (void) param_value_size;
+    (void) num_calls;
 
-    // Test to verify case where empty string is returned - so size is 0
-    (void)num_calls;
-    TEST_ASSERT_EQUAL_HEX(CL_DEVICE_BUILT_IN_KERNELS, param_name);
-    if (param_value == nullptr) {
-        if (param_value_size_ret != nullptr) {
-            *param_value_size_ret = 0;
-        }
+    TEST_ASSERT_EQUAL(program, make_program(0));
+    TEST_ASSERT_NOT_EQUAL(num_devices, 0);
+    TEST_ASSERT_NOT_EQUAL(device_list, nullptr);
+    TEST_ASSERT_EQUAL(options, nullptr);
+    TEST_ASSERT_EQUAL(pfn_notify, nullptr);
+    TEST_ASSERT_EQUAL(user_data, nullptr);
+
+    for (cl_uint i = 0; i < num_devices; i++) {
+        TEST_ASSERT_EQUAL(device_list[i], make_device_id(i));
     }
+
     return CL_SUCCESS;
 }
 
-void testBuiltInKernels(void)
+void testBuildProgramSingleDevice(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    cl_program program = make_program(0);
+    cl_device_id device_id = make_device_id(0);
+
+    // Creating a device queries the platform version:
     clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildProgram);
+
+    // A successful build does not query the program build log:
     clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
 
-    cl::Device d0(make_device_id(0));
+    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
 
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_builtin);
-    cl::string s = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS>();
-#endif
-}
+    cl::Program prog(program);
+    cl::Device dev(device_id);
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-/**
- * Stub implementation of clCloneKernel that returns a new kernel object
- */
-static cl_kernel clCloneKernel_simplecopy(
-    cl_kernel k,
-    cl_int *errcode_ret,
-    int num_calls)
-{
-    (void) k;
-    (void) num_calls;
+    cl_int errcode = prog.build(dev);
 
-    // Test to verify case where empty string is returned - so size is 0
-    if (errcode_ret != nullptr)
-        *errcode_ret = CL_SUCCESS;
-    return make_kernel(POOL_MAX);
+    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
 }
-#endif
 
-void testCloneKernel(void)
+static cl_int clBuildProgram_testBuildProgramFailure(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 210
-    clCloneKernel_StubWithCallback(clCloneKernel_simplecopy);
-    clReleaseKernel_ExpectAndReturn(make_kernel(POOL_MAX), CL_SUCCESS);
-    cl::Kernel clone = kernelPool[0].clone();
-    TEST_ASSERT_EQUAL(clone(), make_kernel(POOL_MAX));
-#endif
+    clBuildProgram_testBuildProgram(
+        program, num_devices, device_list, options, pfn_notify, user_data,
+        num_calls);
+    return CL_BUILD_PROGRAM_FAILURE;
 }
 
-void testEnqueueMapSVM(void)
+void testBuildProgramSingleDeviceFailure(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    std::vector<int> vec(7);
-    clEnqueueSVMMap_ExpectAndReturn(commandQueuePool[0].get(), CL_TRUE, CL_MAP_READ|CL_MAP_WRITE, static_cast<void*>(vec.data()), vec.size()*sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
-    TEST_ASSERT_EQUAL(commandQueuePool[0].enqueueMapSVM(vec, CL_TRUE, CL_MAP_READ|CL_MAP_WRITE), CL_SUCCESS);
-#endif
-}
+    cl_device_id device_id = make_device_id(0);
 
-void testMapSVM(void)
-{
-#if CL_HPP_TARGET_OPENCL_VERSION >= 200
-    std::vector<int> vec(1);
-    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clEnqueueSVMMap_ExpectAndReturn(make_command_queue(1), CL_TRUE, CL_MAP_READ|CL_MAP_WRITE, static_cast<void*>(vec.data()), vec.size()*sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    TEST_ASSERT_EQUAL(cl::mapSVM(vec), CL_SUCCESS);
-#endif
-}
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildProgramFailure);
 
-// Run after other tests to clear the default state in the header
-// using special unit test bypasses.
-// We cannot remove the once_flag, so this is a hard fix
-// but it means we won't hit cmock release callbacks at the end.
-// This is a lot like tearDown but for the header default
-// so we do not want to run it for every test.
-// The alternative would be to manually modify the test runner
-// but we avoid that for now.
-void testCleanupHeaderState(void)
-{
-    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
-    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    cl::Device dev(device_id);
 
-    cl::CommandQueue::unitTestClearDefault();
-    cl::Context::unitTestClearDefault();
-    cl::Device::unitTestClearDefault();
-    cl::Platform::unitTestClearDefault();
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    // The build log is only queried to report the failure
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
+
+    cl_int errcode = CL_SUCCESS;
+    try {
+        programPool[0].build(dev);
+    }
+    catch (cl::BuildError &e) {
+        errcode = e.err();
+        cl::BuildLogType logs = e.getBuildLog();
+        TEST_ASSERT_EQUAL(1, logs.size());
+        TEST_ASSERT_EQUAL_PTR(device_id, logs[0].first());
+        TEST_ASSERT_EQUAL_STRING(
+            "This is the string returned by the build info function.",
+            logs[0].second.c_str());
+    }
+#else
+    // Without exceptions there is nowhere to report the log, so it is not
+    // queried at all
+    cl_int errcode = programPool[0].build(dev);
+#endif
+
+    TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, errcode);
 }
 
-// OpenCL 2.2 APIs:
+static cl_build_status buildAsyncStatus;
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-static void CL_CALLBACK test_program_release_callback(
-    cl_program,
-    void*)
+static cl_int clBuildProgram_testBuildAsync(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    int num_calls)
 {
+    (void) num_calls;
+
+    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
+    TEST_ASSERT_EQUAL(1, num_devices);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device_list[0]);
+    TEST_ASSERT_EQUAL(nullptr, options);
+    TEST_ASSERT_NOT_NULL(pfn_notify);
+
+    // Complete the build from the notification as an asynchronous
+    // implementation would.
+    pfn_notify(program, user_data);
+    return CL_SUCCESS;
 }
-#endif
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-static cl_int clSetProgramReleaseCallback_set(
+static cl_int clGetProgramBuildInfo_testBuildAsync(
     cl_program program,
-    void (CL_CALLBACK * pfn_notify)(cl_program program, void * user_data),
-    void *user_data,
+    cl_device_id device,
+    cl_program_build_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) user_data;
-    (void) num_calls;
-
     TEST_ASSERT_EQUAL_PTR(make_program(0), program);
-    TEST_ASSERT_EQUAL_PTR(pfn_notify, test_program_release_callback);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device);
 
-    return CL_SUCCESS;
+    if (param_name == CL_PROGRAM_BUILD_STATUS) {
+        TEST_ASSERT_EQUAL(sizeof(cl_build_status), param_value_size);
+        *(cl_build_status *) param_value = buildAsyncStatus;
+        return CL_SUCCESS;
+    }
+    return clGetProgramBuildInfo_testGetBuildInfo(
+        program, device, param_name, param_value_size, param_value,
+        param_value_size_ret, num_calls);
 }
-#endif
 
-void testSetProgramReleaseCallback(void)
+void testBuildProgramAsync(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-    cl_program program = make_program(0);
-    int user_data = 0;
+    buildAsyncStatus = CL_BUILD_SUCCESS;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildAsync);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testBuildAsync);
 
-    clSetProgramReleaseCallback_StubWithCallback(clSetProgramReleaseCallback_set);
-    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    std::future<cl::BuildResult> result = programPool[0].buildAsync(devices);
 
-    cl::Program prog(program);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, result.get());
+}
 
-    prog.setReleaseCallback(test_program_release_callback, &user_data);
+void testBuildProgramAsyncFailure(void)
+{
+    buildAsyncStatus = CL_BUILD_ERROR;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildAsync);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testBuildAsync);
+
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    std::future<cl::BuildResult> result = programPool[0].buildAsync(devices);
+
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    bool thrown = false;
+    try {
+        result.get();
+    }
+    catch (cl::BuildError &e) {
+        thrown = true;
+        TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, e.err());
+        cl::BuildLogType logs = e.getBuildLog();
+        TEST_ASSERT_EQUAL(1, logs.size());
+        TEST_ASSERT_EQUAL_PTR(make_device_id(0), logs[0].first());
+        TEST_ASSERT_EQUAL_STRING(
+            "This is the string returned by the build info function.",
+            logs[0].second.c_str());
+    }
+    TEST_ASSERT(thrown);
+#else
+    cl::BuildResult failure = result.get();
+    TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, failure.error);
+    TEST_ASSERT_EQUAL(1, failure.buildLogs.size());
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), failure.buildLogs[0].first());
+    TEST_ASSERT_EQUAL_STRING(
+        "This is the string returned by the build info function.",
+        failure.buildLogs[0].second.c_str());
 #endif
 }
 
-void testSetProgramSpecializationConstantScalar(void)
+static cl_int clBuildProgram_testBuildAsyncSynchronousFailure(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-    cl_program program = make_program(0);
-    int sc = 0;
+    (void) num_devices;
+    (void) device_list;
+    (void) options;
+    (void) num_calls;
 
-    clSetProgramSpecializationConstant_ExpectAndReturn(program, 0, sizeof(sc), &sc, CL_SUCCESS);
-    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+    // A synchronous build that fails still runs the notification, which
+    // keeps its reference to the build state until then.
+    TEST_ASSERT_NOT_NULL(pfn_notify);
+    pfn_notify(program, user_data);
+    return CL_BUILD_PROGRAM_FAILURE;
+}
 
-    cl::Program prog(program);
+void testBuildProgramAsyncSynchronousFailure(void)
+{
+    buildAsyncStatus = CL_BUILD_ERROR;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildAsyncSynchronousFailure);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testBuildAsync);
 
-    prog.setSpecializationConstant(0, sc);
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    std::future<cl::BuildResult> result = programPool[0].buildAsync(devices);
+    TEST_ASSERT(result.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    bool thrown = false;
+    try {
+        result.get();
+    }
+    catch (cl::BuildError &e) {
+        thrown = true;
+        TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, e.err());
+        TEST_ASSERT_EQUAL(1, e.getBuildLog().size());
+    }
+    TEST_ASSERT(thrown);
+#else
+    cl::BuildResult failure = result.get();
+    TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, failure.error);
+    TEST_ASSERT_EQUAL(1, failure.buildLogs.size());
 #endif
 }
 
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-/// Stub for testing boolean specialization constants
-static cl_int clSetProgramSpecializationConstant_testBool(
-    cl_program program,
-    cl_uint spec_id,
-    size_t spec_size,
-    const void* spec_value,
+static int buildParallelCalls;
+
+static cl_int clBuildProgram_testBuildParallel(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
     int num_calls)
 {
+    (void) options;
     (void) num_calls;
 
     TEST_ASSERT_EQUAL_PTR(make_program(0), program);
-    TEST_ASSERT(spec_id == 0 || spec_id == 1);
-    TEST_ASSERT_EQUAL(spec_size, 1);
-    if (spec_id == 0)
-    {
-        const cl_uchar *uc_value = (const cl_uchar*)spec_value;
-        TEST_ASSERT_EQUAL_HEX(uc_value[0], 0);
+    TEST_ASSERT_EQUAL(1, num_devices);
+    TEST_ASSERT_EQUAL(nullptr, pfn_notify);
+    TEST_ASSERT_EQUAL(nullptr, user_data);
+
+    buildParallelCalls++;
+    return device_list[0] == make_device_id(1) ? CL_BUILD_PROGRAM_FAILURE : CL_SUCCESS;
+}
+
+void testBuildProgramParallel(void)
+{
+    buildParallelCalls = 0;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildParallel);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
+
+    cl::vector<cl::Device> devices;
+    devices.push_back(cl::Device(make_device_id(0)));
+    devices.push_back(cl::Device(make_device_id(1)));
+    devices.push_back(cl::Device(make_device_id(2)));
+
+    cl_int errcode = CL_SUCCESS;
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    try {
+        programPool[0].buildParallel(devices, nullptr, 1);
     }
-    if (spec_id == 1)
-    {
-        const cl_uchar *uc_value = (const cl_uchar*)spec_value;
-        TEST_ASSERT_EQUAL_HEX(uc_value[0], CL_UCHAR_MAX);
+    catch (cl::BuildError &e) {
+        errcode = e.err();
+        cl::BuildLogType logs = e.getBuildLog();
+        TEST_ASSERT_EQUAL(3, logs.size());
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_EQUAL_PTR(make_device_id(i), logs[i].first());
+        }
     }
-    return CL_SUCCESS;
-}
+#else
+    errcode = programPool[0].buildParallel(devices, nullptr, 1);
 #endif
 
-void testSetProgramSpecializationConstantBool(void)
-{
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-    // Spec constant "false" should turn into a call with size one and no bits set.
-    // Spec constant "true" should turn into a call with size one and all bits set.
-    cl_program program = make_program(0);
-    bool scFalse = false;
-    bool scTrue = true;
+    TEST_ASSERT_EQUAL(CL_BUILD_PROGRAM_FAILURE, errcode);
+    TEST_ASSERT_EQUAL(3, buildParallelCalls);
+}
 
-    clSetProgramSpecializationConstant_StubWithCallback(clSetProgramSpecializationConstant_testBool);
+static std::atomic<int> buildParallelDeviceBuilds[3];
+static std::atomic<int> buildParallelUnexpectedCalls;
 
-    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+// Called from several threads, so failures are counted rather than asserted
+static cl_int clBuildProgram_testBuildParallelThreads(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    int num_calls)
+{
+    (void) options;
+    (void) num_calls;
 
-    cl::Program prog(program);
+    size_t index = (size_t) device_list[0] - (size_t) make_device_id(0);
+    if (program != make_program(0) || num_devices != 1 ||
+        pfn_notify != nullptr || user_data != nullptr || index >= 3) {
+        buildParallelUnexpectedCalls++;
+        return CL_INVALID_VALUE;
+    }
 
-    prog.setSpecializationConstant(0, scFalse);
-    prog.setSpecializationConstant(1, scTrue);
-#endif
+    buildParallelDeviceBuilds[index]++;
+    return CL_SUCCESS;
 }
 
-void testSetProgramSpecializationConstantPointer(void)
+void testBuildProgramParallelThreads(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 220
-    cl_program program = make_program(0);
-    int scArray[5] = {};
+    for (std::atomic<int>& builds : buildParallelDeviceBuilds) {
+        builds = 0;
+    }
+    buildParallelUnexpectedCalls = 0;
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clBuildProgram_StubWithCallback(clBuildProgram_testBuildParallelThreads);
 
-    clSetProgramSpecializationConstant_ExpectAndReturn(program, 0, sizeof(scArray), &scArray, CL_SUCCESS);
-    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+    cl::vector<cl::Device> devices;
+    devices.push_back(cl::Device(make_device_id(0)));
+    devices.push_back(cl::Device(make_device_id(1)));
+    devices.push_back(cl::Device(make_device_id(2)));
 
-    cl::Program prog(program);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, programPool[0].buildParallel(devices, nullptr, 3));
 
-    prog.setSpecializationConstant(0, sizeof(scArray), scArray);
-#endif
+    TEST_ASSERT_EQUAL(0, buildParallelUnexpectedCalls.load());
+    for (std::atomic<int>& builds : buildParallelDeviceBuilds) {
+        TEST_ASSERT_EQUAL(1, builds.load());
+    }
 }
 
-// OpenCL 3.0 and cl_khr_extended_versioning Queries
-
-// Assumes the core enums, structures, and macros exactly match
-// the extension enums, structures, and macros:
+/****************************************************************************
+* Tests for cl::ProgramBinaryCache
+****************************************************************************/
 
-static_assert(CL_PLATFORM_NUMERIC_VERSION == CL_PLATFORM_NUMERIC_VERSION_KHR,
-    "CL_PLATFORM_NUMERIC_VERSION mismatch");
-static_assert(CL_PLATFORM_EXTENSIONS_WITH_VERSION == CL_PLATFORM_EXTENSIONS_WITH_VERSION_KHR,
-    "CL_PLATFORM_EXTENSIONS_WITH_VERSION mismatch");
+static const char programBinaryCacheSource[] = "kernel void test() {}";
+static const char programBinaryCacheOtherSource[] = "kernel void other() {}";
+static const unsigned char programBinaryCacheBinary[] = { 0xca, 0xfe, 0xf0, 0x0d };
+static int programBinaryCacheSourceBuilds;
+static int programBinaryCacheBinaryBuilds;
+static std::string programBinaryCacheDirectory;
+static int programBinaryCacheDirectories;
 
-static_assert(CL_DEVICE_NUMERIC_VERSION == CL_DEVICE_NUMERIC_VERSION_KHR,
-    "CL_DEVICE_NUMERIC_VERSION mismatch");
-static_assert(CL_DEVICE_EXTENSIONS_WITH_VERSION == CL_DEVICE_EXTENSIONS_WITH_VERSION_KHR,
-    "CL_DEVICE_EXTENSIONS_WITH_VERSION mismatch");
-static_assert(CL_DEVICE_ILS_WITH_VERSION == CL_DEVICE_ILS_WITH_VERSION_KHR,
-    "CL_DEVICE_ILS_WITH_VERSION mismatch");
-static_assert(CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION == CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION_KHR,
-    "CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION mismatch");
+// Each test gets a fresh directory, removed again by tearDown()
+static std::string makeProgramBinaryCacheDirectory(void)
+{
+#if defined(_WIN32)
+    const char *base = getenv("TEMP");
+    int pid = _getpid();
+#else
+    const char *base = getenv("TMPDIR");
+    if (base == nullptr)
+        base = "/tmp";
+    int pid = (int) getpid();
+#endif
+    programBinaryCacheDirectory = std::string(base != nullptr ? base : ".") +
+        "/clhpp_binary_cache_" + std::to_string(pid) + "_" +
+        std::to_string(programBinaryCacheDirectories++);
+#if defined(_WIN32)
+    TEST_ASSERT_EQUAL(0, _mkdir(programBinaryCacheDirectory.c_str()));
+#else
+    TEST_ASSERT_EQUAL(0, mkdir(programBinaryCacheDirectory.c_str(), 0700));
+#endif
+    return programBinaryCacheDirectory;
+}
 
-static_assert(sizeof(cl_name_version) == sizeof(cl_name_version_khr),
-    "cl_name_version mismatch");
+static void removeProgramBinaryCacheDirectory(void)
+{
+    if (programBinaryCacheDirectory.empty()) {
+        return;
+    }
+    cl::ProgramBinaryCache(programBinaryCacheDirectory).clear();
+#if defined(_WIN32)
+    _rmdir(programBinaryCacheDirectory.c_str());
+#else
+    rmdir(programBinaryCacheDirectory.c_str());
+#endif
+    programBinaryCacheDirectory.clear();
+}
 
-static_assert(CL_MAKE_VERSION(1, 2, 3) == CL_MAKE_VERSION_KHR(1, 2, 3),
-    "CL_MAKE_VERSION mismatch");
+static cl_int returnInfoString(
+    const char *value,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret)
+{
+    size_t bytes = strlen(value) + 1;
+    TEST_ASSERT(param_value == nullptr || param_value_size >= bytes);
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = bytes;
+    if (param_value != nullptr)
+        strcpy((char *) param_value, value);
+    return CL_SUCCESS;
+}
 
-static cl_int clGetPlatformInfo_extended_versioning(
-    cl_platform_id id,
-    cl_platform_info param_name,
+static cl_int clGetDeviceInfo_programBinaryCache(
+    cl_device_id id,
+    cl_device_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) id;
+    switch (param_name) {
+    case CL_DEVICE_NAME:
+        return returnInfoString("Mock Device", param_value_size, param_value, param_value_size_ret);
+    case CL_DRIVER_VERSION:
+        return returnInfoString("1.0 Mock", param_value_size, param_value, param_value_size_ret);
+    default:
+        return clGetDeviceInfo_platform(
+            id, param_name, param_value_size, param_value, param_value_size_ret, num_calls);
+    }
+}
+
+static cl_program clCreateProgramWithSource_programBinaryCache(
+    cl_context context,
+    cl_uint count,
+    const char **strings,
+    const size_t *lengths,
+    cl_int *errcode_ret,
+    int num_calls)
+{
     (void) num_calls;
 
-    switch (param_name) {
-    case CL_PLATFORM_NUMERIC_VERSION:
-    {
-        if (param_value_size == sizeof(cl_version) && param_value) {
-            *static_cast<cl_version*>(param_value) = CL_MAKE_VERSION(1, 2, 3);
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_version);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_PLATFORM_EXTENSIONS_WITH_VERSION:
-    {
-        static cl_name_version extension = {
-            CL_MAKE_VERSION(10, 11, 12),
-            "cl_dummy_extension",
-        };
-        if (param_value_size == sizeof(cl_name_version) && param_value) {
-            *static_cast<cl_name_version*>(param_value) = extension;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(extension);
-        }
-        return CL_SUCCESS;
-    }
-    default: break;
-    }
-    TEST_FAIL();
-    return CL_INVALID_OPERATION;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(1, count);
+    const char *source = programBinaryCacheSource;
+    if (lengths[0] == strlen(programBinaryCacheOtherSource) &&
+        memcmp(programBinaryCacheOtherSource, strings[0], lengths[0]) == 0)
+        source = programBinaryCacheOtherSource;
+    TEST_ASSERT_EQUAL(strlen(source), lengths[0]);
+    TEST_ASSERT_EQUAL(0, memcmp(source, strings[0], lengths[0]));
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_program(0);
 }
 
-void testPlatformExtendedVersioning_3_0(void)
+static cl_program clCreateProgramWithBinary_programBinaryCache(
+    cl_context context,
+    cl_uint num_devices,
+    const cl_device_id *device_list,
+    const size_t *lengths,
+    const unsigned char **binaries,
+    cl_int *binary_status,
+    cl_int *errcode_ret,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 300
-    cl::Platform p(make_platform_id(1));
-
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_extended_versioning);
-
-    cl_version platformVersion = p.getInfo<CL_PLATFORM_NUMERIC_VERSION>();
-    TEST_ASSERT_EQUAL_HEX(platformVersion, CL_MAKE_VERSION(1, 2, 3));
+    (void) num_calls;
 
-    std::vector<cl_name_version> extensions = p.getInfo<CL_PLATFORM_EXTENSIONS_WITH_VERSION>();
-    TEST_ASSERT_EQUAL(extensions.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION(10, 11, 12));
-    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 300
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(1, num_devices);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device_list[0]);
+    TEST_ASSERT_EQUAL(sizeof(programBinaryCacheBinary), lengths[0]);
+    TEST_ASSERT_EQUAL(0, memcmp(programBinaryCacheBinary, binaries[0], lengths[0]));
+    if (binary_status != nullptr)
+        binary_status[0] = CL_SUCCESS;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_program(1);
 }
 
-void testPlatformExtendedVersioning_KHR(void)
+static cl_program clCreateProgramWithBinary_rejectBinary(
+    cl_context context,
+    cl_uint num_devices,
+    const cl_device_id *device_list,
+    const size_t *lengths,
+    const unsigned char **binaries,
+    cl_int *binary_status,
+    cl_int *errcode_ret,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION < 300
-    cl::Platform p(make_platform_id(1));
-
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_extended_versioning);
-
-    cl_version_khr platformVersion = p.getInfo<CL_PLATFORM_NUMERIC_VERSION_KHR>();
-    TEST_ASSERT_EQUAL_HEX(platformVersion, CL_MAKE_VERSION_KHR(1, 2, 3));
+    (void) context;
+    (void) device_list;
+    (void) lengths;
+    (void) binaries;
+    (void) num_calls;
 
-    std::vector<cl_name_version_khr> extensions = p.getInfo<CL_PLATFORM_EXTENSIONS_WITH_VERSION_KHR>();
-    TEST_ASSERT_EQUAL(extensions.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION_KHR(10, 11, 12));
-    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
-#endif // CL_HPP_TARGET_OPENCL_VERSION < 300
+    TEST_ASSERT_EQUAL(1, num_devices);
+    if (binary_status != nullptr)
+        binary_status[0] = CL_INVALID_BINARY;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_INVALID_BINARY;
+    return nullptr;
 }
 
+static cl_int clBuildProgram_programBinaryCache(
+    cl_program           program,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    int num_calls)
+{
+    (void) pfn_notify;
+    (void) user_data;
+    (void) num_calls;
 
-// Note: This assumes the core enums, structures, and macros exactly match
-// the extension enums, structures, and macros.
+    TEST_ASSERT_EQUAL(1, num_devices);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device_list[0]);
+    TEST_ASSERT_EQUAL_STRING("-cl-fast-relaxed-math", options);
+    if (program == make_program(0))
+        programBinaryCacheSourceBuilds++;
+    else
+        programBinaryCacheBinaryBuilds++;
+    return CL_SUCCESS;
+}
 
-static cl_int clGetDeviceInfo_extended_versioning(
-    cl_device_id id,
-    cl_device_info param_name,
+static cl_int clGetProgramInfo_programBinaryCache(
+    cl_program program,
+    cl_program_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) id;
+    (void) program;
     (void) num_calls;
 
     switch (param_name) {
-    case CL_DEVICE_NUMERIC_VERSION:
-    {
-        if (param_value_size == sizeof(cl_version) && param_value) {
-            *static_cast<cl_version*>(param_value) = CL_MAKE_VERSION(1, 2, 3);
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_version);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_OPENCL_C_NUMERIC_VERSION_KHR:
-    {
-        if (param_value_size == sizeof(cl_version_khr) && param_value) {
-            *static_cast<cl_version_khr*>(param_value) = CL_MAKE_VERSION_KHR(4, 5, 6);
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_version_khr);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_EXTENSIONS_WITH_VERSION:
-    {
-        static cl_name_version extension = {
-            CL_MAKE_VERSION(10, 11, 12),
-            "cl_dummy_extension",
-        };
-        if (param_value_size == sizeof(cl_name_version) && param_value) {
-            *static_cast<cl_name_version*>(param_value) = extension;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(extension);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_ILS_WITH_VERSION:
-    {
-        static cl_name_version il = {
-            CL_MAKE_VERSION(20, 21, 22),
-            "DUMMY_IR",
-        };
-        if (param_value_size == sizeof(cl_name_version) && param_value) {
-            *static_cast<cl_name_version*>(param_value) = il;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(il);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION:
-    {
-        // Test no built-in kernels:
-        if (param_value_size_ret) {
-            *param_value_size_ret = 0;
-        }
+    case CL_PROGRAM_DEVICES:
+        if (param_value_size_ret != nullptr)
+            *param_value_size_ret = sizeof(cl_device_id);
+        if (param_value != nullptr)
+            *(cl_device_id *) param_value = make_device_id(0);
         return CL_SUCCESS;
-    }
-    case CL_DEVICE_OPENCL_C_ALL_VERSIONS:
-    {
-        static cl_name_version opencl_c = {
-            CL_MAKE_VERSION(30, 31, 32),
-            "OpenCL C",
-        };
-        if (param_value_size == sizeof(cl_name_version) && param_value) {
-            *static_cast<cl_name_version*>(param_value) = opencl_c;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(opencl_c);
-        }
+    case CL_PROGRAM_BINARY_SIZES:
+        if (param_value_size_ret != nullptr)
+            *param_value_size_ret = sizeof(size_t);
+        if (param_value != nullptr)
+            *(size_t *) param_value = sizeof(programBinaryCacheBinary);
         return CL_SUCCESS;
-    }
-    case CL_DEVICE_OPENCL_C_FEATURES:
-    {
-        static cl_name_version opencl_c_features[] = {
-            {
-                CL_MAKE_VERSION(40, 41, 42),
-                "__opencl_c_feature",
-            },
-            {
-                CL_MAKE_VERSION(40, 43, 44),
-                "__opencl_c_fancy_feature",
-            },
-        };
-        if (param_value_size == sizeof(opencl_c_features) && param_value) {
-            cl_name_version* feature = static_cast<cl_name_version*>(param_value);
-            const int numFeatures = ARRAY_SIZE(opencl_c_features);
-            for (int i = 0; i < numFeatures; i++) {
-                feature[i] = opencl_c_features[i];
-            }
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(opencl_c_features);
-        }
+    case CL_PROGRAM_BINARIES:
+        TEST_ASSERT_EQUAL(sizeof(unsigned char *), param_value_size);
+        memcpy(((unsigned char **) param_value)[0],
+               programBinaryCacheBinary, sizeof(programBinaryCacheBinary));
         return CL_SUCCESS;
+    default:
+        TEST_FAIL();
+        return CL_INVALID_VALUE;
     }
-    default: break;
-    }
-    TEST_FAIL();
-    return CL_INVALID_OPERATION;
 }
 
-void testDeviceExtendedVersioning_3_0(void)
+static void prepareProgramBinaryCacheStubs(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 300
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_3_0);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    programBinaryCacheSourceBuilds = 0;
+    programBinaryCacheBinaryBuilds = 0;
 
-    cl::Device d0(make_device_id(0));
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_programBinaryCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clCreateProgramWithSource_StubWithCallback(clCreateProgramWithSource_programBinaryCache);
+    clBuildProgram_StubWithCallback(clBuildProgram_programBinaryCache);
+    clGetProgramInfo_StubWithCallback(clGetProgramInfo_programBinaryCache);
+    clGetProgramBuildInfo_StubWithCallback(clGetProgramBuildInfo_testGetBuildInfo);
+}
 
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_extended_versioning);
+static cl::Program::Sources makeProgramBinaryCacheSources(
+    const char *source = programBinaryCacheSource)
+{
+#if !defined(CL_HPP_ENABLE_PROGRAM_CONSTRUCTION_FROM_ARRAY_COMPATIBILITY)
+    return cl::Program::Sources(1, source);
+#else
+    return cl::Program::Sources(1, std::make_pair(source, strlen(source)));
+#endif
+}
 
-    cl_version deviceVersion = d0.getInfo<CL_DEVICE_NUMERIC_VERSION>();
-    TEST_ASSERT_EQUAL_HEX(deviceVersion, CL_MAKE_VERSION(1, 2, 3));
+void testProgramBinaryCacheReusesBinaries(void)
+{
+    prepareProgramBinaryCacheStubs();
+    clCreateProgramWithBinary_StubWithCallback(clCreateProgramWithBinary_programBinaryCache);
 
-    std::vector<cl_name_version> extensions = d0.getInfo<CL_DEVICE_EXTENSIONS_WITH_VERSION>();
-    TEST_ASSERT_EQUAL(extensions.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION(10, 11, 12));
-    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+    cl_program programs[] = { make_program(0), make_program(1) };
+    int refcounts[] = { 1, 1 };
+    prepare_programRefcounts(2, programs, refcounts);
 
-    std::vector<cl_name_version> ils = d0.getInfo<CL_DEVICE_ILS_WITH_VERSION>();
-    TEST_ASSERT_EQUAL(ils.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(ils[0].version, CL_MAKE_VERSION(20, 21, 22));
-    TEST_ASSERT_EQUAL_STRING(ils[0].name, "DUMMY_IR");
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    cl::Program::Sources sources = makeProgramBinaryCacheSources();
+    cl::ProgramBinaryCache cache(makeProgramBinaryCacheDirectory());
 
-    std::vector<cl_name_version> opencl_c = d0.getInfo<CL_DEVICE_OPENCL_C_ALL_VERSIONS>();
-    TEST_ASSERT_EQUAL(opencl_c.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(opencl_c[0].version, CL_MAKE_VERSION(30, 31, 32));
-    TEST_ASSERT_EQUAL_STRING(opencl_c[0].name, "OpenCL C");
+    cl_int err;
+    cl::Program first = cache.build(contextPool[0], devices, sources, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_program(0), first());
+    TEST_ASSERT_EQUAL(1, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(sizeof(programBinaryCacheBinary), cache.size());
 
-    std::vector<cl_name_version> opencl_c_features = d0.getInfo<CL_DEVICE_OPENCL_C_FEATURES>();
-    TEST_ASSERT_EQUAL(opencl_c_features.size(), 2);
-    TEST_ASSERT_EQUAL_HEX(opencl_c_features[0].version, CL_MAKE_VERSION(40, 41, 42));
-    TEST_ASSERT_EQUAL_STRING(opencl_c_features[0].name, "__opencl_c_feature");
-    TEST_ASSERT_EQUAL_HEX(opencl_c_features[1].version, CL_MAKE_VERSION(40, 43, 44));
-    TEST_ASSERT_EQUAL_STRING(opencl_c_features[1].name, "__opencl_c_fancy_feature");
+    cl::Program second = cache.build(contextPool[0], devices, sources, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_program(1), second());
+    TEST_ASSERT_EQUAL(1, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(1, programBinaryCacheBinaryBuilds);
 
-    std::vector<cl_name_version> builtInKernels = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION>();
-    TEST_ASSERT_EQUAL(builtInKernels.size(), 0);
-#endif // CL_HPP_TARGET_OPENCL_VERSION >= 300
+    cache.clear();
+    TEST_ASSERT_EQUAL(0, cache.size());
 }
 
-void testDeviceExtendedVersioning_KHR(void)
+void testProgramBinaryCacheRebuildsRejectedBinaries(void)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION < 300
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    prepareProgramBinaryCacheStubs();
+    clCreateProgramWithBinary_StubWithCallback(clCreateProgramWithBinary_rejectBinary);
 
-    cl::Device d0(make_device_id(0));
+    cl_program programs[] = { make_program(0) };
+    int refcounts[] = { 2 };
+    prepare_programRefcounts(1, programs, refcounts);
 
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_extended_versioning);
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    cl::Program::Sources sources = makeProgramBinaryCacheSources();
+    cl::ProgramBinaryCache cache(makeProgramBinaryCacheDirectory());
 
-    cl_version_khr deviceVersion = d0.getInfo<CL_DEVICE_NUMERIC_VERSION_KHR>();
-    TEST_ASSERT_EQUAL_HEX(deviceVersion, CL_MAKE_VERSION_KHR(1, 2, 3));
+    cl_int err;
+    cl::Program first = cache.build(contextPool[0], devices, sources, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
 
-    cl_version_khr cVersion = d0.getInfo<CL_DEVICE_OPENCL_C_NUMERIC_VERSION_KHR>();
-    TEST_ASSERT_EQUAL_HEX(cVersion, CL_MAKE_VERSION_KHR(4, 5, 6));
+    cl::Program second = cache.build(contextPool[0], devices, sources, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_program(0), second());
+    TEST_ASSERT_EQUAL(2, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(0, programBinaryCacheBinaryBuilds);
 
-    std::vector<cl_name_version_khr> extensions = d0.getInfo<CL_DEVICE_EXTENSIONS_WITH_VERSION_KHR>();
-    TEST_ASSERT_EQUAL(extensions.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION_KHR(10, 11, 12));
-    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+    cache.clear();
+}
 
-    std::vector<cl_name_version_khr> ils = d0.getInfo<CL_DEVICE_ILS_WITH_VERSION_KHR>();
-    TEST_ASSERT_EQUAL(ils.size(), 1);
-    TEST_ASSERT_EQUAL_HEX(ils[0].version, CL_MAKE_VERSION_KHR(20, 21, 22));
-    TEST_ASSERT_EQUAL_STRING(ils[0].name, "DUMMY_IR");
+void testProgramBinaryCacheEvictsLeastRecentlyUsed(void)
+{
+    prepareProgramBinaryCacheStubs();
+    clCreateProgramWithBinary_StubWithCallback(clCreateProgramWithBinary_programBinaryCache);
+
+    // Every source build returns make_program(0)
+    cl_program programs[] = { make_program(0), make_program(1) };
+    int refcounts[] = { 3, 1 };
+    prepare_programRefcounts(2, programs, refcounts);
+
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    cl::Program::Sources first = makeProgramBinaryCacheSources();
+    cl::Program::Sources second = makeProgramBinaryCacheSources(programBinaryCacheOtherSource);
+    // Room for a single entry
+    cl::ProgramBinaryCache cache(
+        makeProgramBinaryCacheDirectory(), sizeof(programBinaryCacheBinary));
+
+    cl_int err;
+    cache.build(contextPool[0], devices, first, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    cache.build(contextPool[0], devices, second, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL(2, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(sizeof(programBinaryCacheBinary), cache.size());
+
+    // The second entry is still cached
+    cache.build(contextPool[0], devices, second, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL(2, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(1, programBinaryCacheBinaryBuilds);
+
+    // The first one was evicted and is built from source again
+    cache.build(contextPool[0], devices, first, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL(3, programBinaryCacheSourceBuilds);
+    TEST_ASSERT_EQUAL(1, programBinaryCacheBinaryBuilds);
+    TEST_ASSERT_EQUAL(sizeof(programBinaryCacheBinary), cache.size());
+}
+
+void testProgramBinaryCacheBreaksStaleLock(void)
+{
+    prepareProgramBinaryCacheStubs();
+
+    cl_program programs[] = { make_program(0) };
+    int refcounts[] = { 1 };
+    prepare_programRefcounts(1, programs, refcounts);
+
+    // Left behind an hour ago by a process that died holding the lock
+    std::string directory = makeProgramBinaryCacheDirectory();
+    std::string lockPath = directory + "/index.lock";
+    FILE *lock = fopen(lockPath.c_str(), "w");
+    TEST_ASSERT_NOT_NULL(lock);
+    fclose(lock);
+#if defined(_WIN32)
+    struct _utimbuf times;
+    times.actime = times.modtime = time(nullptr) - 3600;
+    TEST_ASSERT_EQUAL(0, _utime(lockPath.c_str(), &times));
+#else
+    struct utimbuf times;
+    times.actime = times.modtime = time(nullptr) - 3600;
+    TEST_ASSERT_EQUAL(0, utime(lockPath.c_str(), &times));
+#endif
+
+    cl::vector<cl::Device> devices(1, cl::Device(make_device_id(0)));
+    cl::Program::Sources sources = makeProgramBinaryCacheSources();
+    cl::ProgramBinaryCache cache(directory);
+
+    cl_int err;
+    cl::Program program = cache.build(contextPool[0], devices, sources, "-cl-fast-relaxed-math", &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL(sizeof(programBinaryCacheBinary), cache.size());
+
+    // The lock was taken over and released again
+    TEST_ASSERT_NULL(fopen(lockPath.c_str(), "r"));
+}
+
+/**
+* Stub implementation of clGetCommandQueueInfo that returns first one image then none
+*/
+static cl_int clGetSupportedImageFormats_testGetSupportedImageFormats(
+    cl_context context,
+    cl_mem_flags flags,
+    cl_mem_object_type image_type,
+    cl_uint num_entries,
+    cl_image_format *image_formats,
+    cl_uint *num_image_formats,
+    int num_calls)
+{
+    (void) context;
+    (void) flags;
+    (void) image_type;
+
+    // Catch failure case that causes error in bugzilla 13355:
+    // returns CL_INVALID_VALUE if flags or image_type are not valid, 
+    // or if num_entries is 0 and image_formats is not nullptr.
+    if (num_entries == 0 && image_formats != nullptr) {
+        return CL_INVALID_VALUE;
+    }
+    if (num_entries == 0)  {
+        // If num_entries was 0 this is the query for number
+        if (num_image_formats) {
+            if (num_calls == 0) {
+                *num_image_formats = 1;
+            }
+            else {
+                *num_image_formats = 0;
+            }
+        }
+    }
+    else {
+        // Should return something
+        TEST_ASSERT_NOT_NULL(image_formats);
+        
+        // For first call we should return one format here
+        if (num_calls == 1) {
+            TEST_ASSERT_EQUAL(num_entries, 1);
+            image_formats[0] = cl::ImageFormat(CL_RGB, CL_FLOAT);
+        }
+    }
+
+    return CL_SUCCESS;
+}
+
+void testGetSupportedImageFormats(void)
+{
+    cl_context ctx_cl = make_context(0);
+
+    clGetSupportedImageFormats_StubWithCallback(clGetSupportedImageFormats_testGetSupportedImageFormats);
+    clGetSupportedImageFormats_StubWithCallback(clGetSupportedImageFormats_testGetSupportedImageFormats);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    cl::Context ctx(ctx_cl);
+    std::vector<cl::ImageFormat> formats;
+    cl_int ret = CL_SUCCESS;
+
+    ret = ctx.getSupportedImageFormats(
+        CL_MEM_READ_WRITE,
+        CL_MEM_OBJECT_IMAGE2D,
+        &formats);
+    TEST_ASSERT_EQUAL(ret, CL_SUCCESS);
+    TEST_ASSERT_EQUAL(formats.size(), 1);
+    ret = ctx.getSupportedImageFormats(
+        CL_MEM_READ_WRITE,
+        CL_MEM_OBJECT_IMAGE2D,
+        &formats);
+    TEST_ASSERT_EQUAL(formats.size(), 0);
+    TEST_ASSERT_EQUAL(ret, CL_SUCCESS);
+}
+
+void testCreateSubDevice(void)
+{
+    // TODO
+
+}
+
+void testGetContextInfoDevices(void)
+{
+    // TODO
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_mem clCreateImage_testCreateImage2DFromBuffer_2_0(
+    cl_context context,
+    cl_mem_flags flags,
+    const cl_image_format *image_format,
+    const cl_image_desc *image_desc,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) context;
+    (void) flags;
+    (void) num_calls;
+
+    TEST_ASSERT_NOT_NULL(image_format);
+    TEST_ASSERT_NOT_NULL(image_desc);
+    TEST_ASSERT_NULL(host_ptr);
+    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
+
+    // Return the passed buffer as the cl_mem and success for the error code
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return image_desc->buffer;
+}
+#endif
+
+void testCreateImage2DFromBuffer_2_0(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2DFromBuffer_2_0);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    cl_int err;
+    cl::Context context(make_context(0));
+
+    // Create buffer
+    // Create image from buffer
+    cl::Buffer buffer(make_mem(0));
+    cl::Image2D imageFromBuffer(
+        context,
+        cl::ImageFormat(CL_R, CL_FLOAT), buffer, 64, 32, 256, &err);
+
+    TEST_ASSERT_EQUAL_PTR(buffer(), imageFromBuffer());
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+
+    buffer() = nullptr;
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_mem clCreateImage_testCreateImage2D_2_0(
+    cl_context context,
+    cl_mem_flags flags,
+    const cl_image_format *image_format,
+    const cl_image_desc *image_desc,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL_HEX(CL_MEM_READ_WRITE, flags);
+
+    TEST_ASSERT_NOT_NULL(image_format);
+    TEST_ASSERT_EQUAL_HEX(CL_RGBA, image_format->image_channel_order);
+    TEST_ASSERT_EQUAL_HEX(CL_FLOAT, image_format->image_channel_data_type);
+
+    TEST_ASSERT_NOT_NULL(image_desc);
+    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
+    TEST_ASSERT_EQUAL(64, image_desc->image_width);
+    TEST_ASSERT_EQUAL(32, image_desc->image_height);
+    TEST_ASSERT_EQUAL(256, image_desc->image_row_pitch);
+    TEST_ASSERT_EQUAL(0, image_desc->num_mip_levels);
+    TEST_ASSERT_EQUAL(0, image_desc->num_samples);
+    TEST_ASSERT_NULL(image_desc->buffer);
+
+    TEST_ASSERT_NULL(host_ptr);
+
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_mem(0);
+}
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_mem clCreateImage_testCreateImage2DFromImage_2_0(
+    cl_context context,
+    cl_mem_flags flags,
+    const cl_image_format *image_format,
+    const cl_image_desc *image_desc,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) context;
+    (void) flags;
+    (void) num_calls;
+
+    TEST_ASSERT_NOT_NULL(image_format);
+    TEST_ASSERT_NOT_NULL(image_desc);
+    TEST_ASSERT_NULL(host_ptr);
+    TEST_ASSERT_EQUAL_HEX(CL_MEM_OBJECT_IMAGE2D, image_desc->image_type);
+
+    // Return the passed buffer as the cl_mem and success for the error code
+    if (errcode_ret) {
+        *errcode_ret = CL_SUCCESS;
+    }
+    return image_desc->buffer;
+}
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_int clGetImageInfo_testCreateImage2DFromImage_2_0(
+    cl_mem image,
+    cl_image_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) image;
+    (void) param_name;
+    (void) param_value_size;
+    (void) param_value;
+    (void) param_value_size_ret;
+
+    TEST_ASSERT_INT_WITHIN(6, 0, num_calls);
+    return CL_SUCCESS;
+}
+#endif
+
+void testCreateImage2DFromImage_2_0(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2D_2_0);
+
+
+    cl_int err;
+    cl::Context context(make_context(0));
+
+    // As in 1.2 2D image test, needed as source for image-from-image
+    cl::Image2D image(
+        context, CL_MEM_READ_WRITE,
+        cl::ImageFormat(CL_RGBA, CL_FLOAT), 64, 32, 256, nullptr, &err);
+
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), image());
+
+    // Continue state for next phase
+    clGetImageInfo_StubWithCallback(clGetImageInfo_testCreateImage2DFromImage_2_0);
+    clCreateImage_StubWithCallback(clCreateImage_testCreateImage2DFromImage_2_0);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    // Create 2D image from 2D Image with a new channel order
+    cl::Image2D imageFromImage(
+        context,
+        CL_sRGB,
+        image,
+        &err
+        );
+
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(image(), imageFromImage());
+
+    //imageFromImage() = nullptr;
+    //image() = nullptr;
+    //context() = nullptr;
+#endif
+}
+
+// Note that default tests maintain state when run from the same
+// unit process.
+// One default setting test will maintain the defaults until the end.
+void testSetDefaultPlatform(void)
+{
+    cl::Platform p(make_platform_id(1));
+    cl::Platform p2 = cl::Platform::setDefault(p);
+    cl::Platform p3 = cl::Platform::getDefault();
+    TEST_ASSERT_EQUAL(p(), p2());
+    TEST_ASSERT_EQUAL(p(), p3());
+}
+
+// Note that default tests maintain state when run from the same
+// unit process.
+// One default setting test will maintain the defaults until the end.
+void testSetDefaultPlatformTwice(void)
+{
+    cl::Platform p(make_platform_id(2));
+    cl::Platform p2 = cl::Platform::getDefault();
+    cl::Platform p3 = cl::Platform::setDefault(p);
+    // Set default should have failed
+    TEST_ASSERT_EQUAL(p2(), p3());
+    TEST_ASSERT_NOT_EQUAL(p(), p3());
+}
+
+// Note that default tests maintain state when run from the same
+// unit process.
+// One default setting test will maintain the defaults until the end.
+void testSetDefaultContext(void)
+{   
+
+    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+
+    cl::Context c(make_context(1));
+    cl::Context c2 = cl::Context::setDefault(c);
+    cl::Context c3 = cl::Context::getDefault();
+    TEST_ASSERT_EQUAL(c(), c2());
+    TEST_ASSERT_EQUAL(c(), c3());
+    // No reference is added
+    TEST_ASSERT_EQUAL(c(), cl::Context::getDefaultRef()());
+}
+
+// Note that default tests maintain state when run from the same
+// unit process.
+// One default setting test will maintain the defaults until the end.
+void testSetDefaultCommandQueue(void)
+{
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+
+    cl::CommandQueue c(make_command_queue(1));
+    cl::CommandQueue c2 = cl::CommandQueue::setDefault(c);
+    cl::CommandQueue c3 = cl::CommandQueue::getDefault();
+    TEST_ASSERT_EQUAL(c(), c2());
+    TEST_ASSERT_EQUAL(c(), c3());
+    // No reference is added
+    TEST_ASSERT_EQUAL(c(), cl::CommandQueue::getDefaultRef()());
+}
+
+// Note that default tests maintain state when run from the same
+// unit process.
+// One default setting test will maintain the defaults until the end.
+void testSetDefaultDevice(void)
+{
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+
+    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clRetainDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+
+    cl::Device d(make_device_id(1));
+    cl::Device  d2 = cl::Device::setDefault(d);
+    cl::Device  d3 = cl::Device::getDefault();
+    TEST_ASSERT_EQUAL(d(), d2());
+    TEST_ASSERT_EQUAL(d(), d3());
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_command_queue clCreateCommandQueueWithProperties_testCommandQueueDevice(
+    cl_context context,
+    cl_device_id device,
+    const cl_queue_properties *properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(1), context);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), device);
+    TEST_ASSERT_EQUAL(properties[0], CL_QUEUE_PROPERTIES);
+    static cl_command_queue default_ = 0;
+
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+
+    if ((properties[1] & CL_QUEUE_ON_DEVICE_DEFAULT) == 0) {
+        TEST_ASSERT_EQUAL(properties[1], (CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE));
+        if (properties[2] == CL_QUEUE_SIZE) {
+            TEST_ASSERT_EQUAL(properties[3], 256);
+            TEST_ASSERT_EQUAL(properties[4], 0);
+            return make_command_queue(2);
+        }
+        else {
+            TEST_ASSERT_EQUAL(properties[2], 0);
+            return make_command_queue(3);
+        }
+    }
+    else {
+        TEST_ASSERT_EQUAL(properties[1], (CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_ON_DEVICE | CL_QUEUE_ON_DEVICE_DEFAULT));
+        if (default_ == 0) {
+            default_ = make_command_queue(4);
+        }
+        return default_;
+    }
+}
+#endif
+
+void testCreateDeviceCommandQueue(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clRetainContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clCreateCommandQueueWithProperties_StubWithCallback(clCreateCommandQueueWithProperties_testCommandQueueDevice);       
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(4), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(4), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(3), CL_SUCCESS);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+
+    cl::Context c(make_context(1));
+    cl::Context c2 = cl::Context::setDefault(c);
+    cl::Device d(make_device_id(1));
+
+    cl::DeviceCommandQueue dq(c, d);
+    cl::DeviceCommandQueue dq2(c, d, 256);    
+
+    cl::DeviceCommandQueue dqd = cl::DeviceCommandQueue::makeDefault(c, d);
+    cl::DeviceCommandQueue dqd2 = cl::DeviceCommandQueue::makeDefault(c, d);
+
+    TEST_ASSERT_EQUAL(dqd(), dqd2());
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_mem clCreatePipe_testCreatePipe(
+    cl_context context,
+    cl_mem_flags flags,
+    cl_uint packet_size,
+    cl_uint num_packets,
+    const cl_pipe_properties *props,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) context;
+    (void) packet_size;
+    (void) num_packets;
+    (void) num_calls;
+
+    if (flags == 0) {
+        flags = CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS;
+    }
+    TEST_ASSERT_EQUAL(flags, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS);
+    TEST_ASSERT_NULL(props);
+
+    if (errcode_ret)
+        *errcode_ret = CL_SUCCESS;
+    return make_mem(0);
+}
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_int clGetPipeInfo_testCreatePipe(
+    cl_mem pipe,
+    cl_pipe_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) pipe;
+    (void) num_calls;
+
+    TEST_ASSERT_NOT_NULL(param_value);
+    if (param_name == CL_PIPE_PACKET_SIZE) {
+        *static_cast<cl_uint*>(param_value) = 16;
+        if (param_value_size_ret) {
+            *param_value_size_ret = param_value_size;
+        }
+        return CL_SUCCESS;
+    }
+    else if (param_name == CL_PIPE_MAX_PACKETS) {
+        *static_cast<cl_uint*>(param_value) = 32;
+        if (param_value_size_ret) {
+            *param_value_size_ret = param_value_size;
+        }
+        return CL_SUCCESS;
+    }
+    else {
+        TEST_FAIL();
+        return CL_INVALID_VALUE;
+    }
+}
+#endif
+
+void testCreatePipe(void)
+{    
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clCreatePipe_StubWithCallback(clCreatePipe_testCreatePipe);
+    clGetPipeInfo_StubWithCallback(clGetPipeInfo_testCreatePipe);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+
+    cl::Context c(make_context(1));
+    cl::Pipe p(c, 16, 32);
+    cl::Pipe p2(16, 32);
+
+    cl_uint size = p2.getInfo<CL_PIPE_PACKET_SIZE>();
+    cl_uint packets;
+    p2.getInfo(CL_PIPE_MAX_PACKETS, &packets);
+
+    TEST_ASSERT_EQUAL(size, 16);
+    TEST_ASSERT_EQUAL(packets, 32);
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+static cl_int clGetKernelSubGroupInfo_testSubGroups(cl_kernel kernel,
+    cl_device_id device,
+    cl_kernel_sub_group_info param_name,
+    size_t input_value_size,
+    const void *input_value,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) kernel;
+    (void) device;
+    (void) input_value_size;
+    (void) param_value_size;
+    (void) num_calls;
+
+    TEST_ASSERT_NOT_NULL(input_value);
+    TEST_ASSERT_NOT_NULL(param_value);
+
+    if (param_name == CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR) {
+        *static_cast<size_t*>(param_value) = 32;
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(size_t);
+        }
+        return CL_SUCCESS;
+    }
+    else if (param_name == CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR) {
+        *static_cast<size_t*>(param_value) = 2;
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(size_t);
+        }
+        return CL_SUCCESS;
+    }
+    else {
+        TEST_ABORT();
+        return CL_INVALID_OPERATION;
+    }
+}
+#endif
+
+void testSubGroups(void)
+{
+// TODO support testing cl_khr_subgroups on 2.0
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clGetKernelSubGroupInfo_StubWithCallback(clGetKernelSubGroupInfo_testSubGroups);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    clReleaseKernel_ExpectAndReturn(make_kernel(0), CL_SUCCESS);
+
+    cl::Kernel k(make_kernel(0));
+    cl::Device d(make_device_id(0));
+    cl_int err;
+    cl::NDRange ndrange(8, 8);
+    size_t res1 = k.getSubGroupInfo<CL_KERNEL_MAX_SUB_GROUP_SIZE_FOR_NDRANGE_KHR>(
+        d, ndrange, &err);
+    size_t res2 = 0;
+    err = k.getSubGroupInfo(
+        d, CL_KERNEL_SUB_GROUP_COUNT_FOR_NDRANGE_KHR, ndrange, &res2);
+
+    TEST_ASSERT_EQUAL(res1, 32);
+    TEST_ASSERT_EQUAL(res2, 2);
+#endif
+}
+
+/**
+* Stub implementation of clGetDeviceInfo that returns an absense of builtin kernels
+*/
+static cl_int clGetDeviceInfo_builtin(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) param_value_size;
+
+    // Test to verify case where empty string is returned - so size is 0
+    (void)num_calls;
+    TEST_ASSERT_EQUAL_HEX(CL_DEVICE_BUILT_IN_KERNELS, param_name);
+    if (param_value == nullptr) {
+        if (param_value_size_ret != nullptr) {
+            *param_value_size_ret = 0;
+        }
+    }
+    return CL_SUCCESS;
+}
+
+void testBuiltInKernels(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+
+    cl::Device d0(make_device_id(0));
+
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_builtin);
+    cl::string s = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS>();
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+/**
+ * Stub implementation of clCloneKernel that returns a new kernel object
+ */
+static cl_kernel clCloneKernel_simplecopy(
+    cl_kernel k,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) k;
+    (void) num_calls;
+
+    // Test to verify case where empty string is returned - so size is 0
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_kernel(POOL_MAX);
+}
+#endif
+
+void testCloneKernel(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    clCloneKernel_StubWithCallback(clCloneKernel_simplecopy);
+    clReleaseKernel_ExpectAndReturn(make_kernel(POOL_MAX), CL_SUCCESS);
+    cl::Kernel clone = kernelPool[0].clone();
+    TEST_ASSERT_EQUAL(clone(), make_kernel(POOL_MAX));
+#endif
+}
+
+static int kernelPoolCreated;
+static int kernelPoolReleased;
+
+static cl_kernel clCreateKernel_kernelPool(
+    cl_program program,
+    const char *kernel_name,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
+    TEST_ASSERT_EQUAL_STRING("test", kernel_name);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_kernel(kernelPoolCreated++);
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+static cl_kernel clCloneKernel_kernelPool(
+    cl_kernel source_kernel,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), source_kernel);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_kernel(kernelPoolCreated++);
+}
+#endif
+
+static cl_int clReleaseKernel_kernelPool(
+    cl_kernel kernel,
+    int num_calls)
+{
+    (void) kernel;
+    (void) num_calls;
+    kernelPoolReleased++;
+    return CL_SUCCESS;
+}
+
+void testKernelPool(void)
+{
+    kernelPoolCreated = 0;
+    kernelPoolReleased = 0;
+    clCreateKernel_StubWithCallback(clCreateKernel_kernelPool);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    clCloneKernel_StubWithCallback(clCloneKernel_kernelPool);
+#endif
+    clRetainProgram_ExpectAndReturn(make_program(0), CL_SUCCESS);
+    clReleaseProgram_ExpectAndReturn(make_program(0), CL_SUCCESS);
+    clReleaseKernel_StubWithCallback(clReleaseKernel_kernelPool);
+
+    {
+        cl_int err;
+        cl::KernelPool pool(programPool[0], "test", &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(1, kernelPoolCreated);
+
+        cl_kernel first;
+        {
+            cl::KernelPool::Lease a = pool.acquire(&err);
+            TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+            cl::KernelPool::Lease b = pool.acquire();
+            TEST_ASSERT_NOT_NULL(a->get());
+            TEST_ASSERT_NOT_NULL((*b)());
+            TEST_ASSERT_NOT_EQUAL(a->get(), b->get());
+            first = a->get();
+            TEST_ASSERT_EQUAL(0, pool.idleCount());
+
+            b.release();
+            TEST_ASSERT_EQUAL(1, pool.idleCount());
+        }
+        TEST_ASSERT_EQUAL(2, pool.idleCount());
+
+        // Returned instances are reused
+        {
+            cl::KernelPool::Lease c = pool.acquire();
+            TEST_ASSERT_EQUAL_PTR(first, c.get()());
+        }
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+        // The prototype plus two clones
+        const int expected = 3;
+#else
+        const int expected = 2;
+#endif
+        TEST_ASSERT_EQUAL(expected, kernelPoolCreated);
+        TEST_ASSERT_EQUAL(0, kernelPoolReleased);
+    }
+    TEST_ASSERT_EQUAL(kernelPoolCreated, kernelPoolReleased);
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+static int kernelPoolCloneAttempts;
+
+static cl_kernel clCloneKernel_unsupported(
+    cl_kernel source_kernel,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) source_kernel;
+    (void) num_calls;
+    kernelPoolCloneAttempts++;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_INVALID_OPERATION;
+    return nullptr;
+}
+#endif
+
+void testKernelPoolWithoutCloneSupport(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 210
+    kernelPoolCreated = 0;
+    kernelPoolReleased = 0;
+    kernelPoolCloneAttempts = 0;
+    clCreateKernel_StubWithCallback(clCreateKernel_kernelPool);
+    clCloneKernel_StubWithCallback(clCloneKernel_unsupported);
+    clRetainProgram_ExpectAndReturn(make_program(0), CL_SUCCESS);
+    clReleaseProgram_ExpectAndReturn(make_program(0), CL_SUCCESS);
+    clReleaseKernel_StubWithCallback(clReleaseKernel_kernelPool);
+
+    {
+        cl::KernelPool pool(programPool[0], "test");
+        cl_int err;
+        cl::KernelPool::Lease a = pool.acquire(&err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_NOT_NULL(a->get());
+        cl::KernelPool::Lease b = pool.acquire(&err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_NOT_EQUAL(a->get(), b->get());
+
+        // Cloning is only attempted once
+        TEST_ASSERT_EQUAL(1, kernelPoolCloneAttempts);
+        TEST_ASSERT_EQUAL(3, kernelPoolCreated);
+    }
+    TEST_ASSERT_EQUAL(kernelPoolCreated, kernelPoolReleased);
+#endif
+}
+
+static const int bufferPoolMems = 16;
+static int bufferPoolRefcounts[bufferPoolMems];
+static int bufferPoolParents;
+static int bufferPoolSubBuffers;
+static size_t bufferPoolOrigins[bufferPoolMems];
+static void (CL_CALLBACK *bufferPoolCallbacks[bufferPoolMems])(cl_mem, void *);
+static void *bufferPoolCallbackData[bufferPoolMems];
+
+static int bufferPoolIndex(cl_mem mem)
+{
+    int index = (int) ((size_t) mem - (size_t) make_mem(0));
+    TEST_ASSERT(index >= 0 && index < bufferPoolMems);
+    return index;
+}
+
+static cl_int clGetDeviceInfo_bufferPool(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    if (param_name == CL_DEVICE_MEM_BASE_ADDR_ALIGN) {
+        (void) id;
+        (void) num_calls;
+        TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_uint));
+        if (param_value_size_ret != nullptr)
+            *param_value_size_ret = sizeof(cl_uint);
+        if (param_value != nullptr)
+            *static_cast<cl_uint *>(param_value) = 1024;
+        return CL_SUCCESS;
+    }
+    return clGetDeviceInfo_platform(
+        id, param_name, param_value_size, param_value, param_value_size_ret, num_calls);
+}
+
+static cl_mem clCreateBuffer_bufferPool(
+    cl_context context,
+    cl_mem_flags flags,
+    size_t size,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_MEM_READ_WRITE, flags);
+    TEST_ASSERT_NULL(host_ptr);
+    // The first block has the block size, the second one fits 8192 bytes
+    TEST_ASSERT_EQUAL(bufferPoolParents == 0 ? 4096 : 8192, size);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    int index = bufferPoolParents++;
+    bufferPoolRefcounts[index] = 1;
+    return make_mem(index);
+}
+
+static cl_mem clCreateSubBuffer_bufferPool(
+    cl_mem buffer,
+    cl_mem_flags flags,
+    cl_buffer_create_type buffer_create_type,
+    const void *buffer_create_info,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT(bufferPoolIndex(buffer) < bufferPoolParents);
+    TEST_ASSERT_EQUAL(CL_MEM_READ_WRITE, flags);
+    TEST_ASSERT_EQUAL(CL_BUFFER_CREATE_TYPE_REGION, buffer_create_type);
+    const cl_buffer_region *region = static_cast<const cl_buffer_region *>(buffer_create_info);
+    TEST_ASSERT_EQUAL(0, region->origin % 128);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    int index = 8 + bufferPoolSubBuffers++;
+    bufferPoolRefcounts[index] = 1;
+    bufferPoolOrigins[index] = region->origin;
+    return make_mem(index);
+}
+
+static cl_int clSetMemObjectDestructorCallback_bufferPool(
+    cl_mem memobj,
+    void (CL_CALLBACK *pfn_notify)(cl_mem, void *),
+    void *user_data,
+    int num_calls)
+{
+    (void) num_calls;
+    int index = bufferPoolIndex(memobj);
+    bufferPoolCallbacks[index] = pfn_notify;
+    bufferPoolCallbackData[index] = user_data;
+    return CL_SUCCESS;
+}
+
+static cl_int clRetainMemObject_bufferPool(
+    cl_mem memobj,
+    int num_calls)
+{
+    (void) num_calls;
+    bufferPoolRefcounts[bufferPoolIndex(memobj)]++;
+    return CL_SUCCESS;
+}
+
+static cl_int clReleaseMemObject_bufferPool(
+    cl_mem memobj,
+    int num_calls)
+{
+    (void) num_calls;
+    int index = bufferPoolIndex(memobj);
+    TEST_ASSERT(bufferPoolRefcounts[index] > 0);
+    if (--bufferPoolRefcounts[index] == 0 && bufferPoolCallbacks[index] != nullptr) {
+        bufferPoolCallbacks[index](memobj, bufferPoolCallbackData[index]);
+    }
+    return CL_SUCCESS;
+}
+
+void testBufferPool(void)
+{
+    bufferPoolParents = 0;
+    bufferPoolSubBuffers = 0;
+    for (int i = 0; i < bufferPoolMems; i++) {
+        bufferPoolRefcounts[i] = 0;
+        bufferPoolCallbacks[i] = nullptr;
+    }
+    cl_device_id device = make_device_id(0);
+    int deviceRefcount = 1;
+    prepare_deviceRefcounts(1, &device, &deviceRefcount);
+    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_bufferPool);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_bufferPool);
+    clCreateSubBuffer_StubWithCallback(clCreateSubBuffer_bufferPool);
+    clSetMemObjectDestructorCallback_StubWithCallback(clSetMemObjectDestructorCallback_bufferPool);
+    clRetainMemObject_StubWithCallback(clRetainMemObject_bufferPool);
+    clReleaseMemObject_StubWithCallback(clReleaseMemObject_bufferPool);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    {
+        cl_int err;
+        cl::BufferPool pool(contextPool[0], CL_MEM_READ_WRITE, 4096, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(128, pool.getAlignment());
+
+        {
+            cl::Buffer a = pool.allocate(100, &err);
+            TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+            cl::Buffer b = pool.allocate<cl_float>(100);
+            TEST_ASSERT_EQUAL_PTR(make_mem(8), a());
+            TEST_ASSERT_EQUAL_PTR(make_mem(9), b());
+            TEST_ASSERT_EQUAL(0, bufferPoolOrigins[8]);
+            TEST_ASSERT_EQUAL(128, bufferPoolOrigins[9]);
+
+            cl::BufferPool::Statistics stats = pool.getStatistics();
+            TEST_ASSERT_EQUAL(1, stats.blocks);
+            TEST_ASSERT_EQUAL(4096, stats.reserved);
+            TEST_ASSERT_EQUAL(500, stats.requested);
+            TEST_ASSERT_EQUAL(640, stats.allocated);
+            TEST_ASSERT_EQUAL(0, stats.free);
+            TEST_ASSERT_EQUAL(2, stats.allocations);
+        }
+
+        // Ranges return once the sub-buffers are destroyed
+        cl::BufferPool::Statistics stats = pool.getStatistics();
+        TEST_ASSERT_EQUAL(0, stats.allocated);
+        TEST_ASSERT_EQUAL(640, stats.free);
+        TEST_ASSERT_EQUAL(0, stats.allocations);
+
+        cl::Buffer c = pool.allocate(128);
+        TEST_ASSERT_EQUAL_PTR(make_mem(10), c());
+        TEST_ASSERT_EQUAL(0, bufferPoolOrigins[10]);
+
+        // Larger than a block
+        cl::Buffer d = pool.allocate(8192);
+        TEST_ASSERT_EQUAL(2, bufferPoolParents);
+
+        stats = pool.getStatistics();
+        TEST_ASSERT_EQUAL(2, stats.blocks);
+        TEST_ASSERT_EQUAL(4096 + 8192, stats.reserved);
+        TEST_ASSERT_EQUAL(128 + 8192, stats.allocated);
+        TEST_ASSERT_EQUAL(512, stats.free);
+
+        // Its parent goes with it
+        d = cl::Buffer();
+        TEST_ASSERT_EQUAL(0, bufferPoolRefcounts[1]);
+        stats = pool.getStatistics();
+        TEST_ASSERT_EQUAL(1, stats.blocks);
+        TEST_ASSERT_EQUAL(4096, stats.reserved);
+        TEST_ASSERT_EQUAL(128, stats.allocated);
+        TEST_ASSERT_EQUAL(512, stats.free);
+
+#if !defined(CL_HPP_ENABLE_EXCEPTIONS)
+        // No size class is large enough
+        cl::Buffer e = pool.allocate(((std::numeric_limits<cl::size_type>::max)() >> 1) + 2, &err);
+        TEST_ASSERT_EQUAL(CL_INVALID_BUFFER_SIZE, err);
+        TEST_ASSERT_NULL(e());
+#endif
+    }
+
+    // The parents go with the pool
+    for (int i = 0; i < bufferPoolMems; i++) {
+        TEST_ASSERT_EQUAL(0, bufferPoolRefcounts[i]);
+    }
+}
+
+static char stagingRingSlots[2][16];
+static int stagingRingMaps;
+static int stagingRingWrites;
+static int stagingRingWaits;
+static int stagingRingUnmaps;
+static char stagingRingDevice[64];
+static int stagingRingEventRefs[4];
+
+static cl_mem clCreateBuffer_stagingRing(
+    cl_context context,
+    cl_mem_flags flags,
+    size_t size,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_MEM_ALLOC_HOST_PTR | CL_MEM_READ_ONLY, flags);
+    TEST_ASSERT_EQUAL(16, size);
+    TEST_ASSERT_NULL(host_ptr);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_mem(1 + num_calls);
+}
+
+static void *clEnqueueMapBuffer_stagingRing(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t cb,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) map_flags;
+    (void) event_wait_list;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(1 + num_calls), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(16, cb);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return stagingRingSlots[stagingRingMaps++];
+}
+
+static cl_int clEnqueueWriteBuffer_stagingRing(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_write,
+    size_t offset,
+    size_t size,
+    const void *ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) event_wait_list;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_FALSE, blocking_write);
+    // Alternates between the slots
+    TEST_ASSERT_EQUAL_PTR(stagingRingSlots[num_calls % 2], ptr);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NOT_NULL(event);
+    std::memcpy(stagingRingDevice + offset, ptr, size);
+    *event = make_event(num_calls);
+    stagingRingEventRefs[num_calls] = 1;
+    stagingRingWrites++;
+    return CL_SUCCESS;
+}
+
+static int stagingRingEvent(cl_event event)
+{
+    for (int i = 0; i < 4; i++) {
+        if (event == make_event(i)) {
+            return i;
+        }
+    }
+    TEST_FAIL_MESSAGE("unexpected event");
+    return 0;
+}
+
+static cl_int clRetainEvent_stagingRing(cl_event event, int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_GREATER_THAN(0, stagingRingEventRefs[stagingRingEvent(event)]);
+    ++stagingRingEventRefs[stagingRingEvent(event)];
+    return CL_SUCCESS;
+}
+
+static cl_int clReleaseEvent_stagingRing(cl_event event, int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_GREATER_THAN(0, stagingRingEventRefs[stagingRingEvent(event)]);
+    --stagingRingEventRefs[stagingRingEvent(event)];
+    return CL_SUCCESS;
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clEnqueueMarkerWithWaitList_stagingRing(
+    cl_command_queue command_queue,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    // Waits for every chunk, including those whose slot was reused
+    TEST_ASSERT_EQUAL(3, num_events_in_wait_list);
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_PTR(make_event(i), event_wait_list[i]);
+        TEST_ASSERT_GREATER_THAN(0, stagingRingEventRefs[i]);
+    }
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(3);
+    stagingRingEventRefs[3] = 1;
+    return CL_SUCCESS;
+}
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clEnqueueMarker_stagingRing(
+    cl_command_queue command_queue,
+    cl_event *event,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(3);
+    stagingRingEventRefs[3] = 1;
+    return CL_SUCCESS;
+}
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+
+static void stubStagingRingEvents(void)
+{
+    std::memset(stagingRingEventRefs, 0, sizeof(stagingRingEventRefs));
+    clRetainEvent_StubWithCallback(clRetainEvent_stagingRing);
+    clReleaseEvent_StubWithCallback(clReleaseEvent_stagingRing);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    clEnqueueMarkerWithWaitList_StubWithCallback(clEnqueueMarkerWithWaitList_stagingRing);
+#else // CL_HPP_TARGET_OPENCL_VERSION >= 120
+    clEnqueueMarker_StubWithCallback(clEnqueueMarker_stagingRing);
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 120
+}
+
+static cl_int clWaitForEvents_stagingRing(
+    cl_uint num_events,
+    const cl_event *event_list,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL(1, num_events);
+    // Only the first slot is reused
+    TEST_ASSERT_EQUAL_PTR(make_event(0), event_list[0]);
+    stagingRingWaits++;
+    return CL_SUCCESS;
+}
+
+static cl_int clEnqueueUnmapMemObject_stagingRing(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(1 + num_calls), memobj);
+    TEST_ASSERT_EQUAL_PTR(stagingRingSlots[num_calls], mapped_ptr);
+    // After the last write from the slot
+    TEST_ASSERT_EQUAL(1, num_events_in_wait_list);
+    TEST_ASSERT_EQUAL_PTR(make_event(num_calls == 0 ? 2 : 1), event_wait_list[0]);
+    TEST_ASSERT_NULL(event);
+    stagingRingUnmaps++;
+    return CL_SUCCESS;
+}
+
+void testStagingRing(void)
+{
+    stagingRingMaps = 0;
+    stagingRingWrites = 0;
+    stagingRingWaits = 0;
+    stagingRingUnmaps = 0;
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_context);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_stagingRing);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_stagingRing);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_stagingRing);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_stagingRing);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_stagingRing);
+    stubStagingRingEvents();
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    char data[40];
+    for (int i = 0; i < 40; i++) {
+        data[i] = (char) i;
+    }
+
+    {
+        cl_int err;
+        cl::StagingRing ring(commandQueuePool[0], 16, 2, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(2, stagingRingMaps);
+
+        cl::Event event;
+        err = ring.write(bufferPool[0], 8, data, sizeof(data), cl::EventWaitList(), &event);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(3, stagingRingWrites);
+        TEST_ASSERT_EQUAL(1, stagingRingWaits);
+        // Completes with every chunk, not just the last one
+        TEST_ASSERT_EQUAL_PTR(make_event(3), event());
+        TEST_ASSERT_EQUAL_MEMORY(data, stagingRingDevice + 8, sizeof(data));
+        // The slots hold the last write from them
+        TEST_ASSERT_EQUAL(0, stagingRingEventRefs[0]);
+        TEST_ASSERT_EQUAL(1, stagingRingEventRefs[1]);
+        TEST_ASSERT_EQUAL(1, stagingRingEventRefs[2]);
+    }
+    TEST_ASSERT_EQUAL(2, stagingRingUnmaps);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, stagingRingEventRefs[i]);
+    }
+}
+
+static cl_int clWaitForEvents_copyStagingRing(
+    cl_uint num_events,
+    const cl_event *event_list,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(1, num_events);
+    // The first slot is reused, then the copy waits for every write
+    TEST_ASSERT_EQUAL_PTR(make_event(num_calls == 0 ? 0 : 3), event_list[0]);
+    stagingRingWaits++;
+    return CL_SUCCESS;
+}
+
+void testCopyStagingRing(void)
+{
+    stagingRingMaps = 0;
+    stagingRingWrites = 0;
+    stagingRingWaits = 0;
+    stagingRingUnmaps = 0;
+    std::memset(stagingRingDevice, 0, sizeof(stagingRingDevice));
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_context);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_stagingRing);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_stagingRing);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_stagingRing);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_copyStagingRing);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_stagingRing);
+    stubStagingRingEvents();
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    // Not random access, so the slots are filled element by element
+    std::list<cl_int> data;
+    for (cl_int i = 0; i < 10; i++) {
+        data.push_back(i);
+    }
+
+    {
+        cl_int err;
+        cl::StagingRing ring(commandQueuePool[0], 16, 2, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+
+        err = cl::copy(ring, data.begin(), data.end(), bufferPool[0]);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(3, stagingRingWrites);
+        TEST_ASSERT_EQUAL(2, stagingRingWaits);
+
+        cl_int device[10];
+        std::memcpy(device, stagingRingDevice, sizeof(device));
+        for (cl_int i = 0; i < 10; i++) {
+            TEST_ASSERT_EQUAL(i, device[i]);
+        }
+    }
+    TEST_ASSERT_EQUAL(2, stagingRingUnmaps);
+}
+
+static cl_mem clCreateBuffer_bufferStagingRing(
+    cl_context context,
+    cl_mem_flags flags,
+    size_t size,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    // The staging buffers come first
+    if (num_calls < 2) {
+        return clCreateBuffer_stagingRing(context, flags, size, host_ptr, errcode_ret, num_calls);
+    }
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_MEM_READ_ONLY, flags);
+    TEST_ASSERT_EQUAL(10 * sizeof(cl_int), size);
+    TEST_ASSERT_NULL(host_ptr);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_mem(0);
+}
+
+void testBufferConstructorStagingRing(void)
+{
+    stagingRingMaps = 0;
+    stagingRingWrites = 0;
+    stagingRingWaits = 0;
+    stagingRingUnmaps = 0;
+    std::memset(stagingRingDevice, 0, sizeof(stagingRingDevice));
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_context);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_bufferStagingRing);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_stagingRing);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_stagingRing);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_copyStagingRing);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_stagingRing);
+    stubStagingRingEvents();
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    cl_int data[10];
+    for (cl_int i = 0; i < 10; i++) {
+        data[i] = i;
+    }
+
+    {
+        cl_int err;
+        cl::StagingRing ring(commandQueuePool[0], 16, 2, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+
+        {
+            cl::Buffer buffer(ring, data, data + 10, true, &err);
+            TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+            TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer());
+            TEST_ASSERT_EQUAL(3, stagingRingWrites);
+            // The slot reuse, then the marker joining every chunk
+            TEST_ASSERT_EQUAL(2, stagingRingWaits);
+            TEST_ASSERT_EQUAL_MEMORY(data, stagingRingDevice, sizeof(data));
+        }
+    }
+    TEST_ASSERT_EQUAL(2, stagingRingUnmaps);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_EQUAL(0, stagingRingEventRefs[i]);
+    }
+}
+
+static cl_int clEnqueueWriteBuffer_stagingRingFailure(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_write,
+    size_t offset,
+    size_t size,
+    const void *ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) command_queue;
+    (void) buffer;
+    (void) blocking_write;
+    (void) offset;
+    (void) size;
+    (void) ptr;
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    (void) event;
+    (void) num_calls;
+    return CL_OUT_OF_RESOURCES;
+}
+
+static cl_int clEnqueueUnmapMemObject_stagingRingFailure(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) memobj;
+    (void) mapped_ptr;
+    (void) event_wait_list;
+    (void) event;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    // No write was enqueued from the slots
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    stagingRingUnmaps++;
+    return CL_SUCCESS;
+}
+
+void testBufferConstructorStagingRingWriteFailure(void)
+{
+    stagingRingMaps = 0;
+    stagingRingUnmaps = 0;
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_context);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_bufferStagingRing);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_stagingRing);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_stagingRingFailure);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_stagingRingFailure);
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    cl_int data[10] = { 0 };
+
+    {
+        cl_int err;
+        cl::StagingRing ring(commandQueuePool[0], 16, 2, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+
+        // The upload failed, not the creation of the buffer
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        const char *errStr = nullptr;
+        try {
+            cl::Buffer buffer(ring, data, data + 10, true);
+        }
+        catch (cl::Error &e) {
+            err = e.err();
+            errStr = e.what();
+        }
+        TEST_ASSERT_EQUAL_STRING("clEnqueueWriteBuffer", errStr);
+#else
+        cl::Buffer buffer(ring, data, data + 10, true, &err);
+#endif
+        TEST_ASSERT_EQUAL(CL_OUT_OF_RESOURCES, err);
+    }
+    TEST_ASSERT_EQUAL(2, stagingRingUnmaps);
+}
+
+static int mappedViewMemory[16];
+static int mappedViewUnmaps;
+
+static void *clEnqueueMapBuffer_testMappedView(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(CL_MAP_WRITE, map_flags);
+    TEST_ASSERT_EQUAL(4 * sizeof(int), offset);
+    TEST_ASSERT_EQUAL(8 * sizeof(int), size);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return mappedViewMemory + 4;
+}
+
+static void *clEnqueueMapImage_testMappedView(
+    cl_command_queue command_queue,
+    cl_mem image,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    const size_t *origin,
+    const size_t *region,
+    size_t *row_pitch,
+    size_t *slice_pitch,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), image);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(CL_MAP_WRITE, map_flags);
+    TEST_ASSERT_EQUAL(1, origin[0]);
+    TEST_ASSERT_EQUAL(2, origin[1]);
+    TEST_ASSERT_EQUAL(0, origin[2]);
+    TEST_ASSERT_EQUAL(3, region[0]);
+    TEST_ASSERT_EQUAL(2, region[1]);
+    TEST_ASSERT_EQUAL(1, region[2]);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event);
+    // Rows of three pixels padded to four
+    *row_pitch = 4 * sizeof(int);
+    *slice_pitch = 0;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return mappedViewMemory;
+}
+
+static cl_int clEnqueueUnmapMemObject_testMappedView(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
+    TEST_ASSERT_TRUE(mapped_ptr == mappedViewMemory || mapped_ptr == mappedViewMemory + 4);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    if (event != nullptr)
+        *event = make_event(0);
+    mappedViewUnmaps++;
+    return CL_SUCCESS;
+}
+
+void testMappedViewBuffer(void)
+{
+    mappedViewUnmaps = 0;
+    std::memset(mappedViewMemory, 0, sizeof(mappedViewMemory));
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_testMappedView);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testMappedView);
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    {
+        cl_int err;
+        cl::MappedView<int> view(
+            commandQueuePool[0], bufferPool[0], CL_MAP_WRITE, 4, 8, cl::EventWaitList(), &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL_PTR(mappedViewMemory + 4, view.data());
+        TEST_ASSERT_EQUAL(8, view.size());
+
+        int i = 0;
+        for (int &value : view) {
+            value = i++;
+        }
+        TEST_ASSERT_EQUAL(7, view[7]);
+        TEST_ASSERT_EQUAL(3, view(3));
+
+        // Moving hands over the mapping
+        cl::MappedView<int> moved(std::move(view));
+        TEST_ASSERT_NULL(view.data());
+        TEST_ASSERT_EQUAL(0, view.size());
+
+        cl::Event event;
+        err = moved.unmap(cl::EventWaitList(), &event);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event());
+        TEST_ASSERT_NULL(moved.data());
+        TEST_ASSERT_EQUAL(1, mappedViewUnmaps);
+    }
+    // Not unmapped again on destruction
+    TEST_ASSERT_EQUAL(1, mappedViewUnmaps);
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL(i, mappedViewMemory[4 + i]);
+    }
+}
+
+void testMappedViewImage(void)
+{
+    mappedViewUnmaps = 0;
+    std::memset(mappedViewMemory, 0, sizeof(mappedViewMemory));
+    clEnqueueMapImage_StubWithCallback(clEnqueueMapImage_testMappedView);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_testMappedView);
+
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+
+    {
+        cl_int err;
+        cl::MappedView<int> view(
+            commandQueuePool[0], image2DPool[0], CL_MAP_WRITE,
+            cl::array<cl::size_type, 2>{{1, 2}}, cl::array<cl::size_type, 2>{{3, 2}},
+            cl::EventWaitList(), &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL(3, view.getWidth());
+        TEST_ASSERT_EQUAL(2, view.getHeight());
+        TEST_ASSERT_EQUAL(1, view.getDepth());
+        TEST_ASSERT_EQUAL(4 * sizeof(int), view.getRowPitch());
+        TEST_ASSERT_EQUAL(8 * sizeof(int), view.getSlicePitch());
+
+        for (cl::size_type y = 0; y < 2; y++) {
+            for (cl::size_type x = 0; x < 3; x++) {
+                view(x, y) = static_cast<int>(10 * y + x + 1);
+            }
+        }
+        TEST_ASSERT_EQUAL_PTR(mappedViewMemory + 4, view.row(1));
+    }
+    // Unmapped on destruction
+    TEST_ASSERT_EQUAL(1, mappedViewUnmaps);
+    for (int y = 0; y < 2; y++) {
+        for (int x = 0; x < 3; x++) {
+            TEST_ASSERT_EQUAL(10 * y + x + 1, mappedViewMemory[4 * y + x]);
+        }
+        // The padding is untouched
+        TEST_ASSERT_EQUAL(0, mappedViewMemory[4 * y + 3]);
+    }
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+static const char fileBufferPath[] = "file_buffer_test.bin";
+static char fileBufferContents[64];
+static cl_bool fileBufferUnified;
+static void *fileBufferHostPtr;
+static void (CL_CALLBACK *fileBufferCallback)(cl_mem, void *);
+static void *fileBufferUserData;
+static char fileBufferSlots[2][64];
+static char fileBufferDevice[64];
+
+static void writeFileBufferFile(void)
+{
+    for (int i = 0; i < 64; i++) {
+        fileBufferContents[i] = (char) (i * 3);
+    }
+    std::ofstream file(fileBufferPath, std::ios::binary);
+    file.write(fileBufferContents, sizeof(fileBufferContents));
+}
+
+static cl_int clGetCommandQueueInfo_fileBuffer(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(void *);
+    if (param_value == nullptr)
+        return CL_SUCCESS;
+    TEST_ASSERT_EQUAL(sizeof(void *), param_value_size);
+    switch (param_name) {
+    case CL_QUEUE_CONTEXT:
+        *static_cast<cl_context *>(param_value) = make_context(0);
+        return CL_SUCCESS;
+    case CL_QUEUE_DEVICE:
+        *static_cast<cl_device_id *>(param_value) = make_device_id(0);
+        return CL_SUCCESS;
+    default:
+        TEST_FAIL();
+        return CL_INVALID_VALUE;
+    }
+}
+
+static cl_int clGetDeviceInfo_fileBuffer(
+    cl_device_id device,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    (void) param_value_size_ret;
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device);
+    TEST_ASSERT_EQUAL(CL_DEVICE_HOST_UNIFIED_MEMORY, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_bool), param_value_size);
+    *static_cast<cl_bool *>(param_value) = fileBufferUnified;
+    return CL_SUCCESS;
+}
+
+static cl_mem clCreateBuffer_fileBuffer(
+    cl_context context,
+    cl_mem_flags flags,
+    size_t size,
+    void *host_ptr,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(64, size);
+    if (num_calls == 0 && fileBufferUnified) {
+        TEST_ASSERT_EQUAL(CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, flags);
+        TEST_ASSERT_NOT_NULL(host_ptr);
+        TEST_ASSERT_EQUAL_MEMORY(fileBufferContents, host_ptr, size);
+        fileBufferHostPtr = host_ptr;
+    }
+    else if (num_calls == 0) {
+        TEST_ASSERT_EQUAL(CL_MEM_READ_ONLY, flags);
+        TEST_ASSERT_NULL(host_ptr);
+    }
+    else {
+        // The staging buffers of the fallback
+        TEST_ASSERT_EQUAL(CL_MEM_ALLOC_HOST_PTR | CL_MEM_READ_ONLY, flags);
+        TEST_ASSERT_NULL(host_ptr);
+    }
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_mem(num_calls);
+}
+
+static cl_int clSetMemObjectDestructorCallback_fileBuffer(
+    cl_mem memobj,
+    void (CL_CALLBACK *pfn_notify)(cl_mem, void *),
+    void *user_data,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), memobj);
+    fileBufferCallback = pfn_notify;
+    fileBufferUserData = user_data;
+    return CL_SUCCESS;
+}
+
+static void *clEnqueueMapBuffer_fileBuffer(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_map,
+    cl_map_flags map_flags,
+    size_t offset,
+    size_t cb,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) map_flags;
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    (void) event;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(1 + num_calls), buffer);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(64, cb);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return fileBufferSlots[num_calls];
+}
+
+static cl_int clEnqueueWriteBuffer_fileBuffer(
+    cl_command_queue command_queue,
+    cl_mem buffer,
+    cl_bool blocking_write,
+    size_t offset,
+    size_t size,
+    const void *ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer);
+    TEST_ASSERT_EQUAL(CL_FALSE, blocking_write);
+    TEST_ASSERT_EQUAL(0, offset);
+    TEST_ASSERT_EQUAL(64, size);
+    // Written from the pinned staging buffer
+    TEST_ASSERT_EQUAL_PTR(fileBufferSlots[0], ptr);
+    std::memcpy(fileBufferDevice, ptr, size);
+    *event = make_event(0);
+    return CL_SUCCESS;
+}
+
+static cl_int clWaitForEvents_fileBuffer(
+    cl_uint num_events,
+    const cl_event *event_list,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL(1, num_events);
+    TEST_ASSERT_EQUAL_PTR(make_event(0), event_list[0]);
+    return CL_SUCCESS;
+}
+
+static cl_int clEnqueueUnmapMemObject_fileBuffer(
+    cl_command_queue command_queue,
+    cl_mem memobj,
+    void *mapped_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) num_events_in_wait_list;
+    (void) event_wait_list;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(1 + num_calls), memobj);
+    TEST_ASSERT_EQUAL_PTR(fileBufferSlots[num_calls], mapped_ptr);
+    TEST_ASSERT_NULL(event);
+    return CL_SUCCESS;
+}
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 110
+
+void testCreateBufferFromFileUnified(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+    writeFileBufferFile();
+    fileBufferUnified = CL_TRUE;
+    fileBufferHostPtr = nullptr;
+    fileBufferCallback = nullptr;
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_fileBuffer);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_fileBuffer);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_fileBuffer);
+    clSetMemObjectDestructorCallback_StubWithCallback(clSetMemObjectDestructorCallback_fileBuffer);
+
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+
+    {
+        cl_int err;
+        cl::Buffer buffer = cl::Buffer::createFromFile(
+            commandQueuePool[0], fileBufferPath, CL_MEM_READ_ONLY, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer());
+        TEST_ASSERT_NOT_NULL(fileBufferCallback);
+        TEST_ASSERT_EQUAL_MEMORY(fileBufferContents, fileBufferHostPtr, sizeof(fileBufferContents));
+    }
+
+    // The implementation calls this once the buffer is destroyed
+    fileBufferCallback(make_mem(0), fileBufferUserData);
+    std::remove(fileBufferPath);
+#endif
+}
+
+void testCreateBufferFromFileStaged(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+    writeFileBufferFile();
+    fileBufferUnified = CL_FALSE;
+    std::memset(fileBufferDevice, 0, sizeof(fileBufferDevice));
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_fileBuffer);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_fileBuffer);
+    clCreateBuffer_StubWithCallback(clCreateBuffer_fileBuffer);
+    clEnqueueMapBuffer_StubWithCallback(clEnqueueMapBuffer_fileBuffer);
+    clEnqueueWriteBuffer_StubWithCallback(clEnqueueWriteBuffer_fileBuffer);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_fileBuffer);
+    clEnqueueUnmapMemObject_StubWithCallback(clEnqueueUnmapMemObject_fileBuffer);
+
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    // The staging ring
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(1), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(2), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseMemObject_ExpectAndReturn(make_mem(0), CL_SUCCESS);
+
+    {
+        cl_int err;
+        cl::Buffer buffer = cl::Buffer::createFromFile(
+            commandQueuePool[0], fileBufferPath, CL_MEM_READ_ONLY, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL_PTR(make_mem(0), buffer());
+        TEST_ASSERT_EQUAL_MEMORY(fileBufferContents, fileBufferDevice, sizeof(fileBufferContents));
+    }
+    std::remove(fileBufferPath);
+#endif
+}
+
+void testCreateBufferFromMissingFile(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 110
+    cl_int err = CL_SUCCESS;
+    cl::Buffer buffer;
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+    try {
+        buffer = cl::Buffer::createFromFile(commandQueuePool[0], "missing_file.bin");
+    }
+    catch (cl::Error &e) {
+        err = e.err();
+    }
+#else
+    buffer = cl::Buffer::createFromFile(
+        commandQueuePool[0], "missing_file.bin", CL_MEM_READ_ONLY, &err);
+#endif
+    TEST_ASSERT_EQUAL(CL_INVALID_VALUE, err);
+    TEST_ASSERT_NULL(buffer());
+#endif
+}
+
+void testEnqueueMapSVM(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    std::vector<int> vec(7);
+    clEnqueueSVMMap_ExpectAndReturn(commandQueuePool[0].get(), CL_TRUE, CL_MAP_READ|CL_MAP_WRITE, static_cast<void*>(vec.data()), vec.size()*sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
+    TEST_ASSERT_EQUAL(commandQueuePool[0].enqueueMapSVM(vec, CL_TRUE, CL_MAP_READ|CL_MAP_WRITE), CL_SUCCESS);
+#endif
+}
+
+void testMapSVM(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200 && !defined(CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE)
+    std::vector<int> vec(1);
+    clEnqueueSVMMap_ExpectAndReturn(make_command_queue(1), CL_TRUE, CL_MAP_READ|CL_MAP_WRITE, static_cast<void*>(vec.data()), vec.size()*sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
+    TEST_ASSERT_EQUAL(cl::mapSVM(vec), CL_SUCCESS);
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+alignas(128) static char svmPoolSlabs[2][8192];
+static int svmPoolAllocs;
+static int svmPoolFrees;
+static int svmPoolMaps;
+
+static void *clSVMAlloc_pooled(
+    cl_context context,
+    cl_svm_mem_flags flags,
+    size_t size,
+    cl_uint alignment,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_MEM_READ_WRITE, flags);
+    TEST_ASSERT_EQUAL(128, alignment);
+    // The first slab has the slab size, the second one fits 8192 bytes
+    TEST_ASSERT_EQUAL(svmPoolAllocs == 0 ? 4096 : 8192, size);
+    return svmPoolSlabs[svmPoolAllocs++];
+}
+
+static void clSVMFree_pooled(
+    cl_context context,
+    void *svm_pointer,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[svmPoolFrees++], svm_pointer);
+}
+
+static cl_int clEnqueueSVMMap_pooled(
+    cl_command_queue command_queue,
+    cl_bool blocking_map,
+    cl_map_flags flags,
+    void *svm_ptr,
+    size_t size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) svm_ptr;
+    (void) size;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL(CL_TRUE, blocking_map);
+    TEST_ASSERT_EQUAL(CL_MAP_READ | CL_MAP_WRITE, flags);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event_wait_list);
+    TEST_ASSERT_NULL(event);
+    svmPoolMaps++;
+    return CL_SUCCESS;
+}
+#endif
+
+void testPooledSVMAllocator(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    svmPoolAllocs = 0;
+    svmPoolFrees = 0;
+    svmPoolMaps = 0;
+    clSVMAlloc_StubWithCallback(clSVMAlloc_pooled);
+    clSVMFree_StubWithCallback(clSVMFree_pooled);
+    clEnqueueSVMMap_StubWithCallback(clEnqueueSVMMap_pooled);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    {
+        cl::PooledSVMAllocator<int, cl::SVMTraitCoarse<>> alloc(
+            contextPool[0], commandQueuePool[0], 0, 4096);
+        TEST_ASSERT_EQUAL(128, alloc.getAlignment());
+
+        int *a = alloc.allocate(10);
+        int *b = alloc.allocate(100);
+        TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[0], a);
+        TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[0] + 128, b);
+        TEST_ASSERT_EQUAL(1, svmPoolAllocs);
+        TEST_ASSERT_EQUAL(2, svmPoolMaps);
+
+        // Reused without mapping it again
+        alloc.deallocate(a, 10);
+        int *c = alloc.allocate(32);
+        TEST_ASSERT_EQUAL_PTR(a, c);
+        TEST_ASSERT_EQUAL(2, svmPoolMaps);
+
+        // Rebound copies share the pool
+        cl::PooledSVMAllocator<float, cl::SVMTraitCoarse<>> floatAlloc(alloc);
+        TEST_ASSERT_TRUE(floatAlloc == alloc);
+        float *d = floatAlloc.allocate(32);
+        TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[0] + 128 + 512, d);
+
+        // Larger than a slab
+        int *e = alloc.allocate(2048);
+        TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[1], e);
+        TEST_ASSERT_EQUAL(2, svmPoolAllocs);
+        TEST_ASSERT_EQUAL(4, svmPoolMaps);
+
+        // No size class is large enough, or the size in bytes overflows
+        cl::PooledSVMAllocator<char, cl::SVMTraitCoarse<>> charAlloc(alloc);
+        const cl::size_type tooLarge = ((std::numeric_limits<cl::size_type>::max)() >> 1) + 2;
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        int thrown = 0;
+        try {
+            charAlloc.allocate(tooLarge);
+        }
+        catch (std::bad_alloc &) {
+            thrown++;
+        }
+        try {
+            alloc.allocate(tooLarge);
+        }
+        catch (std::bad_alloc &) {
+            thrown++;
+        }
+        TEST_ASSERT_EQUAL(2, thrown);
+#else
+        TEST_ASSERT_NULL(charAlloc.allocate(tooLarge));
+        TEST_ASSERT_NULL(alloc.allocate(tooLarge));
+#endif
+        TEST_ASSERT_EQUAL(2, svmPoolAllocs);
+
+        alloc.deallocate(b, 100);
+        alloc.deallocate(c, 32);
+        floatAlloc.deallocate(d, 32);
+        alloc.deallocate(e, 2048);
+        TEST_ASSERT_EQUAL(0, svmPoolFrees);
+    }
+    TEST_ASSERT_EQUAL(2, svmPoolFrees);
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+alignas(128) static char svmCopySlab[4096];
+
+static void *clSVMAlloc_testCopySVMContainer(
+    cl_context context,
+    cl_svm_mem_flags flags,
+    size_t size,
+    cl_uint alignment,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_MEM_SVM_FINE_GRAIN_BUFFER | CL_MEM_READ_WRITE, flags);
+    TEST_ASSERT_EQUAL(4096, size);
+    TEST_ASSERT_EQUAL(128, alignment);
+    return svmCopySlab;
+}
+
+static void clSVMFree_testCopySVMContainer(
+    cl_context context,
+    void *svm_pointer,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL_PTR(svmCopySlab, svm_pointer);
+}
+
+// No devices, so max_size() is not limited by any of them
+static cl_int clGetContextInfo_testCopySVMContainer(
+    cl_context context,
+    cl_context_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) param_value_size;
+    (void) param_value;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    TEST_ASSERT_EQUAL(CL_CONTEXT_DEVICES, param_name);
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = 0;
+    return CL_SUCCESS;
+}
+
+static cl_int clEnqueueSVMUnmap_testCopySVMContainer(
+    cl_command_queue command_queue,
+    void *svm_ptr,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    (void) event_wait_list;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(svmCopySlab, svm_ptr);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(num_calls);
+    return CL_SUCCESS;
+}
+#endif
+
+void testCopySVMContainer(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clSVMAlloc_StubWithCallback(clSVMAlloc_testCopySVMContainer);
+    clSVMFree_StubWithCallback(clSVMFree_testCopySVMContainer);
+    clEnqueueSVMUnmap_StubWithCallback(clEnqueueSVMUnmap_testCopySVMContainer);
+    clGetContextInfo_StubWithCallback(clGetContextInfo_testCopySVMContainer);
+    clWaitForEvents_StubWithCallback(clWaitForEvents_testCopyHostToBuffer);
+
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clEnqueueSVMMap_ExpectAndReturn(make_command_queue(0), CL_TRUE, CL_MAP_WRITE, svmCopySlab, 8 * sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(0), CL_SUCCESS);
+    clEnqueueSVMMap_ExpectAndReturn(make_command_queue(0), CL_TRUE, CL_MAP_READ, svmCopySlab, 8 * sizeof(int), 0, nullptr, nullptr, CL_SUCCESS);
+    clReleaseEvent_ExpectAndReturn(make_event(1), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    {
+        cl::PooledSVMAllocator<int, cl::SVMTraitFine<>> alloc(
+            contextPool[0], commandQueuePool[0], 0, 4096);
+        cl::pooled_fine_svm_vector<int> container(16, 0, alloc);
+
+        std::vector<int> source(8);
+        for (int i = 0; i < 8; i++)
+            source[i] = i;
+
+        cl_int err = cl::copy(commandQueuePool[0], source.begin(), source.end(), container);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        for (int i = 0; i < 8; i++)
+            TEST_ASSERT_EQUAL(i, container[i]);
+
+        std::vector<int> result(8);
+        err = cl::copy(commandQueuePool[0], container, result.begin(), result.end());
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_TRUE(result == source);
+
+        // The range must fit
+        std::vector<int> large(17);
+#if defined(CL_HPP_ENABLE_EXCEPTIONS)
+        err = CL_SUCCESS;
+        try {
+            cl::copy(commandQueuePool[0], large.begin(), large.end(), container);
+        }
+        catch (cl::Error &e) {
+            err = e.err();
+        }
+#else
+        err = cl::copy(commandQueuePool[0], large.begin(), large.end(), container);
+#endif
+        TEST_ASSERT_EQUAL(CL_INVALID_VALUE, err);
+    }
+#endif
+}
+
+void testPooledSVMAllocatorRemapsUnmapped(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    svmPoolAllocs = 0;
+    svmPoolFrees = 0;
+    svmPoolMaps = 0;
+    clSVMAlloc_StubWithCallback(clSVMAlloc_pooled);
+    clSVMFree_StubWithCallback(clSVMFree_pooled);
+    clEnqueueSVMMap_StubWithCallback(clEnqueueSVMMap_pooled);
+    clGetContextInfo_StubWithCallback(clGetContextInfo_testCopySVMContainer);
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clEnqueueSVMUnmap_ExpectAndReturn(make_command_queue(0), svmPoolSlabs[0], 0, nullptr, nullptr, CL_SUCCESS);
+    clEnqueueSVMUnmap_ExpectAndReturn(make_command_queue(0), svmPoolSlabs[0], 0, nullptr, nullptr, CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    {
+        cl::PooledSVMAllocator<int, cl::SVMTraitCoarse<>> alloc(
+            contextPool[0], commandQueuePool[0], 0, 4096);
+
+        {
+            cl::pooled_coarse_svm_vector<int> container(10, 0, alloc);
+            TEST_ASSERT_EQUAL(1, svmPoolMaps);
+            TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueUnmapSVM(container));
+        }
+
+        // The block was freed unmapped, so it is mapped again before the
+        // host writes to it
+        {
+            cl::pooled_coarse_svm_vector<int> container(10, 0, alloc);
+            TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[0], container.data());
+            TEST_ASSERT_EQUAL(2, svmPoolMaps);
+            container[0] = 1;
+
+            // Mapped again by the application before it is freed
+            TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueUnmapSVM(container));
+            TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueMapSVM(
+                container, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE));
+            TEST_ASSERT_EQUAL(3, svmPoolMaps);
+        }
+
+        {
+            cl::pooled_coarse_svm_vector<int> container(10, 0, alloc);
+            TEST_ASSERT_EQUAL_PTR(svmPoolSlabs[0], container.data());
+            TEST_ASSERT_EQUAL(3, svmPoolMaps);
+        }
+        TEST_ASSERT_EQUAL(1, svmPoolAllocs);
+    }
+    TEST_ASSERT_EQUAL(1, svmPoolFrees);
+#endif
+}
+
+static int threadDefaultQueuesCreated = 0;
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_command_queue clCreateCommandQueueWithProperties_testThreadDefault(
+    cl_context context,
+    cl_device_id device,
+    const cl_queue_properties *properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(1), context);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), device);
+    TEST_ASSERT_EQUAL(CL_QUEUE_PROPERTIES, properties[0]);
+    TEST_ASSERT_EQUAL(0, properties[1]);
+    ++threadDefaultQueuesCreated;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_command_queue(2);
+}
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+static cl_command_queue clCreateCommandQueue_testThreadDefault(
+    cl_context context,
+    cl_device_id device,
+    cl_command_queue_properties properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_context(1), context);
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), device);
+    TEST_ASSERT_EQUAL(0, properties);
+    ++threadDefaultQueuesCreated;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_command_queue(2);
+}
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+// Relies on the defaults set by the testSetDefault tests
+void testThreadDefaultCommandQueue(void)
+{
+    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clCreateCommandQueueWithProperties_StubWithCallback(clCreateCommandQueueWithProperties_testThreadDefault);
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clCreateCommandQueue_StubWithCallback(clCreateCommandQueue_testThreadDefault);
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+    threadDefaultQueuesCreated = 0;
+    cl_int err = CL_INVALID_VALUE;
+    const cl::CommandQueue &q = cl::CommandQueue::getThreadDefault(&err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(2), q());
+
+    // Created once per thread and returned without adding a reference
+    const cl::CommandQueue &q2 = cl::CommandQueue::getThreadDefault();
+    TEST_ASSERT_EQUAL_PTR(&q, &q2);
+    TEST_ASSERT_EQUAL(1, threadDefaultQueuesCreated);
+
+    // The process-wide default is not affected
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(1), cl::CommandQueue::getDefaultRef()());
+
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
+    cl::CommandQueue::unitTestClearThreadDefault();
+}
+
+// Relies on the defaults set by the testSetDefault tests
+void testEnqueueArgsThreadDefaultQueue(void)
+{
+#if defined(CL_HPP_ENABLE_THREAD_LOCAL_DEFAULT_QUEUE)
+    clGetContextInfo_StubWithCallback(clGetContextInfo_device);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+#if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clCreateCommandQueueWithProperties_StubWithCallback(clCreateCommandQueueWithProperties_testThreadDefault);
+#else // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_2);
+    clCreateCommandQueue_StubWithCallback(clCreateCommandQueue_testThreadDefault);
+#endif // #if CL_HPP_TARGET_OPENCL_VERSION >= 200
+
+    // The arguments hold their own reference to the queue of the thread
+    // that made them
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
+    // which outlives the thread
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
+
+    threadDefaultQueuesCreated = 0;
+    std::unique_ptr<cl::EnqueueArgs> args;
+    std::thread worker([&args]() {
+        args.reset(new cl::EnqueueArgs(cl::NDRange(1)));
+    });
+    worker.join();
+    TEST_ASSERT_EQUAL(1, threadDefaultQueuesCreated);
+
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(2), CL_SUCCESS);
+    args.reset();
+#endif
+}
+
+// Run after other tests to clear the default state in the header
+// using special unit test bypasses.
+// We cannot remove the once_flag, so this is a hard fix
+// but it means we won't hit cmock release callbacks at the end.
+// This is a lot like tearDown but for the header default
+// so we do not want to run it for every test.
+// The alternative would be to manually modify the test runner
+// but we avoid that for now.
+void testCleanupHeaderState(void)
+{
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(1), CL_SUCCESS);
+    clReleaseDevice_ExpectAndReturn(make_device_id(1), CL_SUCCESS);
+
+    cl::CommandQueue::unitTestClearDefault();
+    cl::Context::unitTestClearDefault();
+    cl::Device::unitTestClearDefault();
+    cl::Platform::unitTestClearDefault();
+}
+
+// OpenCL 2.2 APIs:
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+static void CL_CALLBACK test_program_release_callback(
+    cl_program,
+    void*)
+{
+}
+#endif
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+static cl_int clSetProgramReleaseCallback_set(
+    cl_program program,
+    void (CL_CALLBACK * pfn_notify)(cl_program program, void * user_data),
+    void *user_data,
+    int num_calls)
+{
+    (void) user_data;
+    (void) num_calls;
+
+    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
+    TEST_ASSERT_EQUAL_PTR(pfn_notify, test_program_release_callback);
+
+    return CL_SUCCESS;
+}
+#endif
+
+void testSetProgramReleaseCallback(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+    cl_program program = make_program(0);
+    int user_data = 0;
+
+    clSetProgramReleaseCallback_StubWithCallback(clSetProgramReleaseCallback_set);
+    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+
+    cl::Program prog(program);
+
+    prog.setReleaseCallback(test_program_release_callback, &user_data);
+#endif
+}
+
+void testSetProgramSpecializationConstantScalar(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+    cl_program program = make_program(0);
+    int sc = 0;
+
+    clSetProgramSpecializationConstant_ExpectAndReturn(program, 0, sizeof(sc), &sc, CL_SUCCESS);
+    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+
+    cl::Program prog(program);
+
+    prog.setSpecializationConstant(0, sc);
+#endif
+}
+
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+/// Stub for testing boolean specialization constants
+static cl_int clSetProgramSpecializationConstant_testBool(
+    cl_program program,
+    cl_uint spec_id,
+    size_t spec_size,
+    const void* spec_value,
+    int num_calls)
+{
+    (void) num_calls;
+
+    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
+    TEST_ASSERT(spec_id == 0 || spec_id == 1);
+    TEST_ASSERT_EQUAL(spec_size, 1);
+    if (spec_id == 0)
+    {
+        const cl_uchar *uc_value = (const cl_uchar*)spec_value;
+        TEST_ASSERT_EQUAL_HEX(uc_value[0], 0);
+    }
+    if (spec_id == 1)
+    {
+        const cl_uchar *uc_value = (const cl_uchar*)spec_value;
+        TEST_ASSERT_EQUAL_HEX(uc_value[0], CL_UCHAR_MAX);
+    }
+    return CL_SUCCESS;
+}
+#endif
+
+void testSetProgramSpecializationConstantBool(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+    // Spec constant "false" should turn into a call with size one and no bits set.
+    // Spec constant "true" should turn into a call with size one and all bits set.
+    cl_program program = make_program(0);
+    bool scFalse = false;
+    bool scTrue = true;
+
+    clSetProgramSpecializationConstant_StubWithCallback(clSetProgramSpecializationConstant_testBool);
+
+    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+
+    cl::Program prog(program);
+
+    prog.setSpecializationConstant(0, scFalse);
+    prog.setSpecializationConstant(1, scTrue);
+#endif
+}
+
+void testSetProgramSpecializationConstantPointer(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 220
+    cl_program program = make_program(0);
+    int scArray[5] = {};
+
+    clSetProgramSpecializationConstant_ExpectAndReturn(program, 0, sizeof(scArray), &scArray, CL_SUCCESS);
+    clReleaseProgram_ExpectAndReturn(program, CL_SUCCESS);
+
+    cl::Program prog(program);
+
+    prog.setSpecializationConstant(0, sizeof(scArray), scArray);
+#endif
+}
+
+// OpenCL 3.0 and cl_khr_extended_versioning Queries
+
+// Assumes the core enums, structures, and macros exactly match
+// the extension enums, structures, and macros:
+
+static_assert(CL_PLATFORM_NUMERIC_VERSION == CL_PLATFORM_NUMERIC_VERSION_KHR,
+    "CL_PLATFORM_NUMERIC_VERSION mismatch");
+static_assert(CL_PLATFORM_EXTENSIONS_WITH_VERSION == CL_PLATFORM_EXTENSIONS_WITH_VERSION_KHR,
+    "CL_PLATFORM_EXTENSIONS_WITH_VERSION mismatch");
+
+static_assert(CL_DEVICE_NUMERIC_VERSION == CL_DEVICE_NUMERIC_VERSION_KHR,
+    "CL_DEVICE_NUMERIC_VERSION mismatch");
+static_assert(CL_DEVICE_EXTENSIONS_WITH_VERSION == CL_DEVICE_EXTENSIONS_WITH_VERSION_KHR,
+    "CL_DEVICE_EXTENSIONS_WITH_VERSION mismatch");
+static_assert(CL_DEVICE_ILS_WITH_VERSION == CL_DEVICE_ILS_WITH_VERSION_KHR,
+    "CL_DEVICE_ILS_WITH_VERSION mismatch");
+static_assert(CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION == CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION_KHR,
+    "CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION mismatch");
+
+static_assert(sizeof(cl_name_version) == sizeof(cl_name_version_khr),
+    "cl_name_version mismatch");
+
+static_assert(CL_MAKE_VERSION(1, 2, 3) == CL_MAKE_VERSION_KHR(1, 2, 3),
+    "CL_MAKE_VERSION mismatch");
+
+static cl_int clGetPlatformInfo_extended_versioning(
+    cl_platform_id id,
+    cl_platform_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) num_calls;
+
+    switch (param_name) {
+    case CL_PLATFORM_NUMERIC_VERSION:
+    {
+        if (param_value_size == sizeof(cl_version) && param_value) {
+            *static_cast<cl_version*>(param_value) = CL_MAKE_VERSION(1, 2, 3);
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_version);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_PLATFORM_EXTENSIONS_WITH_VERSION:
+    {
+        static cl_name_version extension = {
+            CL_MAKE_VERSION(10, 11, 12),
+            "cl_dummy_extension",
+        };
+        if (param_value_size == sizeof(cl_name_version) && param_value) {
+            *static_cast<cl_name_version*>(param_value) = extension;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(extension);
+        }
+        return CL_SUCCESS;
+    }
+    default: break;
+    }
+    TEST_FAIL();
+    return CL_INVALID_OPERATION;
+}
+
+void testPlatformExtendedVersioning_3_0(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 300
+    cl::Platform p(make_platform_id(1));
+
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_extended_versioning);
+
+    cl_version platformVersion = p.getInfo<CL_PLATFORM_NUMERIC_VERSION>();
+    TEST_ASSERT_EQUAL_HEX(platformVersion, CL_MAKE_VERSION(1, 2, 3));
+
+    std::vector<cl_name_version> extensions = p.getInfo<CL_PLATFORM_EXTENSIONS_WITH_VERSION>();
+    TEST_ASSERT_EQUAL(extensions.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION(10, 11, 12));
+    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 300
+}
+
+void testPlatformExtendedVersioning_KHR(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION < 300
+    cl::Platform p(make_platform_id(1));
+
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_extended_versioning);
+
+    cl_version_khr platformVersion = p.getInfo<CL_PLATFORM_NUMERIC_VERSION_KHR>();
+    TEST_ASSERT_EQUAL_HEX(platformVersion, CL_MAKE_VERSION_KHR(1, 2, 3));
+
+    std::vector<cl_name_version_khr> extensions = p.getInfo<CL_PLATFORM_EXTENSIONS_WITH_VERSION_KHR>();
+    TEST_ASSERT_EQUAL(extensions.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION_KHR(10, 11, 12));
+    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+#endif // CL_HPP_TARGET_OPENCL_VERSION < 300
+}
+
+
+// Note: This assumes the core enums, structures, and macros exactly match
+// the extension enums, structures, and macros.
+
+static cl_int clGetDeviceInfo_extended_versioning(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) num_calls;
+
+    switch (param_name) {
+    case CL_DEVICE_NUMERIC_VERSION:
+    {
+        if (param_value_size == sizeof(cl_version) && param_value) {
+            *static_cast<cl_version*>(param_value) = CL_MAKE_VERSION(1, 2, 3);
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_version);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_OPENCL_C_NUMERIC_VERSION_KHR:
+    {
+        if (param_value_size == sizeof(cl_version_khr) && param_value) {
+            *static_cast<cl_version_khr*>(param_value) = CL_MAKE_VERSION_KHR(4, 5, 6);
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_version_khr);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_EXTENSIONS_WITH_VERSION:
+    {
+        static cl_name_version extension = {
+            CL_MAKE_VERSION(10, 11, 12),
+            "cl_dummy_extension",
+        };
+        if (param_value_size == sizeof(cl_name_version) && param_value) {
+            *static_cast<cl_name_version*>(param_value) = extension;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(extension);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_ILS_WITH_VERSION:
+    {
+        static cl_name_version il = {
+            CL_MAKE_VERSION(20, 21, 22),
+            "DUMMY_IR",
+        };
+        if (param_value_size == sizeof(cl_name_version) && param_value) {
+            *static_cast<cl_name_version*>(param_value) = il;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(il);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION:
+    {
+        // Test no built-in kernels:
+        if (param_value_size_ret) {
+            *param_value_size_ret = 0;
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_OPENCL_C_ALL_VERSIONS:
+    {
+        static cl_name_version opencl_c = {
+            CL_MAKE_VERSION(30, 31, 32),
+            "OpenCL C",
+        };
+        if (param_value_size == sizeof(cl_name_version) && param_value) {
+            *static_cast<cl_name_version*>(param_value) = opencl_c;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(opencl_c);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_OPENCL_C_FEATURES:
+    {
+        static cl_name_version opencl_c_features[] = {
+            {
+                CL_MAKE_VERSION(40, 41, 42),
+                "__opencl_c_feature",
+            },
+            {
+                CL_MAKE_VERSION(40, 43, 44),
+                "__opencl_c_fancy_feature",
+            },
+        };
+        if (param_value_size == sizeof(opencl_c_features) && param_value) {
+            cl_name_version* feature = static_cast<cl_name_version*>(param_value);
+            const int numFeatures = ARRAY_SIZE(opencl_c_features);
+            for (int i = 0; i < numFeatures; i++) {
+                feature[i] = opencl_c_features[i];
+            }
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(opencl_c_features);
+        }
+        return CL_SUCCESS;
+    }
+    default: break;
+    }
+    TEST_FAIL();
+    return CL_INVALID_OPERATION;
+}
+
+void testDeviceExtendedVersioning_3_0(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 300
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_3_0);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+
+    cl::Device d0(make_device_id(0));
+
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_extended_versioning);
+
+    cl_version deviceVersion = d0.getInfo<CL_DEVICE_NUMERIC_VERSION>();
+    TEST_ASSERT_EQUAL_HEX(deviceVersion, CL_MAKE_VERSION(1, 2, 3));
+
+    std::vector<cl_name_version> extensions = d0.getInfo<CL_DEVICE_EXTENSIONS_WITH_VERSION>();
+    TEST_ASSERT_EQUAL(extensions.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION(10, 11, 12));
+    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+
+    std::vector<cl_name_version> ils = d0.getInfo<CL_DEVICE_ILS_WITH_VERSION>();
+    TEST_ASSERT_EQUAL(ils.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(ils[0].version, CL_MAKE_VERSION(20, 21, 22));
+    TEST_ASSERT_EQUAL_STRING(ils[0].name, "DUMMY_IR");
+
+    std::vector<cl_name_version> opencl_c = d0.getInfo<CL_DEVICE_OPENCL_C_ALL_VERSIONS>();
+    TEST_ASSERT_EQUAL(opencl_c.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(opencl_c[0].version, CL_MAKE_VERSION(30, 31, 32));
+    TEST_ASSERT_EQUAL_STRING(opencl_c[0].name, "OpenCL C");
+
+    std::vector<cl_name_version> opencl_c_features = d0.getInfo<CL_DEVICE_OPENCL_C_FEATURES>();
+    TEST_ASSERT_EQUAL(opencl_c_features.size(), 2);
+    TEST_ASSERT_EQUAL_HEX(opencl_c_features[0].version, CL_MAKE_VERSION(40, 41, 42));
+    TEST_ASSERT_EQUAL_STRING(opencl_c_features[0].name, "__opencl_c_feature");
+    TEST_ASSERT_EQUAL_HEX(opencl_c_features[1].version, CL_MAKE_VERSION(40, 43, 44));
+    TEST_ASSERT_EQUAL_STRING(opencl_c_features[1].name, "__opencl_c_fancy_feature");
+
+    std::vector<cl_name_version> builtInKernels = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION>();
+    TEST_ASSERT_EQUAL(builtInKernels.size(), 0);
+#endif // CL_HPP_TARGET_OPENCL_VERSION >= 300
+}
+
+void testDeviceExtendedVersioning_KHR(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION < 300
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+
+    cl::Device d0(make_device_id(0));
+
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_extended_versioning);
+
+    cl_version_khr deviceVersion = d0.getInfo<CL_DEVICE_NUMERIC_VERSION_KHR>();
+    TEST_ASSERT_EQUAL_HEX(deviceVersion, CL_MAKE_VERSION_KHR(1, 2, 3));
+
+    cl_version_khr cVersion = d0.getInfo<CL_DEVICE_OPENCL_C_NUMERIC_VERSION_KHR>();
+    TEST_ASSERT_EQUAL_HEX(cVersion, CL_MAKE_VERSION_KHR(4, 5, 6));
+
+    std::vector<cl_name_version_khr> extensions = d0.getInfo<CL_DEVICE_EXTENSIONS_WITH_VERSION_KHR>();
+    TEST_ASSERT_EQUAL(extensions.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(extensions[0].version, CL_MAKE_VERSION_KHR(10, 11, 12));
+    TEST_ASSERT_EQUAL_STRING(extensions[0].name, "cl_dummy_extension");
+
+    std::vector<cl_name_version_khr> ils = d0.getInfo<CL_DEVICE_ILS_WITH_VERSION_KHR>();
+    TEST_ASSERT_EQUAL(ils.size(), 1);
+    TEST_ASSERT_EQUAL_HEX(ils[0].version, CL_MAKE_VERSION_KHR(20, 21, 22));
+    TEST_ASSERT_EQUAL_STRING(ils[0].name, "DUMMY_IR");
+
+    std::vector<cl_name_version_khr> builtInKernels = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION_KHR>();
+    TEST_ASSERT_EQUAL(builtInKernels.size(), 0);
+#endif // CL_HPP_TARGET_OPENCL_VERSION < 300
+}
+
+static cl_int clGetDeviceInfo_uuid_pci_bus_info(
+    cl_device_id id,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) id;
+    (void) num_calls;
+
+    switch (param_name) {
+#if defined(cl_khr_device_uuid)
+    case CL_DEVICE_UUID_KHR:
+    case CL_DRIVER_UUID_KHR:
+    {
+        if (param_value_size == CL_UUID_SIZE_KHR && param_value) {
+            cl_uchar* pUUID = static_cast<cl_uchar*>(param_value);
+            cl_uchar start =
+                (param_name == CL_DEVICE_UUID_KHR) ? 1 :
+                (param_name == CL_DRIVER_UUID_KHR) ? 2 :
+                0;
+            for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
+                pUUID[i] = i + start;
+            }
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = CL_UUID_SIZE_KHR;
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_LUID_VALID_KHR:
+    {
+        if (param_value_size == sizeof(cl_bool) && param_value) {
+            *static_cast<cl_bool*>(param_value) = CL_TRUE;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_bool);
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_LUID_KHR:
+    {
+        if (param_value_size == CL_LUID_SIZE_KHR && param_value) {
+            cl_uchar* pLUID = static_cast<cl_uchar*>(param_value);
+            cl_uchar start = 3;
+            for (int i = 0; i < CL_LUID_SIZE_KHR; i++) {
+                pLUID[i] = i + start;
+            }
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = CL_LUID_SIZE_KHR;
+        }
+        return CL_SUCCESS;
+    }
+    case CL_DEVICE_NODE_MASK_KHR:
+    {
+        if (param_value_size == sizeof(cl_uint) && param_value) {
+            *static_cast<cl_uint*>(param_value) = 0xA5A5;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_uint);
+        }
+        return CL_SUCCESS;
+    }
+#endif
+#if defined(cl_khr_pci_bus_info)
+    case CL_DEVICE_PCI_BUS_INFO_KHR:
+    {
+        if (param_value_size == sizeof(cl_device_pci_bus_info_khr) && param_value) {
+            cl_device_pci_bus_info_khr* pInfo = static_cast<cl_device_pci_bus_info_khr*>(param_value);
+            pInfo->pci_domain = 0x11;
+            pInfo->pci_bus = 0x22;
+            pInfo->pci_device = 0x33;
+            pInfo->pci_function = 0x44;
+        }
+        if (param_value_size_ret) {
+            *param_value_size_ret = sizeof(cl_device_pci_bus_info_khr);
+        }
+        return CL_SUCCESS;
+    }
+#endif
+    default: break;
+    }
+    TEST_FAIL();
+    return CL_INVALID_OPERATION;
+}
+
+void testDeviceUUID_KHR(void)
+{
+#if defined(cl_khr_device_uuid)
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+
+    cl::Device d0(make_device_id(0));
+
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_uuid_pci_bus_info);
+
+    std::array<cl_uchar, CL_UUID_SIZE_KHR> dev_uuid = d0.getInfo<CL_DEVICE_UUID_KHR>();
+    for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i + 1, dev_uuid[i]);
+    }
+    std::array<cl_uchar, CL_UUID_SIZE_KHR> drv_uuid = d0.getInfo<CL_DRIVER_UUID_KHR>();
+    for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i + 2, drv_uuid[i]);
+    }
+
+    cl_bool valid = d0.getInfo<CL_DEVICE_LUID_VALID_KHR>();
+    TEST_ASSERT_EQUAL(CL_TRUE, valid);
+    std::array<cl_uchar, CL_LUID_SIZE_KHR> luid = d0.getInfo<CL_DEVICE_LUID_KHR>();
+    for (int i = 0; i < CL_LUID_SIZE_KHR; i++) {
+        TEST_ASSERT_EQUAL_UINT8(i + 3, luid[i]);
+    }
+
+    cl_uint nodeMask = d0.getInfo<CL_DEVICE_NODE_MASK_KHR>();
+    TEST_ASSERT_EQUAL(0xA5A5, nodeMask);
+#endif
+}
+
+void testDevicePCIBusInfo_KHR(void)
+{
+#if defined(cl_khr_pci_bus_info)
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
+    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+
+    cl::Device d0(make_device_id(0));
+
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_uuid_pci_bus_info);
+
+    cl_device_pci_bus_info_khr info = d0.getInfo<CL_DEVICE_PCI_BUS_INFO_KHR>();
+    TEST_ASSERT_EQUAL_HEX(0x11, info.pci_domain);
+    TEST_ASSERT_EQUAL_HEX(0x22, info.pci_bus);
+    TEST_ASSERT_EQUAL_HEX(0x33, info.pci_device);
+    TEST_ASSERT_EQUAL_HEX(0x44, info.pci_function);
+#endif
+}
+
+static  cl_int clGetProgramInfo_testProgramGetContext(cl_program program,
+    cl_program_build_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int /*num_calls*/)
+{
+    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
+    TEST_ASSERT_EQUAL_HEX(CL_PROGRAM_CONTEXT, param_name);
+    TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_context));
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_context);
+    if (param_value != nullptr)
+        *static_cast<cl_context *>(param_value) = make_context(0);
+    return CL_SUCCESS;
+}
+
+static cl_program clLinkProgram_testLinkProgram(cl_context context,
+    cl_uint              num_devices,
+    const cl_device_id * device_list,
+    const char *         options,
+    cl_uint              num_input_programs,
+    const cl_program *   input_programs,
+    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
+    void *               user_data,
+    cl_int *             errcode_ret,
+    int                 /*num_calls*/)
+{
+    TEST_ASSERT_EQUAL_PTR(context, make_context(0));
+    TEST_ASSERT_EQUAL(num_devices, 0);
+    TEST_ASSERT_EQUAL(device_list, nullptr);
+    TEST_ASSERT_EQUAL(options, nullptr);
+    TEST_ASSERT_NOT_EQUAL(num_input_programs, 0);
+    for (int i=0; i<(int)num_input_programs; i++)
+        TEST_ASSERT_EQUAL_PTR(input_programs[i], make_program(i));
+    TEST_ASSERT_EQUAL(pfn_notify, nullptr);
+    TEST_ASSERT_EQUAL(user_data, nullptr);
+
+    *errcode_ret = CL_SUCCESS;
+    return make_program(0);
+}
+
+void testLinkProgram(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    cl_int errcode;
+    int refcount[] = {1,1};
+
+    // verify if class cl::Program was not modified
+    TEST_ASSERT_EQUAL(sizeof(cl_program), sizeof(cl::Program));
+
+    clGetProgramInfo_StubWithCallback(clGetProgramInfo_testProgramGetContext);
+    clLinkProgram_StubWithCallback(clLinkProgram_testLinkProgram);
+
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    prepare_programRefcounts(2, reinterpret_cast<cl_program *>(programPool), refcount);
+
+    cl::Program prog = cl::linkProgram(cl::Program(make_program(0)), cl::Program(make_program(1)),
+        nullptr, nullptr, nullptr, &errcode);
+
+    TEST_ASSERT_EQUAL_PTR(prog(), make_program(0));
+    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
+
+    prog() = nullptr;
+#endif
+}
+
+void testLinkProgramWithVectorProgramInput(void)
+{
+#if CL_HPP_TARGET_OPENCL_VERSION >= 120
+    cl_int errcode;
+    VECTOR_CLASS<cl::Program> prog_vec;
+    std::array<int, ARRAY_SIZE(programPool)> refcount;
+    for (int i=0;i<(int)ARRAY_SIZE(programPool);i++) {
+        prog_vec.push_back(cl::Program(programPool[i]()));
+        refcount[i] = 1;
+    }
+
+    // verify if class cl::Program was not modified
+    TEST_ASSERT_EQUAL(sizeof(cl_program), sizeof(cl::Program));
+
+    clGetProgramInfo_StubWithCallback(clGetProgramInfo_testProgramGetContext);
+    clLinkProgram_StubWithCallback(clLinkProgram_testLinkProgram);
+    prepare_programRefcounts(prog_vec.size(), reinterpret_cast<cl_program *>(prog_vec.data()), refcount.data());
+
+    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+
+    cl::Program prog = linkProgram(prog_vec, nullptr, nullptr, nullptr, &errcode);
+
+    TEST_ASSERT_EQUAL_PTR(prog(), make_program(0));
+    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
+
+    prog() = nullptr;
+#endif
+}
+
+/****************************************************************************
+ * Tests for cl::CommandBufferKhr
+ ****************************************************************************/
+#if defined(cl_khr_command_buffer)
+void testMoveAssignCommandBufferKhrNonNull(void);
+void testMoveAssignCommandBufferKhrNull(void);
+void testMoveConstructCommandBufferKhrNonNull(void);
+void testMoveConstructCommandBufferKhrNull(void);
+MAKE_MOVE_TESTS(CommandBufferKhr, make_command_buffer_khr, clReleaseCommandBufferKHR, commandBufferKhrPool)
+#else
+void testMoveAssignCommandBufferKhrNonNull(void) {}
+void testMoveAssignCommandBufferKhrNull(void) {}
+void testMoveConstructCommandBufferKhrNonNull(void) {}
+void testMoveConstructCommandBufferKhrNull(void) {}
+#endif
+
+// Stub for clGetCommandBufferInfoKHR that returns 1
+static cl_int clGetCommandBufferInfoKHR_testCommandBufferKhrGetNumQueues(
+    cl_command_buffer_khr command_buffer,
+    cl_command_buffer_info_khr param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int /*num_calls*/)
+{
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL_HEX(CL_COMMAND_BUFFER_NUM_QUEUES_KHR, param_name);
+    TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_uint));
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_uint);
+    if (param_value != nullptr)
+        *static_cast<cl_uint *> (param_value) = 1;
+    return CL_SUCCESS;
+}
+
+void testCommandBufferInfoKHRNumQueues(void)
+{
+#if defined(cl_khr_command_buffer)
+    cl_uint expected = 1;
+
+    clGetCommandBufferInfoKHR_StubWithCallback(clGetCommandBufferInfoKHR_testCommandBufferKhrGetNumQueues);
+
+    cl_uint num = commandBufferKhrPool[0].getInfo<CL_COMMAND_BUFFER_NUM_QUEUES_KHR>();
+    TEST_ASSERT_EQUAL_HEX(expected, num);
+#endif
+}
+
+// Stub for clGetCommandBufferInfoKHR that returns command queues array
+static cl_int clGetCommandBufferInfoKHR_testCommandBufferKhrGetCommandQueues(
+    cl_command_buffer_khr command_buffer,
+    cl_command_buffer_info_khr param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int /*num_calls*/)
+{
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL_HEX(CL_COMMAND_BUFFER_QUEUES_KHR, param_name);
+    TEST_ASSERT(param_value == nullptr || param_value_size >= 3 * sizeof(cl_command_queue));
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = 3 * sizeof(cl_command_queue);
+    if (param_value != nullptr)
+    {
+        cl_command_queue *command_queues = static_cast<cl_command_queue *> (param_value);
+        command_queues[0] = make_command_queue(0);
+        command_queues[1] = make_command_queue(1);
+        command_queues[2] = make_command_queue(2);
+    }
+    return CL_SUCCESS;
+}
+
+void testCommandBufferInfoKHRCommandQueues(void)
+{
+#if defined(cl_khr_command_buffer)
+    // creat expected values for refcounter
+    VECTOR_CLASS<cl_command_queue> expected_queue_vec;
+    std::array<int, 3> refcount;
+    for (int i=0;i<3;i++) {
+        expected_queue_vec.push_back(commandQueuePool[i]());
+        refcount[i] = 1;
+    }
+
+    clGetCommandBufferInfoKHR_StubWithCallback(clGetCommandBufferInfoKHR_testCommandBufferKhrGetCommandQueues);
+    prepare_commandQueueRefcounts(expected_queue_vec.size(), expected_queue_vec.data(), refcount.data());
+
+    VECTOR_CLASS<cl::CommandQueue> command_queues = commandBufferKhrPool[0].getInfo<CL_COMMAND_BUFFER_QUEUES_KHR>();
+    TEST_ASSERT_EQUAL(3, command_queues.size());
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queues[0]());
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(1), command_queues[1]());
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(2), command_queues[2]());
+#endif
+}
+
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120 && !defined(__APPLE__) && !defined(__MACOS)
+static bool extensionDispatchResolved[2];
+static int extensionDispatchPlatformCalls[2];
+
+static cl_int extensionDispatchNumQueues(
+    int platform,
+    cl_command_buffer_khr command_buffer,
+    cl_command_buffer_info_khr param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret)
+{
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(platform), command_buffer);
+    TEST_ASSERT_EQUAL_HEX(CL_COMMAND_BUFFER_NUM_QUEUES_KHR, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_uint), param_value_size);
+    *static_cast<cl_uint *>(param_value) = 1;
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_uint);
+    ++extensionDispatchPlatformCalls[platform];
+    return CL_SUCCESS;
+}
+
+static cl_int clGetCommandBufferInfoKHR_extensionDispatch(
+    cl_command_buffer_khr command_buffer,
+    cl_command_buffer_info_khr param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    return extensionDispatchNumQueues(
+        0, command_buffer, param_name, param_value_size, param_value, param_value_size_ret);
+}
+
+// The entry point platform 1 hands out instead of the mock
+static cl_int CL_API_CALL clGetCommandBufferInfoKHR_platform1(
+    cl_command_buffer_khr command_buffer,
+    cl_command_buffer_info_khr param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret)
+{
+    return extensionDispatchNumQueues(
+        1, command_buffer, param_name, param_value_size, param_value, param_value_size_ret);
+}
+
+static void *clGetExtensionFunctionAddressForPlatform_extensionDispatch(
+    cl_platform_id platform,
+    const char *func_name,
+    int num_calls)
+{
+    TEST_ASSERT(platform == make_platform_id(0) || platform == make_platform_id(1));
+    const int index = platform == make_platform_id(1) ? 1 : 0;
+    extensionDispatchResolved[index] = true;
+    if (index == 1 && strcmp(func_name, "clGetCommandBufferInfoKHR") == 0) {
+        return (void *) clGetCommandBufferInfoKHR_platform1;
+    }
+    return clGetExtensionFunctionAddressForPlatform_mocks(platform, func_name, num_calls);
+}
+
+static cl_int clGetCommandQueueInfo_extensionDispatch(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(1), command_queue);
+    TEST_ASSERT_EQUAL_HEX(CL_QUEUE_DEVICE, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_device_id), param_value_size);
+    *static_cast<cl_device_id *>(param_value) = make_device_id(1);
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_device_id);
+    return CL_SUCCESS;
+}
+
+static cl_int clGetDeviceInfo_extensionDispatch(
+    cl_device_id device,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_device_id(1), device);
+    TEST_ASSERT_EQUAL_HEX(CL_DEVICE_PLATFORM, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_platform_id), param_value_size);
+    *static_cast<cl_platform_id *>(param_value) = make_platform_id(1);
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_platform_id);
+    return CL_SUCCESS;
+}
+
+static cl_command_buffer_khr clCreateCommandBufferKHR_extensionDispatch(
+    cl_uint num_queues,
+    const cl_command_queue *queues,
+    const cl_command_buffer_properties_khr *properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) properties;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL(1, num_queues);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(1), queues[0]);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_command_buffer_khr(1);
+}
+#endif
+
+void testExtensionDispatchPerPlatform(void)
+{
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120 && !defined(__APPLE__) && !defined(__MACOS)
+    extensionDispatchResolved[0] = extensionDispatchResolved[1] = false;
+    extensionDispatchPlatformCalls[0] = extensionDispatchPlatformCalls[1] = 0;
+
+    clGetExtensionFunctionAddressForPlatform_StubWithCallback(clGetExtensionFunctionAddressForPlatform_extensionDispatch);
+    clGetPlatformIDs_StubWithCallback(clGetPlatformIDs_testContextFromType);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_extensionDispatch);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_extensionDispatch);
+    clCreateCommandBufferKHR_StubWithCallback(clCreateCommandBufferKHR_extensionDispatch);
+    clGetCommandBufferInfoKHR_StubWithCallback(clGetCommandBufferInfoKHR_extensionDispatch);
+
+    // Entry points are resolved when platforms are discovered
+    VECTOR_CLASS<cl::Platform> platforms;
+    TEST_ASSERT_EQUAL(CL_SUCCESS, cl::Platform::get(&platforms));
+    TEST_ASSERT_TRUE(extensionDispatchResolved[0]);
+    TEST_ASSERT_TRUE(extensionDispatchResolved[1]);
+
+    {
+        clRetainCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+        clReleaseCommandQueue_ExpectAndReturn(make_command_queue(1), CL_SUCCESS);
+        cl_int err = CL_INVALID_OPERATION;
+        cl::CommandBufferKhr commandBuffer(
+            VECTOR_CLASS<cl::CommandQueue>(1, commandQueuePool[1]), 0, &err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(1), commandBuffer());
+
+        // A command buffer of platform 1 calls the entry point of platform 1
+        TEST_ASSERT_EQUAL(1, commandBuffer.getInfo<CL_COMMAND_BUFFER_NUM_QUEUES_KHR>());
+        TEST_ASSERT_EQUAL(1, extensionDispatchPlatformCalls[1]);
+
+        // and so do its copies
+        clRetainCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(1), CL_SUCCESS);
+        cl::CommandBufferKhr copy(commandBuffer);
+        TEST_ASSERT_EQUAL(1, copy.getInfo<CL_COMMAND_BUFFER_NUM_QUEUES_KHR>());
+        TEST_ASSERT_EQUAL(2, extensionDispatchPlatformCalls[1]);
+
+        clReleaseCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(1), CL_SUCCESS);
+        clReleaseCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(1), CL_SUCCESS);
+    }
+
+    // Handles adopted without a platform use the process-wide entry points
+    TEST_ASSERT_EQUAL(1, commandBufferKhrPool[0].getInfo<CL_COMMAND_BUFFER_NUM_QUEUES_KHR>());
+    TEST_ASSERT_EQUAL(1, extensionDispatchPlatformCalls[0]);
+    TEST_ASSERT_EQUAL(2, extensionDispatchPlatformCalls[1]);
+#endif
+}
+
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120 && !defined(__APPLE__) && !defined(__MACOS)
+static cl_int clGetPlatformIDs_singlePlatform(
+    cl_uint num_entries,
+    cl_platform_id *platforms,
+    cl_uint *num_platforms,
+    int num_calls)
+{
+    (void) num_calls;
+    if (platforms != nullptr) {
+        TEST_ASSERT_EQUAL(1, num_entries);
+        platforms[0] = make_platform_id(0);
+    }
+    if (num_platforms != nullptr) {
+        *num_platforms = 1;
+    }
+    return CL_SUCCESS;
+}
 
-    std::vector<cl_name_version_khr> builtInKernels = d0.getInfo<CL_DEVICE_BUILT_IN_KERNELS_WITH_VERSION_KHR>();
-    TEST_ASSERT_EQUAL(builtInKernels.size(), 0);
-#endif // CL_HPP_TARGET_OPENCL_VERSION < 300
+static cl_command_buffer_khr clCreateCommandBufferKHR_singlePlatform(
+    cl_uint num_queues,
+    const cl_command_queue *queues,
+    const cl_command_buffer_properties_khr *properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) properties;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL(1, num_queues);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), queues[0]);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_command_buffer_khr(0);
 }
+#endif
 
-static cl_int clGetDeviceInfo_uuid_pci_bus_info(
-    cl_device_id id,
-    cl_device_info param_name,
+void testExtensionDispatchSinglePlatform(void)
+{
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120 && !defined(__APPLE__) && !defined(__MACOS)
+    clGetExtensionFunctionAddressForPlatform_StubWithCallback(clGetExtensionFunctionAddressForPlatform_mocks);
+    clGetPlatformIDs_StubWithCallback(clGetPlatformIDs_singlePlatform);
+    clCreateCommandBufferKHR_StubWithCallback(clCreateCommandBufferKHR_singlePlatform);
+    cl::pfn_clCreateCommandBufferKHR = nullptr;
+    cl::pfn_clReleaseCommandBufferKHR = nullptr;
+
+    VECTOR_CLASS<cl::Platform> platforms;
+    TEST_ASSERT_EQUAL(CL_SUCCESS, cl::Platform::get(&platforms));
+    TEST_ASSERT_EQUAL(1, platforms.size());
+
+    // The only platform owns every queue, so the queue is not queried
+    clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+    cl_int err = CL_INVALID_OPERATION;
+    cl::CommandBufferKhr commandBuffer(
+        VECTOR_CLASS<cl::CommandQueue>(1, commandQueuePool[0]), 0, &err);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), commandBuffer());
+    TEST_ASSERT_NOT_NULL(commandBuffer.getDispatch());
+
+    clReleaseCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(0), CL_SUCCESS);
+#endif
+}
+
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+static cl_int clRetainObject_commandBufferCapture(void *object, int num_calls)
+{
+    (void) object;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
+
+static cl_int clRetainContext_commandBufferCapture(cl_context context, int num_calls)
+{
+    return clRetainObject_commandBufferCapture(context, num_calls);
+}
+
+static cl_int clRetainEvent_commandBufferCapture(cl_event event, int num_calls)
+{
+    return clRetainObject_commandBufferCapture(event, num_calls);
+}
+
+static cl_int clRetainCommandBufferKHR_commandBufferCapture(
+    cl_command_buffer_khr command_buffer,
+    int num_calls)
+{
+    return clRetainObject_commandBufferCapture(command_buffer, num_calls);
+}
+
+static cl_int clGetCommandQueueInfo_commandBufferCapture(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
     int num_calls)
 {
-    (void) id;
     (void) num_calls;
-
-    switch (param_name) {
-#if defined(cl_khr_device_uuid)
-    case CL_DEVICE_UUID_KHR:
-    case CL_DRIVER_UUID_KHR:
-    {
-        if (param_value_size == CL_UUID_SIZE_KHR && param_value) {
-            cl_uchar* pUUID = static_cast<cl_uchar*>(param_value);
-            cl_uchar start =
-                (param_name == CL_DEVICE_UUID_KHR) ? 1 :
-                (param_name == CL_DRIVER_UUID_KHR) ? 2 :
-                0;
-            for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
-                pUUID[i] = i + start;
-            }
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = CL_UUID_SIZE_KHR;
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_LUID_VALID_KHR:
-    {
-        if (param_value_size == sizeof(cl_bool) && param_value) {
-            *static_cast<cl_bool*>(param_value) = CL_TRUE;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_bool);
-        }
-        return CL_SUCCESS;
-    }
-    case CL_DEVICE_LUID_KHR:
-    {
-        if (param_value_size == CL_LUID_SIZE_KHR && param_value) {
-            cl_uchar* pLUID = static_cast<cl_uchar*>(param_value);
-            cl_uchar start = 3;
-            for (int i = 0; i < CL_LUID_SIZE_KHR; i++) {
-                pLUID[i] = i + start;
-            }
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = CL_LUID_SIZE_KHR;
-        }
-        return CL_SUCCESS;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    if (param_name == CL_QUEUE_PROPERTIES) {
+        TEST_ASSERT_EQUAL(sizeof(cl_command_queue_properties), param_value_size);
+        *static_cast<cl_command_queue_properties *>(param_value) = 0;
     }
-    case CL_DEVICE_NODE_MASK_KHR:
-    {
-        if (param_value_size == sizeof(cl_uint) && param_value) {
-            *static_cast<cl_uint*>(param_value) = 0xA5A5;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_uint);
-        }
-        return CL_SUCCESS;
+    else {
+        TEST_ASSERT_EQUAL_HEX(CL_QUEUE_CONTEXT, param_name);
+        TEST_ASSERT_EQUAL(sizeof(cl_context), param_value_size);
+        *static_cast<cl_context *>(param_value) = make_context(0);
     }
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = param_value_size;
+    return CL_SUCCESS;
+}
+
+static cl_event clCreateUserEvent_commandBufferCapture(
+    cl_context context,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL_PTR(make_context(0), context);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_event(num_calls);
+}
+
+static cl_event clCreateUserEvent_commandBufferCaptureFailure(
+    cl_context context,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    (void) context;
+    (void) num_calls;
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_OUT_OF_HOST_MEMORY;
+    return nullptr;
+}
+
+static int commandBufferCaptureKernels;
+
+static cl_int clCommandNDRangeKernelKHR_commandBufferCapture(
+    cl_command_buffer_khr command_buffer,
+    cl_command_queue command_queue,
+    const cl_ndrange_kernel_command_properties_khr *properties,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_sync_points_in_wait_list,
+    const cl_sync_point_khr *sync_point_wait_list,
+    cl_sync_point_khr *sync_point,
+    cl_mutable_command_khr *mutable_handle,
+    int num_calls)
+{
+    (void) properties;
+    (void) num_calls;
+    commandBufferCaptureKernels++;
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_NULL(command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(1, work_dim);
+    TEST_ASSERT_NULL(global_work_offset);
+    TEST_ASSERT_EQUAL(64, global_work_size[0]);
+    TEST_ASSERT_NULL(local_work_size);
+    TEST_ASSERT_EQUAL(0, num_sync_points_in_wait_list);
+    TEST_ASSERT_NULL(sync_point_wait_list);
+    TEST_ASSERT_NULL(mutable_handle);
+    *sync_point = 1;
+    return CL_SUCCESS;
+}
+
+static cl_int clCommandCopyBufferKHR_commandBufferCapture(
+    cl_command_buffer_khr command_buffer,
+    cl_command_queue command_queue,
+    cl_mem src_buffer,
+    cl_mem dst_buffer,
+    size_t src_offset,
+    size_t dst_offset,
+    size_t size,
+    cl_uint num_sync_points_in_wait_list,
+    const cl_sync_point_khr *sync_point_wait_list,
+    cl_sync_point_khr *sync_point,
+    cl_mutable_command_khr *mutable_handle,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_NULL(command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_mem(0), src_buffer);
+    TEST_ASSERT_EQUAL_PTR(make_mem(1), dst_buffer);
+    TEST_ASSERT_EQUAL(0, src_offset);
+    TEST_ASSERT_EQUAL(0, dst_offset);
+    TEST_ASSERT_EQUAL(16, size);
+    // The kernel event, which is also the previous command
+    TEST_ASSERT_EQUAL(1, num_sync_points_in_wait_list);
+    TEST_ASSERT_EQUAL(1, sync_point_wait_list[0]);
+    TEST_ASSERT_NULL(mutable_handle);
+    *sync_point = 2;
+    return CL_SUCCESS;
+}
+
+static cl_int clCommandBarrierWithWaitListKHR_commandBufferCapture(
+    cl_command_buffer_khr command_buffer,
+    cl_command_queue command_queue,
+    cl_uint num_sync_points_in_wait_list,
+    const cl_sync_point_khr *sync_point_wait_list,
+    cl_sync_point_khr *sync_point,
+    cl_mutable_command_khr *mutable_handle,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_NULL(command_queue);
+    // An empty wait list waits for everything recorded before
+    TEST_ASSERT_EQUAL(2, num_sync_points_in_wait_list);
+    TEST_ASSERT_EQUAL(1, sync_point_wait_list[0]);
+    TEST_ASSERT_EQUAL(2, sync_point_wait_list[1]);
+    TEST_ASSERT_NULL(mutable_handle);
+    *sync_point = 3;
+    return CL_SUCCESS;
+}
 #endif
-#if defined(cl_khr_pci_bus_info)
-    case CL_DEVICE_PCI_BUS_INFO_KHR:
+
+void testCommandBufferCapture(void)
+{
+#if defined(cl_khr_command_buffer) && CL_HPP_TARGET_OPENCL_VERSION >= 120
+    cl::pfn_clCommandNDRangeKernelKHR = ::clCommandNDRangeKernelKHR;
+    cl::pfn_clCommandCopyBufferKHR = ::clCommandCopyBufferKHR;
+    cl::pfn_clCommandBarrierWithWaitListKHR = ::clCommandBarrierWithWaitListKHR;
+    cl::pfn_clEnqueueCommandBufferKHR = ::clEnqueueCommandBufferKHR;
+
+    clRetainCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_commandBufferCapture);
+    clReleaseCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_commandBufferCapture);
+    clRetainContext_StubWithCallback(clRetainContext_commandBufferCapture);
+    clReleaseContext_StubWithCallback(clRetainContext_commandBufferCapture);
+    clRetainEvent_StubWithCallback(clRetainEvent_commandBufferCapture);
+    clReleaseEvent_StubWithCallback(clRetainEvent_commandBufferCapture);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_commandBufferCapture);
+    clCreateUserEvent_StubWithCallback(clCreateUserEvent_commandBufferCapture);
+    clCommandNDRangeKernelKHR_StubWithCallback(clCommandNDRangeKernelKHR_commandBufferCapture);
+    clCommandCopyBufferKHR_StubWithCallback(clCommandCopyBufferKHR_commandBufferCapture);
+    clCommandBarrierWithWaitListKHR_StubWithCallback(clCommandBarrierWithWaitListKHR_commandBufferCapture);
+
+    commandBufferCaptureKernels = 0;
+    cl::CommandBufferKhr commandBuffer;
     {
-        if (param_value_size == sizeof(cl_device_pci_bus_info_khr) && param_value) {
-            cl_device_pci_bus_info_khr* pInfo = static_cast<cl_device_pci_bus_info_khr*>(param_value);
-            pInfo->pci_domain = 0x11;
-            pInfo->pci_bus = 0x22;
-            pInfo->pci_device = 0x33;
-            pInfo->pci_function = 0x44;
-        }
-        if (param_value_size_ret) {
-            *param_value_size_ret = sizeof(cl_device_pci_bus_info_khr);
+        cl::CommandBufferCapture capture(commandQueuePool[0], commandBufferKhrPool[0]);
+        TEST_ASSERT_TRUE(capture.isActive());
+
+        cl::Event kernelEvent;
+        TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueNDRangeKernel(
+            kernelPool[0], cl::NullRange, cl::NDRange(64), cl::NullRange,
+            cl::EventWaitList(), &kernelEvent));
+        TEST_ASSERT_EQUAL_PTR(make_event(0), kernelEvent());
+        TEST_ASSERT_EQUAL(1, commandBufferCaptureKernels);
+
+#if !defined(CL_HPP_ENABLE_EXCEPTIONS)
+        // Commands that cannot be recorded would overtake the recorded ones
+        int data;
+        TEST_ASSERT_EQUAL(CL_INVALID_OPERATION, commandQueuePool[0].enqueueReadBuffer(
+            bufferPool[0], CL_FALSE, 0, sizeof(data), &data));
+        cl_int mapErr;
+        TEST_ASSERT_NULL(commandQueuePool[0].enqueueMapBuffer(
+            bufferPool[0], CL_FALSE, CL_MAP_READ, 0, sizeof(data), nullptr, nullptr, &mapErr));
+        TEST_ASSERT_EQUAL(CL_INVALID_OPERATION, mapErr);
+
+        // A placeholder only completes when the capture ends
+        TEST_ASSERT_EQUAL(CL_INVALID_OPERATION, kernelEvent.wait());
+        cl::vector<cl::Event> waitEvents(1, kernelEvent);
+        TEST_ASSERT_EQUAL(CL_INVALID_OPERATION, cl::WaitForEvents(waitEvents));
+
+        // Nothing is recorded when the placeholder cannot be created
+        clCreateUserEvent_StubWithCallback(clCreateUserEvent_commandBufferCaptureFailure);
+        cl::Event failedEvent;
+        TEST_ASSERT_EQUAL(CL_OUT_OF_HOST_MEMORY, commandQueuePool[0].enqueueNDRangeKernel(
+            kernelPool[0], cl::NullRange, cl::NDRange(64), cl::NullRange,
+            cl::EventWaitList(), &failedEvent));
+        TEST_ASSERT_EQUAL(1, commandBufferCaptureKernels);
+        TEST_ASSERT_NULL(failedEvent());
+#endif
+
+        // Any wrapper of the captured queue is recorded
+        clRetainCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+        clReleaseCommandQueue_ExpectAndReturn(make_command_queue(0), CL_SUCCESS);
+        {
+            cl::CommandQueue queue = commandQueuePool[0];
+            TEST_ASSERT_EQUAL(CL_SUCCESS, queue.enqueueCopyBuffer(
+                bufferPool[0], bufferPool[1], 0, 0, 16, cl::EventWaitList(kernelEvent)));
         }
-        return CL_SUCCESS;
+
+        TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueBarrierWithWaitList());
+
+        clSetUserEventStatus_ExpectAndReturn(make_event(0), CL_COMPLETE, CL_SUCCESS);
+        clFinalizeCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(0), CL_SUCCESS);
+        cl_int err;
+        commandBuffer = capture.end(&err);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, err);
+        TEST_ASSERT_FALSE(capture.isActive());
+        TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), commandBuffer());
     }
+
+    // Enqueued directly once the capture has ended
+    clEnqueueBarrierWithWaitList_ExpectAndReturn(
+        make_command_queue(0), 0, nullptr, nullptr, CL_SUCCESS);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, commandQueuePool[0].enqueueBarrierWithWaitList());
+
+    clEnqueueCommandBufferKHR_ExpectAndReturn(
+        0, nullptr, make_command_buffer_khr(0), 0, nullptr, nullptr, CL_SUCCESS);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, commandBuffer.enqueueCommandBuffer());
+
+    cl::pfn_clCommandNDRangeKernelKHR = nullptr;
+    cl::pfn_clCommandCopyBufferKHR = nullptr;
+    cl::pfn_clCommandBarrierWithWaitListKHR = nullptr;
+    cl::pfn_clEnqueueCommandBufferKHR = nullptr;
 #endif
-    default: break;
-    }
-    TEST_FAIL();
-    return CL_INVALID_OPERATION;
 }
 
-void testDeviceUUID_KHR(void)
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+static cl_mutable_dispatch_fields_khr launchCacheFields;
+
+static cl_int clRetainObject_launchCache(void *object, int num_calls)
 {
-#if defined(cl_khr_device_uuid)
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
+    (void) object;
+    (void) num_calls;
+    return CL_SUCCESS;
+}
 
-    cl::Device d0(make_device_id(0));
+static cl_int clRetainKernel_launchCache(cl_kernel kernel, int num_calls)
+{
+    return clRetainObject_launchCache(kernel, num_calls);
+}
 
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_uuid_pci_bus_info);
+static cl_int clRetainEvent_launchCache(cl_event event, int num_calls)
+{
+    return clRetainObject_launchCache(event, num_calls);
+}
 
-    std::array<cl_uchar, CL_UUID_SIZE_KHR> dev_uuid = d0.getInfo<CL_DEVICE_UUID_KHR>();
-    for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
-        TEST_ASSERT_EQUAL_UINT8(i + 1, dev_uuid[i]);
-    }
-    std::array<cl_uchar, CL_UUID_SIZE_KHR> drv_uuid = d0.getInfo<CL_DRIVER_UUID_KHR>();
-    for (int i = 0; i < CL_UUID_SIZE_KHR; i++) {
-        TEST_ASSERT_EQUAL_UINT8(i + 2, drv_uuid[i]);
-    }
+static cl_int clRetainCommandQueue_launchCache(cl_command_queue queue, int num_calls)
+{
+    return clRetainObject_launchCache(queue, num_calls);
+}
 
-    cl_bool valid = d0.getInfo<CL_DEVICE_LUID_VALID_KHR>();
-    TEST_ASSERT_EQUAL(CL_TRUE, valid);
-    std::array<cl_uchar, CL_LUID_SIZE_KHR> luid = d0.getInfo<CL_DEVICE_LUID_KHR>();
-    for (int i = 0; i < CL_LUID_SIZE_KHR; i++) {
-        TEST_ASSERT_EQUAL_UINT8(i + 3, luid[i]);
+static cl_int clRetainMemObject_launchCache(cl_mem memobj, int num_calls)
+{
+    return clRetainObject_launchCache(memobj, num_calls);
+}
+
+static cl_int clRetainCommandBufferKHR_launchCache(
+    cl_command_buffer_khr command_buffer,
+    int num_calls)
+{
+    return clRetainObject_launchCache(command_buffer, num_calls);
+}
+
+static cl_int clGetCommandQueueInfo_launchCache(
+    cl_command_queue command_queue,
+    cl_command_queue_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_HEX(CL_QUEUE_DEVICE, param_name);
+    TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_device_id));
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = sizeof(cl_device_id);
+    if (param_value != nullptr)
+        *static_cast<cl_device_id *>(param_value) = make_device_id(0);
+    return CL_SUCCESS;
+}
+
+static cl_int clGetDeviceInfo_launchCache(
+    cl_device_id device,
+    cl_device_info param_name,
+    size_t param_value_size,
+    void *param_value,
+    size_t *param_value_size_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL_PTR(make_device_id(0), device);
+    switch (param_name) {
+    case CL_DEVICE_MUTABLE_DISPATCH_CAPABILITIES_KHR:
+        TEST_ASSERT_EQUAL(sizeof(cl_mutable_dispatch_fields_khr), param_value_size);
+        *static_cast<cl_mutable_dispatch_fields_khr *>(param_value) = launchCacheFields;
+        break;
+    case CL_DEVICE_COMMAND_BUFFER_CAPABILITIES_KHR:
+        // No simultaneous use
+        TEST_ASSERT_EQUAL(sizeof(cl_device_command_buffer_capabilities_khr), param_value_size);
+        *static_cast<cl_device_command_buffer_capabilities_khr *>(param_value) = 0;
+        break;
+    default:
+        // Queried to find the platform of new command buffers
+        return clGetDeviceInfo_platform(
+            device, param_name, param_value_size, param_value, param_value_size_ret, num_calls);
     }
+    if (param_value_size_ret != nullptr)
+        *param_value_size_ret = param_value_size;
+    return CL_SUCCESS;
+}
 
-    cl_uint nodeMask = d0.getInfo<CL_DEVICE_NODE_MASK_KHR>();
-    TEST_ASSERT_EQUAL(0xA5A5, nodeMask);
-#endif
+static cl_command_buffer_khr clCreateCommandBufferKHR_launchCache(
+    cl_uint num_queues,
+    const cl_command_queue *queues,
+    const cl_command_buffer_properties_khr *properties,
+    cl_int *errcode_ret,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL(1, num_queues);
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), queues[0]);
+    TEST_ASSERT_EQUAL(CL_COMMAND_BUFFER_FLAGS_KHR, properties[0]);
+    TEST_ASSERT_EQUAL(CL_COMMAND_BUFFER_MUTABLE_KHR, properties[1]);
+    TEST_ASSERT_EQUAL(0, properties[2]);
+    if (errcode_ret != nullptr)
+        *errcode_ret = CL_SUCCESS;
+    return make_command_buffer_khr(0);
 }
 
-void testDevicePCIBusInfo_KHR(void)
+static cl_int clCommandNDRangeKernelKHR_launchCache(
+    cl_command_buffer_khr command_buffer,
+    cl_command_queue command_queue,
+    const cl_ndrange_kernel_command_properties_khr *properties,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_sync_points_in_wait_list,
+    const cl_sync_point_khr *sync_point_wait_list,
+    cl_sync_point_khr *sync_point,
+    cl_mutable_command_khr *mutable_handle,
+    int num_calls)
 {
-#if defined(cl_khr_pci_bus_info)
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_platform);
-    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_2_0);
-    clReleaseDevice_ExpectAndReturn(make_device_id(0), CL_SUCCESS);
-
-    cl::Device d0(make_device_id(0));
+    (void) command_queue;
+    (void) sync_point_wait_list;
+    (void) sync_point;
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL(CL_MUTABLE_DISPATCH_UPDATABLE_FIELDS_KHR, properties[0]);
+    TEST_ASSERT_EQUAL(CL_MUTABLE_DISPATCH_ARGUMENTS_KHR | CL_MUTABLE_DISPATCH_GLOBAL_SIZE_KHR, properties[1]);
+    TEST_ASSERT_EQUAL(0, properties[2]);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(1, work_dim);
+    TEST_ASSERT_NULL(global_work_offset);
+    TEST_ASSERT_EQUAL(64, global_work_size[0]);
+    TEST_ASSERT_NULL(local_work_size);
+    TEST_ASSERT_EQUAL(0, num_sync_points_in_wait_list);
+    TEST_ASSERT_NOT_NULL(mutable_handle);
+    *mutable_handle = (cl_mutable_command_khr) 0x4d4d4d4d;
+    return CL_SUCCESS;
+}
 
-    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_uuid_pci_bus_info);
+static cl_int clUpdateMutableCommandsKHR_launchCache(
+    cl_command_buffer_khr command_buffer,
+    const cl_mutable_base_config_khr *mutable_config,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL(CL_STRUCTURE_TYPE_MUTABLE_BASE_CONFIG_KHR, mutable_config->type);
+    TEST_ASSERT_EQUAL(1, mutable_config->num_mutable_dispatch);
+
+    // Only the scalar argument and the global size changed, the buffer is
+    // the same one
+    const cl_mutable_dispatch_config_khr &dispatch = mutable_config->mutable_dispatch_list[0];
+    TEST_ASSERT_EQUAL(CL_STRUCTURE_TYPE_MUTABLE_DISPATCH_CONFIG_KHR, dispatch.type);
+    TEST_ASSERT_EQUAL_PTR((cl_mutable_command_khr) 0x4d4d4d4d, dispatch.command);
+    TEST_ASSERT_EQUAL(1, dispatch.num_args);
+    TEST_ASSERT_EQUAL(1, dispatch.arg_list[0].arg_index);
+    TEST_ASSERT_EQUAL(sizeof(cl_int), dispatch.arg_list[0].arg_size);
+    TEST_ASSERT_EQUAL(2, *static_cast<const cl_int *>(dispatch.arg_list[0].arg_value));
+    TEST_ASSERT_EQUAL(0, dispatch.num_svm_args);
+    TEST_ASSERT_EQUAL(1, dispatch.work_dim);
+    TEST_ASSERT_NULL(dispatch.global_work_offset);
+    TEST_ASSERT_EQUAL(128, dispatch.global_work_size[0]);
+    TEST_ASSERT_NULL(dispatch.local_work_size);
+    return CL_SUCCESS;
+}
 
-    cl_device_pci_bus_info_khr info = d0.getInfo<CL_DEVICE_PCI_BUS_INFO_KHR>();
-    TEST_ASSERT_EQUAL_HEX(0x11, info.pci_domain);
-    TEST_ASSERT_EQUAL_HEX(0x22, info.pci_bus);
-    TEST_ASSERT_EQUAL_HEX(0x33, info.pci_device);
-    TEST_ASSERT_EQUAL_HEX(0x44, info.pci_function);
-#endif
+static cl_int clEnqueueCommandBufferKHR_launchCache(
+    cl_uint num_queues,
+    cl_command_queue *queues,
+    cl_command_buffer_khr command_buffer,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_queues);
+    TEST_ASSERT_NULL(queues);
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event_wait_list);
+    // Requested even without simultaneous use
+    TEST_ASSERT_NOT_NULL(event);
+    *event = make_event(num_calls);
+    return CL_SUCCESS;
 }
 
-static  cl_int clGetProgramInfo_testProgramGetContext(cl_program program,
-    cl_program_build_info param_name,
+static cl_int clGetEventInfo_launchCache(
+    cl_event event,
+    cl_event_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
-    int /*num_calls*/)
+    int num_calls)
 {
-    TEST_ASSERT_EQUAL_PTR(make_program(0), program);
-    TEST_ASSERT_EQUAL_HEX(CL_PROGRAM_CONTEXT, param_name);
-    TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_context));
+    TEST_ASSERT_EQUAL_PTR(make_event(num_calls), event);
+    TEST_ASSERT_EQUAL_HEX(CL_EVENT_COMMAND_EXECUTION_STATUS, param_name);
+    TEST_ASSERT_EQUAL(sizeof(cl_int), param_value_size);
+    // The first launch has completed, the second is still running
+    *static_cast<cl_int *>(param_value) = num_calls == 0 ? CL_COMPLETE : CL_RUNNING;
     if (param_value_size_ret != nullptr)
-        *param_value_size_ret = sizeof(cl_context);
-    if (param_value != nullptr)
-        *static_cast<cl_context *>(param_value) = make_context(0);
+        *param_value_size_ret = param_value_size;
     return CL_SUCCESS;
 }
 
-static cl_program clLinkProgram_testLinkProgram(cl_context context,
-    cl_uint              num_devices,
-    const cl_device_id * device_list,
-    const char *         options,
-    cl_uint              num_input_programs,
-    const cl_program *   input_programs,
-    void (CL_CALLBACK *  pfn_notify)(cl_program program, void * user_data),
-    void *               user_data,
-    cl_int *             errcode_ret,
-    int                 /*num_calls*/)
+static cl_int clSetKernelArg_launchCache(
+    cl_kernel kernel,
+    cl_uint arg_index,
+    size_t arg_size,
+    const void *arg_value,
+    int num_calls)
 {
-    TEST_ASSERT_EQUAL_PTR(context, make_context(0));
-    TEST_ASSERT_EQUAL(num_devices, 0);
-    TEST_ASSERT_EQUAL(device_list, nullptr);
-    TEST_ASSERT_EQUAL(options, nullptr);
-    TEST_ASSERT_NOT_EQUAL(num_input_programs, 0);
-    for (int i=0; i<(int)num_input_programs; i++)
-        TEST_ASSERT_EQUAL_PTR(input_programs[i], make_program(i));
-    TEST_ASSERT_EQUAL(pfn_notify, nullptr);
-    TEST_ASSERT_EQUAL(user_data, nullptr);
-
-    *errcode_ret = CL_SUCCESS;
-    return make_program(0);
+    (void) arg_value;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(arg_index == 0 ? sizeof(cl_mem) : sizeof(cl_int), arg_size);
+    return CL_SUCCESS;
 }
 
-void testLinkProgram(void)
+static cl_int clEnqueueNDRangeKernel_launchCache(
+    cl_command_queue command_queue,
+    cl_kernel kernel,
+    cl_uint work_dim,
+    const size_t *global_work_offset,
+    const size_t *global_work_size,
+    const size_t *local_work_size,
+    cl_uint num_events_in_wait_list,
+    const cl_event *event_wait_list,
+    cl_event *event,
+    int num_calls)
 {
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-    cl_int errcode;
-    int refcount[] = {1,1};
-
-    // verify if class cl::Program was not modified
-    TEST_ASSERT_EQUAL(sizeof(cl_program), sizeof(cl::Program));
-
-    clGetProgramInfo_StubWithCallback(clGetProgramInfo_testProgramGetContext);
-    clLinkProgram_StubWithCallback(clLinkProgram_testLinkProgram);
-
-    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
-    prepare_programRefcounts(2, reinterpret_cast<cl_program *>(programPool), refcount);
-
-    cl::Program prog = cl::linkProgram(cl::Program(make_program(0)), cl::Program(make_program(1)),
-        nullptr, nullptr, nullptr, &errcode);
-
-    TEST_ASSERT_EQUAL_PTR(prog(), make_program(0));
-    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
-
-    prog() = nullptr;
-#endif
+    (void) global_work_offset;
+    (void) local_work_size;
+    (void) event_wait_list;
+    (void) num_calls;
+    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queue);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(1, work_dim);
+    TEST_ASSERT_EQUAL(64, global_work_size[0]);
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event);
+    return CL_SUCCESS;
 }
+#endif
 
-void testLinkProgramWithVectorProgramInput(void)
-{
-#if CL_HPP_TARGET_OPENCL_VERSION >= 120
-    cl_int errcode;
-    VECTOR_CLASS<cl::Program> prog_vec;
-    std::array<int, ARRAY_SIZE(programPool)> refcount;
-    for (int i=0;i<(int)ARRAY_SIZE(programPool);i++) {
-        prog_vec.push_back(cl::Program(programPool[i]()));
-        refcount[i] = 1;
-    }
+void testKernelLaunchCache(void)
+{
+#if defined(cl_khr_command_buffer_mutable_dispatch)
+    cl::pfn_clCommandNDRangeKernelKHR = ::clCommandNDRangeKernelKHR;
+    cl::pfn_clEnqueueCommandBufferKHR = ::clEnqueueCommandBufferKHR;
+    cl::pfn_clUpdateMutableCommandsKHR = ::clUpdateMutableCommandsKHR;
+    launchCacheFields = CL_MUTABLE_DISPATCH_ARGUMENTS_KHR | CL_MUTABLE_DISPATCH_GLOBAL_SIZE_KHR;
+
+    clRetainKernel_StubWithCallback(clRetainKernel_launchCache);
+    clReleaseKernel_StubWithCallback(clRetainKernel_launchCache);
+    clRetainEvent_StubWithCallback(clRetainEvent_launchCache);
+    clReleaseEvent_StubWithCallback(clRetainEvent_launchCache);
+    clRetainCommandQueue_StubWithCallback(clRetainCommandQueue_launchCache);
+    clReleaseCommandQueue_StubWithCallback(clRetainCommandQueue_launchCache);
+    clRetainMemObject_StubWithCallback(clRetainMemObject_launchCache);
+    clReleaseMemObject_StubWithCallback(clRetainMemObject_launchCache);
+    clRetainCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_launchCache);
+    clReleaseCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_launchCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_launchCache);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_launchCache);
+    clCreateCommandBufferKHR_StubWithCallback(clCreateCommandBufferKHR_launchCache);
+    clCommandNDRangeKernelKHR_StubWithCallback(clCommandNDRangeKernelKHR_launchCache);
+    clUpdateMutableCommandsKHR_StubWithCallback(clUpdateMutableCommandsKHR_launchCache);
+    clEnqueueCommandBufferKHR_StubWithCallback(clEnqueueCommandBufferKHR_launchCache);
+    clGetEventInfo_StubWithCallback(clGetEventInfo_launchCache);
+    clSetKernelArg_StubWithCallback(clSetKernelArg_launchCache);
+    clEnqueueNDRangeKernel_StubWithCallback(clEnqueueNDRangeKernel_launchCache);
 
-    // verify if class cl::Program was not modified
-    TEST_ASSERT_EQUAL(sizeof(cl_program), sizeof(cl::Program));
+    {
+        cl::KernelLaunchCache<cl::Buffer, cl_int> cache(kernelPool[0]);
 
-    clGetProgramInfo_StubWithCallback(clGetProgramInfo_testProgramGetContext);
-    clLinkProgram_StubWithCallback(clLinkProgram_testLinkProgram);
-    prepare_programRefcounts(prog_vec.size(), reinterpret_cast<cl_program *>(prog_vec.data()), refcount.data());
+        // Recorded
+        clFinalizeCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(0), CL_SUCCESS);
+        cl::Event event = cache(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(64)), bufferPool[0], 1);
+        TEST_ASSERT_EQUAL_PTR(make_event(0), event());
 
-    clRetainContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
-    clReleaseContext_ExpectAndReturn(make_context(0), CL_SUCCESS);
+        // Updated, as the first execution has completed
+        TEST_ASSERT_EQUAL(CL_SUCCESS, cache.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(128)), bufferPool[0], 2));
 
-    cl::Program prog = linkProgram(prog_vec, nullptr, nullptr, nullptr, &errcode);
+        // Enqueued directly, as the second execution is still running
+        TEST_ASSERT_EQUAL(CL_SUCCESS, cache.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(64)), bufferPool[0], 2));
+    }
 
-    TEST_ASSERT_EQUAL_PTR(prog(), make_program(0));
-    TEST_ASSERT_EQUAL(errcode, CL_SUCCESS);
+    {
+        // Enqueued directly, as the device cannot update arguments
+        launchCacheFields = CL_MUTABLE_DISPATCH_GLOBAL_SIZE_KHR;
+        cl::KernelLaunchCache<cl::Buffer, cl_int> cache(kernelPool[0]);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, cache.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(64)), bufferPool[0], 1));
+    }
 
-    prog() = nullptr;
+    cl::pfn_clCommandNDRangeKernelKHR = nullptr;
+    cl::pfn_clEnqueueCommandBufferKHR = nullptr;
+    cl::pfn_clUpdateMutableCommandsKHR = nullptr;
 #endif
 }
 
-/****************************************************************************
- * Tests for cl::CommandBufferKhr
- ****************************************************************************/
-#if defined(cl_khr_command_buffer)
-void testMoveAssignCommandBufferKhrNonNull(void);
-void testMoveAssignCommandBufferKhrNull(void);
-void testMoveConstructCommandBufferKhrNonNull(void);
-void testMoveConstructCommandBufferKhrNull(void);
-MAKE_MOVE_TESTS(CommandBufferKhr, make_command_buffer_khr, clReleaseCommandBufferKHR, commandBufferKhrPool)
-#else
-void testMoveAssignCommandBufferKhrNonNull(void) {}
-void testMoveAssignCommandBufferKhrNull(void) {}
-void testMoveConstructCommandBufferKhrNonNull(void) {}
-void testMoveConstructCommandBufferKhrNull(void) {}
-#endif
+#if defined(cl_khr_command_buffer_mutable_dispatch) && CL_HPP_TARGET_OPENCL_VERSION >= 200
+static int launchCacheSVMData[2];
 
-// Stub for clGetCommandBufferInfoKHR that returns 1
-static cl_int clGetCommandBufferInfoKHR_testCommandBufferKhrGetNumQueues(
-    cl_command_buffer_khr command_buffer,
-    cl_command_buffer_info_khr param_name,
-    size_t param_value_size,
-    void *param_value,
-    size_t *param_value_size_ret,
-    int /*num_calls*/)
+static cl_int clSetKernelArgSVMPointer_launchCacheSVM(
+    cl_kernel kernel,
+    cl_uint arg_index,
+    const void *arg_value,
+    int num_calls)
 {
-    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
-    TEST_ASSERT_EQUAL_HEX(CL_COMMAND_BUFFER_NUM_QUEUES_KHR, param_name);
-    TEST_ASSERT(param_value == nullptr || param_value_size >= sizeof(cl_uint));
-    if (param_value_size_ret != nullptr)
-        *param_value_size_ret = sizeof(cl_uint);
-    if (param_value != nullptr)
-        *static_cast<cl_uint *> (param_value) = 1;
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(0, arg_index);
+    TEST_ASSERT_EQUAL_PTR(&launchCacheSVMData[0], arg_value);
     return CL_SUCCESS;
 }
 
-void testCommandBufferInfoKHRNumQueues(void)
+static cl_int clSetKernelArg_launchCacheSVM(
+    cl_kernel kernel,
+    cl_uint arg_index,
+    size_t arg_size,
+    const void *arg_value,
+    int num_calls)
 {
-#if defined(cl_khr_command_buffer)
-    cl_uint expected = 1;
-
-    clGetCommandBufferInfoKHR_StubWithCallback(clGetCommandBufferInfoKHR_testCommandBufferKhrGetNumQueues);
-
-    cl_uint num = commandBufferKhrPool[0].getInfo<CL_COMMAND_BUFFER_NUM_QUEUES_KHR>();
-    TEST_ASSERT_EQUAL_HEX(expected, num);
-#endif
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_kernel(0), kernel);
+    TEST_ASSERT_EQUAL(1, arg_index);
+    TEST_ASSERT_EQUAL(sizeof(cl_int), arg_size);
+    TEST_ASSERT_EQUAL(1, *static_cast<const cl_int *>(arg_value));
+    return CL_SUCCESS;
 }
 
-// Stub for clGetCommandBufferInfoKHR that returns command queues array
-static cl_int clGetCommandBufferInfoKHR_testCommandBufferKhrGetCommandQueues(
+static cl_int clUpdateMutableCommandsKHR_launchCacheSVM(
     cl_command_buffer_khr command_buffer,
-    cl_command_buffer_info_khr param_name,
+    const cl_mutable_base_config_khr *mutable_config,
+    int num_calls)
+{
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
+    TEST_ASSERT_EQUAL(1, mutable_config->num_mutable_dispatch);
+
+    // The SVM pointer is patched as such, the unchanged scalar is not
+    const cl_mutable_dispatch_config_khr &dispatch = mutable_config->mutable_dispatch_list[0];
+    TEST_ASSERT_EQUAL(0, dispatch.num_args);
+    TEST_ASSERT_NULL(dispatch.arg_list);
+    TEST_ASSERT_EQUAL(1, dispatch.num_svm_args);
+    TEST_ASSERT_EQUAL(0, dispatch.arg_svm_list[0].arg_index);
+    TEST_ASSERT_EQUAL_PTR(&launchCacheSVMData[1], dispatch.arg_svm_list[0].arg_value);
+    TEST_ASSERT_NULL(dispatch.global_work_size);
+    return CL_SUCCESS;
+}
+
+static cl_int clGetEventInfo_launchCacheSVM(
+    cl_event event,
+    cl_event_info param_name,
     size_t param_value_size,
     void *param_value,
     size_t *param_value_size_ret,
-    int /*num_calls*/)
+    int num_calls)
 {
-    TEST_ASSERT_EQUAL_PTR(make_command_buffer_khr(0), command_buffer);
-    TEST_ASSERT_EQUAL_HEX(CL_COMMAND_BUFFER_QUEUES_KHR, param_name);
-    TEST_ASSERT(param_value == nullptr || param_value_size >= 3 * sizeof(cl_command_queue));
+    (void) event;
+    (void) param_name;
+    (void) num_calls;
+    *static_cast<cl_int *>(param_value) = CL_COMPLETE;
     if (param_value_size_ret != nullptr)
-        *param_value_size_ret = 3 * sizeof(cl_command_queue);
-    if (param_value != nullptr)
-    {
-        cl_command_queue *command_queues = static_cast<cl_command_queue *> (param_value);
-        command_queues[0] = make_command_queue(0);
-        command_queues[1] = make_command_queue(1);
-        command_queues[2] = make_command_queue(2);
-    }
+        *param_value_size_ret = param_value_size;
     return CL_SUCCESS;
 }
+#endif
 
-void testCommandBufferInfoKHRCommandQueues(void)
-{
-#if defined(cl_khr_command_buffer)
-    // creat expected values for refcounter
-    VECTOR_CLASS<cl_command_queue> expected_queue_vec;
-    std::array<int, 3> refcount;
-    for (int i=0;i<3;i++) {
-        expected_queue_vec.push_back(commandQueuePool[i]());
-        refcount[i] = 1;
-    }
+void testKernelLaunchCacheSVMPointer(void)
+{
+#if defined(cl_khr_command_buffer_mutable_dispatch) && CL_HPP_TARGET_OPENCL_VERSION >= 200
+    cl::pfn_clCommandNDRangeKernelKHR = ::clCommandNDRangeKernelKHR;
+    cl::pfn_clEnqueueCommandBufferKHR = ::clEnqueueCommandBufferKHR;
+    cl::pfn_clUpdateMutableCommandsKHR = ::clUpdateMutableCommandsKHR;
+    launchCacheFields = CL_MUTABLE_DISPATCH_ARGUMENTS_KHR | CL_MUTABLE_DISPATCH_GLOBAL_SIZE_KHR;
+
+    clRetainKernel_StubWithCallback(clRetainKernel_launchCache);
+    clReleaseKernel_StubWithCallback(clRetainKernel_launchCache);
+    clRetainEvent_StubWithCallback(clRetainEvent_launchCache);
+    clReleaseEvent_StubWithCallback(clRetainEvent_launchCache);
+    clRetainCommandQueue_StubWithCallback(clRetainCommandQueue_launchCache);
+    clReleaseCommandQueue_StubWithCallback(clRetainCommandQueue_launchCache);
+    clRetainCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_launchCache);
+    clReleaseCommandBufferKHR_StubWithCallback(clRetainCommandBufferKHR_launchCache);
+    clGetPlatformInfo_StubWithCallback(clGetPlatformInfo_version_1_1);
+    clGetCommandQueueInfo_StubWithCallback(clGetCommandQueueInfo_launchCache);
+    clGetDeviceInfo_StubWithCallback(clGetDeviceInfo_launchCache);
+    clCreateCommandBufferKHR_StubWithCallback(clCreateCommandBufferKHR_launchCache);
+    clCommandNDRangeKernelKHR_StubWithCallback(clCommandNDRangeKernelKHR_launchCache);
+    clUpdateMutableCommandsKHR_StubWithCallback(clUpdateMutableCommandsKHR_launchCacheSVM);
+    clEnqueueCommandBufferKHR_StubWithCallback(clEnqueueCommandBufferKHR_launchCache);
+    clGetEventInfo_StubWithCallback(clGetEventInfo_launchCacheSVM);
+    clSetKernelArgSVMPointer_StubWithCallback(clSetKernelArgSVMPointer_launchCacheSVM);
+    clSetKernelArg_StubWithCallback(clSetKernelArg_launchCacheSVM);
 
-    clGetCommandBufferInfoKHR_StubWithCallback(clGetCommandBufferInfoKHR_testCommandBufferKhrGetCommandQueues);
-    prepare_commandQueueRefcounts(expected_queue_vec.size(), expected_queue_vec.data(), refcount.data());
+    {
+        cl::KernelLaunchCache<int*, cl_int> cache(kernelPool[0]);
 
-    VECTOR_CLASS<cl::CommandQueue> command_queues = commandBufferKhrPool[0].getInfo<CL_COMMAND_BUFFER_QUEUES_KHR>();
-    TEST_ASSERT_EQUAL(3, command_queues.size());
-    TEST_ASSERT_EQUAL_PTR(make_command_queue(0), command_queues[0]());
-    TEST_ASSERT_EQUAL_PTR(make_command_queue(1), command_queues[1]());
-    TEST_ASSERT_EQUAL_PTR(make_command_queue(2), command_queues[2]());
+        clFinalizeCommandBufferKHR_ExpectAndReturn(make_command_buffer_khr(0), CL_SUCCESS);
+        TEST_ASSERT_EQUAL(CL_SUCCESS, cache.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(64)), &launchCacheSVMData[0], 1));
+        TEST_ASSERT_EQUAL(CL_SUCCESS, cache.enqueue(
+            cl::EnqueueArgs(commandQueuePool[0], cl::NDRange(64)), &launchCacheSVMData[1], 1));
+    }
+
+    cl::pfn_clCommandNDRangeKernelKHR = nullptr;
+    cl::pfn_clEnqueueCommandBufferKHR = nullptr;
+    cl::pfn_clUpdateMutableCommandsKHR = nullptr;
 #endif
 }
 
@@ -3606,6 +8119,50 @@ void testEnqueueSignalSemaphores(void)
     sema_objects[0]() = nullptr;
 }
 
+static cl_int clEnqueueSignalSemaphoresKHR_testManySemaphores(
+    cl_command_queue command_queue,
+    cl_uint num_sema_objects,
+    const cl_semaphore_khr* sema_objects,
+    const cl_semaphore_payload_khr* sema_payload_list,
+    cl_uint num_events_in_wait_list,
+    const cl_event* event_wait_list,
+    cl_event* event,
+    int num_calls)
+{
+    (void) sema_payload_list;
+    (void) event_wait_list;
+
+    TEST_ASSERT_EQUAL(0, num_calls);
+    TEST_ASSERT_EQUAL_PTR(commandQueuePool[1](), command_queue);
+    TEST_ASSERT_EQUAL(12, num_sema_objects);
+    for (int i = 0; i < 12; i++) {
+        TEST_ASSERT_EQUAL_PTR(make_semaphore_khr(i), sema_objects[i]);
+    }
+    TEST_ASSERT_EQUAL(0, num_events_in_wait_list);
+    TEST_ASSERT_NULL(event);
+    return CL_SUCCESS;
+}
+
+// More semaphores than fit in the inline storage of the handle list
+void testEnqueueSignalManySemaphores(void)
+{
+    clEnqueueSignalSemaphoresKHR_StubWithCallback(clEnqueueSignalSemaphoresKHR_testManySemaphores);
+
+    VECTOR_CLASS<cl::Semaphore> sema_objects;
+    for (int i = 0; i < 12; i++) {
+        sema_objects.emplace_back(make_semaphore_khr(i));
+    }
+    VECTOR_CLASS<cl_semaphore_payload_khr> sema_payloads(12);
+
+    cl_int status = commandQueuePool[1].enqueueSignalSemaphores(sema_objects, sema_payloads);
+    TEST_ASSERT_EQUAL(CL_SUCCESS, status);
+
+    // prevent destructor from interfering with the test
+    for (cl::Semaphore &semaphore : sema_objects) {
+        semaphore() = nullptr;
+    }
+}
+
 cl_semaphore_khr clCreateSemaphoreWithProperties_testSemaphoreWithProperties(
     cl_context context,
     const cl_semaphore_properties_khr* sema_props,
@@ -3872,6 +8429,7 @@ void testSemaphoreRelease(void)
 #else
 void testEnqueueWaitSemaphores(void) {}
 void testEnqueueSignalSemaphores(void) {}
+void testEnqueueSignalManySemaphores(void) {}
 void testSemaphoreWithProperties(void) {}
 void testSemaphoreGetInfoContext(void) {}
 void testSemaphoreGetInfoReferenceCount(void) {}